@@ -13,7 +13,8 @@
 
 Area::Area(QWidget *parent) :
     QAbstractScrollArea(parent),
-    ignoreScrolls(false)
+    ignoreScrolls(false),
+    sceneValid(false)
 {
     setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
@@ -43,21 +44,120 @@ bool Area::event(QEvent * ev)
     return QAbstractScrollArea::event(ev);
 }
 
-void Area::paintEvent(QPaintEvent*)
+/*----------------------------------------------------------------------*/
+/* Drawing is split into the page itself ("scene"), which is retained	*/
+/* in a pixmap and redrawn only where it has been invalidated, and the	*/
+/* overlays (selection, netlist highlight, pending elements), which	*/
+/* are cheap and drawn fresh on every repaint.				*/
+/*----------------------------------------------------------------------*/
+
+void Area::invalidate()
 {
-    QPainter p(viewport());
+    sceneValid = false;
+    sceneDirty = QRegion();
+}
+
+void Area::invalidate(const QRect & r)
+{
+    if (sceneValid) sceneDirty += r.intersected(viewport()->rect());
+    viewport()->update(r);
+}
+
+/*----------------------------------------------------------------------*/
+/* Summarize the window state which affects the scene but which is not	*/
+/* otherwise tracked, so that a change forces a full redraw.		*/
+/*----------------------------------------------------------------------*/
+
+int Area::sceneMode() const
+{
+    int mode = 0;
+
+    switch (eventmode) {
+       case CATALOG_MODE:
+          mode = xobjs.showtech ? 1 : 2;
+          break;
+       case CATTEXT_MODE:
+          mode = 3;
+          break;
+       case ASSOC_MODE: case FONTCAT_MODE: case EFONTCAT_MODE: case CATMOVE_MODE:
+          mode = 1;
+          break;
+       default:
+          break;
+    }
+    if (areawin->gridon) mode |= 0x04;
+    if (areawin->axeson) mode |= 0x08;
+    if (areawin->snapto) mode |= 0x10;
+    if (areawin->bboxon) mode |= 0x20;
+    if (areawin->editinplace) mode |= 0x40;
+    if (areawin->pinpointon) mode |= 0x80;
+    return mode;
+}
+
+/*----------------------------------------------------------------------*/
+/* If the view was only panned, and by a whole number of pixels, shift	*/
+/* the retained scene and mark the uncovered strips dirty.  Returns	*/
+/* false if the scene has to be redrawn completely.			*/
+/*----------------------------------------------------------------------*/
+
+bool Area::sceneScroll()
+{
+    const float eps = 0.05;
+    float fdx, fdy;
+    int dx, dy, w, h;
+
+    if (areawin->pcorner.x == sceneX && areawin->pcorner.y == sceneY) return true;
+
+    fdx = (float)(sceneX - areawin->pcorner.x) * areawin->vscale;
+    fdy = (float)(areawin->pcorner.y - sceneY) * areawin->vscale;
+    dx = qRound(fdx);
+    dy = qRound(fdy);
+    w = areawin->width();
+    h = areawin->height();
+    if (qAbs(fdx - dx) > eps || qAbs(fdy - dy) > eps) return false;
+    if (qAbs(dx) >= w || qAbs(dy) >= h) return false;
+
+    const qreal ratio = scene.devicePixelRatio();
+    scene.scroll(qRound(dx * ratio), qRound(dy * ratio), scene.rect());
+    sceneDirty.translate(dx, dy);
+
+    if (dx > 0) sceneDirty += QRect(0, 0, dx, h);
+    else if (dx < 0) sceneDirty += QRect(w + dx, 0, -dx, h);
+    if (dy > 0) sceneDirty += QRect(0, 0, w, dy);
+    else if (dy < 0) sceneDirty += QRect(0, h + dy, w, -dy);
+
+    sceneX = areawin->pcorner.x;
+    sceneY = areawin->pcorner.y;
+    return true;
+}
+
+/*----------------------------------------------------------------------*/
+/* Redraw the part of the retained scene inside "clip".		*/
+/*----------------------------------------------------------------------*/
+
+void Area::drawScene(const QRect & clip)
+{
+    QPainter p(&scene);
+    p.setClipRect(clip);
     p.setRenderHint(QPainter::Antialiasing, areawin->antialias);
     float x, y, spc, spc2, i, j, fpart;
     XPoint originpt;
     DrawContext c(&p);
-    areawin->markUpdated();
+
+    /* Elements whose bounding box misses the clip rectangle may still	*/
+    /* reach into it with their line width, so cull generously.		*/
+    if (clip != viewport()->rect()) {
+       int margin = 8 + (int)(4.0 * xobjs.pagelist[areawin->page].wirewidth
+			* areawin->vscale);
+       c.setClipRect(clip.adjusted(-margin, -margin, margin, margin));
+    }
 
     if (xobjs.pagelist[areawin->page].background.name != (char *)NULL)
       copybackground(&c);
 
     SetThinLineAttributes(c.gc(), 0, LineSolid, CapRound, JoinBevel);
 
-    p.fillRect(rect(), QColor(BACKGROUND));
+    p.fillRect(clip, QColor(BACKGROUND));
 
     /* draw GRIDCOLOR lines for grid; mark axes in AXESCOLOR */
 
@@ -188,14 +288,66 @@ void Area::paintEvent(QPaintEvent*)
       }
     }
 
-    /* draw all of the elements on the screen */
+    /* draw all of the elements on the screen, on several threads */
 
-    SetForeground(c.gc(), FOREGROUND);
+    tiles_draw(&c, clip);
+}
+
+void Area::paintEvent(QPaintEvent* ev)
+{
+#ifndef QT_NO_DEBUG
+    AllocWatch watch("paint");
+#endif
+    const QRect vrect = viewport()->rect();
+    const qreal ratio = viewport()->devicePixelRatioF();
+    const int mode = sceneMode();
+
+    areawin->markUpdated();
+
+    /* nothing is being drawn:  drop library cells read over the limit */
+    libcache_trim();
 
-    /* Initialize hierstack */
-    pushlistptr hierstack = NULL;
-    UDrawObject(&c, areawin->topinstance, TOPLEVEL, FOREGROUND, &hierstack);
-    free_stack(&hierstack);
+    if (scene.size() != vrect.size() * ratio || scene.devicePixelRatio() != ratio) {
+       scene = QPixmap(vrect.size() * ratio);
+       scene.setDevicePixelRatio(ratio);
+       sceneValid = false;
+    }
+    if (sceneValid && (sceneScale != areawin->vscale || scenePage != areawin->page
+		|| sceneInst != areawin->topinstance || sceneModeKey != mode
+		|| sceneAntialias != areawin->antialias))
+       sceneValid = false;
+    if (sceneValid && !sceneScroll())
+       sceneValid = false;
+
+    if (!sceneValid) {
+       sceneDirty = QRegion();
+       drawScene(vrect);
+       sceneValid = true;
+       sceneScale = areawin->vscale;
+       sceneX = areawin->pcorner.x;
+       sceneY = areawin->pcorner.y;
+       scenePage = areawin->page;
+       sceneInst = areawin->topinstance;
+       sceneModeKey = mode;
+       sceneAntialias = areawin->antialias;
+
+       /* the rest of the window is out of date too */
+       if (ev->rect() != vrect) viewport()->update();
+    }
+    else if (!sceneDirty.isEmpty()) {
+       QRect dirty = sceneDirty.boundingRect().intersected(vrect);
+       sceneDirty = QRegion();
+       if (!dirty.isEmpty()) drawScene(dirty);
+    }
+
+    QPainter p(viewport());
+    p.drawPixmap(0, 0, scene);
+    p.setRenderHint(QPainter::Antialiasing, areawin->antialias);
+    DrawContext c(&p);
+
+    SetForeground(c.gc(), FOREGROUND);
+    SetLineAttributes(c.gc(), c.UTopTransScale(xobjs.pagelist[areawin->page].wirewidth),
+		LineSolid, CapRound, JoinBevel);
 
     /* draw the highlighted netlist, if any */
     if (checkvalid(topobject) != -1)
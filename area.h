@@ -2,6 +2,8 @@
 #define AREA_H
 
 #include <QAbstractScrollArea>
+#include <QPixmap>
+#include <QRegion>
 
 class QPinchGesture;
 
@@ -11,6 +13,9 @@ class Area : public QAbstractScrollArea
 public:
     explicit Area(QWidget *parent = 0);
 
+    void invalidate();
+    void invalidate(const QRect &);
+
 protected:
     bool event(QEvent *);
     void paintEvent(QPaintEvent*);
@@ -32,8 +37,22 @@ protected slots:
     void on_corner_clicked();
 
 private:
+    int sceneMode() const;
+    bool sceneScroll();
+    void drawScene(const QRect &);
+
     bool ignoreScrolls;
     float initialScale;
+
+    /* retained rendering of the page; overlays are drawn on top of it */
+    QPixmap scene;
+    QRegion sceneDirty;
+    bool sceneValid;
+    float sceneScale;
+    int sceneX, sceneY;
+    int scenePage, sceneModeKey;
+    bool sceneAntialias;
+    const void *sceneInst;
 };
 
 #endif // AREA_H
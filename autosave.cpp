@@ -0,0 +1,176 @@
+/*----------------------------------------------------------------------*/
+/* autosave.cpp --- crash recovery file writing off the GUI thread	*/
+/*----------------------------------------------------------------------*/
+
+#include <QHash>
+#include <QPair>
+#include <QSaveFile>
+#include <QThreadPool>
+
+#include <cstdlib>
+
+#include "xcircuit.h"
+#include "prototypes.h"
+#include "autosave.h"
+
+/*----------------------------------------------------------------------*/
+/* Encoded images from the last autosave, keyed by image and name.	*/
+/* Only used on the autosave thread.					*/
+/*----------------------------------------------------------------------*/
+
+typedef QPair<qint64, QByteArray> ImageKey;
+
+static QHash<ImageKey, QByteArray> lastimages, nextimages;
+
+/*----------------------------------------------------------------------*/
+/* Autosaves run one at a time, in order, on a pool of their own	*/
+/*----------------------------------------------------------------------*/
+
+static QThreadPool *autosave_pool()
+{
+   static QThreadPool *pool = NULL;
+
+   if (pool == NULL) {
+      pool = new QThreadPool;
+      pool->setMaxThreadCount(1);
+   }
+   return pool;
+}
+
+Autosave::Autosave(const QString &fname) :
+        fname(fname),
+        text(NULL),
+        textlen(0)
+{
+}
+
+Autosave::~Autosave()
+{
+   free(text);
+}
+
+/*----------------------------------------------------------------------*/
+/* Open the stream that savefile() writes the text to			*/
+/*----------------------------------------------------------------------*/
+
+FILE *Autosave::open()
+{
+#ifdef _WIN32
+   return tmpfile();
+#else
+   return open_memstream(&text, &textlen);
+#endif
+}
+
+/*----------------------------------------------------------------------*/
+/* Note an image to be written at the current position of the text	*/
+/*----------------------------------------------------------------------*/
+
+void Autosave::addimage(FILE *ps, const QImage &image, const char *name)
+{
+   Image img;
+
+   fflush(ps);
+   img.pos = ftell(ps);
+   img.image = image;
+   img.name = name;
+   images.append(img);
+}
+
+/*----------------------------------------------------------------------*/
+/* Finish the text.  The stream is closed.				*/
+/*----------------------------------------------------------------------*/
+
+void Autosave::close(FILE *ps)
+{
+#ifdef _WIN32
+   long len;
+
+   fflush(ps);
+   len = ftell(ps);
+   rewind(ps);
+   text = (char *)malloc(len + 1);
+   textlen = fread(text, 1, len, ps);
+   fclose(ps);
+#else
+   fclose(ps);
+#endif
+}
+
+/*----------------------------------------------------------------------*/
+/* Return the PostScript for an image, reusing the encoding from the	*/
+/* last autosave if the image has not changed since.			*/
+/*----------------------------------------------------------------------*/
+
+QByteArray Autosave::encode(const Image &img)
+{
+   ImageKey key(img.image.cacheKey(), img.name);
+   QByteArray data;
+   FILE *ps;
+
+   if (lastimages.contains(key))
+      data = lastimages.value(key);
+   else if ((ps = tmpfile()) != NULL) {
+      long len;
+
+      printimage(ps, img.image, img.name.constData());
+      fflush(ps);
+      len = ftell(ps);
+      rewind(ps);
+      data.resize(len);
+      data.resize(fread(data.data(), 1, len, ps));
+      fclose(ps);
+   }
+   nextimages.insert(key, data);
+   return data;
+}
+
+/*----------------------------------------------------------------------*/
+/* Write the file (on the autosave thread)				*/
+/*----------------------------------------------------------------------*/
+
+void Autosave::run()
+{
+   QSaveFile out(fname);
+   size_t pos = 0;
+
+   if (!out.open(QIODevice::WriteOnly)) {
+      Fprintf(stderr, "Error writing crash recovery file %s\n",
+		fname.toLocal8Bit().data());
+      return;
+   }
+
+   foreach (const Image &img, images) {
+      out.write(text + pos, img.pos - pos);
+      out.write(encode(img));
+      pos = img.pos;
+   }
+   out.write(text + pos, textlen - pos);
+
+   /* Drop the encodings of images no longer in the file */
+   lastimages.swap(nextimages);
+   nextimages.clear();
+
+   if (!out.commit())
+      Fprintf(stderr, "Error writing crash recovery file %s\n",
+		fname.toLocal8Bit().data());
+}
+
+/*----------------------------------------------------------------------*/
+/* Queue a finished autosave.  The pool deletes it when written.	*/
+/*----------------------------------------------------------------------*/
+
+void autosave_start(Autosave *snapshot)
+{
+   autosave_pool()->start(snapshot);
+}
+
+/*----------------------------------------------------------------------*/
+/* Wait for any autosave in progress, before the crash recovery file	*/
+/* is removed or replaced.						*/
+/*----------------------------------------------------------------------*/
+
+void autosave_wait()
+{
+   autosave_pool()->waitForDone();
+}
@@ -0,0 +1,46 @@
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QRunnable>
+#include <QString>
+#include <QVector>
+
+#include <cstdio>
+
+/*----------------------------------------------------------------------*/
+/* A crash recovery file, written by savefile(ALL_PAGES) into memory	*/
+/* and then to disk on the autosave thread.  The PostScript text is	*/
+/* generated on the GUI thread;  images are only noted at their place	*/
+/* in the text, with a (shared, copy-on-write) copy of the image, and	*/
+/* are encoded by the thread.  The file is replaced atomically, so a	*/
+/* crash during the write leaves the previous backup in place.		*/
+/*----------------------------------------------------------------------*/
+
+class Autosave : public QRunnable {
+public:
+    explicit Autosave(const QString &fname);
+    ~Autosave();
+
+    FILE *open();
+    void addimage(FILE *, const QImage &, const char *name);
+    void close(FILE *);
+    void run();
+
+private:
+    struct Image {
+        long pos;		/* offset of the image in the text */
+        QImage image;
+        QByteArray name;
+    };
+
+    QByteArray encode(const Image &);
+
+    QString fname;
+    char *text;
+    size_t textlen;
+    QVector<Image> images;
+};
+
+#endif // AUTOSAVE_H
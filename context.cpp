@@ -1,8 +1,115 @@
+#include <QPainter>
+
+#ifndef QT_NO_DEBUG
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#endif
+
 #include "context.h"
 #include "matrix.h"
 #include "xctypes.h"
 #include "xcircuit.h"
 #include "prototypes.h"
+#include "xcqt.h"
+
+/*----------------------------------------------------------------------*/
+/* Scratch space for the window coordinates of the element being drawn	*/
+/* and the parts of each object level near the drawing area.  It is	*/
+/* kept (for each drawing thread) from one redraw to the next, so that	*/
+/* once it has grown to the largest element, drawing does not allocate.	*/
+/* A context may be made while another is drawing (a tile, thumbnail	*/
+/* or sprite), so each context takes a block of lists of parts of its	*/
+/* own, one list per level.  Blocks are made on the first nesting that	*/
+/* needs them, kept for reuse and never moved, so the lists of an	*/
+/* outer context stay put while an inner one draws.			*/
+/*----------------------------------------------------------------------*/
+
+static thread_local QVector<XPoint> scratchpoints;
+static thread_local QVector<QPoint> scratchqpoints;
+static thread_local QVector<QVector<int> *> scratchparts;	/* blocks */
+static thread_local int scratchnest = 0;	/* blocks taken by contexts */
+#ifndef QT_NO_DEBUG
+static thread_local int scratchgrown = 0;
+#endif
+
+#ifndef QT_NO_DEBUG
+/*----------------------------------------------------------------------*/
+/* Allocation watch.  In debug builds operator new is replaced by one	*/
+/* that, while an AllocWatch exists, counts the allocations of every	*/
+/* thread that is inside a DrawContext.  Area::paintEvent() watches	*/
+/* each paint:  once the first few have filled the scratch space and	*/
+/* caches, a paint of an unchanged page should count nothing.  Qt	*/
+/* containers take their memory with malloc(), which is not counted;	*/
+/* their growth in the scratch space is counted by scratchgrown.	*/
+/*----------------------------------------------------------------------*/
+
+#define ALLOCWATCH_WARMUP	3	/* paints not reported */
+
+static std::atomic<bool> allocwatching(false);
+static std::atomic<int> allocwatched(0);
+static thread_local int allocdrawing = 0;	/* DrawContexts of the thread */
+
+static inline void *allocwatch_new(size_t size)
+{
+    if ((allocdrawing > 0) && allocwatching.load(std::memory_order_relaxed))
+        allocwatched.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+void *operator new(size_t size)
+{
+    void *ptr = allocwatch_new(size);
+    if (ptr == NULL) throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    void *ptr = allocwatch_new(size);
+    if (ptr == NULL) throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return allocwatch_new(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return allocwatch_new(size);
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { free(ptr); }
+
+AllocWatch::AllocWatch(const char *what) :
+        what(what)
+{
+    allocwatched.store(0);
+    allocwatching.store(true);
+}
+
+AllocWatch::~AllocWatch()
+{
+    static int watches = 0;
+    int count;
+
+    allocwatching.store(false);
+    count = allocwatched.load();
+    if ((++watches > ALLOCWATCH_WARMUP) && (count > 0))
+        qDebug("%s made %d allocations while drawing", what, count);
+}
+#endif
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+DrawMutex drawlock;
+#else
+DrawMutex drawlock(QMutex::Recursive);
+#endif
 
 DrawContext::DrawContext(QPainter * gc, const UIContext * uic) :
         gccolor(0),
@@ -10,30 +117,224 @@ DrawContext::DrawContext(QPainter * gc, const UIContext * uic) :
         gc_(gc),
         ui(uic),
         ownUi(uic == NULL),
-        matStack(new Matrix)
+        matStack(matrices),
+        overflow(0),
+        clip_(0, 0, areawin->width(), areawin->height()),
+        batchstyle(0),
+        batchwidth(0)
 {
     if (ownUi) ui = new UIContext;
     DCTM()->makeWCTM();
+    if (scratchnest == scratchparts.size())
+        scratchparts.append(new QVector<int>[CTM_DEPTH]);
+    partlists = scratchparts[scratchnest++];
+#ifndef QT_NO_DEBUG
+    grown = scratchgrown;
+    allocdrawing++;
+#endif
 }
 
 DrawContext::~DrawContext()
 {
+    flush();
+    scratchnest--;
+#ifndef QT_NO_DEBUG
+    allocdrawing--;
+#endif
     if (ownUi) delete ui;
+#ifndef QT_NO_DEBUG
+    /* After the first few redraws, this should never be seen */
+    if (scratchgrown != grown)
+       qDebug("redraw grew %d scratch buffers", scratchgrown - grown);
+#endif
 }
 
 void DrawContext::setPainter(QPainter * gc)
 {
+    flush();
     gc_ = gc;
 }
 
+void DrawContext::setClipRect(const QRect & r)
+{
+    clip_ = r;
+}
+
+/*----------------------------------------------------------------------*/
+/* Quick check of a window-space bounding box (two opposite corners)	*/
+/* against the area being drawn.					*/
+/*----------------------------------------------------------------------*/
+
+bool DrawContext::visible(const XPoint *bboxout) const
+{
+   u_char xm = (bboxout[0].x < bboxout[1].x) ? 0 : 1;
+   u_char ym = (bboxout[0].y < bboxout[1].y) ? 0 : 1;
+
+   return (bboxout[xm].x < clip_.x() + clip_.width() &&
+	bboxout[ym].y < clip_.y() + clip_.height() &&
+	bboxout[1 - xm].x > clip_.x() && bboxout[1 - ym].y > clip_.y());
+}
+
+/*----------------------------------------------------------------------*/
+/* Push and pop the matrix stack.  A push past the end of the stack	*/
+/* (which the hierarchy limit should prevent) reuses the top matrix.	*/
+/*----------------------------------------------------------------------*/
+
 void DrawContext::UPopCTM()
 {
-    Matrix::pop(matStack);
+    if (overflow > 0)
+        overflow--;
+    else if (matStack == matrices)
+        Wprintf("Matrix stack pop error");
+    else
+        matStack--;
 }
 
 void DrawContext::UPushCTM()
 {
-    Matrix::push(matStack);
+    if (matStack == matrices + CTM_DEPTH - 1) {
+        if (overflow++ == 0) Wprintf("Matrix stack push error");
+        return;
+    }
+    matStack[1] = matStack[0];
+    matStack++;
+}
+
+/*----------------------------------------------------------------------*/
+/* Scratch space for "count" points.  Only one element is drawn at a	*/
+/* time, so the space is good until the next call.			*/
+/*----------------------------------------------------------------------*/
+
+XPoint* DrawContext::points(int count)
+{
+#ifndef QT_NO_DEBUG
+    if (count > scratchpoints.capacity()) scratchgrown++;
+#endif
+    if (count > scratchpoints.size()) scratchpoints.resize(count);
+    return scratchpoints.data();
+}
+
+QPoint* DrawContext::qpoints(int count)
+{
+#ifndef QT_NO_DEBUG
+    if (count > scratchqpoints.capacity()) scratchgrown++;
+#endif
+    if (count > scratchqpoints.size()) scratchqpoints.resize(count);
+    return scratchqpoints.data();
+}
+
+/*----------------------------------------------------------------------*/
+/* Scratch list of parts for the object level at the top of the stack	*/
+/*----------------------------------------------------------------------*/
+
+QVector<int>& DrawContext::parts()
+{
+    QVector<int>& vparts = partlists[depth()];
+
+    vparts.resize(0);
+    return vparts;
+}
+
+/*----------------------------------------------------------------------*/
+/* Add an outline (in window coordinates) to the outlines to be stroked	*/
+/* with the painter's pen, in line style "style" and width "width".	*/
+/* Outlines of the same style are kept in one path until the style	*/
+/* changes or the painter is used for anything else (through gc()),	*/
+/* and are then stroked in one call.					*/
+/*									*/
+/* Outlines were once drawn one segment at a time, and each segment is	*/
+/* still a subpath of its own, so that dashes start over and caps are	*/
+/* drawn at every vertex as before.  The closing segment runs from the	*/
+/* first point to the last, as it did.  Without antialiasing, the	*/
+/* batch covers the same pixels as the segments drawn singly;  with	*/
+/* it, the ends where segments overlap are blended once, not twice.	*/
+/* "xcircuit -checkdraw" compares the two (see setBatching()).		*/
+/*----------------------------------------------------------------------*/
+
+static bool batching = true;	/* false to draw outlines at once */
+
+void DrawContext::setBatching(bool on)
+{
+    batching = on;
+}
+
+void DrawContext::stroke(const XPoint *points, int number, bool closed,
+	short style, int width)
+{
+    int i;
+
+    style &= (DASHED | DOTTED | SQUARECAP);
+    if (!batch.isEmpty() && ((style != batchstyle) || (width != batchwidth)))
+        flush();
+    batchstyle = style;
+    batchwidth = width;
+
+    if (number <= 0) return;
+
+    if (!batching) {
+        if (gc_ == NULL) return;
+        strokepen(style, width);
+        DrawLines(gc_, (XPoint *)points, number);
+        if (closed)
+            gc_->drawLine(points[0].x, points[0].y, points[number - 1].x,
+			points[number - 1].y);
+        return;
+    }
+
+    for (i = 1; i < number; i++) {
+        batch.moveTo(points[i - 1].x, points[i - 1].y);
+        batch.lineTo(points[i].x, points[i].y);
+    }
+    if (closed) {
+        batch.moveTo(points[0].x, points[0].y);
+        batch.lineTo(points[number - 1].x, points[number - 1].y);
+    }
+}
+
+/*----------------------------------------------------------------------*/
+/* Set the painter's pen for outlines of "style" and "width"		*/
+/*----------------------------------------------------------------------*/
+
+void DrawContext::strokepen(short style, int width) const
+{
+    /* dash patterns, in units of the line width */
+    static const QVector<qreal> dashpattern = QVector<qreal>() << 4 << 4;
+    static const QVector<qreal> dotpattern = QVector<qreal>() << 1 << 4;
+
+    if (style & (DASHED | DOTTED)) {
+        XSetLineAttributes(gc_, width, LineOnOffDash, CapButt,
+		(style & SQUARECAP) ? JoinMiter : JoinBevel);
+        QPen pen(gc_->pen());
+        pen.setDashPattern((style & DASHED) ? dashpattern : dotpattern);
+        gc_->setPen(pen);
+    }
+    else
+        XSetLineAttributes(gc_, width, LineSolid,
+		(style & SQUARECAP) ? CapProjecting : CapRound,
+		(style & SQUARECAP) ? JoinMiter : JoinBevel);
+}
+
+/*----------------------------------------------------------------------*/
+/* Stroke the outlines collected by stroke().  The painter is left	*/
+/* with the line attributes of the batch, as if each outline had been	*/
+/* drawn on its own.							*/
+/*----------------------------------------------------------------------*/
+
+void DrawContext::flush() const
+{
+    if (batch.isEmpty()) return;
+
+    if (gc_ != NULL) {
+        strokepen(batchstyle, batchwidth);
+        gc_->strokePath(batch, gc_->pen());
+    }
+
+    /* keep the path's storage for the next batch, where Qt allows */
+#if QT_VERSION >= QT_VERSION_CHECK(5, 13, 0)
+    batch.clear();
+#else
+    batch = QPainterPath();
+#endif
 }
 
 /*----------------------------------------------------------------------*/
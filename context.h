@@ -2,19 +2,57 @@
 #define CONTEXT_H
 
 #include <qglobal.h>
+#include <QMutex>
 #include <QVector>
+#include <QRect>
+#include <QPoint>
+#include <QPainterPath>
+
+#include "matrix.h"
+#include "xcircuit.h"
 
 class QPainter;
-class Matrix;
 class UIContext;
 
+/* Depth of the matrix stack:  the object hierarchy, plus the labels	*/
+/* and glyphs drawn at the bottom of it.				*/
+#define CTM_DEPTH	(HIERARCHY_LIMIT + 8)
+
+/* Shared state which drawing fills in on first use (parameter values	*/
+/* substituted into objects, library cells, spatial indexes, glyphs,	*/
+/* label layouts, scaled images and the level of detail caches) is	*/
+/* only touched with the draw lock held, so that the page may be drawn	*/
+/* in tiles on several threads at once (see tiles.cpp).  The lock is	*/
+/* recursive, as objects are drawn inside of objects.			*/
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+typedef QRecursiveMutex DrawMutex;
+#else
+typedef QMutex DrawMutex;
+#endif
+extern DrawMutex drawlock;
+
+#ifndef QT_NO_DEBUG
+/* In debug builds, counts what is allocated with operator new by	*/
+/* threads drawing through a DrawContext while it exists, and reports	*/
+/* any allocation after the first few (see context.cpp).		*/
+class AllocWatch
+{
+public:
+    AllocWatch(const char *what);
+    ~AllocWatch();
+private:
+    const char *what;
+    Q_DISABLE_COPY(AllocWatch)
+};
+#endif
+
 class DrawContext
 {
 public:
     DrawContext(QPainter *, const UIContext * ui = NULL);
     ~DrawContext();
     void setPainter(QPainter *);
-    inline QPainter* gc() const { return gc_; }
+    inline QPainter* gc() const { if (!batch.isEmpty()) flush(); return gc_; }
     inline Matrix* DCTM() const { return matStack; }
     inline Matrix& CTM() const { return *matStack; }
 
@@ -27,21 +65,49 @@ public:
     void UTopOffset(int *offx, int *offy) const;
     void UTopDrawingOffset(int *offx, int *offy) const;
     short flipadjust(short justify);
+    inline int depth() const { return matStack - matrices; }
+
+    // scratch space for the drawing of one element, kept between redraws
+    XPoint* points(int count);
+    QPoint* qpoints(int count);
+    QVector<int>& parts();
+
+    // outlines drawn with the same line style are stroked together
+    void stroke(const XPoint *, int number, bool closed, short style, int width);
+    void flush() const;
+    static void setBatching(bool);	// for comparison with unbatched outlines
+
+    // window area outside of which drawing may be skipped
+    inline const QRect& clipRect() const { return clip_; }
+    void setClipRect(const QRect &);
+    bool visible(const XPoint *bboxout) const;
 
     // hack purgatory
     int gccolor, gctype;
 private:
+    void strokepen(short style, int width) const;
+
     QPainter* gc_;
     const UIContext* ui;
     bool ownUi;
-    Matrix* matStack;
+    Matrix* matStack;		// top of "matrices"
+    Matrix matrices[CTM_DEPTH];
+    int overflow;		// pushes past the end of "matrices"
+    QVector<int>* partlists;	// scratch lists of parts, one per level
+#ifndef QT_NO_DEBUG
+    int grown;			// scratch buffers grown, at the start
+#endif
+    QRect clip_;
+    mutable QPainterPath batch;	// outlines not yet stroked
+    short batchstyle;		// DASHED, DOTTED and SQUARECAP of the batch
+    int batchwidth;
     Q_DISABLE_COPY(DrawContext)
 };
 
 class UIContext
 {
 public:
-    QVector<short> selects;
+    QVector<int> selects;
 };
 
 #endif // CONTEXT_H
@@ -83,7 +83,8 @@ void textbutton(u_char dopin, int x, int y)
 {
    labelptr *newlabel;
    XPoint userpt;
-   short tmpheight, *newselect;
+   int tmpheight;
+   int *newselect;
 
    XDefineCursor(areawin->viewport, TEXTPTR);
    W3printf("Click to end or cancel.");
@@ -97,7 +98,7 @@ void textbutton(u_char dopin, int x, int y)
    newselect = allocselect();
    *newselect = topobject->parts;
 
-   tmpheight = (short)(TEXTHEIGHT * (*newlabel)->scale);
+   tmpheight = (int)(TEXTHEIGHT * (*newlabel)->scale);
    userpt.y -= ((*newlabel)->justify & NOTBOTTOM) ?
 	(((*newlabel)->justify & TOP) ? tmpheight : tmpheight / 2) : 0;
    areawin->update();
@@ -169,6 +170,9 @@ bool labeltext(int keypressed, char *clientdata)
       return false;
    }
 
+   /* the string (or a parameter string it links to) is about to change */
+   layout_invalidate();
+
    /* find text segment of the current position */
    curpos = findstringpart(areawin->textpos, &locpos, curlabel->string,
 		areawin->topinstance);
@@ -291,6 +295,7 @@ bool labeltext(int keypressed, char *clientdata)
 			== NULL))
 	       libobjname = techptr + 2;
 	    strcpy(libobjname, curlabel->string->nextpart->data.string);
+	    names_invalidate();
 
 	    /* If checkname() alters the name, it has to be copied back to */
 	    /* the catalog label for the object.			   */
@@ -572,7 +577,7 @@ void textreturn()
 void rejustify(short mode)
 {
    labelptr curlabel = NULL;
-   short    *tsel;
+   int      *tsel;
    short jsave;
    bool preselected = false, changed = false;
    static short transjust[] = {15, 13, 12, 7, 5, 4, 3, 1, 0};
@@ -631,7 +636,7 @@ void splinebutton(int x, int y)
 {
    splineptr *newspline;
    XPoint userpt;
-   short *newselect;
+   int *newselect;
 
    unselect_all();
    snap(x, y, &userpt);
@@ -750,7 +755,7 @@ void arcbutton(int x, int y)
 {
    arcptr *newarc;
    XPoint userpt;
-   short *newselect;
+   int *newselect;
 
    unselect_all();
    snap(x, y, &userpt);
@@ -813,7 +818,7 @@ void trackarc(Widget, caddr_t, caddr_t)
    else if (cycle == 0) {
       short direc = (newarc->radius < 0);
       newarc->radius = wirelength(&newpos, &(newarc->position));
-      newarc->yaxis = (short)((double)newarc->radius * saveratio);
+      newarc->yaxis = (int)((double)newarc->radius * saveratio);
       if (direc) newarc->radius = -newarc->radius;
    }
    else {
@@ -825,7 +830,10 @@ void trackarc(Widget, caddr_t, caddr_t)
    printpos(newpos);
 
    areawin->save = newpos;
-   areawin->update();
+   if (eventmode == ARC_MODE)
+      areawin->updateOverlay();	/* new arc is not yet part of the page */
+   else
+      areawin->update();
 }
 
 /*------------------------------------*/
@@ -836,7 +844,7 @@ void boxbutton(int x, int y)
 {
    polyptr *newbox;
    XPoint userpt;
-   short *newselect;
+   int *newselect;
 
    unselect_all();
    snap(x, y, &userpt);
@@ -873,7 +881,7 @@ void trackbox(Widget, caddr_t, caddr_t)
    printpos(newpos);
 
    areawin->save = newpos;
-   areawin->update();
+   areawin->updateOverlay();
 }
 
 /*----------------------------------------------------------------------*/
@@ -910,7 +918,7 @@ void trackwire(Widget, caddr_t, caddr_t)
       *tpoint = newpos;
       areawin->save = newpos;
       printpos(newpos);
-      areawin->update();
+      areawin->updateOverlay();
    }
 }
 
@@ -921,7 +929,7 @@ void trackwire(Widget, caddr_t, caddr_t)
 void startwire(XPoint *userpt)
 {
    polyptr *newwire;
-   short *newselect;
+   int *newselect;
 
    unselect_all();
    newwire = topobject->temp_append(new polygon);
@@ -1066,7 +1074,7 @@ void findconstrained(polyptr lastpoly)
 void trackelement(Widget, caddr_t, caddr_t)
 {
    XPoint newpos, origpt, *curpt;
-   short	*selobj;
+   int		*selobj;
    pointselect	*cptr;
    XPoint delta;
 
@@ -1109,22 +1117,29 @@ void trackelement(Widget, caddr_t, caddr_t)
 
    /* Now adjust all edited elements relative to the reference point */
 
+   /* A spline being created is not yet part of the page */
+   if (eventmode != SPLINE_MODE) invalidate_selected();
+
    for (selobj = areawin->selectlist; selobj < areawin->selectlist +
                 areawin->selects; selobj++)
    {
       editpoints(SELTOGENERICPTR(selobj), delta);
+      if (eventmode != SPLINE_MODE)
+         spatial_update(topobject, SELTOGENERICPTR(selobj));
    }
 
+   if (eventmode != SPLINE_MODE) invalidate_selected();
+
    printpos(newpos);
    areawin->save = newpos;
-   areawin->update();
+   areawin->updateOverlay();
 }
 
 /*-------------------------------------------------*/
 /* Determine values of endpoints of an element	   */
 /*-------------------------------------------------*/
 
-void setendpoint(short *scnt, short direc, XPoint **endpoint, XPoint *arcpoint)
+void setendpoint(int *scnt, short direc, XPoint **endpoint, XPoint *arcpoint)
 {
    genericptr *sptr = topobject->begin() + (*scnt);
 
@@ -1143,14 +1158,14 @@ void setendpoint(short *scnt, short direc, XPoint **endpoint, XPoint *arcpoint)
 	 break;
       case ARC:
 	 if (direc) {
-	    arcpoint->x = (short)(TOARC(sptr)->points[TOARC(sptr)->number - 1].x
+	    arcpoint->x = (int)(TOARC(sptr)->points[TOARC(sptr)->number - 1].x
 		+ 0.5);
-	    arcpoint->y = (short)(TOARC(sptr)->points[TOARC(sptr)->number - 1].y
+	    arcpoint->y = (int)(TOARC(sptr)->points[TOARC(sptr)->number - 1].y
 		+ 0.5);
 	 }
 	 else {
-	    arcpoint->x = (short)(TOARC(sptr)->points[0].x + 0.5);
-	    arcpoint->y = (short)(TOARC(sptr)->points[0].y + 0.5);
+	    arcpoint->x = (int)(TOARC(sptr)->points[0].x + 0.5);
+	    arcpoint->y = (int)(TOARC(sptr)->points[0].y + 0.5);
 	 }
 	 *endpoint = arcpoint;
 	 break;
@@ -1177,7 +1192,7 @@ void reversefpoints(XfPoint *plist, short number)
 /*	add = 1 if plist has (parts + 1) elements		*/
 /*--------------------------------------------------------------*/
 
-static void freepathparts(short *selectobj, short add)
+static void freepathparts(int *selectobj, short add)
 {
    delete topobject->at(*selectobj);
    removep(selectobj, add);
@@ -1188,7 +1203,7 @@ static void freepathparts(short *selectobj, short add)
 /* 	add = 1 if plist has (parts + 1) elements		*/
 /*--------------------------------------------------------------*/
 
-void removep(short *selectobj, short add)
+void removep(int *selectobj, short add)
 {
    genericptr *oldelem = topobject->begin() + (*selectobj);
 
@@ -1204,7 +1219,7 @@ void removep(short *selectobj, short add)
 
 void unjoin()
 {
-   short *selectobj;
+   int *selectobj;
    pathptr oldpath;
    polyptr oldpoly, *newpoly;
    bool preselected;
@@ -1269,7 +1284,7 @@ void unjoin_call(QAction*, void*, void*)
 
 bool neartest(XPoint *point1, XPoint *point2)
 {
-   short diff[2];
+   int diff[2];
 
    diff[0] = point1->x - point2->x;
    diff[1] = point1->y - point2->y;
@@ -1287,12 +1302,13 @@ bool neartest(XPoint *point1, XPoint *point2)
 
 void join()
 {
-   short     *selectobj;
+   int       *selectobj;
    polyptr   *newpoly, nextwire;
    pathptr   *newpath;
-   short     *scount, *sptr, *sptr2, *direc, *order;
-   short     ordered, startpt = 0;
-   short     numpolys, numlabels, numpoints, polytype;
+   int       *scount, *sptr, *sptr2, *direc, *order;
+   int       ordered, startpt = 0;
+   int       numpolys, numlabels, numpoints;
+   short     polytype;
    int	     polycolor;
    float     polywidth;
    XPoint    *testpoint, *testpoint2, *begpoint, *endpoint, arcpoint[4];
@@ -1349,9 +1365,9 @@ void join()
    /* direc is an ordered table of path directions (0=same as element,	*/
    /* 	1=reverse from element definition)				*/
 
-   scount = new short[numpolys];
-   order  = new short[numpolys];
-   direc  = new short[numpolys];
+   scount = new int[numpolys];
+   order  = new int[numpolys];
+   direc  = new int[numpolys];
    sptr = scount;
    numpoints = 1;
 
@@ -1453,7 +1469,7 @@ void join()
       testpoint2 = (*newpoly)->points.begin();
       for (sptr = order; sptr < order + numpolys; sptr++) {
          nextwire = SELTOPOLY(sptr);
-	 if (*(direc + (short)(sptr - order)) == 0) {
+	 if (*(direc + (sptr - order)) == 0) {
             for (testpoint = nextwire->points.begin(); testpoint < nextwire->points.end() - 1;
                 testpoint++) {
                *testpoint2 = *testpoint;
@@ -1494,7 +1510,7 @@ void join()
          genericptr newelem = *(*newpath)->append(oldelem->copy());
 
 	 /* reverse point order if necessary */
-         if (*(direc + (short)(sptr - order)) == 1) newelem->reverse();
+         if (*(direc + (sptr - order)) == 1) newelem->reverse();
 
 	 /* decompose arcs into bezier curves */
          if (ELEMENTTYPE(newelem) == ARC) (*newpath)->replace_last(new spline(*TOARC(&newelem)));
@@ -1514,7 +1530,7 @@ void join()
       selectobj = allocselect();
       for (pathiter pgen; topobject->values(pgen); ) {
          if (pgen == (*newpath)) {
-            *selectobj = (short)(pgen - topobject->begin());
+            *selectobj = (int)(pgen - topobject->begin());
 	    break;
 	 }
       }
@@ -1614,7 +1630,7 @@ void wire_op(int op, int x, int y)
 
 	 topobject->parts++;
 	 incr_changes(topobject);
-	 if (!nonnetwork(newwire)) invalidate_netlist(topobject);
+	 add_netlist_wire(topobject, newwire);
          register_for_undo(XCF_Wire, UNDO_MORE, areawin->topinstance, newwire);
       }
       areawin->update();
@@ -1,11 +1,14 @@
 #ifndef ELEMENTS_H
 #define ELEMENTS_H
 
+#include <QHash>
 #include <QVector>
 
 #include "xctypes.h"
 #include "colors.h"
 
+class LabelLayout;
+
 /*----------------------------------------------------------------------*/
 /* Labels are constructed of strings and executables 			*/
 /*----------------------------------------------------------------------*/
@@ -67,7 +70,10 @@ public:
         short	kern[2];
     } data;
     stringpart() : nextpart(NULL), type(NULL_TYPE) {}
+    static void *operator new(size_t size);		/* see pool.cpp */
+    static void operator delete(void *ptr, size_t size);
 };
+NO_FREE(stringpart*);
 
 /*----------------------------------------------------------------------*/
 /* Object & object instance parameter structure				*/
@@ -79,7 +85,6 @@ public:
 enum paramtypes {XC_INT = 0, XC_FLOAT, XC_STRING, XC_EXPR};
 
 /* Object parameters: general key:value parameter model */
-/* Note that this really should be a hash table, not a linked list. . . */
 
 class oparam {
 public:
@@ -98,14 +103,46 @@ public:
 typedef oparam *oparamptr;
 NO_FREE(oparamptr);
 
+/* Parameter list of an object or instance.  The oparam chain keeps	*/
+/* the parameters in order for file output;  lookups by key go through	*/
+/* a hash on interned key IDs (see paramkeyid()), rebuilt on the first	*/
+/* lookup after the list head changes.  Code which links or unlinks	*/
+/* entries other than at the head, or renames a key already in the	*/
+/* list, must call invalidate().  Every change also gives the list a	*/
+/* new stamp, unique over all lists, for opsubstitute().		*/
+
+class ParamList {
+public:
+   ParamList(oparamptr h = NULL) : head(h), stale(true), changed(++stamps) {}
+   ParamList(const ParamList &src) : head(src.head), stale(true),
+	changed(++stamps) {}
+   ParamList &operator=(const ParamList &src)
+	{ head = src.head; invalidate(); return *this; }
+   ParamList &operator=(oparamptr h) { head = h; invalidate(); return *this; }
+   operator oparamptr() const { return head; }
+   oparamptr operator->() const { return head; }
+
+   oparamptr find(int keyid) const;
+   void invalidate() { stale = true; changed = ++stamps; }
+   u_int stamp() const { return changed; }
+
+private:
+   oparamptr head;
+   mutable bool stale;
+   u_int changed;
+   mutable QHash<int, oparamptr> index;
+
+   static u_int stamps;
+};
+
 /* Element parameters: reference back to the object's parameters */
 /* These parameters are forward-substituted when descending into */
 /* an object instance.						 */
-/* Note that this really should be a hash table, not a linked list. . . */
 
 class eparam {
 public:
    char *	key;	    /* name of the parameter */
+   int		keyid;	    /* interned key, from paramkeyid() */
    u_char	flags;	    /* namely, bit declaring an indirect parameter */
    union {
       int	pointno;    /* point number in point array, for polygons */
@@ -164,6 +201,8 @@ public:
     virtual void calc() {}
     virtual void reverse() {}
     bool operator==(const generic&) const;
+    static void *operator new(size_t size);		/* see pool.cpp */
+    static void operator delete(void *ptr, size_t size);
 protected:
     virtual void doGetBbox(XPoint*, float scale, int extend, objinst* callinst) const { Q_UNUSED(scale); Q_UNUSED(extend); Q_UNUSED(callinst); }
     inline generic(Type _type) : type(_type), color(DEFAULTCOLOR), passed(NULL) {}
@@ -183,9 +222,11 @@ NO_FREE(genericptr);
 
 class Plist {
 public:
-    short	parts;
+    int		parts;
 private:
     genericptr	*plist;
+    int		room;		/* slots allocated, grown by doubling */
+    void reserve(int);
 public:
     typedef const genericptr * const_iterator;
     typedef genericptr * iterator;
@@ -257,6 +298,8 @@ public:
         return it < end();
     }
     bool operator==(const Plist & other) const;
+
+    static u_int resizes;	/* count of list reallocations */
 };
 NO_FREE(Plist*);
 
@@ -317,7 +360,7 @@ class object;
 class objinst : public positionable {
 public:
     object*	thisobject;
-    oparamptr	params;		/* parameter substitutions for this instance */
+    ParamList	params;		/* parameter substitutions for this instance */
     BBox	bbox;		/* per-instance bounding box information */
     BBox	*schembbox;	/* Extra bounding box for pin labels */
     objinst();
@@ -348,6 +391,7 @@ public:
     short	justify;
     u_char	pin;
     stringpart	*string;
+    mutable LabelLayout *layout;	/* cached measurements (may be NULL) */
     label();
     label(const label&);
     label(u_char dopin, XPoint pos);
@@ -439,8 +483,8 @@ public:
     pointselect	*cycle;		/* Edit position(s), or NULL */
     u_short	style;
     float	width;
-    short	radius; 	/* x-axis radius */
-    short	yaxis;		/* y-axis radius */
+    int		radius; 	/* x-axis radius */
+    int		yaxis;		/* y-axis radius */
     float	angle1;		/* endpoint angles, in degrees */
     float	angle2;
     XPoint	position;
@@ -35,6 +35,7 @@
 #include "prototypes.h"
 #include "xcqt.h"
 #include "area.h"
+#include "spatial.h"
 #include "context.h"
 
 /*-------------------------------------------------------------------------*/
@@ -50,7 +51,6 @@ extern char  _STR[150];
 extern short beeper;
 extern double saveratio;
 extern u_char texttype;
-extern aliasptr aliastop;
 
 #ifdef TCL_WRAPPER
 extern Tcl_Interp *xcinterp;
@@ -89,7 +89,7 @@ bool recursefind(objectptr parent, objectptr suspect)
 
 void transferselects()
 {
-   short locselects;
+   int locselects;
    XPoint newpos;
 
    if (areawin->editstack->parts == 0) return;
@@ -101,7 +101,7 @@ void transferselects()
 
       locselects = areawin->editstack->parts;
       areawin->selectlist = xc_undelete(areawin->topinstance,
-                areawin->editstack, (short *)NULL);
+                areawin->editstack, (int *)NULL);
       areawin->selects = locselects;
 
       /* Move all selected items to the cursor position	*/
@@ -288,7 +288,7 @@ void free_stack(pushlistptr *stackroot)
 
 void pushobject(objinstptr thisinst)
 {
-  short *selectobj, *savelist;
+  int *selectobj, *savelist;
    int saves;
    u_char undo_type = UNDO_DONE;
    objinstptr pushinst = thisinst;
@@ -452,6 +452,7 @@ void resetbutton(QAction*, void* pageno_, void*)
    xobjs.pagelist[page].filename = QString::fromLocal8Bit(pageobj->name);
    pageobj->clear();
    flush_undo_stack();
+   pool_trim();
 
    if (page == areawin->page) {
       areawin->update();
@@ -618,17 +619,17 @@ void zoomoutbox(int x, int y)
    }
 
    /* extrapolate to find new lower-left corner of screen */
-   newll.x = areawin->pcorner.x - (int)((float)(newll.x -
+   newll.x = areawin->pcorner.x - (long)((double)(newll.x -
 		areawin->pcorner.x) / scalefac);
-   newll.y = areawin->pcorner.y - (int)((float)(newll.y -
+   newll.y = areawin->pcorner.y - (long)((double)(newll.y -
 		areawin->pcorner.y) / scalefac);
 
    eventmode = NORMAL_MODE;
    areawin->pcorner = newll;
 
    DrawContext ctx(NULL);
-   if ((newll.x << 1) != (long)(areawin->pcorner.x << 1) || (newll.y << 1)
-         != (long)(areawin->pcorner.y << 1) || checkbounds(&ctx) == -1) {
+   if (newll.x != areawin->pcorner.x || newll.y != areawin->pcorner.y
+	 || checkbounds(&ctx) == -1) {
       areawin->vscale = savescale; 
       areawin->pcorner = savell;
       Wprintf("At maximum scale: cannot scale further.");
@@ -668,7 +669,8 @@ void warppointer(int x, int y)
 
 void panbutton(u_int ptype, int x, int y, float value)
 {
-   int  xpos, ypos, newllx, newlly;
+   int  xpos, ypos;
+   long newllx, newlly;
    XPoint savell;
    Dimension hwidth = areawin->width() >> 1, hheight = areawin->height() >> 1;
 
@@ -719,15 +721,15 @@ void panbutton(u_int ptype, int x, int y, float value)
    xpos -= hwidth;
    ypos = hheight - ypos;
 
-   newllx = (int)areawin->pcorner.x + (int)((float)xpos / areawin->vscale);
-   newlly = (int)areawin->pcorner.y + (int)((float)ypos / areawin->vscale);
+   newllx = (long)areawin->pcorner.x + (long)((double)xpos / areawin->vscale);
+   newlly = (long)areawin->pcorner.y + (long)((double)ypos / areawin->vscale);
 
-   areawin->pcorner.x = (short) newllx;
-   areawin->pcorner.y = (short) newlly;
+   areawin->pcorner.x = (int) newllx;
+   areawin->pcorner.y = (int) newlly;
 
    DrawContext ctx(NULL);
-   if ((newllx << 1) != (long)(areawin->pcorner.x << 1) || (newlly << 1)
-           != (long)(areawin->pcorner.y << 1) || checkbounds(&ctx) == -1) {
+   if (newllx != areawin->pcorner.x || newlly != areawin->pcorner.y
+	   || checkbounds(&ctx) == -1) {
       areawin->pcorner = savell;
       Wprintf("Reached bounds:  cannot pan further.");
       return;
@@ -744,7 +746,7 @@ void panbutton(u_int ptype, int x, int y, float value)
 void panrefresh(u_int ptype, int x, int y, float value)
 {
    panbutton(ptype, x, y, value);
-   refresh(NULL, NULL, NULL);
+   areawin->area->refresh();	/* page unchanged; only scrolled */
 }
 
 /*----------------------------------------------------------------*/
@@ -1228,7 +1230,7 @@ void attach_to()
    /* to attach to.						*/
 
    if (areawin->selects <= 1) {
-      short *refsel;
+      int *refsel;
 
       if (areawin->attachto >= 0) {
 	 areawin->attachto = -1;	/* default value---no attachments */
@@ -2107,7 +2109,7 @@ void setsnap(short direction)
 
 void snapelement()
 {
-   short *selectobj;
+   int *selectobj;
    bool preselected;
 
    preselected = (areawin->selects > 0) ? true : false;
@@ -2247,11 +2249,11 @@ void fraccalc(float xyval, char *fstr)
       if (denom > 1024)
 	 sprintf(fstr, "%5.3f", xyval); 
       else if (ip == 0)
-         sprintf(fstr, "%hd/%hd", (xyval > 0) ? numer : -numer, denom);
+         sprintf(fstr, "%d/%d", (xyval > 0) ? numer : -numer, denom);
       else
-         sprintf(fstr, "%hd %hd/%hd", ip, numer, denom);
+         sprintf(fstr, "%d %d/%d", ip, numer, denom);
    }
-   else sprintf(fstr, "%hd", ip);
+   else sprintf(fstr, "%d", ip);
 }
 
 /*------------------------------------------------------------------------------*/
@@ -2719,7 +2721,7 @@ void elemrotate(genericptr genobj, short direction, XPoint *position)
 
 void elementrotate(short direction, XPoint *position)
 {
-  short    *selectobj;
+  int      *selectobj;
    bool  single = false;
    bool  need_refresh = false;
    bool  preselected;
@@ -2841,7 +2843,7 @@ void elementrotate(short direction, XPoint *position)
 
 void elementrescale(float newscale)
 {
-   short *selectobj;
+   int *selectobj;
    labelptr sclab;
    objinstptr scinst;
    graphicptr scgraph;
@@ -2877,7 +2879,7 @@ void elementrescale(float newscale)
 
 void edit(int x, int y)
 {
-   short *selectobj, saveselects;
+   int *selectobj, saveselects;
    bool preselected = false;
 
    if (areawin->selects == 0) {
@@ -2894,7 +2896,7 @@ void edit(int x, int y)
       return;
    else if (areawin->selects != 1) { /* Multiple object edit */
       int selnum;
-      short *selectlist, selrefno;
+      int *selectlist, selrefno;
 
       /* Find the closest part to use as a reference */
       selnum = areawin->selects;
@@ -3012,7 +3014,7 @@ void pathedit(genericptr editpart)
    polyptr lastpoly = NULL;
    arcptr lastarc;
    XPoint *savept;
-   short *eselect;
+   int *eselect;
    int cycle;
    bool havecycle;
 
@@ -3192,7 +3194,7 @@ void pathedit(genericptr editpart)
 /* Raise/Lower an object			   */
 /*-------------------------------------------------*/
 
-void xc_raise(short *selectno)
+void xc_raise(int *selectno)
 {
    genericptr *raiseobj, *genobj, temp;
 
@@ -3207,7 +3209,7 @@ void xc_raise(short *selectno)
 
 /*-------------------------------------------------*/
 
-void xc_lower(short *selectno)
+void xc_lower(int *selectno)
 {
    genericptr *lowerobj, *genobj, temp;
 
@@ -3234,7 +3236,8 @@ void xc_lower(short *selectno)
 
 void copyvirtual()
 {
-   short *selectno, created = 0;
+   int *selectno;
+   short created = 0;
    objinstptr vcpobj, libinst;
 
    for (selectno = areawin->selectlist; selectno < areawin->selectlist +
@@ -3263,7 +3266,7 @@ void copyvirtual()
 
 void exchange()
 {
-   short *selectno;
+   int *selectno;
    genericptr *exchobj, *exchobj2, temp;
    bool preselected;
 
@@ -3378,7 +3381,7 @@ void elvflip(genericptr *genobj, short y)
 
 void elementflip(XPoint *position)
 {
-   short *selectobj;
+   int *selectobj;
    bool single = false;
    bool preselected;
 
@@ -3453,7 +3456,7 @@ void elementflip(XPoint *position)
 
 void elementvflip(XPoint *position)
 {
-   short *selectobj;
+   int *selectobj;
    bool preselected;
    bool single = false;
 
@@ -3583,31 +3586,42 @@ void delete_one_element(objinstptr thisinstance, genericptr thiselement)
 /* routine (calls freeselects()), but not otherwise.			*/
 /*----------------------------------------------------------------------*/
 
-objectptr delete_element(objinstptr thisinstance, short *slist, int selects)
+objectptr delete_element(objinstptr thisinstance, int *slist, int selects)
 {
-   short *selectobj;
+   int *selectobj;
    objectptr delobj, thisobject;
-   genericptr *genobj;
+   genericptr *genobj, *keepobj;
    bool pinchange = false;
+   QVector<bool> deleted;
 
    if (slist == NULL || selects == 0) return NULL;
 
    thisobject = thisinstance->thisobject;
 
    delobj = new object;
+   deleted.fill(false, thisobject->parts);
 
    for (selectobj = slist; selectobj < slist + selects; selectobj++) {
+      if (deleted[*selectobj]) continue;
+      deleted[*selectobj] = true;
       genobj = thisobject->begin() + *selectobj;
+      if (thisinstance == areawin->topinstance) invalidate_element(genobj);
       delobj->append(*genobj);
 
        /* The netlist contains pointers to elements which no longer	*/
        /* exist on the page, so we should remove them from the netlist.	*/
 
       if (RemoveFromNetlist(thisobject, *genobj)) pinchange = true;
-      while (thisobject->values(genobj)) *(genobj - 1) = *genobj;
-      thisobject->take_last();
-      reviseselect(slist, selects, selectobj);
    }
+
+   /* Close up the element list in one pass */
+
+   keepobj = thisobject->begin();
+   for (genobj = thisobject->begin(); genobj != thisobject->end(); genobj++)
+      if (!deleted[genobj - thisobject->begin()])
+	 *keepobj++ = *genobj;
+   thisobject->parts = keepobj - thisobject->begin();
+
    if (pinchange) setobjecttype(thisobject);
 
    if (slist == areawin->selectlist)
@@ -3616,8 +3630,7 @@ objectptr delete_element(objinstptr thisinstance, short *slist, int selects)
    calcbbox(thisinstance);
    /* freenetlist(thisobject); */
 
-   /// \todo this may be gratuituous, it used to depend on drawmode
-   areawin->update();
+   if (thisinstance != areawin->topinstance) areawin->update();
    return delobj;
 }
   
@@ -3635,7 +3648,7 @@ void standard_element_delete()
    register_for_undo(XCF_Select, UNDO_MORE, areawin->topinstance,
 		areawin->selectlist, areawin->selects);
 #endif
-   select_invalidate_netlist();
+   select_remove_netlist();
    delobj = delete_element(areawin->topinstance, areawin->selectlist,
         areawin->selects);
    register_for_undo(XCF_Delete, UNDO_DONE, areawin->topinstance,
@@ -3650,7 +3663,7 @@ void standard_element_delete()
 /* allows objects to be carried across pages and through the hierarchy.	*/
 /*----------------------------------------------------------------------*/
 
-void delete_for_xfer(short *slist, int selects)
+void delete_for_xfer(int *slist, int selects)
 {
    if (selects > 0) {
       delete areawin->editstack;
@@ -3668,7 +3681,7 @@ void delete_noundo()
 {
    objectptr delobj;
 
-   select_invalidate_netlist();
+   select_remove_netlist();
    delobj = delete_element(areawin->topinstance, areawin->selectlist,
         areawin->selects);
 
@@ -3686,29 +3699,60 @@ void delete_noundo()
 /* in delobj!  It is up to the calling routine to check this.		*/
 /*----------------------------------------------------------------------*/
 
-short *xc_undelete(objinstptr thisinstance, objectptr delobj, 	short *olist)
+int *xc_undelete(objinstptr thisinstance, objectptr delobj, 	int *olist)
 {
    objectptr  thisobject;
    genericptr *regen;
-   short      *slist, count, i;
+   int        *slist, count, i, src;
+   bool	      merged = false;
 
    thisobject = thisinstance->thisobject;
-   slist = (short *)malloc(delobj->parts * sizeof(short));
+   slist = (int *)malloc(delobj->parts * sizeof(int));
    count = 0;
 
-   for (regen = 0; delobj->values(regen); ) {
-      thisobject->temp_append();
-      if (olist == NULL) {
-         *(slist + count) = thisobject->parts;
-         *(ENDPART) = *regen;
+   /* Elements going back to increasing positions (as from an area	*/
+   /* select) are merged into the list in one pass.  Otherwise each	*/
+   /* is inserted in turn.						*/
+
+   if ((olist != NULL) && (delobj->parts > 0) && (*(olist + delobj->parts - 1)
+		< thisobject->parts + delobj->parts)) {
+      merged = true;
+      for (i = 1; i < delobj->parts; i++)
+	 if (*(olist + i) <= *(olist + i - 1)) merged = false;
+   }
+   if (merged) {
+      src = thisobject->parts - 1;
+      for (i = 0; i < delobj->parts; i++) {
+         thisobject->temp_append();
+         thisobject->parts++;
       }
-      else {
+      count = delobj->parts - 1;
+      for (i = thisobject->parts - 1; i >= 0; i--) {
+	 if ((count >= 0) && (*(olist + count) == i))
+            *(thisobject->begin() + i) = delobj->at(count--);
+	 else
+            *(thisobject->begin() + i) = *(thisobject->begin() + src--);
+      }
+      count = 0;
+   }
+
+   for (regen = 0; delobj->values(regen); ) {
+      if (merged)
          *(slist + count) = *(olist + count);
-	 for (i = thisobject->parts; i > *(olist + count); i--)
-            *(thisobject->begin() + i) = *(thisobject->begin() + i - 1);
-         *(thisobject->begin() + i) = *regen;
+      else {
+         thisobject->temp_append();
+         if (olist == NULL) {
+            *(slist + count) = thisobject->parts;
+            *(ENDPART) = *regen;
+         }
+         else {
+            *(slist + count) = *(olist + count);
+	    for (i = thisobject->parts; i > *(olist + count); i--)
+               *(thisobject->begin() + i) = *(thisobject->begin() + i - 1);
+            *(thisobject->begin() + i) = *regen;
+         }
+         thisobject->parts++;
       }
-      thisobject->parts++;
       count++;
 
       /* If the element has passed parameters (eparam), then we have to */
@@ -3741,7 +3785,7 @@ short *xc_undelete(objinstptr thisinstance, objectptr delobj, 	short *olist)
 		     lastpart->nextpart = gstr->nextpart;
 		  else
 		     glab->string = gstr->nextpart;
-		  free(gstr);
+		  delete gstr;
 		  gstr = (lastpart) ? lastpart : glab->string;
 	       }
 	    }
@@ -3822,12 +3866,9 @@ void printname(objectptr curobject)
 
 char *checkvalidname(char *teststring, objectptr newobj)
 {
-   int i, j;
    short dupl;  /* flag a duplicate string */
-   objectptr *libobj;
-   char *sptr, *pptr;
-   aliasptr aref;
-   slistptr sref;
+   objectptr libobj;
+   char *sptr, *pptr, *aptr;
 
    /* Try not to allocate memory unless necessary */
 
@@ -3837,52 +3878,38 @@ char *checkvalidname(char *teststring, objectptr newobj)
    do {
       dupl = 0;
       if (newobj != NULL) {
-         for (i = 0; i < xobjs.numlibs; i++) {
-	    for (j = 0; j < xobjs.userlibs[i].number; j++) {
-	       libobj = xobjs.userlibs[i].library + j;
-
-	       if (*libobj == newobj) continue;
-               if (!strcmp(pptr, (*libobj)->name)) { 
-
-		  /* Instead of the old method of prepending an		*/
-		  /* underscore to the name, we now change the		*/
-		  /* technology, not the name, to avoid a conflict.  	*/
-		  /* If there's no technology, then we add one called	*/
-		  /* "unref".  Otherwise, the technology gets the	*/
-		  /* leading underscore.				*/
-
-		  if (strstr(pptr, "::") == NULL) {
-                     pptr = (char *)malloc(strlen((*libobj)->name) + 2);
-		     sprintf(pptr, "unref::%s", (*libobj)->name);
-		  }
-		  else {
-		     if (pptr == sptr)
-                        pptr = (char *)malloc(strlen((*libobj)->name) + 2);
-		     else
-                        pptr = (char *)realloc(pptr, strlen((*libobj)->name) + 2);
-	             sprintf(pptr, "_%s", (*libobj)->name);
-		  }
-	          dupl = 1;
-	       }
+         if ((libobj = names_findexact(pptr, newobj)) != NULL) {
+
+	    /* Instead of the old method of prepending an		*/
+	    /* underscore to the name, we now change the		*/
+	    /* technology, not the name, to avoid a conflict.  	*/
+	    /* If there's no technology, then we add one called	*/
+	    /* "unref".  Otherwise, the technology gets the		*/
+	    /* leading underscore.					*/
+
+	    if (strstr(pptr, "::") == NULL) {
+               pptr = (char *)malloc(strlen(libobj->name) + 8);
+	       sprintf(pptr, "unref::%s", libobj->name);
 	    }
+	    else {
+	       if (pptr == sptr)
+                  pptr = (char *)malloc(strlen(libobj->name) + 2);
+	       else
+                  pptr = (char *)realloc(pptr, strlen(libobj->name) + 2);
+	       sprintf(pptr, "_%s", libobj->name);
+	    }
+	    dupl = 1;
 	 }
 
          /* If we're in the middle of a file load, the name cannot be	*/
          /* the same as an alias, either.				*/
 	
-         if (aliastop != NULL) {
-	    for (aref = aliastop; aref != NULL; aref = aref->next) {
-	       for (sref = aref->aliases; sref != NULL; sref = sref->next) {
-	          if (!strcmp(pptr, sref->alias)) {
-		     if (pptr == sptr)
-                        pptr = (char *)malloc(strlen(sref->alias) + 2);
-		     else
-                        pptr = (char *)realloc(pptr, strlen(sref->alias) + 2);
-	             sprintf(pptr, "_%s", sref->alias);
-	             dupl = 1;
-		  }
-	       }
-	    }
+         else if (names_isalias(NULL, pptr)) {
+            aptr = (char *)malloc(strlen(pptr) + 2);
+	    sprintf(aptr, "_%s", pptr);
+	    if (pptr != sptr) free(pptr);
+	    pptr = aptr;
+	    dupl = 1;
          }
       }
 
@@ -3920,6 +3947,7 @@ bool checkname(objectptr newobj)
 			"existing object", newobj->name, pptr);
       strncpy(newobj->name, pptr, 79);
       free(pptr);
+      names_invalidate();
    }
    return true;
 }
@@ -4219,6 +4247,7 @@ objinstptr domakeobject(int libnum, char *name, bool forceempty)
 
    strcpy((*newobj)->name, name);
    checkname(*newobj);
+   names_addobject(LIBRARY + loclibnum, *newobj);
 
    /* register the technology and mark the technology as not saved */
    AddObjectTechnology(*newobj);
@@ -4294,8 +4323,8 @@ void patheditpush(pathptr lastpath)
 
 void delete_more(objinstptr thisinst, genericptr gen)
 {
-    objectptr thisobject, delobj;
-    short stmp;
+    objectptr thisobject = thisinst->thisobject, delobj;
+    int stmp;
     bool deleted = false;
 
     for (stmp = 0; stmp < thisobject->parts; stmp++) {
@@ -4307,7 +4336,7 @@ void delete_more(objinstptr thisinst, genericptr gen)
         /* If we destroy elements in the current window, we need to	   */
         /* make sure that the selection list is updated appropriately. */
         if (thisobject == topobject && areawin->selects != 0) {
-           for (short * sobj = areawin->selectlist; sobj < areawin->selectlist +
+           for (int * sobj = areawin->selectlist; sobj < areawin->selectlist +
                     areawin->selects; sobj++)
               if (*sobj > stmp) (*sobj)--;
         }
@@ -4327,8 +4356,12 @@ void delete_more(objinstptr thisinst, genericptr gen)
 
 void checkoverlap()
 {
-   short *sobj, *cobj;
+   int *sobj, *cobj;
    genericptr *sgen, *pgen;
+   int llx, lly, urx, ury;
+   SpatialIndex *sidx = spatial_index(topobject);
+   QVector<int> nearparts;
+   int nnext;
 
    QList<genericptr> tagged;
 
@@ -4338,10 +4371,27 @@ void checkoverlap()
 	areawin->selects; sobj++) {
       sgen = topobject->begin() + (*sobj);
 
+      /* A duplicate has the same bounding box, so on large pages only	*/
+      /* the elements overlapping it need to be compared.		*/
+
+      nearparts.clear();
+      if (sidx != NULL) {
+         calcinstbbox(sgen, &llx, &lly, &urx, &ury);
+         if ((llx <= urx) && (lly <= ury))
+            sidx->query(llx, lly, urx, ury, nearparts);
+      }
+      nnext = 0;
+
       /* For each object being copied, compare it against every object	*/
       /* on the current page (except self).  Flag if it's the same.	*/
 
-      for (pgen = 0; topobject->values(pgen); ) {
+      for (pgen = 0; ; ) {
+	 if (nearparts.size() > 0) {
+	    if (nnext >= nearparts.size()) break;
+	    pgen = topobject->begin() + nearparts[nnext++];
+	 }
+	 else if (!topobject->values(pgen)) break;
+
 	 if (pgen == sgen) continue;
          if (**sgen == **pgen) {
 	    /* Make sure that this object is not part of the selection, */
@@ -4376,7 +4426,7 @@ void checkoverlap()
 
 void placeselects(const XPoint & dlt, XPoint *userpt)
 {
-   short *dragselect;
+   int *dragselect;
    XPoint delta = dlt, newpos, *ppt;
    int rot;
    short closest;
@@ -4389,6 +4439,9 @@ void placeselects(const XPoint & dlt, XPoint *userpt)
 
    if (doattach) findattach(&newpos, &rot, userpt);
 
+   /* repaint the area vacated by the elements, and the area they move to */
+   invalidate_selected();
+
    for (dragselect = areawin->selectlist; dragselect < areawin->selectlist
       + areawin->selects; dragselect++) {
 
@@ -4405,13 +4458,10 @@ void placeselects(const XPoint & dlt, XPoint *userpt)
 	    else {
                draginst->position += delta;
 	    }
-            areawin->update();
-
 	 } break;
          case GRAPHIC: {
 	    graphicptr dragg = SELTOGRAPHIC(dragselect);
             dragg->position += delta;
-            areawin->update();
 	 } break;
 	 case LABEL: {
 	    labelptr draglabel = SELTOLABEL(dragselect);
@@ -4422,7 +4472,6 @@ void placeselects(const XPoint & dlt, XPoint *userpt)
 	    else {
                draglabel->position += delta;
 	    }
-            areawin->update();
 	 } break;
 	 case PATH: {
 	    pathptr dragpath = SELTOPATH(dragselect);
@@ -4435,7 +4484,6 @@ void placeselects(const XPoint & dlt, XPoint *userpt)
             for (pathlist = 0; dragpath->values(pathlist); ) {
                movepoints(pathlist, delta);
 	    }
-            areawin->update();
 	 } break;
 	 case POLYGON: {
             polyptr dragpoly = SELTOPOLY(dragselect);
@@ -4446,7 +4494,6 @@ void placeselects(const XPoint & dlt, XPoint *userpt)
                delta = newpos - dragpoly->points[closest];
 	    }
             dragpoly->points += delta;
-            areawin->update();
 	 } break;   
 	 case SPLINE: {
 	    splineptr dragspline = SELTOSPLINE(dragselect);
@@ -4466,7 +4513,6 @@ void placeselects(const XPoint & dlt, XPoint *userpt)
 	    for (j = 0; j < 4; j++) {
                dragspline->ctrl[j] += delta;
 	    }
-            areawin->update();
 	 } break;
 	 case ARC: {
 	    arcptr dragarc = SELTOARC(dragselect);
@@ -4480,10 +4526,11 @@ void placeselects(const XPoint & dlt, XPoint *userpt)
 		 points + dragarc->number; dragpoints++) {
                *dragpoints += delta;
 	    }
-            areawin->update();
          } break;
       }
+      spatial_update(topobject, SELTOGENERICPTR(dragselect));
    }
+   invalidate_selected();
 
    if (areawin->pinattach) {
        for (polyiter cpoly; topobject->values(cpoly); ) {
@@ -4492,8 +4539,10 @@ void placeselects(const XPoint & dlt, XPoint *userpt)
            newpos = *ppt + delta;
            if (areawin->manhatn)
               manhattanize(&newpos, cpoly, cpoly->cycle->number, false);
+           invalidate_element(cpoly.peek());
            *ppt = newpos;
-           areawin->update();
+           invalidate_element(cpoly.peek());
+           spatial_update(topobject, cpoly.peek());
         }
       }	
    }
@@ -4507,10 +4556,11 @@ void placeselects(const XPoint & dlt, XPoint *userpt)
 
 void createcopies()
 {
-   short *selectobj;
+   int *selectobj;
 
    if (!checkselect(ALL_TYPES, true)) return;
    u2u_snap(areawin->save);
+   allocstats_mark();
    for (selectobj = areawin->selectlist; selectobj < areawin->selectlist
 		+ areawin->selects; selectobj++) {
       topobject->append((*SELTOGENERICPTR(selectobj))->copy());
@@ -4518,6 +4568,7 @@ void createcopies()
       /* change selection from the old to the new object */
       *selectobj = topobject->parts - 1;
    }
+   allocstats_report("copy");
 }
 
 /*--------------------------------------------------------------*/
@@ -4765,7 +4816,7 @@ void finish_op(int op, int x, int y)
 			(int)(areawin->save.y - areawin->origin.y));
 	       pwriteback(areawin->topinstance);
 	       incr_changes(topobject);
-	       select_invalidate_netlist();
+	       select_move_netlist();
 	    }
 	    W3printf("");
 	    /* full calc needed: move may shrink bbox */
@@ -4944,7 +4995,7 @@ void path_op(genericptr editpart, int op, int x, int y)
 	          topobject->parts++;
                   areawin->update();
 	          incr_changes(topobject);
-		  if (!nonnetwork(newbox)) invalidate_netlist(topobject);
+		  add_netlist_wire(topobject, newbox);
                   register_for_undo(XCF_Box, UNDO_MORE, areawin->topinstance,
 					newbox);
 	       }
@@ -5209,7 +5260,8 @@ void path_op(genericptr editpart, int op, int x, int y)
    /* then register the move for the remaining items.		*/
 
    if (donecycles) {
-      short *eselect, cycle;
+      int *eselect;
+      short cycle;
       bool fullmove = false;
 
       for (eselect = areawin->selectlist; eselect < areawin->selectlist +
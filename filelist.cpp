@@ -94,6 +94,7 @@ char *getcrashfilename(const QString & filename)
 void crashrecover(QAction*, const QString &str, void*)
 {
    if (!xobjs.tempfile.isEmpty()) {
+      autosave_wait();
       QFile::remove(xobjs.tempfile);
    }
    xobjs.tempfile = str;
@@ -10,6 +10,7 @@
 #include <QTemporaryFile>
 #include <QAction>
 
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -34,6 +35,8 @@
 #include "prototypes.h"
 #include "xcqt.h"
 #include "colors.h"
+#include "autosave.h"
+#include "loadprogress.h"
 
 #ifdef ASG
 extern void Route(XCWindowData *, bool);
@@ -262,7 +265,7 @@ void freelabel(stringpart *string)
       if (strptr->type == TEXT_STRING || strptr->type == PARAM_START)
          free(strptr->data.string);
       tmpptr = strptr->nextpart;
-      free(strptr);
+      delete strptr;
       strptr = tmpptr;
    }
 }
@@ -322,7 +325,7 @@ void dostcount(FILE *ps, short *count, short addlength)
 /* substitution if appropriate.	 Returns true if substitution was done */
 /*----------------------------------------------------------------------*/
 
-bool varpcheck(FILE *ps, short value, objectptr localdata, int pointno,
+bool varpcheck(FILE *ps, int value, objectptr localdata, int pointno,
 	short *stptr, genericptr thiselem, u_char which)
 {
    oparamptr ops;
@@ -355,7 +358,7 @@ bool varpcheck(FILE *ps, short value, objectptr localdata, int pointno,
 /* like varpcheck(), but without pointnumber				*/
 /*----------------------------------------------------------------------*/
 
-void varcheck(FILE *ps, short value, objectptr localdata,
+void varcheck(FILE *ps, int value, objectptr localdata,
 	short *stptr, genericptr thiselem, u_char which)
 {
    varpcheck(ps, value, localdata, 0, stptr, thiselem, which);
@@ -392,7 +395,7 @@ void varfcheck(FILE *ps, float value, objectptr localdata, short *stptr,
 /* Like varpcheck(), for path types only.				*/
 /*----------------------------------------------------------------------*/
 
-bool varpathcheck(FILE *ps, short value, objectptr localdata, int pointno,
+bool varpathcheck(FILE *ps, int value, objectptr localdata, int pointno,
 	short *stptr, genericptr *thiselem, pathptr thispath, u_char which)
 {
    oparamptr ops;
@@ -564,6 +567,10 @@ bool xc_variable_expand(QString & filename)
    return false;
 } 
 
+/* stdio buffer size for files being read in */
+
+#define READBUFSIZE	(1 << 20)
+
 /*--------------------------------------------------------------*/
 /* Attempt to find a file and open it.				*/
 /*--------------------------------------------------------------*/
@@ -608,6 +615,10 @@ static FILE *common_open(const QString &filename, const char *suffix, const QStr
         if (file || pathidx > path.count()) break;
    }
 
+   /* Files are read a line at a time;  read them from disk in large	*/
+   /* blocks rather than the default of one filesystem block.		*/
+   if (file) setvbuf(file, NULL, _IOFBF, READBUFSIZE);
+
    if (name_return) *name_return = inname;
    return file;
 }
@@ -764,6 +775,7 @@ bool addalias(objectptr thisobj, char *newname)
       sref->alias = strdup(newname);
       sref->next = aref->aliases;
       aref->aliases = sref;
+      names_addalias(thisobj, newname);
       return false;
    }
    else return true;		/* alias already exists! */
@@ -793,6 +805,7 @@ void cleanupaliases(short mode)
       delete aliastop;
    delete aliastop;
    aliastop = NULL;
+   names_clearaliases();
 
    /* Get rid of propagating underscores in names */
 
@@ -1093,15 +1106,8 @@ bool CompareTechnology(objectptr cobj, char *technology)
 
 TechPtr LookupTechnology(char *technology)
 {
-   TechPtr nsp;
-
    if (technology == NULL) return NULL;
-
-   for (nsp = xobjs.technologies; nsp != NULL; nsp = nsp->next)
-      if (!strcmp(technology, nsp->technology))
-	 return nsp;
-
-   return NULL;
+   return names_findtech(technology);
 }
 
 /*------------------------------------------------------*/
@@ -1135,9 +1141,7 @@ TechPtr GetObjectTechnology(objectptr thisobj)
    if (cptr == NULL) return NULL;
    else *cptr = '\0';
 
-   for (nsp = xobjs.technologies; nsp != NULL; nsp = nsp->next)
-      if (!strcmp(thisobj->name, nsp->technology))
-	 break;
+   nsp = names_findtech(thisobj->name);
 
    *cptr = ':';
    return nsp;
@@ -1153,19 +1157,17 @@ TechPtr AddNewTechnology(char *technology, char *filename)
 
    if (technology == NULL) return NULL;
 
-   for (nsp = xobjs.technologies; nsp != NULL; nsp = nsp->next) {
-      if (!strcmp(technology, nsp->technology)) {
+   if ((nsp = names_findtech(technology)) != NULL) {
 
-	 /* A namespace may be created for an object that is a dependency */
-	 /* in a different technology.  If so, it will have a NULL	  */
-	 /* filename, and the filename should be replaced if we ever load */
-	 /* the file that properly defines the technology.		  */
+      /* A namespace may be created for an object that is a dependency */
+      /* in a different technology.  If so, it will have a NULL	       */
+      /* filename, and the filename should be replaced if we ever load */
+      /* the file that properly defines the technology.		       */
 
-	 if ((nsp->filename == NULL) && (filename != NULL)) 
-	    nsp->filename = strdup(filename);
+      if ((nsp->filename == NULL) && (filename != NULL)) 
+	 nsp->filename = strdup(filename);
 
-	 return nsp;	/* Namespace already exists */
-      }
+      return nsp;	/* Namespace already exists */
    }
 
    nsp = new Technology;
@@ -1177,6 +1179,7 @@ TechPtr AddNewTechnology(char *technology, char *filename)
    nsp->technology = strdup(technology);
    nsp->flags = (u_char)0;
    xobjs.technologies = nsp;
+   names_addtech(nsp);
 
    return nsp;
 }
@@ -1199,32 +1202,17 @@ void AddObjectTechnology(objectptr thisobj)
 }
 
 /*------------------------------------------------------*/
-/* Load a library page (given in parameter "mode") and	*/
-/* rename the library page to match the library name as */
-/* found in the file header.				*/
+/* Read the header and objects of library file "ps"	*/
+/* (named "inname") into library "mode", recording them	*/
+/* for the library cache.  The technology declared in	*/
+/* the header is returned in "nsptr".			*/
 /*------------------------------------------------------*/
 
-bool loadlibrary(short mode, const QString & filename)
+static bool readlibrary(FILE *ps, short mode, const QString & inname,
+	TechPtr *nsptr)
 {
-   FILE *ps;
    objinstptr saveinst;
-   QString inname;
    char temp[150], keyword[30], percentc;
-   TechPtr nsptr = NULL;
-
-   ps = libopen(filename, mode, &inname);
-
-   if ((ps == NULL) && (mode == FONTLIB)) {
-      /* We automatically try looking in all the usual places plus a	*/
-      /* subdirectory named "fonts".					*/
-
-      sprintf(temp, "fonts/%s", filename.toLocal8Bit().data());
-      ps = libopen(temp, mode, &inname);
-   }
-   if (ps == NULL) {
-      Wprintf("Library not found.");
-      return false;
-   }
 
    /* current version is PROG_VERSION;  however, all libraries newer than */
    /* version 2.0 require "Version" in the header.  So unnumbered	  */
@@ -1234,7 +1222,6 @@ bool loadlibrary(short mode, const QString & filename)
    for(;;) {
       if (fgets(temp, 149, ps) == NULL) {
          Wprintf("Error in library.");
-	 fclose(ps);
          return false;
       }
       sscanf(temp, "%c %29s", &percentc, keyword);
@@ -1266,7 +1253,7 @@ bool loadlibrary(short mode, const QString & filename)
 	       nptr = strrchr(cptr, '.');
 	       if ((nptr != NULL) && !strcmp(nptr, ".lps")) *nptr = '\0';
 
-               nsptr = AddNewTechnology(cptr, inname.toLocal8Bit().data());
+               *nsptr = AddNewTechnology(cptr, inname.toLocal8Bit().data());
 	    }
          }
 
@@ -1289,11 +1276,50 @@ bool loadlibrary(short mode, const QString & filename)
    areawin->topinstance = xobjs.libtop[mode];
 
    load_in_progress = true;
-   objectread(ps, topobject, 0, 0, mode, temp, DEFAULTCOLOR, nsptr);
+   libcache_begin(mode, inname, *nsptr);
+   objectread(ps, topobject, 0, 0, mode, temp, DEFAULTCOLOR, *nsptr);
+   libcache_end();
    load_in_progress = false;
    cleanupaliases(mode);
 
    areawin->topinstance = saveinst;
+   return true;
+}
+
+/*------------------------------------------------------*/
+/* Load a library page (given in parameter "mode") and	*/
+/* rename the library page to match the library name as */
+/* found in the file header.				*/
+/*------------------------------------------------------*/
+
+bool loadlibrary(short mode, const QString & filename)
+{
+   FILE *ps;
+   QString inname;
+   char temp[150];
+   TechPtr nsptr = NULL;
+
+   ps = libopen(filename, mode, &inname);
+
+   if ((ps == NULL) && (mode == FONTLIB)) {
+      /* We automatically try looking in all the usual places plus a	*/
+      /* subdirectory named "fonts".					*/
+
+      sprintf(temp, "fonts/%s", filename.toLocal8Bit().data());
+      ps = libopen(temp, mode, &inname);
+   }
+   if (ps == NULL) {
+      Wprintf("Library not found.");
+      return false;
+   }
+
+   /* Use the binary cache of the file if it is up to date */
+
+   if (!libcache_replay(mode, inname, &nsptr) &&
+		!readlibrary(ps, mode, inname, &nsptr)) {
+      fclose(ps);
+      return false;
+   }
 
    if (mode != FONTLIB) {
       composelib(mode);
@@ -1333,6 +1359,7 @@ void startloadfile(int libnum, const QString & filelist)
 
    foreach (QString file, files) {
       loadfile(0, libnum, file);
+      if (loadprogress_cancelled()) break;
 
       /* find next undefined page */
 
@@ -1364,7 +1391,10 @@ void normalloadfile(QAction*, const QString& str, void*)
 void importfile(QAction*, const QString& filelist, void*)
 {
    QStringList files = filelist.split(',', QString::SkipEmptyParts);
-   foreach (QString file, files) loadfile(1, -1, file);
+   foreach (QString file, files) {
+      loadfile(1, -1, file);
+      if (loadprogress_cancelled()) break;
+   }
 }
 
 /*--------------------------------------------------------------*/
@@ -1416,6 +1446,18 @@ void importspice(QAction*, void*, void*)
 
 #endif
 
+/*------------------------------------------------------*/
+/* Give up a load that has been cancelled.  The load is	*/
+/* undone by the caller's LoadProgress.			*/
+/*------------------------------------------------------*/
+
+static bool loadcancelled(FILE *ps, const QString &inname)
+{
+   fclose(ps);
+   Wprintf("Load of %ls cancelled.", inname.utf16());
+   return false;
+}
+
 /*--------------------------------------------------------------*/
 /* Load an xcircuit file into xcircuit				*/
 /*								*/
@@ -1484,6 +1526,10 @@ bool loadfile(short mode, int libnum, const QString & filename)
       loadlibrary(loclibnum, str);
       return true;
    }
+   else if (inname.endsWith(".xcb")) {
+      fclose(ps);
+      return loadxcb(mode, libnum, inname);
+   }
    
 
 #ifdef LGF
@@ -1546,6 +1592,12 @@ bool loadfile(short mode, int libnum, const QString & filename)
       return false;
    }
 
+   /* Progress is shown by position in the file.  A cancelled load is	*/
+   /* undone when "progress" goes out of scope.				*/
+
+   LoadProgress progress(mode, inname, (fstat(fileno(ps), &statbuf) == 0) ?
+		(qint64)statbuf.st_size : 0, ps);
+
    version = 1.0;
    multipage = 1;
    pagesize.x = 612;
@@ -1583,8 +1635,8 @@ bool loadfile(short mode, int libnum, const QString & filename)
                 }
 	 }
 	 else if ((temppmode == 1) && !strcmp(pdchar, "%BoundingBox:")) {
-	    short botx, boty;
-	    sscanf(temp, "%*s %hd %hd %hd %hd", &botx, &boty,
+	    int botx, boty;
+	    sscanf(temp, "%*s %d %d %d %d", &botx, &boty,
 		&(pagesize.x), &(pagesize.y));
 	    pagesize.x += botx;
 	    pagesize.y += boty;
@@ -1614,6 +1666,7 @@ bool loadfile(short mode, int libnum, const QString & filename)
          load_in_progress = true;
 	 objectread(ps, topobject, 0, 0, loclibnum, temp, DEFAULTCOLOR, NULL);
          load_in_progress = false;
+	 if (progress.cancelled()) return loadcancelled(ps, inname);
       }
 
       if (strstr(temp, "%%Page:") != NULL) {
@@ -1662,6 +1715,7 @@ bool loadfile(short mode, int libnum, const QString & filename)
       /* good so far;  let's clear out the old data structure */
 
       if (mode == 0) {
+         progress.holdpage();
          topobject->clear();
          pagereset(areawin->page);
          xobjs.pagelist[areawin->page].pmode = temppmode;
@@ -1694,12 +1748,12 @@ bool loadfile(short mode, int libnum, const QString & filename)
 
 	 if ((temppmode == 1) && strstr(temp, "%%PageBoundingBox:") != NULL) {
 	    /* Recast the individual page size if specified per page */
-	    sscanf(temp, "%*s %*d %*d %hd %hd",
+	    sscanf(temp, "%*s %*d %*d %d %d",
                 &xobjs.pagelist[areawin->page].pagesize.x,
                 &xobjs.pagelist[areawin->page].pagesize.y);
 	 }
 	 else if (strstr(temp, "drawingscale") != NULL)
-	    sscanf(temp, "%*c %hd:%hd %*s",
+	    sscanf(temp, "%*c %d:%d %*s",
                 &xobjs.pagelist[areawin->page].drawingscale.x,
                 &xobjs.pagelist[areawin->page].drawingscale.y);
 
@@ -1800,6 +1854,7 @@ bool loadfile(short mode, int libnum, const QString & filename)
       load_in_progress = true;
       objectread(ps, topobject, offx, offy, LIBRARY, temp, DEFAULTCOLOR, NULL);
       load_in_progress = false;
+      if (progress.cancelled()) return loadcancelled(ps, inname);
 
       /* skip to next page boundary or file trailer */
 
@@ -1851,6 +1906,7 @@ bool loadfile(short mode, int libnum, const QString & filename)
       /* set object position to fit to window separately for each page */
       calcbbox(areawin->topinstance);
       centerview(areawin->topinstance);
+      if (progress.pagedone()) return loadcancelled(ps, inname);
    }
 
    /* Crash file recovery: read any out-of-page library definitions tacked */
@@ -1859,6 +1915,7 @@ bool loadfile(short mode, int libnum, const QString & filename)
       load_in_progress = true;
       objectread(ps, topobject, 0, 0, USERLIB, temp, DEFAULTCOLOR, NULL);
       load_in_progress = false;
+      if (progress.cancelled()) return loadcancelled(ps, inname);
    }
 
    cleanupaliases(USERLIB);
@@ -2020,6 +2077,30 @@ void cleanuplabel(stringpart **strhead)
    }
 }
 
+/*----------------------------------------------------------------------*/
+/* Return the index of the font named "psname", loading the font if	*/
+/* it has not been loaded.  A font which cannot be found is replaced	*/
+/* by the first font.							*/
+/*----------------------------------------------------------------------*/
+
+int lookupfont(const char *psname)
+{
+   int j;
+
+   for (j = 0; j < fontcount; j++)
+      if (!strcmp(psname, fonts[j].psname))
+	 return j;
+
+   /* this is a non-loaded font */
+   if (loadfontfile(psname) >= 0) return j;
+
+   if (fontcount > 0)
+      Wprintf("Error:  Font \"%s\" not found---using default.", psname);
+   else
+      Wprintf("Error:  No fonts!");
+   return 0;
+}
+
 /*----------------------------------------------------------------------*/
 /* Read label segments							*/
 /*----------------------------------------------------------------------*/
@@ -2133,21 +2214,7 @@ void readlabel(objectptr localdata, char *lineptr, stringpart **strhead)
 	    *(nextptr++) = '\0';
 	    while (isspace(*nextptr)) nextptr++;
 
-            for (j = 0; j < fontcount; j++)
-               if (!strcmp(newptr, fonts[j].psname))
-	          break;
-
-            if (j == fontcount) 		/* this is a non-loaded font */
-               if (loadfontfile(newptr) < 0) {
-		  if (fontcount > 0) {
-		     Wprintf("Error:  Font \"%s\" not found---using default.", newptr);
-		     j = 0;
-		  }
-		  else {
-		     Wprintf("Error:  No fonts!");
-	    	     newpart->type = NOLINE;	/* placeholder */
-		  }
-	       }
+            j = lookupfont(newptr);
 
             if (isdigit(*nextptr)) { /* second form of "cf" command---includes scale */
 	       float locscale;
@@ -2240,6 +2307,45 @@ char *advancetoken(char *lineptr)
    return locptr;
 }
 
+/*--------------------------------------------------------------*/
+/* Scan an integer, as sscanf("%d") would but without the	*/
+/* format parsing.  Returns false, leaving "hvalue" alone, if	*/
+/* the input does not start with a number.			*/
+/*--------------------------------------------------------------*/
+
+static bool scanint(const char *lineptr, int *hvalue)
+{
+   long value = 0;
+   bool neg = false;
+
+   while (isspace(*lineptr)) lineptr++;
+   if ((*lineptr == '-') || (*lineptr == '+')) neg = (*lineptr++ == '-');
+   if (!isdigit(*lineptr)) return false;
+   for (; isdigit(*lineptr); lineptr++) {
+      if (value <= (LONG_MAX - 9) / 10) value = value * 10 + (*lineptr - '0');
+      else value = LONG_MAX;
+   }
+   if (value > INT_MAX) value = INT_MAX;
+   *hvalue = (int)(neg ? -value : value);
+   return true;
+}
+
+/*--------------------------------------------------------------*/
+/* Scan a float, as sscanf("%f") would.  The conversion itself	*/
+/* is left to strtof() so that values round exactly as before.	*/
+/*--------------------------------------------------------------*/
+
+static bool scanfloat(const char *lineptr, float *fvalue)
+{
+   char *endptr;
+   float value;
+
+   value = strtof(lineptr, &endptr);
+   if (endptr == lineptr) return false;
+   *fvalue = value;
+   return true;
+}
+
 /*------------------------------------------------------*/
 /* Read a parameter list for an object instance call.	*/
 /* This uses the key-value dictionary method but also	*/
@@ -2320,6 +2426,7 @@ void readparams(objectptr localdata, objinstptr newinst, objectptr libobj,
 	 else {
             for (fops = newinst->params; fops->next != NULL; fops = fops->next) ;
 	    fops->next = newops;
+	    newinst->params.invalidate();
 	 }
       }
       else {
@@ -2328,6 +2435,7 @@ void readparams(objectptr localdata, objinstptr newinst, objectptr libobj,
 	 else {
             for (fops = libobj->params; fops->next != NULL; fops = fops->next) ;
 	    fops->next = newops;
+	    libobj->params.invalidate();
 	 }
       }
 
@@ -2395,6 +2503,7 @@ void readparams(objectptr localdata, objinstptr newinst, objectptr libobj,
 	    newops->which = P_COLOR;
             newops->parameter.ivalue = qRgb(r * 255, g * 255, b * 255);
 	    addnewcolorentry(newops->parameter.ivalue);
+	    libcache_color(newops->parameter.ivalue);
 	    *substrend = csave;
 	 }
 	 else {
@@ -2503,20 +2612,20 @@ void readparams(objectptr localdata, objinstptr newinst, objectptr libobj,
 }
 
 /*--------------------------------------------------------------*/
-/* Read a value which might be a short integer or a parameter.	*/
+/* Read a value which might be an integer or a parameter.	*/
 /* If the value is a parameter, check the parameter list to see */
 /* if it needs to be re-typecast.  Return the position to the	*/
 /* next token in "lineptr".					*/
 /*--------------------------------------------------------------*/
 
-char *varpscan(objectptr localdata, char *lineptr, short *hvalue,
+char *varpscan(objectptr localdata, char *lineptr, int *hvalue,
 	genericptr thiselem, int pointno, int offset, u_char which)
 {
    oparamptr ops = NULL;
    char key[100];
    eparamptr newepp;
 
-   if (sscanf(lineptr, "%hd", hvalue) != 1) {
+   if (!scanint(lineptr, hvalue)) {
       parse_ps_string(lineptr, key, 99, false, true);
       ops = match_param(localdata, key);
       newepp = make_new_eparam(key);
@@ -2539,7 +2648,7 @@ char *varpscan(objectptr localdata, char *lineptr, short *hvalue,
 			((ops->parameter.fvalue < 0) ? -0.1 : 0.1));
 	 }
 	 ops->which = which;
-	 *hvalue = (short)ops->parameter.ivalue;
+	 *hvalue = ops->parameter.ivalue;
       }
       else {
 	 *hvalue = 0; /* okay; will get filled in later */
@@ -2547,22 +2656,36 @@ char *varpscan(objectptr localdata, char *lineptr, short *hvalue,
       }
    }
 
-   *hvalue -= (short)offset;
+   *hvalue -= offset;
   
    return advancetoken(skipwhitespace(lineptr));
 }
 
 /*--------------------------------------------------------------*/
-/* Read a value which might be a short integer or a parameter,	*/
+/* Read a value which might be an integer or a parameter,	*/
 /* but which is not a point in a pointlist.			*/
 /*--------------------------------------------------------------*/
 
-char *varscan(objectptr localdata, char *lineptr, short *hvalue,
+char *varscan(objectptr localdata, char *lineptr, int *hvalue,
 	 genericptr thiselem, u_char which)
 {
    return varpscan(localdata, lineptr, hvalue, thiselem, 0, 0, which);
 }
 
+/*--------------------------------------------------------------*/
+/* Same as above, for values (style, rotation) kept in a short	*/
+/*--------------------------------------------------------------*/
+
+char *varscan(objectptr localdata, char *lineptr, short *hvalue,
+	 genericptr thiselem, u_char which)
+{
+   int ivalue = *hvalue;
+
+   lineptr = varpscan(localdata, lineptr, &ivalue, thiselem, 0, 0, which);
+   *hvalue = (short)ivalue;
+   return lineptr;
+}
+
 /*--------------------------------------------------------------*/
 /* Read a value which might be a float or a parameter.		*/
 /* Return the position to the next token in "lineptr".		*/
@@ -2575,7 +2698,7 @@ char *varfscan(objectptr localdata, char *lineptr, float *fvalue,
    eparamptr newepp;
    char key[100];
 
-   if (sscanf(lineptr, "%f", fvalue) != 1) {
+   if (!scanfloat(lineptr, fvalue)) {
       parse_ps_string(lineptr, key, 99, false, true);
       ops = match_param(localdata, key);
       newepp = make_new_eparam(key);
@@ -2600,7 +2723,7 @@ char *varfscan(objectptr localdata, char *lineptr, float *fvalue,
 /* Same as varpscan(), but for path types only.			*/
 /*--------------------------------------------------------------*/
 
-char *varpathscan(objectptr localdata, char *lineptr, short *hvalue,
+char *varpathscan(objectptr localdata, char *lineptr, int *hvalue,
 	genericptr *thiselem, pathptr thispath, int pointno, int offset,
 	u_char which, eparamptr *nepptr)
 {
@@ -2610,7 +2733,7 @@ char *varpathscan(objectptr localdata, char *lineptr, short *hvalue,
 
    if (nepptr != NULL) *nepptr = NULL;
 
-   if (sscanf(lineptr, "%hd", hvalue) != 1) {
+   if (!scanint(lineptr, hvalue)) {
       parse_ps_string(lineptr, key, 99, false, true);
       ops = match_param(localdata, key);
       newepp = make_new_eparam(key);
@@ -2648,7 +2771,7 @@ char *varpathscan(objectptr localdata, char *lineptr, short *hvalue,
 			((ops->parameter.fvalue < 0) ? -0.1 : 0.1));
 	 }
 	 ops->which = which;
-	 *hvalue = (short)ops->parameter.ivalue;
+	 *hvalue = ops->parameter.ivalue;
       }
       else {
 	 *hvalue = 0; /* okay; will get filled in later */
@@ -2657,7 +2780,7 @@ char *varpathscan(objectptr localdata, char *lineptr, short *hvalue,
    }
 
 pathdone:
-   *hvalue -= (short)offset;
+   *hvalue -= offset;
    return advancetoken(skipwhitespace(lineptr));
 }
 
@@ -2694,6 +2817,35 @@ objinstptr addtoinstlist(int libnum, objectptr libobj, bool isvirtual)
    return newinst;
 }
 
+/*--------------------------------------------------------------*/
+/* Find the object called by an instance named "name" in a	*/
+/* file being read into library "mode".  Objects which have a	*/
+/* technology ("<lib>::<obj>") must compare exactly.  Objects	*/
+/* which don't will match any object of the same name in any	*/
+/* library technology.  Names with appended underscores match	*/
+/* if they are on the list of aliases.				*/
+/*--------------------------------------------------------------*/
+
+objectptr findinstobject(short mode, char *name)
+{
+   objectptr *matches;
+   char *libobjname;
+   bool matchtech = (strstr(name, "::") == NULL) ? false : true;
+   int k, nmatch;
+
+   nmatch = names_find(mode, name, !matchtech, &matches, NULL);
+   for (k = 0; k < nmatch; k++) {
+      libobjname = matches[k]->name;
+      if (!matchtech) {
+	 char *objnamestart = strstr(libobjname, "::");
+	 if (objnamestart != NULL) libobjname = objnamestart + 2;
+      }
+      if (!strcmp(name, libobjname) || names_isalias(matches[k], name))
+	 return matches[k];
+   }
+   return NULL;
+}
+
 /*--------------------------------------------------------------*/
 /* Deal with object reads:  Create a new object and prepare for	*/
 /* reading.  The library number is passed as "mode".		*/
@@ -2703,12 +2855,12 @@ objectptr *new_library_object(short mode, char *name, objlistptr *retlist,
 		TechPtr defaulttech)
 {
    objlistptr newdef, redef = NULL;
-   objectptr *newobject, *libobj;
+   objectptr *newobject, *matches;
    objectptr *curlib = (mode == FONTLIB) ?
 		xobjs.fontlib.library : xobjs.userlibs[mode - LIBRARY].library;
    short *libobjects = (mode == FONTLIB) ?
 		&xobjs.fontlib.number : &xobjs.userlibs[mode - LIBRARY].number;
-   int i, j;
+   int i, nmatch, *matchlibs;
    char *nsptr, *fullname = name;
 
    curlib = (objectptr *) realloc(curlib, (*libobjects + 1)
@@ -2734,39 +2886,22 @@ objectptr *new_library_object(short mode, char *name, objlistptr *retlist,
    *newobject = new object;
 
    /* check that this object is not already in list of objects */
+   /* (a font character may be a redefinition of another;  an	*/
+   /* object may be a redefinition of another object)		*/
 
-   if (mode == FONTLIB) {
-      for (libobj = xobjs.fontlib.library; libobj != xobjs.fontlib.library +
-            xobjs.fontlib.number; libobj++) {
-	 /* This font character may be a redefinition of another */
-	 if (!objnamecmp(fullname, (*libobj)->name)) {
-            newdef = new objlist;
-	    newdef->libno = FONTLIB;
-	    newdef->thisobject = *libobj;
-	    newdef->next = redef;
-	    redef = newdef;
-	 }
-      }
-   }
-   else {
-      for (i = 0; i < xobjs.numlibs; i++) {
-	 for (j = 0; j < xobjs.userlibs[i].number; j++) {
-	    libobj = xobjs.userlibs[i].library + j;
-	    /* This object may be a redefinition of another object */
-	    if (!objnamecmp(fullname, (*libobj)->name)) {
-               newdef = new objlist;
-	       newdef->libno = i + LIBRARY;
-	       newdef->thisobject = *libobj;
-	       newdef->next = redef;
-	       redef = newdef;
-	    }
-	 }
-      }
+   nmatch = names_find(mode, fullname, false, &matches, &matchlibs);
+   for (i = 0; i < nmatch; i++) {
+      newdef = new objlist;
+      newdef->libno = (mode == FONTLIB) ? FONTLIB : (matchlibs[i] + LIBRARY);
+      newdef->thisobject = matches[i];
+      newdef->next = redef;
+      redef = newdef;
    }
 
    (*libobjects)++;
    sprintf((*newobject)->name, "%s", fullname);
    if (fullname != name) free(fullname);
+   names_addobject(mode, *newobject);
 
    /* object::object() initialized schemtype to PRIMARY;  change it. */
    (*newobject)->schemtype = (mode == FONTLIB) ? GLYPH : SYMBOL;
@@ -2817,9 +2952,10 @@ bool library_object_unique(short mode, objectptr newobject, objlistptr redef)
 	     newdef->thisobject->symschem->symschem = newdef->thisobject;
 	  }
 
+	  (*libobjects)--;
+	  names_removeobject(mode, newobject);
           delete newobject;
           newobject = NULL;
-	  (*libobjects)--;
 	  is_unique = false;
 	  break;
        }
@@ -2836,9 +2972,10 @@ bool library_object_unique(short mode, objectptr newobject, objlistptr redef)
 	  TechPtr nsptr = GetObjectTechnology(newobject);
 
 	  if (nsptr && (nsptr->flags & LIBRARY_REPLACE)) {
+	     (*libobjects)--;
+	     names_removeobject(mode, newobject);
              delete newobject;
              newobject = NULL;
-	     (*libobjects)--;
 	     is_unique = false;
 	  }
 	  else
@@ -3038,6 +3175,106 @@ void readimagedata(FILE *ps, int width, int height)
    for (x = 0; x < 5; x++) fgets(temp, 149, ps);  /* skip image dictionary */
 }
 
+/*--------------------------------------------------------------*/
+/* Keywords recognized by objectread()				*/
+/*--------------------------------------------------------------*/
+
+enum {
+   PS_NONE = 0, PS_SHOWPAGE, PS_SCB, PS_SCE, PS_BEGINPATH, PS_ENDPATH,
+   PS_POLYC, PS_ARC, PS_ARCN, PS_PELLIP, PS_NELLIP, PS_CURVETO, PS_XCARC,
+   PS_ELLIPSE, PS_POLYGON, PS_WIRE, PS_SPLINE, PS_GRAPHIC, PS_FONTSET,
+   PS_LABEL, PS_PINLABEL, PS_PINGLOBAL, PS_INFOLABEL, PS_IS_SCHEMATIC,
+   PS_BBOX, PS_HIDDEN, PS_LIBINST, PS_BEGINOBJ, PS_DEF, PS_LOADFONTENCODING,
+   PS_LOADLIBRARY, PS_BEGINPARM, PS_NONETWORK, PS_TRIVIAL, PS_BEGINGATE,
+   PS_TRAILER, PS_ENDLIB, PS_RESTORE, PS_GRESTORE, PS_ENDGATE, PS_XYARRAY
+};
+
+static const struct {
+   const char *name;
+   int id;
+} pskeywords[] = {
+   {"showpage", PS_SHOWPAGE}, {"scb", PS_SCB}, {"sce", PS_SCE},
+   {"beginpath", PS_BEGINPATH}, {"endpath", PS_ENDPATH},
+   {"polyc", PS_POLYC}, {"arc", PS_ARC}, {"arcn", PS_ARCN},
+   {"pellip", PS_PELLIP}, {"nellip", PS_NELLIP}, {"curveto", PS_CURVETO},
+   {"xcarc", PS_XCARC}, {"ellipse", PS_ELLIPSE}, {"polygon", PS_POLYGON},
+   {"wire", PS_WIRE}, {"spline", PS_SPLINE}, {"graphic", PS_GRAPHIC},
+   {"fontset", PS_FONTSET}, {"label", PS_LABEL}, {"pinlabel", PS_PINLABEL},
+   {"pinglobal", PS_PINGLOBAL}, {"infolabel", PS_INFOLABEL},
+   {"is_schematic", PS_IS_SCHEMATIC}, {"bbox", PS_BBOX},
+   {"hidden", PS_HIDDEN}, {"libinst", PS_LIBINST}, {"{", PS_BEGINOBJ},
+   {"def", PS_DEF}, {"loadfontencoding", PS_LOADFONTENCODING},
+   {"loadlibrary", PS_LOADLIBRARY}, {"beginparm", PS_BEGINPARM},
+   {"nonetwork", PS_NONETWORK}, {"trivial", PS_TRIVIAL},
+   {"begingate", PS_BEGINGATE}, {"%%Trailer", PS_TRAILER},
+   {"EndLib", PS_ENDLIB}, {"restore", PS_RESTORE},
+   {"grestore", PS_GRESTORE}, {"endgate", PS_ENDGATE},
+   {"xyarray", PS_XYARRAY}
+};
+
+#define PSKEYSLOTS	128	/* power of two, well above the keyword count */
+
+static inline u_int pskeyhash(const char *key)
+{
+   u_int h = 2166136261u;
+
+   for (; *key != '\0'; key++) h = (h ^ (u_char)*key) * 16777619u;
+   return h;
+}
+
+/* Slots of the keyword hash table, holding indexes into pskeywords[] + 1 */
+
+struct PsKeySlots {
+   short slot[PSKEYSLOTS];
+
+   PsKeySlots() {
+      u_int h;
+      int i;
+
+      memset(slot, 0, sizeof(slot));
+      for (i = 0; i < (int)(sizeof(pskeywords) / sizeof(pskeywords[0])); i++) {
+	 for (h = pskeyhash(pskeywords[i].name); slot[h & (PSKEYSLOTS - 1)] != 0; h++) ;
+	 slot[h & (PSKEYSLOTS - 1)] = i + 1;
+      }
+   }
+};
+
+/*--------------------------------------------------------------*/
+/* Return the keyword ID of a token, or PS_NONE.  The table is	*/
+/* open-addressed, so a lookup costs one hash and (almost	*/
+/* always) one string comparison.				*/
+/*--------------------------------------------------------------*/
+
+static int pskeyword(const char *key)
+{
+   static const PsKeySlots table;
+   u_int h;
+   int i;
+
+   for (h = pskeyhash(key); table.slot[h & (PSKEYSLOTS - 1)] != 0; h++) {
+      i = table.slot[h & (PSKEYSLOTS - 1)] - 1;
+      if (!strcmp(key, pskeywords[i].name)) return pskeywords[i].id;
+   }
+   return PS_NONE;
+}
+
+/*--------------------------------------------------------------*/
+/* Copy the token at "keyptr" into "keyword" (79 characters at	*/
+/* most).  As with sscanf("%79s"), "keyword" is left alone if	*/
+/* there is no token.						*/
+/*--------------------------------------------------------------*/
+
+static void copykeyword(const char *keyptr, char *keyword)
+{
+   int i;
+
+   while (isspace(*keyptr)) keyptr++;
+   if (*keyptr == '\0') return;
+   for (i = 0; (i < 79) && (*keyptr != '\0') && !isspace(*keyptr); i++)
+      keyword[i] = *keyptr++;
+   keyword[i] = '\0';
+}
+
 /*--------------------------------------------------------------*/
 /* Read an object (page) from a file into xcircuit		*/
 /*--------------------------------------------------------------*/
@@ -3046,13 +3283,13 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 	short mode, char *retstr, int ccolor, TechPtr defaulttech)
 {
    char *temp, *buffer, keyword[80];
+   int kw;
    short tmpfont = -1;
    float tmpscale = 0.0;
-   objectptr	*libobj;
    int curcolor = ccolor;
    char *colorkey = NULL;
-   int i, j, k;
-   short px, py;
+   int i;
+   int px, py;
    objinstptr *newinst;
    eparamptr epptrx, epptry;	/* used for paths only */
 
@@ -3082,9 +3319,10 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
       if (lineptr != buffer) {  /* ignore any blank lines */
          for (keyptr = lineptr - 1; isspace(*keyptr) && keyptr != buffer; keyptr--) ;
          for (; !isspace(*keyptr) && keyptr != buffer; keyptr--) ;
-         sscanf(keyptr, "%79s", keyword);
+         copykeyword(keyptr, keyword);
+         kw = pskeyword(keyword);
 
-         if (!strcmp(keyword, "showpage")) {
+         if (kw == PS_SHOWPAGE) {
             strncpy(retstr, buffer, 150);
             retstr[149] = '\0';
 	    free(buffer);
@@ -3125,11 +3363,12 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 
 	 /* make a color change, adding the color if necessary */
 
-	 else if (!strcmp(keyword, "scb")) {
+	 else if (kw == PS_SCB) {
 	    float red, green, blue;
 	    if (sscanf(buffer, "%f %f %f", &red, &green, &blue) == 3) {
                curcolor = qRgb(red * 255, green * 255, blue * 255);
 	       addnewcolorentry(curcolor);
+	       libcache_color(curcolor);
 	       colorkey = NULL;
 	    }
 	    else {
@@ -3158,14 +3397,14 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 
 	 /* end the color change, returning to default */
 
-	 else if (!strcmp(keyword, "sce")) {
+	 else if (kw == PS_SCE) {
 	    curcolor = ccolor;
 	    colorkey = NULL;
 	 }
 
 	 /* begin a path constructor */
 
-	 else if (!strcmp(keyword, "beginpath")) {
+	 else if (kw == PS_BEGINPATH) {
             px = py = 0;
 	    
             newpath = localdata->append(new path);
@@ -3205,7 +3444,7 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 
 	 /* end the path constructor */
 
-	 else if (!strcmp(keyword, "endpath")) {
+	 else if (kw == PS_ENDPATH) {
 
             lineptr = varscan(localdata, buffer, (short int*)&(*newpath)->style,
                         *newpath, P_STYLE);
@@ -3222,7 +3461,7 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 
 	 /* read path parts */
 
-	 else if (!strcmp(keyword, "polyc")) {
+	 else if (kw == PS_POLYC) {
 	    polyptr *newpoly;
             XPoint* newpoints;
 	    short tmpnum;
@@ -3301,7 +3540,7 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
             startpoint = *(newpoints + (*newpoly)->points.count() - 1);
 	 }
 
-	 else if (!strcmp(keyword, "arc") || !strcmp(keyword, "arcn")) {
+	 else if (kw == PS_ARC || kw == PS_ARCN) {
 	    arcptr *newarc;
             newarc = (*newpath)->append(new arc);
 	    (*newarc)->width = 1.0;
@@ -3321,7 +3560,7 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
                         *newarc, P_ANGLE2);
 
 	    (*newarc)->yaxis = (*newarc)->radius;
-	    if (!strcmp(keyword, "arcn")) {
+	    if (kw == PS_ARCN) {
 	       float tmpang = (*newarc)->angle1;
 	       (*newarc)->radius = -((*newarc)->radius);
 	       (*newarc)->angle1 = (*newarc)->angle2;
@@ -3333,7 +3572,7 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
             (*newpath)->replace_last(new spline(**newarc));
 	 }
 
-	 else if (!strcmp(keyword, "pellip") || !strcmp(keyword, "nellip")) {
+	 else if (kw == PS_PELLIP || kw == PS_NELLIP) {
 	    arcptr *newarc;
             newarc = (*newpath)->append(new arc);
 	    (*newarc)->width = 1.0;
@@ -3354,7 +3593,7 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 	    lineptr = varfscan(localdata, lineptr, &(*newarc)->angle2,
                         *newarc, P_ANGLE2);
 
-	    if (!strcmp(keyword, "nellip")) {
+	    if (kw == PS_NELLIP) {
 	       float tmpang = (*newarc)->angle1;
 	       (*newarc)->radius = -((*newarc)->radius);
 	       (*newarc)->angle1 = (*newarc)->angle2;
@@ -3366,7 +3605,7 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
             (*newpath)->replace_last(new spline(**newarc));
 	 }
 
-	 else if (!strcmp(keyword, "curveto")) {
+	 else if (kw == PS_CURVETO) {
 	    splineptr *newspline;
             newspline = (*newpath)->append(new spline);
             px = py = 0;
@@ -3443,7 +3682,7 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 
          /* read arcs */
 
-         else if (!strcmp(keyword, "xcarc")) {
+         else if (kw == PS_XCARC) {
             arcptr *newarc;
             newarc = localdata->append(new arc);
             (*newarc)->color = curcolor;
@@ -3451,7 +3690,7 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 
 	    /* backward compatibility */
 	    if (version < 1.5) {
-	       sscanf(buffer, "%hd %hd %hd %f %f %f %hd", &(*newarc)->position.x,
+	       sscanf(buffer, "%d %d %d %f %f %f %hd", &(*newarc)->position.x,
 	          &(*newarc)->position.y, &(*newarc)->radius, &(*newarc)->angle1,
 	          &(*newarc)->angle2, &(*newarc)->width, &(*newarc)->style);
 	       (*newarc)->position.x -= offx;
@@ -3481,7 +3720,7 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 
 	 /* read ellipses */
 
-         else if (!strcmp(keyword, "ellipse")) {
+         else if (kw == PS_ELLIPSE) {
 	    arcptr *newarc;
             newarc = localdata->append(new arc);
             (*newarc)->color = curcolor;
@@ -3511,7 +3750,7 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
          /* read polygons */
 	 /* (and wires---backward compatibility for v1.5 and earlier) */
 
-         else if (!strcmp(keyword, "polygon") || !strcmp(keyword, "wire")) {
+         else if (kw == PS_POLYGON || kw == PS_WIRE) {
 	    polyptr *newpoly;
             XPoint* newpoints;
             px = py = 0;
@@ -3521,7 +3760,7 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 
             (*newpoly)->cycle = NULL;
 
-	    if (!strcmp(keyword, "wire")) {
+	    if (kw == PS_WIRE) {
                (*newpoly)->points.resize(2);
 	       (*newpoly)->width = 1.0;
 	       (*newpoly)->style = UNCLOSED;
@@ -3587,7 +3826,7 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 
 	 /* read spline curves */
 
-         else if (!strcmp(keyword, "spline")) {
+         else if (kw == PS_SPLINE) {
             splineptr *newspline;
             px = py = 0;
 
@@ -3597,7 +3836,7 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 
 	    /* backward compatibility */
 	    if (version < 1.5) {
-               sscanf(buffer, "%f %hd %hd %hd %hd %hd %hd %hd %hd %hd", 
+               sscanf(buffer, "%f %d %d %d %d %d %d %d %d %hd", 
 	          &(*newspline)->width, &(*newspline)->ctrl[1].x,
 	          &(*newspline)->ctrl[1].y, &(*newspline)->ctrl[2].x,
 	          &(*newspline)->ctrl[2].y, &(*newspline)->ctrl[3].x,
@@ -3660,12 +3899,13 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 
          /* read graphics image instances */
 
-	 else if (!strcmp(keyword, "graphic")) {
+	 else if (kw == PS_GRAPHIC) {
             graphicptr *newgp;
 	    Imagedata *img;
 
             newgp = localdata->append(new graphic);
             (*newgp)->color = curcolor;
+	    libcache_reject();
 
 	    lineptr = buffer + 1;
 	    for (i = 0; i < xobjs.images; i++) {
@@ -3691,7 +3931,7 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 
          /* read labels */
 
-         else if (!strcmp(keyword, "fontset")) { 	/* old style */
+         else if (kw == PS_FONTSET) { 	/* old style */
             char tmpstring[100];
             int i;
             sscanf(buffer, "%f %*c%99s", &tmpscale, tmpstring);
@@ -3703,8 +3943,8 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 	    if (i == fontcount) i = 0;	/* Why bother with anything fancy? */
          }
 
-         else if (!strcmp(keyword, "label") || !strcmp(keyword, "pinlabel")
-		|| !strcmp(keyword, "pinglobal") || !strcmp(keyword, "infolabel")) {
+         else if (kw == PS_LABEL || kw == PS_PINLABEL
+		|| kw == PS_PINGLOBAL || kw == PS_INFOLABEL) {
 
 	    labelptr *newlabel;
 	    stringpart *firstscale, *firstfont;
@@ -3729,7 +3969,7 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 	    }
 	    /* no. segments is ignored---may be a derived quantity, anyway */
 	    if (version < 2.25) {
-	       sscanf(lineptr, "%*s %hd %hd %hd %hd", &(*newlabel)->justify,
+	       sscanf(lineptr, "%*s %hd %hd %d %d", &(*newlabel)->justify,
 		   &(*newlabel)->rotation, &(*newlabel)->position.x,
 		   &(*newlabel)->position.y);
 	       (*newlabel)->position.x -= offx; (*newlabel)->position.y -= offy;
@@ -3754,13 +3994,13 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 	    while ((*newlabel)->rotation < 0) (*newlabel)->rotation += 360;
 
 	    (*newlabel)->pin = false;
-	    if (strcmp(keyword, "label")) {	/* all the schematic types */
+	    if (kw != PS_LABEL) {	/* all the schematic types */
 	       /* enable schematic capture if it is not already on. */
-	       if (!strcmp(keyword, "pinlabel"))
+	       if (kw == PS_PINLABEL)
 		  (*newlabel)->pin = LOCAL;
-	       else if (!strcmp(keyword, "pinglobal"))
+	       else if (kw == PS_PINGLOBAL)
 		  (*newlabel)->pin = GLOBAL;
-	       else if (!strcmp(keyword, "infolabel")) {
+	       else if (kw == PS_INFOLABEL) {
 		  /* Do not turn top-level pages into symbols! */
 		  /* Info labels on schematics are treated differently. */
 		  if (localdata != topobject)
@@ -3810,16 +4050,17 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 
 	 /* read symbol-to-schematic connection */
 
-	 else if (!strcmp(keyword, "is_schematic")) {
+	 else if (kw == PS_IS_SCHEMATIC) {
 	    char tempstr[50];
             for (lineptr = buffer; *lineptr == ' '; lineptr++) ;
             parse_ps_string(++lineptr, tempstr, 49, false, false);
 	    checksym(localdata, tempstr);
+	    libcache_reject();
 	 }
 
          /* read bounding box (font files only)	*/
 
-         else if (!strcmp(keyword, "bbox")) {
+         else if (kw == PS_BBOX) {
             for (lineptr = buffer; *lineptr == ' '; lineptr++) ;
             if (*lineptr != '%') {
 	       Wprintf("Illegal bbox.");
@@ -3827,31 +4068,32 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
                *retstr = '\0';
 	       return true;
 	    }
-	    sscanf(++lineptr, "%hd %hd %hd %hd",
+	    sscanf(++lineptr, "%d %d %d %d",
 		&localdata->bbox.lowerleft.x, &localdata->bbox.lowerleft.y,
 		&localdata->bbox.width, &localdata->bbox.height);
          }
 
 	 /* read "hidden" attribute */
 
-	 else if (!strcmp(keyword, "hidden")) {
+	 else if (kw == PS_HIDDEN) {
 	    localdata->hidden = true;
 	 }
 
 	 /* read "libinst" special instance of a library part */
 
-	 else if (!strcmp(keyword, "libinst")) {
+	 else if (kw == PS_LIBINST) {
 
 	    /* Read backwards from keyword to find name of object instanced. */
 	    for (lineptr = keyptr; *lineptr != '/' && lineptr > buffer;
                         lineptr--) ;
             parse_ps_string(++lineptr, keyword, 79, false, false);
+	    libcache_libinst(keyword, buffer);
 	    new_library_instance(mode - LIBRARY, keyword, buffer, defaulttech);
 	 }
 
 	 /* read objects */
 
-         else if (!strcmp(keyword, "{")) {  /* This is an object definition */
+         else if (kw == PS_BEGINOBJ) {  /* This is an object definition */
 	    objlistptr redef;
 	    objectptr *newobject;
 
@@ -3863,35 +4105,47 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 	    }
             parse_ps_string(lineptr, keyword, 79, false, false);
 
+	    libcache_beginobject(keyword);
 	    newobject = new_library_object(mode, keyword, &redef, defaulttech);
 
 	    if (objectread(ps, *newobject, 0, 0, mode, retstr, curcolor,
                         defaulttech)) {
+	       libcache_reject();
                strncpy(retstr, buffer, 150);
                retstr[149] = '\0';
 	       free(buffer);
 	       return true;
             }
 	    else {
-	       if (library_object_unique(mode, *newobject, redef))
+	       libcache_endobject(*newobject);
+	       if (library_object_unique(mode, *newobject, redef)) {
 	          add_object_to_library(mode, *newobject);
+	          libcache_addedobject(mode, *newobject);
+	       }
+	       if (loadprogress_step(ps)) {
+		  libcache_reject();
+		  free(buffer);
+		  *retstr = '\0';
+		  return true;
+	       }
 	    }
          }
-         else if (!strcmp(keyword, "def")) {
+         else if (kw == PS_DEF) {
             strncpy(retstr, buffer, 150);
             retstr[149] = '\0';
 	    free (buffer);
 	    return false; /* end of object def or end of object library */
 	 }
 
-	 else if (!strcmp(keyword, "loadfontencoding")) {
+	 else if (kw == PS_LOADFONTENCODING) {
 	    /* Deprecated, but retained for backward compatibility. */
 	    /* Load from script, .xcircuitrc, or command line instead. */
             for (lineptr = buffer; *lineptr != '%'; lineptr++) ;
 	    sscanf (lineptr + 1, "%149s", _STR);
 	    if (*(lineptr + 1) != '%') loadfontfile(_STR);
+	    libcache_reject();
 	 }
-	 else if (!strcmp(keyword, "loadlibrary")) {
+	 else if (kw == PS_LOADLIBRARY) {
 	    /* Deprecated, but retained for backward compatibility */
 	    /* Load from script, .xcircuitrc, or command line instead. */
 	    int ilib, tlib;
@@ -3913,8 +4167,9 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 	       mode = ilib - 1 + LIBRARY;
 	    }
             loadlibrary(mode, str);
+	    libcache_reject();
 	 }
-	 else if (!strcmp(keyword, "beginparm")) { /* parameterized object */
+	 else if (kw == PS_BEGINPARM) { /* parameterized object */
 	    short tmpnum, i;
             for (--keyptr; *keyptr == ' '; keyptr--) ;
             for (; isdigit(*keyptr) && (keyptr >= buffer); keyptr--) ;
@@ -3929,10 +4184,10 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 		  oparamptr newops;
 
                   newops = new oparam;
-		  newops->next = localdata->params;
-		  localdata->params = newops;
 		  newops->key = (char *)malloc(6);
 		  sprintf(newops->key, "v%d", i + 1);
+		  newops->next = localdata->params;
+		  localdata->params = newops;
 
 		  if (*lineptr == '(' || *lineptr == '{') {  /* type is XC_STRING */
 		     char *linetmp, csave;
@@ -3971,28 +4226,28 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 	       }
 	    }
 	 }
-	 else if (!strcmp(keyword, "nonetwork")) {
+	 else if (kw == PS_NONETWORK) {
 	    localdata->valid = true;
 	    localdata->schemtype = NONETWORK;
 	 }
-	 else if (!strcmp(keyword, "trivial")) {
+	 else if (kw == PS_TRIVIAL) {
 	    localdata->schemtype = TRIVIAL;
 	 }
-         else if (!strcmp(keyword, "begingate")) {
+         else if (kw == PS_BEGINGATE) {
 	    localdata->params = NULL;
 	    /* read dictionary of parameter key:value pairs */
 	    readparams(NULL, NULL, localdata, buffer);
 	 }
 
-         else if (!strcmp(keyword, "%%Trailer")) break;
-         else if (!strcmp(keyword, "EndLib")) break;
-	 else if (!strcmp(keyword, "restore"));    /* handled at top */
-	 else if (!strcmp(keyword, "grestore"));   /* ignore */
-         else if (!strcmp(keyword, "endgate"));    /* also ignore */
-	 else if (!strcmp(keyword, "xyarray"));	   /* ignore for now */
+         else if (kw == PS_TRAILER) break;
+         else if (kw == PS_ENDLIB) break;
+	 else if (kw == PS_RESTORE);    /* handled at top */
+	 else if (kw == PS_GRESTORE);   /* ignore */
+         else if (kw == PS_ENDGATE);    /* also ignore */
+	 else if (kw == PS_XYARRAY);	   /* ignore for now */
          else {
-	    char *tmpptr, *libobjname;
-	    bool matchtech, found = false;
+	    char *tmpptr;
+	    objectptr instobj;
 
 	    /* First, make sure this is not a general comment line */
 	    /* Return if we have a page boundary	   	   */
@@ -4001,6 +4256,7 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
             for (tmpptr = buffer; isspace(*tmpptr); tmpptr++) ;
 	    if (*tmpptr == '%') {
 	       if (strstr(buffer, "%%Page:") == tmpptr) {
+		  libcache_reject();
                   strncpy(retstr, buffer, 150);
                   retstr[149] = '\0';
 		  free (buffer);
@@ -4010,102 +4266,55 @@ bool objectread(FILE *ps, objectptr localdata, short offx, short offy,
 		  int width, height;
 		  sscanf(buffer, "%*s %d %d", &width, &height);
 		  readimagedata(ps, width, height);
+		  libcache_reject();
 	       }
 	       continue;
 	    }
 
             parse_ps_string(keyword, keyword, 79, false, false);
-            matchtech =  (strstr(keyword, "::") == NULL) ? false : true;
 
 	    /* (Assume that this line calls an object instance) */
-	    /* Double loop through user libraries 		*/
-
-            for (k = 0; k < ((mode == FONTLIB) ? 1 : xobjs.numlibs); k++) {
-	       for (j = 0; j < ((mode == FONTLIB) ? xobjs.fontlib.number :
-			xobjs.userlibs[k].number); j++) {
-
-		  libobj = (mode == FONTLIB) ? xobjs.fontlib.library + j :
-			xobjs.userlibs[k].library + j;
-
-		  /* Objects which have a technology ("<lib>::<obj>")	*/
-		  /* must compare exactly.  Objects which don't	 will	*/
-		  /* match any object of the same name in any library	*/
-		  /* technology.					*/
-
-		  libobjname = (*libobj)->name;
-		  if (!matchtech) {
-		     char *objnamestart = strstr(libobjname, "::");
-		     if (objnamestart != NULL) libobjname = objnamestart + 2;
+	    /* Look up the name in the user (or font) libraries	*/
+
+	    if ((instobj = findinstobject(mode, keyword)) != NULL) {
+	       newinst = localdata->append(new objinst);
+	       (*newinst)->thisobject = instobj;
+	       (*newinst)->color = curcolor;
+	       (*newinst)->bbox.lowerleft = instobj->bbox.lowerleft;
+	       (*newinst)->bbox = instobj->bbox;
+	       libcache_instance(*newinst, keyword);
+
+	       lineptr = varfscan(localdata, buffer, &(*newinst)->scale,
+			*newinst, P_SCALE);
+	       lineptr = varscan(localdata, lineptr, &(*newinst)->rotation,
+			*newinst, P_ROTATION);
+	       lineptr = varpscan(localdata, lineptr, &(*newinst)->position.x,
+			*newinst, 0, offx, P_POSITION_X);
+	       lineptr = varpscan(localdata, lineptr, &(*newinst)->position.y,
+			*newinst, 0, offy, P_POSITION_Y);
+
+	       /* Negative rotations = flip in x in version 2.3.6 and    */
+	       /* earlier.  Later versions don't allow negative rotation */
+
+	       if (version < 2.4) {
+		  if ((*newinst)->rotation < 0) {
+		     (*newinst)->scale = -((*newinst)->scale);
+		     (*newinst)->rotation++;
 		  }
-	          if (!objnamecmp(keyword, libobjname)) {
-
-		     /* If the name is not exactly the same (appended underscores) */
-		     /* check if the name is on the list of aliases. */
-
-		     if (strcmp(keyword, libobjname)) {
-			bool is_alias = false;
-			aliasptr ckalias = aliastop;
-			slistptr sref;
-
-			for (; ckalias != NULL; ckalias = ckalias->next) {
-			   if (ckalias->baseobj == (*libobj)) {
-			      sref = ckalias->aliases;
-			      for (; sref != NULL; sref = sref->next) {
-			         if (!strcmp(keyword, sref->alias)) {
-				    is_alias = true;
-				    break;
-				 }
-			      }
-			      if (is_alias) break;
-			   }
-			}
-			if (!is_alias) continue;
-		     }
-
-		     found = true;
-                     newinst = localdata->append(new objinst);
-		     (*newinst)->thisobject = *libobj;
-                     (*newinst)->color = curcolor;
-                     (*newinst)->bbox.lowerleft = (*libobj)->bbox.lowerleft;
-                     (*newinst)->bbox = (*libobj)->bbox;
-
-	             lineptr = varfscan(localdata, buffer, &(*newinst)->scale,
-                                *newinst, P_SCALE);
-	       	     lineptr = varscan(localdata, lineptr, &(*newinst)->rotation,
-                                *newinst, P_ROTATION);
-	             lineptr = varpscan(localdata, lineptr, &(*newinst)->position.x,
-                                *newinst, 0, offx, P_POSITION_X);
-	             lineptr = varpscan(localdata, lineptr, &(*newinst)->position.y,
-                                *newinst, 0, offy, P_POSITION_Y);
-
-		     /* Negative rotations = flip in x in version 2.3.6 and    */
-		     /* earlier.  Later versions don't allow negative rotation */
-
-	    	     if (version < 2.4) {
-                        if ((*newinst)->rotation < 0) {
-			   (*newinst)->scale = -((*newinst)->scale);
-			   (*newinst)->rotation++;
-		        }
-		        (*newinst)->rotation = -(*newinst)->rotation;
-		     }
-
-                     while ((*newinst)->rotation > 360) (*newinst)->rotation -= 360;
-                     while ((*newinst)->rotation < 0) (*newinst)->rotation += 360;
-
-                     std_eparam(*newinst, colorkey);
+		  (*newinst)->rotation = -(*newinst)->rotation;
+	       }
 
-		     /* Does this instance contain parameters? */
-		     readparams(localdata, *newinst, *libobj, buffer);
+	       while ((*newinst)->rotation > 360) (*newinst)->rotation -= 360;
+	       while ((*newinst)->rotation < 0) (*newinst)->rotation += 360;
 
-		     calcbboxinst(*newinst);
+	       std_eparam(*newinst, colorkey);
 
-		     break;
+	       /* Does this instance contain parameters? */
+	       readparams(localdata, *newinst, instobj, buffer);
 
-	          } /* if !strcmp */
-	       } /* for j loop */
-	       if (found) break;
-	    } /* for k loop */
-	    if (!found)		/* will assume that we have a continuation line */
+	       calcbboxinst(*newinst);
+	    }
+	    else	/* will assume that we have a continuation line */
 	       temp = continueline(&buffer);
          }
       }
@@ -4202,6 +4411,13 @@ void incr_changes(objectptr thisobj)
       return;
    }
 
+   /* Geometry may have changed without calcbboxvalues() being called */
+   spatial_invalidate(thisobj);
+   glyph_invalidate(thisobj);
+   layout_invalidate();
+   param_invalidate();
+   lod_invalidate();
+
    /* Remove any pending timeout */
 
    if (xobjs.timeout_id != 0) {
@@ -4255,6 +4471,14 @@ void savetemp(XtPointer, XtIntervalId *)
 
    xobjs.timeout_id = (XtIntervalId)NULL;
 
+   /* Not while a file is being read;  try again later */
+
+   if (loadprogress_running()) {
+      xobjs.timeout_id = xcAddTimeout(60000 * xobjs.save_interval,
+		savetemp, NULL);
+      return;
+   }
+
    /* First see if there are any unsaved changes in the file.	*/
    /* If not, then just reset the counter and continue.  	*/
 
@@ -4270,12 +4494,10 @@ void savetemp(XtPointer, XtIntervalId *)
              xobjs.tempfile = temp.fileName();
          }
       }
-      /* Show the "wristwatch" cursor, as graphic data may cause this	*/
-      /* step to be inordinately long.					*/
+      /* Only the PostScript text is generated here;  graphic data	*/
+      /* are encoded and the file written by the autosave thread.	*/
 
-      XDefineCursor(areawin->viewport, WAITFOR);
       savefile(ALL_PAGES);
-      XDefineCursor(areawin->viewport, DEFAULTCURSOR);
       xobjs.new_changes = 0;	/* reset the count */
    }
 }
@@ -4406,6 +4628,7 @@ void savetechnology(char *technology, char *outname)
 	    /* Search for all object definitions instantiated in this object, */
 	    /* and add them to the dependency list (non-recursive).	   */
 
+	    libcache_materialize(libobjptr);
             for (objinstiter oiptr; libobjptr->values(oiptr); ) {
               depobj = oiptr->thisobject;
 
@@ -4518,12 +4741,114 @@ void findfonts(objectptr writepage, short *fontsused) {
    }
 }
 
+/*----------------------------------------------------------------------*/
+/* Write the data of one image to the output, as a reusable stream	*/
+/* named "name".  This touches no program state, and is also used by	*/
+/* the autosave thread (see autosave.cpp).				*/
+/*----------------------------------------------------------------------*/
+
+void printimage(FILE *ps, const XImage &image, const char *name)
+{
+   int ilen, flen, j, k, m = 0, n, q = 0;
+   u_char *filtbuf, *flatebuf;
+   char ascbuf[6];
+   bool lastpix = false;
+   union {
+      u_long i;
+      u_char b[4];
+   } pixel;
+
+   fprintf(ps, "%%imagedata %d %d\n", image.width(), image.height());
+   fprintf(ps, "currentfile /ASCII85Decode filter ");
+
+#ifdef HAVE_LIBZ
+   fprintf(ps, "/FlateDecode filter\n");
+#endif
+
+   fprintf(ps, "/ReusableStreamDecode filter\n");
+
+   /* creating a stream buffer is wasteful if we're just using ASCII85	*/
+   /* decoding but is a must for compression filters. 			*/
+
+   ilen = 3 * image.width() * image.height();
+   filtbuf = (u_char *)malloc(ilen + 4);
+   q = 0;
+   for (j = 0; j < image.height(); j++) {
+      for (k = 0; k < image.width(); k++) {
+         QRgb pixel = image.pixel(k, j);
+         filtbuf[q++] = qRed(pixel);
+         filtbuf[q++] = qGreen(pixel);
+         filtbuf[q++] = qBlue(pixel);
+      }
+   }
+   for (j = 0; j < 4; j++)
+      filtbuf[q++] = 0;
+
+   /* Extra encoding goes here */
+#ifdef HAVE_LIBZ
+   flen = ilen * 2;
+   flatebuf = (u_char *)malloc(flen);
+   ilen = large_deflate(flatebuf, flen, filtbuf, ilen);
+   free(filtbuf);
+#else
+   flatebuf = filtbuf;
+#endif
+
+   ascbuf[5] = '\0';
+   for (j = 0; j < ilen; j += 4) {
+      if ((j + 4) > ilen) lastpix = true;
+      if (!lastpix && (flatebuf[j] + flatebuf[j + 1] + flatebuf[j + 2]
+			+ flatebuf[j + 3] == 0)) {
+	 fprintf(ps, "z");
+	 m++;
+      }
+      else {
+	 for (n = 0; n < 4; n++)
+	    pixel.b[3 - n] = flatebuf[j + n];
+
+	 ascbuf[0] = '!' + (pixel.i / 52200625);
+	 pixel.i %= 52200625;
+	 ascbuf[1] = '!' + (pixel.i / 614125);
+	 pixel.i %= 614125;
+	 ascbuf[2] = '!' + (pixel.i / 7225);
+	 pixel.i %= 7225;
+	 ascbuf[3] = '!' + (pixel.i / 85);
+	 pixel.i %= 85;
+	 ascbuf[4] = '!' + pixel.i;
+	 if (lastpix)
+	    for (n = 0; n < ilen + 1 - j; n++)
+	       fprintf(ps, "%c", ascbuf[n]);
+	 else
+	    fprintf(ps, "%5s", ascbuf);
+	 m += 5;
+      }
+      if (m > 75) {
+	 fprintf(ps, "\n");
+	 m = 0;
+      }
+   }
+   fprintf(ps, "~>\n");
+   free(flatebuf);
+
+   fprintf(ps, "/%sdata exch def\n", name);
+   fprintf(ps, "/%s <<\n", name);
+   fprintf(ps, "  /ImageType 1 /Width %d /Height %d /BitsPerComponent 8\n",
+		image.width(), image.height());
+   fprintf(ps, "  /MultipleDataSources false\n");
+   fprintf(ps, "  /Decode [0 1 0 1 0 1]\n");
+   fprintf(ps, "  /ImageMatrix [1 0 0 -1 %d %d]\n",
+		(image.width() >> 1), (image.height() >> 1));
+   fprintf(ps, "  /DataSource %sdata >> def\n\n", name);
+}
+
 /*----------------------------------------------------------------------*/
 /* Main file saving routine						*/
 /*----------------------------------------------------------------------*/
 /*	mode 		description					*/
 /*----------------------------------------------------------------------*/
-/*	ALL_PAGES	saves a crash recovery backup file		*/
+/*	ALL_PAGES	saves a crash recovery backup file.  The file	*/
+/*			is written to memory here, and to disk by the	*/
+/*			autosave thread (see autosave.cpp).		*/
 /*	CURRENT_PAGE	saves all pages associated with the same	*/
 /*			filename as the current page, and all		*/
 /*			dependent schematics (which have their		*/
@@ -4536,14 +4861,22 @@ void savefile(short mode)
 {
    FILE *ps, *pro;
    QString fname, outname, basename;
-   char temp[150], prologue[150], ascbuf[6];
+   char temp[150], prologue[150];
    short written, fontsused[256], i, page, curpage, multipage;
    short savepage, stcount, *pagelist, *glist;
    objectptr *wroteobjs;
    objinstptr writepage;
-   int findex, j;
+   int findex;
    time_t tdate;
    char *tmp_s;
+   Autosave *snapshot = NULL;
+
+   /* Binary files are written by savexcb() */
+   if ((mode != ALL_PAGES) &&
+		xobjs.pagelist[areawin->page].filename.endsWith(".xcb")) {
+      savexcb(mode);
+      return;
+   }
 
    if (mode != ALL_PAGES) {
       /* doubly-protected file write: protect against errors during file write */
@@ -4552,9 +4885,7 @@ void savefile(short mode)
       QFile::rename(fname, outname);
    }
    else {
-      /* doubly-protected backup: protect against errors during file write */
-      outname = xobjs.tempfile + "B";
-      QFile::rename(xobjs.tempfile, outname);
+      /* the backup is replaced atomically by the autosave thread */
       fname = xobjs.tempfile;
    }
 
@@ -4568,9 +4899,15 @@ void savefile(short mode)
    xc_tilde_expand(outname);
    while(xc_variable_expand(outname)) ;
 
-   ps = fopen(outname.toLocal8Bit(), "w");
+   if (mode == ALL_PAGES) {
+      snapshot = new Autosave(outname);
+      ps = snapshot->open();
+   }
+   else
+      ps = fopen(outname.toLocal8Bit(), "w");
    if (ps == NULL) {
       Wprintf("Can't open file %s for writing.", outname.toLocal8Bit().data());
+      delete snapshot;
       return;
    }
 
@@ -4597,6 +4934,7 @@ void savefile(short mode)
       Wprintf("Panic:  could not find this page in page list!");
       free (pagelist);
       fclose(ps);
+      delete snapshot;
       return;
    }
 
@@ -4686,6 +5024,7 @@ void savefile(short mode)
             Wprintf("Can't open prolog.");
 	    free(pagelist);
 	    fclose(ps);
+	    delete snapshot;
             return;
 	 }
       }
@@ -4757,88 +5096,9 @@ void savefile(short mode)
 
    for (i = 0; i < xobjs.images; i++) {
       Imagedata *img = xobjs.imagelist + i;
-      int ilen, flen, k, m = 0, n, q = 0;
-      u_char *filtbuf, *flatebuf;
-      bool lastpix = false;
-      union {
-	u_long i;
-	u_char b[4];
-      } pixel;
 
       if (glist[i] == 0) continue;
 
-      fprintf(ps, "%%imagedata %d %d\n", img->image->width(), img->image->height());
-      fprintf(ps, "currentfile /ASCII85Decode filter ");
-
-#ifdef HAVE_LIBZ
-      fprintf(ps, "/FlateDecode filter\n");
-#endif
-
-      fprintf(ps, "/ReusableStreamDecode filter\n");
-
-      /* creating a stream buffer is wasteful if we're just using ASCII85	*/
-      /* decoding but is a must for compression filters. 			*/
-
-      ilen = 3 * img->image->width() * img->image->height();
-      filtbuf = (u_char *)malloc(ilen + 4);
-      q = 0;
-      for (j = 0; j < img->image->height(); j++) {
-         for (k = 0; k < img->image->width(); k++) {
-            QRgb pixel = img->image->pixel(k, j);
-            filtbuf[q++] = qRed(pixel);
-            filtbuf[q++] = qGreen(pixel);
-            filtbuf[q++] = qBlue(pixel);
-	 }
-      }
-      for (j = 0; j < 4; j++)
-	 filtbuf[q++] = 0;
-
-      /* Extra encoding goes here */
-#ifdef HAVE_LIBZ
-      flen = ilen * 2;
-      flatebuf = (u_char *)malloc(flen);
-      ilen = large_deflate(flatebuf, flen, filtbuf, ilen);
-      free(filtbuf);
-#else
-      flatebuf = filtbuf;
-#endif
-	    
-      ascbuf[5] = '\0';
-      for (j = 0; j < ilen; j += 4) {
-         if ((j + 4) > ilen) lastpix = true;
-	 if (!lastpix && (flatebuf[j] + flatebuf[j + 1] + flatebuf[j + 2]
-			+ flatebuf[j + 3] == 0)) {
-	    fprintf(ps, "z");
-	    m++;
-	 }
-	 else {
-	    for (n = 0; n < 4; n++)
-	       pixel.b[3 - n] = flatebuf[j + n];
-
-	    ascbuf[0] = '!' + (pixel.i / 52200625);
-	    pixel.i %= 52200625;
-	    ascbuf[1] = '!' + (pixel.i / 614125);
-	    pixel.i %= 614125;
-	    ascbuf[2] = '!' + (pixel.i / 7225);
-	    pixel.i %= 7225;
-	    ascbuf[3] = '!' + (pixel.i / 85);
-	    pixel.i %= 85;
-	    ascbuf[4] = '!' + pixel.i;
-	    if (lastpix)
-	       for (n = 0; n < ilen + 1 - j; n++)
-	          fprintf(ps, "%c", ascbuf[n]);
-	    else
-	       fprintf(ps, "%5s", ascbuf);
-	    m += 5;
-	 }
-	 if (m > 75) {
-	    fprintf(ps, "\n");
-	    m = 0;
-	 }
-      }
-      fprintf(ps, "~>\n");
-      free(flatebuf);
-
       /* Remove any filesystem path information from the image name.	*/
       /* Otherwise, the slashes will cause PostScript to err.		*/
 
@@ -4847,15 +5107,11 @@ void savefile(short mode)
 	 fptr = img->filename;
       else
 	 fptr++;
-      fprintf(ps, "/%sdata exch def\n", fptr);
-      fprintf(ps, "/%s <<\n", fptr);
-      fprintf(ps, "  /ImageType 1 /Width %d /Height %d /BitsPerComponent 8\n",
-                img->image->width(), img->image->height());
-      fprintf(ps, "  /MultipleDataSources false\n");
-      fprintf(ps, "  /Decode [0 1 0 1 0 1]\n");
-      fprintf(ps, "  /ImageMatrix [1 0 0 -1 %d %d]\n",
-                (img->image->width() >> 1), (img->image->height() >> 1));
-      fprintf(ps, "  /DataSource %sdata >> def\n\n", fptr);
+
+      if (snapshot != NULL)
+	 snapshot->addimage(ps, *img->image, fptr);
+      else
+	 printimage(ps, *img->image, fptr);
    }
    free(glist);
 
@@ -4931,16 +5187,19 @@ void savefile(short mode)
    fprintf(ps, "%%%%Trailer\n");
    fprintf(ps, "XCIRCsave restore\n");
    fprintf(ps, "%%%%EOF\n");
-   fclose(ps);
+
+   if (snapshot != NULL) {
+      /* Hand the file to the autosave thread */
+      snapshot->close(ps);
+      autosave_start(snapshot);
+   }
+   else
+      fclose(ps);
 
    Wprintf("File %ls saved (%d page%s).", fname.utf16(), multipage,
 		(multipage > 1 ? "s" : ""));
 
-   if (mode == ALL_PAGES) {
-      /* Remove the temporary redundant backup */
-      QFile::remove(xobjs.tempfile + 'B');
-   }
-   else if (!xobjs.retain_backup) {
+   if ((mode != ALL_PAGES) && !xobjs.retain_backup) {
       /* Remove the backup file */
       QFile::remove(fname + '~');
    }
@@ -5784,6 +6043,8 @@ void printobjects(FILE *ps, objectptr localdata, objectptr **wrotelist,
       if (*optr == localdata)
 	  return;
 
+   libcache_materialize(localdata);
+
    /* If this page is a schematic, write out the definiton of any symbol */
    /* attached to it, because that symbol may not be used anywhere else. */
 
@@ -5967,7 +6228,7 @@ void printpageobject(FILE *ps, objectptr localdata, short page, short mpage)
 
    if (xobjs.pagelist[mpage].drawingscale.x != 1
                 || xobjs.pagelist[mpage].drawingscale.y != 1)
-      fprintf(ps, "%% %hd:%hd drawingscale\n", xobjs.pagelist[mpage].drawingscale.x,
+      fprintf(ps, "%% %d:%d drawingscale\n", xobjs.pagelist[mpage].drawingscale.x,
                 xobjs.pagelist[mpage].drawingscale.y);
 
    if (xobjs.pagelist[mpage].gridspace != 32
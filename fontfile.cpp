@@ -35,13 +35,13 @@ extern Tcl_Interp *xcinterp;
 #endif
 
 /*----------------------------------------------------------------------*/
-/* Find the file containing the encoding for the given font		*/
+/* Open the encoding file of the given font, if it is in the search	*/
+/* path under its own name.  Leaves the name tried in _STR.		*/
 /*----------------------------------------------------------------------*/
 
-FILE *findfontfile(const char *fontname)
+static FILE *openfontfile(const char *fontname)
 {
    int i;
-   char tempname[256];
    FILE *fd;
 
    /* Add subdirectory "fonts".  We will try both with and	*/
@@ -64,6 +64,19 @@ FILE *findfontfile(const char *fontname)
    fd = libopen(_STR + 6, FONTENCODING);
 
    if (fd == NULL) fd = libopen(_STR, FONTENCODING);
+   return fd;
+}
+
+/*----------------------------------------------------------------------*/
+/* Find the file containing the encoding for the given font		*/
+/*----------------------------------------------------------------------*/
+
+FILE *findfontfile(const char *fontname)
+{
+   char tempname[256];
+   FILE *fd;
+
+   fd = openfontfile(fontname);
 
    /* Some other, probably futile, attempts (call findfontfile recursively) */
 
@@ -126,6 +139,27 @@ FILE *findfontfile(const char *fontname)
    return fd;
 }
 
+/*----------------------------------------------------------------------*/
+/* Start reading the caches of the character libraries of a font	*/
+/* ahead of loading it (see libcache_prefetch()).  Fonts not found	*/
+/* under their own name are left to loadfontfile().			*/
+/*----------------------------------------------------------------------*/
+
+void prefetchfont(const char *fontname)
+{
+   FILE *fd;
+   char temp[250], commandstr[30], str[150];
+
+   if ((fd = openfontfile(fontname)) == NULL) return;
+
+   while (fgets(temp, 249, fd) != NULL) {
+      if (sscanf(temp, "%29s %149s", commandstr, str) != 2) continue;
+      if (!strcmp(commandstr, "file:") || !strcmp(commandstr, "load:"))
+	 libcache_prefetch(FONTLIB, str);
+   }
+   fclose(fd);
+}
+
 /*----------------------------------------------------------------------*/
 /* Load a named font							*/
 /* Return 1 if successful, 0 if font is already present, and -1 if any	*/
@@ -142,6 +176,7 @@ int loadfontfile(const char *fontname)
    int i;
    float fontscale = 1.0;
    objectptr *j, *eptr;
+   int k, nmatch;
    objectptr *encoding = NULL;
    float saveversion = version;
 
@@ -315,14 +350,14 @@ int loadfontfile(const char *fontname)
 	       if ((int)(eptr - encoding) == 256) break;
 	       sscanf(temp2, "%99s", tempname);
 	       *eptr = (objectptr) NULL;
-	       for (j = xobjs.fontlib.library; j < xobjs.fontlib.library +
-			xobjs.fontlib.number; j++) {
-	          if (!strcmp(tempname, (*j)->name)) {
-	             *eptr = (*j);
+	       nmatch = names_find(FONTLIB, tempname, false, &j, NULL);
+	       for (k = 0; k < nmatch; k++) {
+	          if (!strcmp(tempname, j[k]->name)) {
+	             *eptr = j[k];
 		     break;
 	          }
 	       }
-	       if (j == xobjs.fontlib.library + xobjs.fontlib.number) {
+	       if (*eptr == NULL) {
 	          Fprintf(stdout, "Font load warning: character \"%s\" at code ",
 				tempname);
 	 	  Fprintf(stdout, "position %d not found.\n", (int)(eptr - encoding));
@@ -366,5 +401,7 @@ int loadfontfile(const char *fontname)
       }
    }
    fclose(fd);
+   layout_invalidate();
+   lod_invalidate();
    return 1;
 }
@@ -12,6 +12,7 @@
 #include <cstring>
 #include <cmath>
 #include <climits>
+#include <algorithm>
 
 #ifdef TCL_WRAPPER 
 #include <tk.h>
@@ -84,7 +85,7 @@ long finddist(const XPoint *linept1, const XPoint *linept2, const XPoint *userpt
    else if (-frac >= c) return a;
    else {
       protod = (float)(c + a - b);
-      return (a - (long)((protod * protod) / (float)(c << 2)));
+      return (a - (long)((protod * protod) / ((float)c * 4.0)));
    }
 }
 
@@ -116,8 +117,8 @@ void findsplinepos(splineptr thespline, float t, XPoint *retpoint, int *retrot)
    double dxdt, dydt;
 
    computecoeffs(thespline, &ax, &bx, &cx, &ay, &by, &cy);
-   retpoint->x = (short)(ax * tcb + bx * tsq + cx * t + (float)thespline->ctrl[0].x);
-   retpoint->y = (short)(ay * tcb + by * tsq + cy * t + (float)thespline->ctrl[0].y);
+   retpoint->x = (int)(ax * tcb + bx * tsq + cx * t + (float)thespline->ctrl[0].x);
+   retpoint->y = (int)(ay * tcb + by * tsq + cy * t + (float)thespline->ctrl[0].y);
 
    if (retrot != NULL) {
       dxdt = (double)(3 * ax * tsq + 2 * bx * t + cx);
@@ -199,9 +200,9 @@ float findsplinemin(splineptr thespline, XPoint *upoint)
 /* Find closest point of a polygon to the cursor			      */
 /*----------------------------------------------------------------------------*/
 
-short closepointdistance(polyptr curpoly, XPoint *cursloc, short *mindist)
+short closepointdistance(polyptr curpoly, XPoint *cursloc, int *mindist)
 {
-   short curdist;
+   int curdist;
    XPoint *curpt, *savept; 
 
    curpt = savept = curpoly->points.begin();
@@ -222,7 +223,7 @@ short closepointdistance(polyptr curpoly, XPoint *cursloc, short *mindist)
 
 short closepoint(polyptr curpoly, XPoint *cursloc)
 {
-   short mindist;
+   int mindist;
    return closepointdistance(curpoly, cursloc, &mindist);
 }
 
@@ -230,9 +231,9 @@ short closepoint(polyptr curpoly, XPoint *cursloc)
 /* Find the distance to the closest point of a polygon to the cursor	      */
 /*----------------------------------------------------------------------------*/
 
-short closedistance(polyptr curpoly, XPoint *cursloc)
+int closedistance(polyptr curpoly, XPoint *cursloc)
 {
-   short mindist;
+   int mindist;
    closepointdistance(curpoly, cursloc, &mindist);
    return mindist;
 }
@@ -243,41 +244,44 @@ short closedistance(polyptr curpoly, XPoint *cursloc)
 
 /*------------------------------------------------------------------------------*/
 /*  Check screen bounds:  minimum, maximum scale and translation is determined	*/
-/*  by values which fit in an X11 type XPoint (short int).  If the window	*/
-/*  extremes exceed type short when mapped to user space, or if the page 	*/
-/*  bounds exceed type short when mapped to X11 window space, return error.	*/ 
+/*  by the range of user coordinates (MAXCOORD) and of window coordinates	*/
+/*  (type int).  If the window extremes exceed MAXCOORD when mapped to user	*/
+/*  space, or if the page bounds exceed type int when mapped to window space,	*/
+/*  return error.								*/
 /*------------------------------------------------------------------------------*/
 
-short checkbounds(DrawContext* ctx)
+#define OUTOFRANGE(v, max)	(((v) > (double)(max)) || ((v) < -(double)(max)))
+
+short checkbounds(DrawContext*)
 {
-   XPoint testpt;
-   long lval;
+   double dval;
 
    /* check window-to-user space */
 
-   lval = 2 * (long)((float) (areawin->width()) / areawin->vscale) +
-	(long)areawin->pcorner.x;
-   if (lval != (long)((short)lval)) return -1;
-   lval = 2 * (long)((float) (areawin->height()) / areawin->vscale) +
-	(long)areawin->pcorner.y;
-   if (lval != (long)((short)lval)) return -1;
+   dval = 2.0 * (double)areawin->width() / areawin->vscale +
+	(double)areawin->pcorner.x;
+   if (OUTOFRANGE(dval, MAXCOORD) || OUTOFRANGE((double)areawin->pcorner.x,
+	MAXCOORD)) return -1;
+   dval = 2.0 * (double)areawin->height() / areawin->vscale +
+	(double)areawin->pcorner.y;
+   if (OUTOFRANGE(dval, MAXCOORD) || OUTOFRANGE((double)areawin->pcorner.y,
+	MAXCOORD)) return -1;
 
    /* check user-to-window space */
 
-   lval = (long)((float)(topobject->bbox.lowerleft.x - areawin->pcorner.x) *
-	areawin->vscale);
-   if (lval != (long)((short)lval)) return -1;
-   lval = (long)areawin->height() - (long)((float)(topobject->bbox.lowerleft.y -
-	areawin->pcorner.y) * areawin->vscale); 
-   if (lval != (long)((short)lval)) return -1;
-   ctx->CTM().transform(&(topobject->bbox.lowerleft), &testpt, 1);
-
-   lval = (long)((float)(topobject->bbox.lowerleft.x + topobject->bbox.width -
-	areawin->pcorner.x) * areawin->vscale);
-   if (lval != (long)((short)lval)) return -1;
-   lval = (long)areawin->height() - (long)((float)(topobject->bbox.lowerleft.y +
-	topobject->bbox.height - areawin->pcorner.y) * areawin->vscale); 
-   if (lval != (long)((short)lval)) return -1;
+   dval = ((double)topobject->bbox.lowerleft.x - areawin->pcorner.x) *
+	areawin->vscale;
+   if (OUTOFRANGE(dval, INT_MAX)) return -1;
+   dval = (double)areawin->height() - ((double)topobject->bbox.lowerleft.y -
+	areawin->pcorner.y) * areawin->vscale; 
+   if (OUTOFRANGE(dval, INT_MAX)) return -1;
+
+   dval = ((double)topobject->bbox.lowerleft.x + topobject->bbox.width -
+	areawin->pcorner.x) * areawin->vscale;
+   if (OUTOFRANGE(dval, INT_MAX)) return -1;
+   dval = (double)areawin->height() - ((double)topobject->bbox.lowerleft.y +
+	topobject->bbox.height - areawin->pcorner.y) * areawin->vscale; 
+   if (OUTOFRANGE(dval, INT_MAX)) return -1;
 
    return 0;
 }
@@ -288,17 +292,17 @@ short checkbounds(DrawContext* ctx)
 
 void window_to_user(short xw, short yw, XPoint *upt)
 {
-  float tmpx, tmpy;
+  double tmpx, tmpy;
 
-  tmpx = (float)xw / areawin->vscale + (float)areawin->pcorner.x;
-  tmpy = (float)(areawin->height() - yw) / areawin->vscale +
-	(float)areawin->pcorner.y;
+  tmpx = (double)xw / areawin->vscale + (double)areawin->pcorner.x;
+  tmpy = (double)(areawin->height() - yw) / areawin->vscale +
+	(double)areawin->pcorner.y;
 
   tmpx += (tmpx > 0) ? 0.5 : -0.5;
   tmpy += (tmpy > 0) ? 0.5 : -0.5;
 
-  upt->x = (short)tmpx;
-  upt->y = (short)tmpy;
+  upt->x = (int)tmpx;
+  upt->y = (int)tmpy;
 }
 
 /*------------------------------------------------------------------------*/
@@ -307,17 +311,17 @@ void window_to_user(short xw, short yw, XPoint *upt)
 
 void user_to_window(XPoint upt, XPoint *wpt)
 {
-  float tmpx, tmpy;
+  double tmpx, tmpy;
 
-  tmpx = (float)(upt.x - areawin->pcorner.x) * areawin->vscale;
-  tmpy = (float)areawin->height() - (float)(upt.y - areawin->pcorner.y)
+  tmpx = ((double)upt.x - areawin->pcorner.x) * areawin->vscale;
+  tmpy = (double)areawin->height() - ((double)upt.y - areawin->pcorner.y)
 	* areawin->vscale; 
 
   tmpx += (tmpx > 0) ? 0.5 : -0.5;
   tmpy += (tmpy > 0) ? 0.5 : -0.5;
 
-  wpt->x = (short)tmpx;
-  wpt->y = (short)tmpy;
+  wpt->x = (int)tmpx;
+  wpt->y = (int)tmpy;
 }
 
 /*----------------------------------------------------------------------*/
@@ -361,21 +365,21 @@ XPoint u2u_getSnapped(XPoint f)
 
 void u2u_snap(XPoint &uvalue)
 {
-   float tmpx, tmpy;
-   float tmpix, tmpiy;
+   double tmpx, tmpy;
+   double tmpix, tmpiy;
 
    if (areawin->snapto) {
-      tmpx = (float)uvalue.x / xobjs.pagelist[areawin->page].snapspace;
+      tmpx = (double)uvalue.x / xobjs.pagelist[areawin->page].snapspace;
       if (tmpx > 0)
-	 tmpix = (float)((int)(tmpx + 0.5));
+	 tmpix = (double)((int)(tmpx + 0.5));
       else
-         tmpix = (float)((int)(tmpx - 0.5));
+         tmpix = (double)((int)(tmpx - 0.5));
 
-      tmpy = (float)uvalue.y / xobjs.pagelist[areawin->page].snapspace;
+      tmpy = (double)uvalue.y / xobjs.pagelist[areawin->page].snapspace;
       if (tmpy > 0)
-         tmpiy = (float)((int)(tmpy + 0.5));
+         tmpiy = (double)((int)(tmpy + 0.5));
       else
-         tmpiy = (float)((int)(tmpy - 0.5));
+         tmpiy = (double)((int)(tmpy - 0.5));
 
       tmpix *= xobjs.pagelist[areawin->page].snapspace;
       tmpix += (tmpix > 0) ? 0.5 : -0.5;
@@ -490,7 +494,7 @@ void manhattanize(XPoint *pospt, polyptr newpoly, short cycle, bool strict)
 /* Bounding box calculation routines					*/
 /*----------------------------------------------------------------------*/
 
-void bboxcalc(short testval, short *lowerval, short *upperval)
+void bboxcalc(int testval, int *lowerval, int *upperval)
 {
    if (testval < *lowerval) *lowerval = testval;
    if (testval > *upperval) *upperval = testval;
@@ -500,8 +504,8 @@ void bboxcalc(short testval, short *lowerval, short *upperval)
 /* Bounding box calculation for elements which can be part of a path	*/
 /*----------------------------------------------------------------------*/
 
-void calcextents(genericptr *bboxgen, short *llx, short *lly, 
-	short *urx, short *ury)
+void calcextents(genericptr *bboxgen, int *llx, int *lly, 
+	int *urx, int *ury)
 {
    switch (ELEMENTTYPE(*bboxgen)) {
       case(POLYGON): {
@@ -519,8 +523,8 @@ void calcextents(genericptr *bboxgen, short *llx, short *lly,
          bboxcalc(TOSPLINE(bboxgen)->ctrl[3].y, lly, ury);
          for (bboxpts = TOSPLINE(bboxgen)->points; bboxpts < 
 		 TOSPLINE(bboxgen)->points + INTSEGS; bboxpts++) {
-	    bboxcalc((short)(bboxpts->x), llx, urx);
-	    bboxcalc((short)(bboxpts->y), lly, ury);
+	    bboxcalc((int)(bboxpts->x), llx, urx);
+	    bboxcalc((int)(bboxpts->y), lly, ury);
          }
          } break;
 
@@ -528,8 +532,8 @@ void calcextents(genericptr *bboxgen, short *llx, short *lly,
          fpointlist bboxpts;
          for (bboxpts = TOARC(bboxgen)->points; bboxpts < TOARC(bboxgen)->points +
 	         TOARC(bboxgen)->number; bboxpts++) {
-            bboxcalc((short)(bboxpts->x), llx, urx);
-	    bboxcalc((short)(bboxpts->y), lly, ury);
+            bboxcalc((int)(bboxpts->x), llx, urx);
+	    bboxcalc((int)(bboxpts->y), lly, ury);
          }
          } break;
    }
@@ -539,11 +543,11 @@ void calcextents(genericptr *bboxgen, short *llx, short *lly,
 /* Wrapper for single call to calcbboxsingle() in the netlister */
 /*--------------------------------------------------------------*/
 
-void calcinstbbox(genericptr *bboxgen, short *llx, short *lly, short *urx,
-                short *ury)
+void calcinstbbox(genericptr *bboxgen, int *llx, int *lly, int *urx,
+                int *ury)
 {
-   *llx = *lly = 32767;
-   *urx = *ury = -32768;
+   *llx = *lly = MAXCOORD;
+   *urx = *ury = -MAXCOORD;
 
    calcbboxsingle(bboxgen, areawin->topinstance, llx, lly, urx, ury);
 }
@@ -553,7 +557,7 @@ void calcinstbbox(genericptr *bboxgen, short *llx, short *lly, short *urx,
 /*----------------------------------------------------------------------*/
 
 void calcbboxsingle(genericptr *bboxgen, objinstptr thisinst, 
-		short *llx, short *lly, short *urx, short *ury)
+		int *llx, int *lly, int *urx, int *ury)
 {
    XPoint npoints[4];
    short j;
@@ -666,23 +670,24 @@ void calcbboxinst(objinstptr thisinst)
 {
    objectptr thisobj;
    genericptr *gelem;
-   short llx, lly, urx, ury;
+   int llx, lly, urx, ury;
 
-   short pllx, plly, purx, pury;
+   int pllx, plly, purx, pury;
    bool hasschembbox = false;
    bool didparamsubs = false;
 
    if (thisinst == NULL) return;
 
    thisobj = thisinst->thisobject;
+   libcache_materialize(thisobj);
 
    llx = thisobj->bbox.lowerleft.x;
    lly = thisobj->bbox.lowerleft.y;
    urx = llx + thisobj->bbox.width;
    ury = lly + thisobj->bbox.height;
 
-   pllx = plly = 32767;
-   purx = pury = -32768;
+   pllx = plly = MAXCOORD;
+   purx = pury = -MAXCOORD;
 
    for (gelem = thisobj->begin(); gelem != thisobj->end(); gelem++) {
       /* pins which do not appear outside of the object	*/
@@ -706,6 +711,19 @@ void calcbboxinst(objinstptr thisinst)
       }
    }
 
+   /* instance entries of the spatial index depend on the bounding boxes */
+   if (thisinst->bbox.lowerleft.x != llx || thisinst->bbox.lowerleft.y != lly
+		|| thisinst->bbox.width != urx - llx
+		|| thisinst->bbox.height != ury - lly)
+      spatial_bboxchanged();
+   else if (hasschembbox ? (thisinst->schembbox == NULL
+		|| thisinst->schembbox->lowerleft.x != pllx
+		|| thisinst->schembbox->lowerleft.y != plly
+		|| thisinst->schembbox->width != purx - pllx
+		|| thisinst->schembbox->height != pury - plly)
+		: (thisinst->schembbox != NULL))
+      spatial_bboxchanged();
+
    thisinst->bbox.lowerleft.x = llx;
    thisinst->bbox.lowerleft.y = lly;
    thisinst->bbox.width = urx - llx;
@@ -798,7 +816,7 @@ void singlebbox(genericptr *gelem)
 
 void calcbboxselect()
 {
-   short *bsel;
+   int *bsel;
    for (bsel = areawin->selectlist; bsel < areawin->selectlist +
 		areawin->selects; bsel++)
       calcbboxvalues(areawin->topinstance, topobject->begin() + *bsel);
@@ -815,20 +833,31 @@ void calcbboxselect()
 void calcbboxvalues(objinstptr thisinst, genericptr *newelement)
 {
    genericptr *bboxgen;
-   short llx, lly, urx, ury;
+   int llx, lly, urx, ury;
    objectptr thisobj = thisinst->thisobject;
 
+   libcache_materialize(thisobj);
+
    /* no action if there are no elements */
    if (thisobj->parts == 0) return;
 
+   /* keep the spatial index of the object current */
+   if (newelement != NULL)
+      spatial_update(thisobj, newelement);
+   else
+      spatial_invalidate(thisobj);
+   glyph_invalidate(thisobj);
+   layout_invalidate();
+   param_invalidate();
+
    /* If this object has parameters, then we will do a separate		*/
    /* bounding box calculation on parameterized parts.  This		*/
    /* calculation ignores them, and the result is a base that the	*/
    /* instance bounding-box computation can use as a starting point.	*/
 
    /* set starting bounds as maximum bounds of screen */
-   llx = lly = 32767;
-   urx = ury = -32768;
+   llx = lly = MAXCOORD;
+   urx = ury = -MAXCOORD;
 
    for (bboxgen = thisobj->begin(); bboxgen != thisobj->end(); bboxgen++) {
 
@@ -877,6 +906,10 @@ nextgen:
    /* their initial values.  If so, then don't touch the bounding box.	*/
 
    if ((llx <= urx) && (lly <= ury)) {
+      if (thisobj->bbox.lowerleft.x != llx || thisobj->bbox.lowerleft.y != lly
+		|| thisobj->bbox.width != urx - llx
+		|| thisobj->bbox.height != ury - lly)
+	 spatial_bboxchanged();
       thisobj->bbox.lowerleft.x = llx;
       thisobj->bbox.lowerleft.y = lly;
       thisobj->bbox.width = urx - llx;
@@ -894,7 +927,7 @@ nextgen:
 void centerview(objinstptr tinst)
 {
    XPoint origin, corner;
-   Dimension width, height;
+   int width, height;
    float fitwidth, fitheight;
    objectptr tobj = tinst->thisobject;
 
@@ -932,9 +965,76 @@ void centerview(objinstptr tinst)
 
 void refresh(QAction*, void*, void*)
 {
+    areawin->area->invalidate();
     areawin->area->refresh();
 }
 
+/*----------------------------------------------------------------------*/
+/* Mark the window area covered by an element of the top-level object	*/
+/* for redrawing.  This is called both before and after an element is	*/
+/* changed, so that the old and the new position are both repainted	*/
+/* without redrawing the whole page.					*/
+/*----------------------------------------------------------------------*/
+
+void invalidate_element(genericptr *gelem)
+{
+   int llx, lly, urx, ury;
+   float lwidth, margin, wx0, wy0, wx1, wy1;
+   float wwidth = (float)areawin->width(), wheight = (float)areawin->height();
+
+   if (areawin->area == NULL) return;
+
+   /* The page bounding box and out-of-object pin marks are part of the */
+   /* page drawing too, and may change with the element.		*/
+
+   if (areawin->bboxon || (areawin->pinpointon && IS_OBJINST(*gelem))) {
+      areawin->update();
+      return;
+   }
+
+   calcinstbbox(gelem, &llx, &lly, &urx, &ury);
+   if ((llx > urx) || (lly > ury)) return;
+
+   switch (ELEMENTTYPE(*gelem)) {
+      case POLYGON: lwidth = TOPOLY(gelem)->width; break;
+      case ARC: lwidth = TOARC(gelem)->width; break;
+      case SPLINE: lwidth = TOSPLINE(gelem)->width; break;
+      case PATH: lwidth = TOPATH(gelem)->width; break;
+      case OBJINST: lwidth = 4.0 * fabs(TOOBJINST(gelem)->scale); break;
+      case LABEL: lwidth = 4.0 * fabs(TOLABEL(gelem)->scale); break;
+      default: lwidth = 1.0; break;
+   }
+   margin = 4.0 + lwidth * xobjs.pagelist[areawin->page].wirewidth
+		* areawin->vscale;
+
+   wx0 = (float)(llx - areawin->pcorner.x) * areawin->vscale - margin;
+   wx1 = (float)(urx - areawin->pcorner.x) * areawin->vscale + margin;
+   wy0 = wheight - (float)(ury - areawin->pcorner.y) * areawin->vscale - margin;
+   wy1 = wheight - (float)(lly - areawin->pcorner.y) * areawin->vscale + margin;
+
+   if ((wx1 < 0) || (wy1 < 0) || (wx0 > wwidth) || (wy0 > wheight)) return;
+   wx0 = qMax(wx0, -1.0f);
+   wy0 = qMax(wy0, -1.0f);
+   wx1 = qMin(wx1, wwidth + 1);
+   wy1 = qMin(wy1, wheight + 1);
+
+   areawin->area->invalidate(QRect(QPoint((int)floor(wx0), (int)floor(wy0)),
+		QPoint((int)ceil(wx1), (int)ceil(wy1))));
+}
+
+/*----------------------------------------------------------------------*/
+/* Same as above, for all selected elements				*/
+/*----------------------------------------------------------------------*/
+
+void invalidate_selected()
+{
+   int *selobj;
+
+   for (selobj = areawin->selectlist; selobj < areawin->selectlist +
+		areawin->selects; selobj++)
+      invalidate_element(topobject->begin() + *selobj);
+}
+
 /*------------------------------------------------------*/
 /* Center the current page in the viewing window	*/
 /*------------------------------------------------------*/
@@ -1061,10 +1161,10 @@ void UDrawXDown(DrawContext* ctx, labelptr curlabel)
 /* top-level object.							*/
 /*----------------------------------------------------------------------*/
 
-int toplevelwidth(objinstptr bbinst, short *rllx)
+int toplevelwidth(objinstptr bbinst, int *rllx)
 {
-   short llx, urx;
-   short origin, corner;
+   int llx, urx;
+   int origin, corner;
 
    if (bbinst->schembbox == NULL) {
       if (rllx) *rllx = bbinst->bbox.lowerleft.x;
@@ -1086,10 +1186,10 @@ int toplevelwidth(objinstptr bbinst, short *rllx)
 
 /*----------------------------------------------------------------------*/
 
-int toplevelheight(objinstptr bbinst, short *rlly)
+int toplevelheight(objinstptr bbinst, int *rlly)
 {
-   short lly, ury;
-   short origin, corner;
+   int lly, ury;
+   int origin, corner;
 
    if (bbinst->schembbox == NULL) {
       if (rlly) *rlly = bbinst->bbox.lowerleft.y;
@@ -1115,7 +1215,7 @@ int toplevelheight(objinstptr bbinst, short *rlly)
 
 void extendschembbox(objinstptr bbinst, XPoint *origin, XPoint *corner)
 {
-   short llx, lly, urx, ury;
+   int llx, lly, urx, ury;
 
    if ((bbinst == NULL) || (bbinst->schembbox == NULL)) return;
 
@@ -1134,7 +1234,7 @@ void extendschembbox(objinstptr bbinst, XPoint *origin, XPoint *corner)
 /* Adjust a pinlabel position to account for pad spacing		*/
 /*----------------------------------------------------------------------*/
 
-void pinadjust (short justify, short *xpoint, short *ypoint, short dir)
+void pinadjust (short justify, int *xpoint, int *ypoint, short dir)
 {
    int delx, dely;
 
@@ -1316,17 +1416,16 @@ void UDrawBBox(DrawContext* ctx)
 /* Fill and/or draw a border around the stroking path			   */
 /*-------------------------------------------------------------------------*/
 
-void strokepath(DrawContext* ctx, XPoint *pathlist, short number, short style, float width)
+void strokepath(DrawContext* ctx, XPoint *pathlist, int number, short style, float width)
 {
    float        tmpwidth;
-   short	minwidth;
+   QPoint	*qpoints;
 
    tmpwidth = ctx->UTopTransScale(xobjs.pagelist[areawin->page].wirewidth * width);
-   minwidth = qMax(1.0F, tmpwidth);
-
-   QPainter * const p = ctx->gc();
 
    if (style & FILLED || (!(style & FILLED) && style & OPAQUE)) {
+      QPainter * const p = ctx->gc();
+
       if ((style & FILLSOLID) == FILLSOLID) {
          p->setBrush(p->pen().color());
       } else if (!(style & FILLED)) {
@@ -1335,33 +1434,15 @@ void strokepath(DrawContext* ctx, XPoint *pathlist, short number, short style, f
       else {
          SetStipple(p, ((style & FILLSOLID) >> 5), style & OPAQUE);
       }
-      FillPolygon(p, pathlist, number);
+      qpoints = ctx->qpoints(number);
+      std::copy(pathlist, pathlist + number, qpoints);
+      p->drawPolygon(qpoints, number);
       /* return to original state */
       p->setBrush(p->pen().color());
    }
-   if (!(style & NOBORDER)) {
-      /* set up dots or dashes */
-      QVector<qreal> dashes;
-      if (style & DASHED) dashes << 4 * minwidth;
-      else if (style & DOTTED) dashes << minwidth;
-      dashes << 4*minwidth;
-      if (style & (DASHED | DOTTED)) {
-         QPen pen(p->pen());
-         pen.setDashPattern(dashes);
-         SetLineAttributes(p, tmpwidth, LineOnOffDash,
-		CapButt, (style & SQUARECAP) ? JoinMiter : JoinBevel);
-      }
-      else
-         SetLineAttributes(p, tmpwidth, LineSolid,
-		(style & SQUARECAP) ? CapProjecting : CapRound,
-		(style & SQUARECAP) ? JoinMiter : JoinBevel);
-
-      /* draw the spline and close off if so specified */
-      DrawLines(p, pathlist, number);
-      if (!(style & UNCLOSED))
-         p->drawLine(pathlist[0].x,
-		pathlist[0].y, pathlist[number - 1].x, pathlist[number - 1].y);
-   }
+   /* the border is stroked with others of the same style */
+   if (!(style & NOBORDER))
+      ctx->stroke(pathlist, number, !(style & UNCLOSED), style, LineWidth(tmpwidth));
 }
 
 /*-------------------------------------------------------------------------*/
@@ -0,0 +1,191 @@
+/*----------------------------------------------------------------------*/
+/* glyph.cpp --- font characters flattened for fast label drawing	*/
+/*----------------------------------------------------------------------*/
+
+#include "context.h"
+#include "matrix.h"
+#include "xcircuit.h"
+#include "prototypes.h"
+#include "xcqt.h"
+#include "colors.h"
+#include "glyph.h"
+
+/*----------------------------------------------------------------------*/
+/* Flatten the elements of a character object into strokes.  This	*/
+/* mirrors what UDrawObject() draws at level SINGLE.			*/
+/*----------------------------------------------------------------------*/
+
+GlyphPath::GlyphPath(object * charobj) :
+        ok(true),
+        parts(charobj->parts),
+        maxcount(0)
+{
+   genericptr *cgen, *pgen;
+   short j;
+
+   if (charobj->params != NULL) {
+      ok = false;
+      return;
+   }
+
+   for (cgen = charobj->begin(); cgen != charobj->end(); cgen++) {
+      switch (ELEMENTTYPE(*cgen)) {
+	 case POLYGON: {
+	    polyptr cpoly = TOPOLY(cgen);
+	    if (cpoly->style & BBOX) break;
+	    begin(cpoly->style, cpoly->width, cpoly->color);
+	    for (j = 0; j < cpoly->points.count(); j++)
+	       points.append(cpoly->points[j]);
+	    end();
+	    } break;
+
+	 case ARC: {
+	    arcptr carc = TOARC(cgen);
+	    begin(carc->style, carc->width, carc->color);
+	    for (j = 0; j < carc->number; j++)
+	       points.append(carc->points[j]);
+	    end();
+	    } break;
+
+	 case SPLINE: {
+	    splineptr cspline = TOSPLINE(cgen);
+	    begin(cspline->style, cspline->width, cspline->color);
+	    points.append(cspline->ctrl[0]);
+	    for (j = 0; j < INTSEGS; j++)
+	       points.append(cspline->points[j]);
+	    points.append(cspline->ctrl[3]);
+	    end();
+	    } break;
+
+	 case PATH: {
+	    pathptr cpath = TOPATH(cgen);
+	    begin(cpath->style, cpath->width, cpath->color);
+	    for (pgen = cpath->begin(); pgen != cpath->end(); pgen++) {
+	       if (ELEMENTTYPE(*pgen) == POLYGON) {
+		  polyptr ppoly = TOPOLY(pgen);
+		  for (j = 0; j < ppoly->points.count(); j++)
+		     points.append(ppoly->points[j]);
+	       }
+	       else if (ELEMENTTYPE(*pgen) == SPLINE) {
+		  splineptr pspline = TOSPLINE(pgen);
+		  points.append(pspline->ctrl[0]);
+		  for (j = 0; j < INTSEGS; j++)
+		     points.append(pspline->points[j]);
+		  points.append(pspline->ctrl[3]);
+	       }
+	    }
+	    end();
+	    } break;
+
+	 default:	/* instances, labels, graphics */
+	    ok = false;
+	    break;
+      }
+      if (!ok) break;
+   }
+
+   if (!ok) {
+      points.clear();
+      strokes.clear();
+   }
+}
+
+void GlyphPath::begin(short style, float width, int color)
+{
+   Stroke s;
+
+   s.first = points.size();
+   s.count = 0;
+   s.style = style;
+   s.width = width;
+   s.color = color;
+   strokes.append(s);
+}
+
+void GlyphPath::end()
+{
+   Stroke &s = strokes.last();
+
+   s.count = points.size() - s.first;
+   if (s.count == 0)
+      strokes.removeLast();
+   else if (s.count > maxcount)
+      maxcount = s.count;
+}
+
+/*----------------------------------------------------------------------*/
+/* The character object has been edited since the glyph was built	*/
+/*----------------------------------------------------------------------*/
+
+bool GlyphPath::stale(const object * charobj) const
+{
+   return (charobj->parts != parts);
+}
+
+/*----------------------------------------------------------------------*/
+/* Draw the character at 0, 0 of the current transformation matrix	*/
+/*----------------------------------------------------------------------*/
+
+void GlyphPath::draw(DrawContext * ctx, float scale, int passcolor) const
+{
+   XPoint *wpoints = ctx->points(maxcount);
+   int curcolor = passcolor;
+   float tmpwidth;
+
+   ctx->UPushCTM();
+   ctx->CTM().preMult(XPoint(0, 0), scale, 0);
+
+   tmpwidth = ctx->UTopTransScale(xobjs.pagelist[areawin->page].wirewidth);
+   SetLineAttributes(ctx->gc(), tmpwidth, LineSolid, CapRound, JoinBevel);
+
+   foreach (const Stroke & s, strokes) {
+      if ((passcolor != DOFORALL) && (s.color != curcolor)) {
+	 curcolor = (s.color == DEFAULTCOLOR) ? passcolor : s.color;
+	 XcTopSetForeground(ctx, curcolor);
+      }
+      ctx->CTM().transform(points.constData() + s.first, wpoints, s.count);
+      strokepath(ctx, wpoints, s.count, s.style, s.width);
+   }
+
+   if ((passcolor != DOFORALL) && (passcolor != curcolor))
+      XTopSetForeground(ctx->gc(), passcolor);
+
+   ctx->UPopCTM();
+}
+
+/*----------------------------------------------------------------------*/
+/* Draw a font character from its cached glyph, building the glyph on	*/
+/* first use.  Returns false if the character must be drawn as an	*/
+/* object instead.							*/
+/*----------------------------------------------------------------------*/
+
+bool glyph_draw(DrawContext *ctx, objectptr charobj, float scale, int passcolor)
+{
+   GlyphPath *glyph;
+
+   /* Glyphs are made under the draw lock, but once made are not	*/
+   /* changed until the character is edited, so they are drawn	*/
+   /* without it.							*/
+
+   QMutexLocker lock(&drawlock);
+   if ((charobj->glyph != NULL) && charobj->glyph->stale(charobj))
+      glyph_invalidate(charobj);
+   if (charobj->glyph == NULL)
+      charobj->glyph = new GlyphPath(charobj);
+   glyph = charobj->glyph;
+   lock.unlock();
+
+   if (!glyph->drawable()) return false;
+   glyph->draw(ctx, scale, passcolor);
+   return true;
+}
+
+/*----------------------------------------------------------------------*/
+/* Discard the cached glyph of an object that has been changed		*/
+/*----------------------------------------------------------------------*/
+
+void glyph_invalidate(objectptr thisobj)
+{
+   delete thisobj->glyph;
+   thisobj->glyph = NULL;
+}
@@ -0,0 +1,48 @@
+#ifndef GLYPH_H
+#define GLYPH_H
+
+#include <QVector>
+
+#include "xctypes.h"
+
+class object;
+class DrawContext;
+
+/*----------------------------------------------------------------------*/
+/* Font character object flattened into a list of point strokes, in	*/
+/* the coordinates of the character object.  Drawing a character then	*/
+/* needs only one point transformation per vertex, instead of a full	*/
+/* UDrawObject() pass over the character's elements.			*/
+/*									*/
+/* Characters containing instances, labels, graphics or parameters	*/
+/* cannot be flattened;  for those, drawable() returns false and the	*/
+/* caller falls back to drawing the object.				*/
+/*----------------------------------------------------------------------*/
+
+class GlyphPath {
+public:
+    explicit GlyphPath(object *);
+
+    inline bool drawable() const { return ok; }
+    bool stale(const object *) const;
+    void draw(DrawContext *, float scale, int passcolor) const;
+
+private:
+    struct Stroke {
+        int first, count;	/* range in "points" */
+        short style;
+        float width;
+        int color;
+    };
+
+    void begin(short style, float width, int color);
+    void end();
+
+    bool ok;
+    short parts;		/* element count when the glyph was built */
+    int maxcount;		/* largest stroke, for the scratch buffer */
+    QVector<XfPoint> points;
+    QVector<Stroke> strokes;
+};
+
+#endif // GLYPH_H
@@ -192,6 +192,10 @@ void graphic::draw(DrawContext* ctx) const
 {
     XPoint ppt;
 
+    /* the scaled and rotated image is kept with the graphic, which	*/
+    /* other drawing threads may be drawing at another scale		*/
+    QMutexLocker lock(&drawlock);
+
     /* transform to current scale and rotation, if necessary */
     if (! transform(ctx)) return;  /* Graphic off-screen */
 
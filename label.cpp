@@ -3,18 +3,21 @@
 #include "prototypes.h"
 #include "colors.h"
 #include "matrix.h"
+#include "layout.h"
 
 label::label() :
         positionable(LABEL),
         cycle(NULL),
-        string(NULL)
+        string(NULL),
+        layout(NULL)
 {
 }
 
 label::label(u_char dopin, XPoint pos) :
         positionable(LABEL),
         cycle(NULL),
-        string(new stringpart)
+        string(new stringpart),
+        layout(NULL)
 {
    rotation = 0;
    color = areawin->color;
@@ -37,7 +40,8 @@ label::label(u_char dopin, XPoint pos) :
 label::label(const label & src) :
         positionable(LABEL),
         cycle(NULL),
-        string(new stringpart)
+        string(new stringpart),
+        layout(NULL)
 {
     *this = src;
 }
@@ -48,6 +52,8 @@ label & label::operator=(const label & src)
     positionable::operator=(src);
     freelabel(string);
     string = stringcopy(src.string);
+    delete layout;
+    layout = NULL;
     position = src.position;
     rotation = src.rotation;
     scale = src.scale;
@@ -61,6 +67,7 @@ label & label::operator=(const label & src)
 label::~label()
 {
     freelabel(string);
+    delete layout;
 }
 
 generic* label::copy() const
@@ -0,0 +1,156 @@
+/*----------------------------------------------------------------------*/
+/* layout.cpp --- cached measurement of label strings			*/
+/*----------------------------------------------------------------------*/
+
+#include "xcircuit.h"
+#include "prototypes.h"
+#include "context.h"
+#include "layout.h"
+
+/*----------------------------------------------------------------------*/
+/* Bumped on every change which may affect the layout of any label	*/
+/*----------------------------------------------------------------------*/
+
+static int layout_generation = 0;
+
+void TextLayout::clear()
+{
+   full.width = full.ascent = full.descent = full.base = 0;
+   tail = full;
+   stops.clear();
+   glyphs.clear();
+   xend = 0.5;
+   posend = 0;
+   cacheable = true;
+}
+
+/*----------------------------------------------------------------------*/
+/* Extents of the string up to (and including) position "pos"		*/
+/*----------------------------------------------------------------------*/
+
+TextExtents TextLayout::stop(short pos) const
+{
+   if (pos < 1) pos = 1;
+   return (pos <= stops.size()) ? stops[pos - 1] : tail;
+}
+
+/*----------------------------------------------------------------------*/
+/* Find the string position nearest to the point "tbreak", given in	*/
+/* the coordinates of the label.  Lines are laid out downward, so the	*/
+/* characters on lines at or below the point are a tail of the glyph	*/
+/* list, found by bisection;  the character is then the first one on	*/
+/* those lines which extends past the point.				*/
+/*----------------------------------------------------------------------*/
+
+short TextLayout::hit(const XPoint *tbreak, short slen) const
+{
+   float xtotal = xend, lasttotal = 0.5;
+   short locpos = posend, lastpos = 0;
+   int lo, hi, mid;
+
+   lo = 0;
+   hi = glyphs.size();
+   while (lo < hi) {
+      mid = (lo + hi) >> 1;
+      if (glyphs[mid].base <= tbreak->y) hi = mid;
+      else lo = mid + 1;
+   }
+   for (; lo < glyphs.size(); lo++)
+      if (glyphs[lo].x > tbreak->x) break;
+
+   if (lo < glyphs.size()) {
+      xtotal = glyphs[lo].x;
+      locpos = glyphs[lo].pos;
+   }
+   if (lo > 0) {
+      lasttotal = glyphs[lo - 1].x;
+      lastpos = glyphs[lo - 1].pos;
+   }
+
+   if ((tbreak->x - lasttotal) < (xtotal - tbreak->x))
+      locpos = lastpos + 1;
+   if (locpos < 1) locpos = 1;
+   else if (locpos > slen) locpos = slen;
+   return locpos;
+}
+
+LabelLayout::LabelLayout() :
+        generation(-1),
+        strip(false),
+        hasparams(false)
+{
+}
+
+/*----------------------------------------------------------------------*/
+/* Return the layout of the label for the given instance, measuring	*/
+/* the string if it has not been seen since the last change.  Layouts	*/
+/* which cannot be kept are returned in "scratch".			*/
+/*----------------------------------------------------------------------*/
+
+const TextLayout *LabelLayout::find(const label *thislabel, objinstptr localinst,
+		bool dostrip, TextLayout *scratch)
+{
+   stringpart *strptr;
+   const void *key = NULL;
+
+   if ((generation != layout_generation) || (strip != dostrip)) {
+      entries.clear();
+      generation = layout_generation;
+      strip = dostrip;
+      hasparams = false;
+      for (strptr = thislabel->string; strptr != NULL; strptr = strptr->nextpart)
+	 if (strptr->type == PARAM_START) {
+	    hasparams = true;
+	    break;
+	 }
+   }
+
+   /* Without a calling instance, parameters come from the current page */
+   if (hasparams)
+      key = (localinst != NULL) ? (const void *)localinst : (const void *)topobject;
+
+   QHash<const void *, TextLayout>::iterator it = entries.find(key);
+   if (it != entries.end()) return &(*it);
+
+   layoutstring(thislabel, localinst, dostrip, scratch);
+   if (!scratch->cacheable) return scratch;
+   return &(*entries.insert(key, *scratch));
+}
+
+/*----------------------------------------------------------------------*/
+/* Return the layout of a label string.  The label being edited is	*/
+/* always measured anew.  Labels are measured, and kept layouts found	*/
+/* (or thrown out), by any drawing thread, so it is done under the	*/
+/* draw lock and the layout found is copied to "scratch";  the copy	*/
+/* is cheap, as its lists are shared.					*/
+/*----------------------------------------------------------------------*/
+
+const TextLayout *textlayout(const label *thislabel, objinstptr localinst,
+		bool strip, TextLayout *scratch)
+{
+   const TextLayout *found;
+   QMutexLocker lock(&drawlock);
+
+   if (((eventmode == TEXT_MODE) || (eventmode == ETEXT_MODE) ||
+		(eventmode == CATTEXT_MODE)) && (areawin->selects > 0) &&
+		(thislabel == TOLABEL(EDITPART))) {
+      layoutstring(thislabel, localinst, strip, scratch);
+      return scratch;
+   }
+
+   if (thislabel->layout == NULL)
+      thislabel->layout = new LabelLayout();
+   found = thislabel->layout->find(thislabel, localinst, strip, scratch);
+   if (found != scratch) *scratch = *found;
+   return scratch;
+}
+
+/*----------------------------------------------------------------------*/
+/* Discard all label layouts.  Called whenever an object, a string, a	*/
+/* parameter value or the set of fonts changes.				*/
+/*----------------------------------------------------------------------*/
+
+void layout_invalidate()
+{
+   layout_generation++;
+}
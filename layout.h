@@ -0,0 +1,55 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <QHash>
+#include <QVector>
+
+#include "xcircuit.h"
+
+/*----------------------------------------------------------------------*/
+/* Result of measuring a label string.  One pass over the string	*/
+/* records the full extents, the extents up to each string position	*/
+/* (for cursor placement and substring selection) and the x position	*/
+/* following each printable character (for hit testing).		*/
+/*----------------------------------------------------------------------*/
+
+struct TextLayout {
+    struct Glyph {
+        short pos;		/* string position of the character */
+        short base;		/* baseline of the character's line */
+        float x;		/* x position following the character */
+    };
+
+    TextExtents full;		/* extents of the whole string */
+    TextExtents tail;		/* extents when stopped past the end */
+    QVector<TextExtents> stops;	/* extents up to position 1, 2, ... */
+    QVector<Glyph> glyphs;
+    float xend;			/* x position at end of string */
+    short posend;		/* string position at end of string */
+    bool cacheable;		/* false if expressions were evaluated */
+
+    void clear();
+    TextExtents stop(short pos) const;
+    short hit(const XPoint *tbreak, short slen) const;
+};
+
+/*----------------------------------------------------------------------*/
+/* Layouts of one label, kept with the label.  Labels with parameters	*/
+/* are laid out once per calling instance.  All layouts are discarded	*/
+/* when layout_invalidate() is called, which happens on any edit of an	*/
+/* object, string, parameter or font.					*/
+/*----------------------------------------------------------------------*/
+
+class LabelLayout {
+public:
+    LabelLayout();
+    const TextLayout *find(const label *, objinstptr, bool strip, TextLayout *);
+
+private:
+    int generation;
+    bool strip;			/* technology namespaces stripped */
+    bool hasparams;
+    QHash<const void *, TextLayout> entries;
+};
+
+#endif // LAYOUT_H
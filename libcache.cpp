@@ -0,0 +1,1347 @@
+/*----------------------------------------------------------------------*/
+/* libcache.cpp --- binary cache of library and font files		*/
+/*----------------------------------------------------------------------*/
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSemaphore>
+#include <QSet>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QVector>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "xcircuit.h"
+#include "colors.h"
+#include "prototypes.h"
+#include "libcache.h"
+
+extern fontinfo *fonts;
+extern short fontcount;
+extern float version;
+extern bool load_in_progress;
+
+/*----------------------------------------------------------------------*/
+/* Cache file format							*/
+/*----------------------------------------------------------------------*/
+
+#define LIBCACHE_MAGIC	0x58434c43	/* "XCLC" */
+#define LIBCACHE_FORMAT	3
+
+static void setformat(QDataStream &stream)
+{
+   stream.setVersion(QDataStream::Qt_5_0);
+   stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+}
+
+/* Records in the body of a cache file, in the order of the file	*/
+
+enum {REC_END = 0, REC_OBJECT, REC_LIBINST, REC_COLOR, REC_BBOX};
+
+static void writebbox(QDataStream &out, const BBox &bbox)
+{
+   out << (qint32)bbox.lowerleft.x << (qint32)bbox.lowerleft.y
+	<< (qint32)bbox.width << (qint32)bbox.height;
+}
+
+static void readbbox(QDataStream &in, BBox &bbox)
+{
+   qint32 x, y, width, height;
+
+   in >> x >> y >> width >> height;
+   bbox.lowerleft.x = x;
+   bbox.lowerleft.y = y;
+   bbox.width = width;
+   bbox.height = height;
+}
+
+/*----------------------------------------------------------------------*/
+/* StringTable								*/
+/*----------------------------------------------------------------------*/
+
+qint32 StringTable::index(const QByteArray &str)
+{
+   QHash<QByteArray, qint32>::const_iterator it = indexes.constFind(str);
+
+   if (it != indexes.constEnd()) return *it;
+   strings.append(str);
+   indexes.insert(str, strings.size() - 1);
+   return strings.size() - 1;
+}
+
+/*----------------------------------------------------------------------*/
+/* LibWriter								*/
+/*----------------------------------------------------------------------*/
+
+void LibWriter::writename(const QByteArray &name)
+{
+   if (strings != NULL)
+      out << strings->index(name);
+   else
+      out << name;
+}
+
+void LibWriter::writepoint(const XPoint &pt)
+{
+   out << (qint32)pt.x << (qint32)pt.y;
+}
+
+void LibWriter::writestring(stringpart *strptr)
+{
+   stringpart *sp;
+   qint32 nparts = 0;
+
+   for (sp = strptr; sp != NULL; sp = sp->nextpart) nparts++;
+   out << nparts;
+
+   for (sp = strptr; sp != NULL; sp = sp->nextpart) {
+      out << (qint8)sp->type;
+      switch (sp->type) {
+	 case TEXT_STRING:
+	    out << QByteArray(sp->data.string);
+	    break;
+	 case PARAM_START:
+	    writename(sp->data.string);
+	    break;
+	 case FONT_NAME:
+	    if ((sp->data.font < 0) || (sp->data.font >= fontcount))
+	       valid = false;
+	    else
+	       writename(fonts[sp->data.font].psname);
+	    break;
+	 case FONT_SCALE:
+	    out << sp->data.scale;
+	    break;
+	 case FONT_COLOR:
+	    if ((sp->data.color < 0) || (sp->data.color >= colorlist.count()))
+	       out << (qint32)DEFAULTCOLOR;
+	    else
+	       out << (qint32)colorlist[sp->data.color];
+	    break;
+	 case KERN:
+	    out << (qint16)sp->data.kern[0] << (qint16)sp->data.kern[1];
+	    break;
+      }
+   }
+}
+
+void LibWriter::writeparams(oparamptr ops)
+{
+   oparamptr op;
+   qint32 nparams = 0;
+
+   for (op = ops; op != NULL; op = op->next) nparams++;
+   out << nparams;
+
+   for (op = ops; op != NULL; op = op->next) {
+      writename(op->key);
+      out << (quint8)op->type << (quint8)op->which;
+      switch (op->type) {
+	 case XC_INT:
+	    out << (qint32)op->parameter.ivalue;
+	    break;
+	 case XC_FLOAT:
+	    out << op->parameter.fvalue;
+	    break;
+	 case XC_STRING:
+	    writestring(op->parameter.string);
+	    break;
+	 case XC_EXPR:
+	    out << QByteArray(op->parameter.expr);
+	    break;
+      }
+   }
+}
+
+void LibWriter::writeeparams(eparamptr epp)
+{
+   eparamptr ep;
+   qint32 nparams = 0;
+
+   for (ep = epp; ep != NULL; ep = ep->next) nparams++;
+   out << nparams;
+
+   for (ep = epp; ep != NULL; ep = ep->next) {
+      writename(ep->key);
+      out << (quint8)ep->flags;
+      if (ep->flags & P_INDIRECT)
+	 writename(ep->pdata.refkey);
+      else
+	 out << (qint32)ep->pdata.pointno;	/* also covers pathpt[] */
+   }
+}
+
+void LibWriter::writeelement(genericptr elem)
+{
+   out << (quint8)elem->type << (qint32)elem->color;
+   writeeparams(elem->passed);
+
+   switch (ELEMENTTYPE(elem)) {
+      case OBJINST: {
+	 objinstptr inst = (objinstptr)elem;
+	 QByteArray name = instnames.value(inst);
+
+	 if (name.isNull()) name = inst->thisobject->name;
+	 deps.append(name);
+	 writename(name);
+	 writepoint(inst->position);
+	 out << (qint16)inst->rotation << inst->scale;
+	 writeparams(inst->params);
+	 } break;
+
+      case LABEL: {
+	 labelptr lab = (labelptr)elem;
+	 writepoint(lab->position);
+	 out << (qint16)lab->rotation << lab->scale;
+	 out << (qint16)lab->justify << (quint8)lab->pin;
+	 writestring(lab->string);
+	 } break;
+
+      case POLYGON: {
+	 polyptr poly = (polyptr)elem;
+	 out << (quint16)poly->style << poly->width;
+	 out << (qint32)poly->points.count();
+	 for (pointlist::iterator pt = poly->points.begin();
+			pt != poly->points.end(); ++pt)
+	    writepoint(*pt);
+	 } break;
+
+      case SPLINE: {
+	 splineptr spl = (splineptr)elem;
+	 int i;
+	 out << (quint16)spl->style << spl->width;
+	 for (i = 0; i < 4; i++) writepoint(spl->ctrl[i]);
+	 } break;
+
+      case ARC: {
+	 arcptr thisarc = (arcptr)elem;
+	 out << (quint16)thisarc->style << thisarc->width;
+	 out << (qint32)thisarc->radius << (qint32)thisarc->yaxis;
+	 out << thisarc->angle1 << thisarc->angle2;
+	 writepoint(thisarc->position);
+	 } break;
+
+      case PATH: {
+	 pathptr thispath = (pathptr)elem;
+	 out << (quint16)thispath->style << thispath->width;
+	 out << (qint32)thispath->parts;
+	 for (genericptr *pgen = thispath->begin(); pgen < thispath->end(); pgen++)
+	    writeelement(*pgen);
+	 } break;
+
+      case GRAPHIC: {
+	 graphicptr gp = (graphicptr)elem;
+
+	 /* Graphics refer to the session's image list */
+	 if ((images == NULL) || !images->contains(gp->source)) {
+	    valid = false;
+	    break;
+	 }
+	 out << images->value(gp->source);
+	 writepoint(gp->position);
+	 out << (qint16)gp->rotation << gp->scale;
+	 } break;
+
+      default:
+	 valid = false;
+	 break;
+   }
+}
+
+void LibWriter::writeelements(objectptr thisobj)
+{
+   out << (qint32)thisobj->parts;
+   for (genericptr *pgen = thisobj->begin(); pgen < thisobj->end(); pgen++)
+      writeelement(*pgen);
+}
+
+/*----------------------------------------------------------------------*/
+/* Write an object:  its flags and parameters, the names called by its	*/
+/* instances, and the block of its elements.				*/
+/*----------------------------------------------------------------------*/
+
+void LibWriter::writeobject(objectptr thisobj)
+{
+   QByteArray block;
+   QDataStream blockout(&block, QIODevice::WriteOnly);
+   LibWriter elements(blockout);
+
+   out << (quint8)thisobj->hidden << (quint8)thisobj->schemtype
+	<< (quint8)thisobj->valid;
+   writebbox(out, thisobj->bbox);
+   writeparams(thisobj->params);
+
+   setformat(blockout);
+   elements.instnames = instnames;
+   elements.strings = strings;
+   elements.images = images;
+   elements.writeelements(thisobj);
+   if (!elements.ok()) valid = false;
+   out << elements.deps << block;
+}
+
+/*----------------------------------------------------------------------*/
+/* LibReader								*/
+/*----------------------------------------------------------------------*/
+
+static char *readcstring(QDataStream &in)
+{
+   QByteArray str;
+
+   in >> str;
+   return str.isNull() ? NULL : strdup(str.constData());
+}
+
+QByteArray LibReader::readname()
+{
+   QByteArray name;
+   qint32 index;
+
+   if (strings == NULL)
+      in >> name;
+   else {
+      in >> index;
+      if ((index >= 0) && (index < strings->size()))
+	 name = strings->at(index);
+      else
+	 in.setStatus(QDataStream::ReadCorruptData);
+   }
+   return name;
+}
+
+char *LibReader::readcname()
+{
+   QByteArray name = readname();
+
+   return name.isNull() ? NULL : strdup(name.constData());
+}
+
+/*----------------------------------------------------------------------*/
+/* Read the count of a list whose entries are at least "minsize" bytes	*/
+/* long.  A count the rest of the stream cannot hold is corrupt; it is	*/
+/* refused here, before anything is allocated for it.			*/
+/*----------------------------------------------------------------------*/
+
+qint32 LibReader::readcount(int minsize)
+{
+   qint32 count = 0;
+
+   in >> count;
+   if (in.status() != QDataStream::Ok) return 0;
+   if ((count < 0) || ((in.device() != NULL) &&
+		(count > in.device()->bytesAvailable() / minsize))) {
+      in.setStatus(QDataStream::ReadCorruptData);
+      return 0;
+   }
+   return count;
+}
+
+void LibReader::readpoint(XPoint &pt)
+{
+   qint32 x, y;
+
+   in >> x >> y;
+   pt.x = x;
+   pt.y = y;
+}
+
+stringpart *LibReader::readstring()
+{
+   stringpart *strhead = NULL, **tail = &strhead, *newpart;
+   QByteArray psname;
+   qint32 nparts, color;
+   qint16 kx, ky;
+   qint8 type;
+
+   nparts = readcount(1);
+   while ((nparts-- > 0) && (in.status() == QDataStream::Ok)) {
+      in >> type;
+      newpart = new stringpart;
+      newpart->type = type;
+      newpart->data.string = NULL;
+      switch (type) {
+	 case TEXT_STRING:
+	    newpart->data.string = readcstring(in);
+	    break;
+	 case PARAM_START:
+	    newpart->data.string = readcname();
+	    break;
+	 case FONT_NAME:
+	    psname = readname();
+	    newpart->data.font = lookupfont(psname.constData());
+	    break;
+	 case FONT_SCALE:
+	    in >> newpart->data.scale;
+	    break;
+	 case FONT_COLOR:
+	    in >> color;
+	    newpart->data.color = (color == (qint32)DEFAULTCOLOR) ? DEFAULTCOLOR :
+			colorlist.indexOf((QRgb)color);
+	    break;
+	 case KERN:
+	    in >> kx >> ky;
+	    newpart->data.kern[0] = kx;
+	    newpart->data.kern[1] = ky;
+	    break;
+      }
+      *tail = newpart;
+      tail = &newpart->nextpart;
+   }
+   return strhead;
+}
+
+oparamptr LibReader::readparams()
+{
+   oparamptr head = NULL, *tail = &head, newops;
+   QByteArray key;
+   qint32 nparams, ivalue;
+   quint8 type, which;
+
+   nparams = readcount(6);
+   while ((nparams-- > 0) && (in.status() == QDataStream::Ok)) {
+      key = readname();
+      in >> type >> which;
+      newops = make_new_parameter(key.data());
+      newops->type = type;
+      newops->which = which;
+      switch (type) {
+	 case XC_INT:
+	    in >> ivalue;
+	    newops->parameter.ivalue = ivalue;
+	    break;
+	 case XC_FLOAT:
+	    in >> newops->parameter.fvalue;
+	    break;
+	 case XC_STRING:
+	    newops->parameter.string = readstring();
+	    break;
+	 case XC_EXPR:
+	    newops->parameter.expr = readcstring(in);
+	    break;
+      }
+      *tail = newops;
+      tail = &newops->next;
+   }
+   return head;
+}
+
+eparamptr LibReader::readeparams()
+{
+   eparamptr head = NULL, *tail = &head, newepp;
+   QByteArray key;
+   qint32 nparams, pointno;
+   quint8 flags;
+
+   nparams = readcount(5);
+   while ((nparams-- > 0) && (in.status() == QDataStream::Ok)) {
+      key = readname();
+      in >> flags;
+      newepp = make_new_eparam(key.data());
+      newepp->flags = flags;
+      if (flags & P_INDIRECT)
+	 newepp->pdata.refkey = readcname();
+      else {
+	 in >> pointno;
+	 newepp->pdata.pointno = pointno;
+      }
+      *tail = newepp;
+      tail = &newepp->next;
+   }
+   return head;
+}
+
+/*----------------------------------------------------------------------*/
+/* Read an element and append it to "dest".  An instance of an object	*/
+/* which can no longer be found is read and dropped, as the text file	*/
+/* reader would.							*/
+/*----------------------------------------------------------------------*/
+
+bool LibReader::readelement(Plist *dest)
+{
+   genericptr elem = NULL;
+   eparamptr passed;
+   qint32 color, count;
+   qint16 rotation, sval, yaxis;
+   qint32 radius, axis;
+   quint16 style;
+   quint8 type, pin;
+   int i;
+
+   in >> type >> color;
+   passed = readeparams();
+
+   switch (type) {
+      case OBJINST: {
+	 objinstptr inst = new objinst;
+	 QByteArray name;
+	 objectptr libobj;
+
+	 name = readname();
+	 readpoint(inst->position);
+	 in >> rotation >> inst->scale;
+	 inst->rotation = rotation;
+	 inst->params = readparams();
+
+	 if (deps == NULL)
+	    libobj = findinstobject(mode, name.data());
+	 else
+	    libobj = (nextdep < deps->size()) ? deps->at(nextdep++) : NULL;
+
+	 if (libobj != NULL) {
+	    inst->thisobject = libobj;
+	    inst->bbox = libobj->bbox;
+	    elem = inst;
+	 }
+	 else {
+	    inst->passed = passed;
+	    delete inst;
+	    return (in.status() == QDataStream::Ok);
+	 }
+	 } break;
+
+      case LABEL: {
+	 labelptr lab = new label;
+	 readpoint(lab->position);
+	 in >> rotation >> lab->scale >> sval >> pin;
+	 lab->rotation = rotation;
+	 lab->justify = sval;
+	 lab->pin = pin;
+	 lab->string = readstring();
+	 elem = lab;
+	 } break;
+
+      case POLYGON: {
+	 polyptr poly = new polygon;
+	 in >> style >> poly->width;
+	 poly->style = style;
+	 count = readcount(8);
+	 poly->points.resize(count);
+	 for (pointlist::iterator pt = poly->points.begin();
+			pt != poly->points.end(); ++pt)
+	    readpoint(*pt);
+	 elem = poly;
+	 } break;
+
+      case SPLINE: {
+	 splineptr spl = new spline;
+	 in >> style >> spl->width;
+	 spl->style = style;
+	 for (i = 0; i < 4; i++) readpoint(spl->ctrl[i]);
+	 spl->calc();
+	 elem = spl;
+	 } break;
+
+      case ARC: {
+	 arcptr thisarc = new arc;
+	 in >> style >> thisarc->width;
+	 if (narrowarcs) {
+	    in >> sval >> yaxis;
+	    radius = sval;
+	    axis = yaxis;
+	 }
+	 else
+	    in >> radius >> axis;
+	 thisarc->style = style;
+	 thisarc->radius = radius;
+	 thisarc->yaxis = axis;
+	 in >> thisarc->angle1 >> thisarc->angle2;
+	 readpoint(thisarc->position);
+	 thisarc->calc();
+	 elem = thisarc;
+	 } break;
+
+      case PATH: {
+	 pathptr thispath = new path;
+	 in >> style >> thispath->width;
+	 thispath->style = style;
+	 count = readcount(9);
+	 for (i = 0; i < count; i++)
+	    if (!readelement(thispath)) break;
+	 elem = thispath;
+	 } break;
+
+      case GRAPHIC: {
+	 graphicptr gp = new graphic;
+	 Imagedata *img;
+
+	 in >> count;
+	 readpoint(gp->position);
+	 in >> rotation >> gp->scale;
+	 gp->rotation = rotation;
+	 gp->passed = passed;
+
+	 if ((images == NULL) || (count < 0) || (count >= images->size())) {
+	    delete gp;
+	    in.setStatus(QDataStream::ReadCorruptData);
+	    return false;
+	 }
+	 img = xobjs.imagelist + images->at(count);
+	 gp->source = img->image;
+	 img->refcount++;
+	 elem = gp;
+	 } break;
+
+      default:
+	 in.setStatus(QDataStream::ReadCorruptData);
+	 return false;
+   }
+
+   elem->color = color;
+   elem->passed = passed;
+   dest->append(elem);
+   if (IS_OBJINST(elem)) calcbboxinst((objinstptr)elem);
+
+   return (in.status() == QDataStream::Ok);
+}
+
+/*----------------------------------------------------------------------*/
+/* Read a block of elements written by LibWriter::writeelements()	*/
+/*----------------------------------------------------------------------*/
+
+bool LibReader::readelements(Plist *dest)
+{
+   qint32 parts;
+   int i;
+
+   parts = readcount(9);
+   for (i = 0; i < parts; i++)
+      if (!readelement(dest)) return false;
+
+   return (in.status() == QDataStream::Ok);
+}
+
+bool LibReader::readheader(objectptr thisobj)
+{
+   quint8 hidden, schemtype, valid;
+
+   in >> hidden >> schemtype >> valid;
+   thisobj->hidden = hidden;
+   thisobj->schemtype = schemtype;
+   thisobj->valid = valid;
+   readbbox(in, thisobj->bbox);
+   thisobj->params = readparams();
+
+   return (in.status() == QDataStream::Ok);
+}
+
+/*----------------------------------------------------------------------*/
+/* Read an object written by LibWriter::writeobject() into "thisobj",	*/
+/* a new, named and empty library object.				*/
+/*----------------------------------------------------------------------*/
+
+bool LibReader::readobject(objectptr thisobj)
+{
+   QList<QByteArray> names;
+   QByteArray block;
+
+   if (!readheader(thisobj)) return false;
+   in >> names >> block;
+   if (in.status() != QDataStream::Ok) return false;
+
+   QDataStream blockin(block);
+   setformat(blockin);
+   LibReader elements(blockin, mode);
+   elements.strings = strings;
+   elements.images = images;
+   elements.narrowarcs = narrowarcs;
+
+   return elements.readelements(thisobj);
+}
+
+/*----------------------------------------------------------------------*/
+/* Same as readobject(), but keep the elements unread.  Returns their	*/
+/* block, with the objects called by its instances, or NULL on error.	*/
+/*----------------------------------------------------------------------*/
+
+LazyBody *LibReader::readlazy(objectptr thisobj)
+{
+   QList<QByteArray> names;
+   LazyBody *lazy;
+
+   if (!readheader(thisobj)) return NULL;
+   lazy = new LazyBody(mode);
+   in >> names >> lazy->elements;
+   if (in.status() != QDataStream::Ok) {
+      delete lazy;
+      return NULL;
+   }
+   foreach (QByteArray name, names)
+      lazy->deps.append(findinstobject(mode, name.data()));
+   return lazy;
+}
+
+/*----------------------------------------------------------------------*/
+/* Location of the cache of library file "inname".  The cache directory	*/
+/* is $XCIRCUIT_CACHE_DIR if set (such as a site-wide cache filled by	*/
+/* "xcircuit -prewarm"), or else the user's cache directory.		*/
+/*----------------------------------------------------------------------*/
+
+static QString cachedir()
+{
+   const char *tmp_s = getenv((const char *)"XCIRCUIT_CACHE_DIR");
+
+   if (tmp_s != NULL && *tmp_s != '\0')
+      return QString::fromLocal8Bit(tmp_s);
+   return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+		+ "/xcircuit";
+}
+
+static QString cachefile(const QString &path, short mode)
+{
+   QByteArray key = path.toUtf8();
+
+   if (mode == FONTLIB) key.prepend("font:");
+   return cachedir() + "/" + QCryptographicHash::hash(key,
+		QCryptographicHash::Md5).toHex() + ".xcl";
+}
+
+/*----------------------------------------------------------------------*/
+/* A library file load in progress, recorded for the cache.  Library	*/
+/* loads nest (a label may ask for a font that has not been loaded),	*/
+/* so the recordings are kept in a stack.				*/
+/*----------------------------------------------------------------------*/
+
+class LibRecorder {
+public:
+   LibRecorder() : out(&body, QIODevice::WriteOnly), writer(out),
+	depth(0), valid(true) {}
+
+   short mode;
+   QString path;
+   QByteArray technology;
+   float fileversion;
+   int topparts;		/* library page, to check that the file */
+   oparamptr topparams;		/* only defines objects */
+
+   QByteArray body;
+   QDataStream out;
+   LibWriter writer;
+   QByteArray objname;		/* name of the object being read */
+   int depth;
+   bool valid;
+};
+
+static QVector<LibRecorder *> recorders;
+
+static inline LibRecorder *recorder()
+{
+   return recorders.isEmpty() ? NULL : recorders.last();
+}
+
+/*----------------------------------------------------------------------*/
+/* Start recording a library file load, after reading its header	*/
+/*----------------------------------------------------------------------*/
+
+void libcache_begin(short mode, const QString &inname, TechPtr nsptr)
+{
+   LibRecorder *rec = new LibRecorder;
+
+   setformat(rec->out);
+   rec->mode = mode;
+   rec->path = QFileInfo(inname).absoluteFilePath();
+   if (nsptr != NULL) rec->technology = nsptr->technology;
+   rec->fileversion = version;
+   rec->topparts = topobject->parts;
+   rec->topparams = topobject->params;
+   recorders.append(rec);
+}
+
+/*----------------------------------------------------------------------*/
+/* Something was read that the cache does not reproduce		*/
+/*----------------------------------------------------------------------*/
+
+void libcache_reject()
+{
+   LibRecorder *rec = recorder();
+
+   if (rec != NULL) rec->valid = false;
+}
+
+/*----------------------------------------------------------------------*/
+/* An object definition starts, with the name given in the file, and	*/
+/* ends (before it is compared with any object of the same name).	*/
+/*----------------------------------------------------------------------*/
+
+void libcache_beginobject(const char *name)
+{
+   LibRecorder *rec = recorder();
+
+   if (rec == NULL) return;
+   if (rec->depth++ > 0) rec->valid = false;	/* nested definition */
+   rec->objname = name;
+}
+
+void libcache_endobject(objectptr thisobj)
+{
+   LibRecorder *rec = recorder();
+
+   if (rec == NULL) return;
+   if (thisobj->symschem != NULL) rec->valid = false;
+   if ((--rec->depth == 0) && rec->valid) {
+      rec->out << (quint8)REC_OBJECT << rec->objname;
+      rec->writer.writeobject(thisobj);
+      if (!rec->writer.ok()) rec->valid = false;
+   }
+   rec->writer.instnames.clear();
+}
+
+/*----------------------------------------------------------------------*/
+/* The object just ended was added to library "mode":  record the	*/
+/* bounding boxes worked out for it and for its library instance.	*/
+/*----------------------------------------------------------------------*/
+
+void libcache_addedobject(short mode, objectptr thisobj)
+{
+   LibRecorder *rec = recorder();
+   liblistptr spec;
+
+   if ((rec == NULL) || (rec->depth > 0) || (mode == FONTLIB)) return;
+
+   for (spec = xobjs.userlibs[mode - LIBRARY].instlist; spec != NULL &&
+		spec->next != NULL; spec = spec->next) ;
+   if ((spec == NULL) || (spec->thisinst->thisobject != thisobj)) {
+      rec->valid = false;
+      return;
+   }
+
+   rec->out << (quint8)REC_BBOX;
+   writebbox(rec->out, thisobj->bbox);
+   writebbox(rec->out, spec->thisinst->bbox);
+   rec->out << (quint8)(spec->thisinst->schembbox != NULL);
+   if (spec->thisinst->schembbox != NULL)
+      writebbox(rec->out, *spec->thisinst->schembbox);
+}
+
+/*----------------------------------------------------------------------*/
+/* An instance was read, calling its object by "name"			*/
+/*----------------------------------------------------------------------*/
+
+void libcache_instance(objinstptr inst, const char *name)
+{
+   LibRecorder *rec = recorder();
+
+   if (rec != NULL) rec->writer.instnames.insert(inst, QByteArray(name));
+}
+
+/*----------------------------------------------------------------------*/
+/* A "libinst" line, with the object name and the whole line		*/
+/*----------------------------------------------------------------------*/
+
+void libcache_libinst(const char *name, const char *buffer)
+{
+   LibRecorder *rec = recorder();
+
+   if (rec == NULL) return;
+   if (rec->depth > 0) rec->valid = false;
+   rec->out << (quint8)REC_LIBINST << QByteArray(name) << QByteArray(buffer);
+}
+
+/*----------------------------------------------------------------------*/
+/* A color was added to the color list					*/
+/*----------------------------------------------------------------------*/
+
+void libcache_color(int ccolor)
+{
+   LibRecorder *rec = recorder();
+
+   if (rec != NULL) rec->out << (quint8)REC_COLOR << (qint32)ccolor;
+}
+
+/*----------------------------------------------------------------------*/
+/* The file has been read:  write the cache, unless something in it	*/
+/* could not be recorded.						*/
+/*----------------------------------------------------------------------*/
+
+void libcache_end()
+{
+   LibRecorder *rec = recorder();
+   QFileInfo info;
+   QSaveFile file;
+   QByteArray header;
+
+   if (rec == NULL) return;
+   recorders.removeLast();
+
+   if ((topobject->parts != rec->topparts) ||
+		((oparamptr)topobject->params != rec->topparams))
+      rec->valid = false;
+
+   info.setFile(rec->path);
+   if (rec->valid && info.exists() && QDir().mkpath(cachedir())) {
+      QDataStream out(&header, QIODevice::WriteOnly);
+
+      rec->out << (quint8)REC_END;
+      setformat(out);
+      out << (quint32)LIBCACHE_MAGIC << (quint32)LIBCACHE_FORMAT
+		<< (float)PROG_VERSION << (quint8)(rec->mode == FONTLIB)
+		<< rec->path << (qint64)info.size()
+		<< (qint64)info.lastModified().toMSecsSinceEpoch()
+		<< rec->fileversion << rec->technology
+		<< QCryptographicHash::hash(rec->body, QCryptographicHash::Md5)
+		<< rec->body;
+
+      file.setFileName(cachefile(rec->path, rec->mode));
+      if (file.open(QIODevice::WriteOnly)) {
+	 file.write(header);
+	 file.commit();
+      }
+   }
+   delete rec;
+}
+
+/*----------------------------------------------------------------------*/
+/* Read the cache of "inname" if it is current.  Return the body and	*/
+/* the header values that the text file would have supplied.  Touches	*/
+/* nothing but the files, so it may run on any thread.			*/
+/*----------------------------------------------------------------------*/
+
+static bool readcache(short mode, const QString &inname, QByteArray *body,
+	float *fileversion, QByteArray *technology)
+{
+   QFileInfo info(inname);
+   QString path = info.absoluteFilePath(), cpath;
+   QFile file(cachefile(path, mode));
+   QByteArray checksum;
+   quint32 magic, format;
+   qint64 size, mtime;
+   float progversion;
+   quint8 isfont;
+
+   if (!info.exists() || !file.open(QIODevice::ReadOnly)) return false;
+
+   QDataStream in(&file);
+   setformat(in);
+   in >> magic >> format;
+   if ((magic != LIBCACHE_MAGIC) || (format != LIBCACHE_FORMAT)) return false;
+
+   in >> progversion >> isfont >> cpath >> size >> mtime;
+   if ((progversion != (float)PROG_VERSION) || (isfont != (mode == FONTLIB))
+		|| (cpath != path) || (size != info.size())
+		|| (mtime != info.lastModified().toMSecsSinceEpoch()))
+      return false;
+
+   in >> *fileversion >> *technology >> checksum >> *body;
+   if (in.status() != QDataStream::Ok) return false;
+   return (checksum == QCryptographicHash::hash(*body, QCryptographicHash::Md5));
+}
+
+/*----------------------------------------------------------------------*/
+/* The caches of files named in a script are read and checked ahead,	*/
+/* several at a time, on a pool of worker threads, and loadlibrary()	*/
+/* then makes the objects from them without parsing.  Objects are made	*/
+/* on the main thread in the order of the script, so that name		*/
+/* resolution, aliases and technologies are as for a serial load.	*/
+/*									*/
+/* Files without a current cache are not read ahead:  they are parsed	*/
+/* by objectread() on the main thread, which looks up instances, fonts	*/
+/* and colors in the global tables and sets the global "version", and	*/
+/* so cannot run on a worker.						*/
+/*----------------------------------------------------------------------*/
+
+class Prefetch : public QRunnable {
+public:
+   Prefetch(short mode, const QString &path) : mode(mode), path(path),
+	size(-1), mtime(-1), cached(false), fileversion(0.0)
+	{ setAutoDelete(false); }
+   void run();
+
+   short mode;
+   QString path;
+   qint64 size, mtime;		/* of the file when read */
+   bool cached;
+   QByteArray body, technology;
+   float fileversion;
+   QSemaphore done;
+};
+
+static QHash<QString, Prefetch *> prefetches;
+
+static QString prefetchkey(const QString &path, short mode)
+{
+   return (mode == FONTLIB) ? ("font:" + path) : path;
+}
+
+void Prefetch::run()
+{
+   QFileInfo info(path);
+
+   size = info.size();
+   mtime = info.lastModified().toMSecsSinceEpoch();
+   cached = readcache(mode, path, &body, &fileversion, &technology);
+   done.release();
+}
+
+/*----------------------------------------------------------------------*/
+/* Start reading the cache of library file "filename", found as	*/
+/* loadlibrary() would find it, for a later load into library "mode".	*/
+/*----------------------------------------------------------------------*/
+
+void libcache_prefetch(short mode, const char *filename)
+{
+   FILE *ps;
+   QString inname, key;
+   char temp[150];
+   Prefetch *pre;
+
+   ps = libopen(filename, mode, &inname);
+   if ((ps == NULL) && (mode == FONTLIB)) {
+      snprintf(temp, sizeof(temp), "fonts/%s", filename);
+      ps = libopen(temp, mode, &inname);
+   }
+   if (ps == NULL) return;
+   fclose(ps);
+
+   inname = QFileInfo(inname).absoluteFilePath();
+   key = prefetchkey(inname, mode);
+   if (prefetches.contains(key)) return;
+
+   pre = new Prefetch(mode, inname);
+   prefetches.insert(key, pre);
+   QThreadPool::globalInstance()->start(pre);
+}
+
+/*----------------------------------------------------------------------*/
+/* Take the read-ahead of "path", if there is one, waiting for it to	*/
+/* finish.  A read-ahead of a file which has changed since is dropped.	*/
+/*----------------------------------------------------------------------*/
+
+static Prefetch *takeprefetch(const QString &path, short mode)
+{
+   Prefetch *pre = prefetches.take(prefetchkey(path, mode));
+   QFileInfo info(path);
+
+   if (pre == NULL) return NULL;
+   pre->done.acquire();
+   if ((pre->size != info.size()) ||
+		(pre->mtime != info.lastModified().toMSecsSinceEpoch())) {
+      delete pre;
+      return NULL;
+   }
+   return pre;
+}
+
+/*----------------------------------------------------------------------*/
+/* Drop read-aheads that were not used (their files were never loaded)	*/
+/*----------------------------------------------------------------------*/
+
+void libcache_endprefetch()
+{
+   foreach (Prefetch *pre, prefetches) {
+      pre->done.acquire();
+      delete pre;
+   }
+   prefetches.clear();
+}
+
+/*----------------------------------------------------------------------*/
+/* Add object "thisobj", whose elements are in "lazy", to the end of	*/
+/* library "mode" as add_object_to_library() would, but with the	*/
+/* bounding boxes of the following REC_BBOX record instead of ones	*/
+/* worked out from the elements.  Returns false if there is no such	*/
+/* record.								*/
+/*----------------------------------------------------------------------*/
+
+static bool add_lazy_object(QDataStream &in, short mode, objectptr thisobj,
+	LazyBody *lazy)
+{
+   objinstptr libinst;
+   quint8 rec, hasschem;
+   char next;
+
+   if ((in.device()->peek(&next, 1) != 1) || (next != REC_BBOX)) return false;
+   in >> rec;
+
+   libinst = addtoinstlist(mode - LIBRARY, thisobj, false);
+   readbbox(in, thisobj->bbox);
+   readbbox(in, libinst->bbox);
+   in >> hasschem;
+   if (hasschem) {
+      libinst->schembbox = new BBox;
+      readbbox(in, *libinst->schembbox);
+   }
+   centerview(libinst);
+
+   thisobj->lazy = lazy;
+   return true;
+}
+
+/*----------------------------------------------------------------------*/
+/* Load library file "inname" into library "mode" from its cache, if	*/
+/* the cache is current, going through the same steps as objectread()	*/
+/* but without parsing any text.  Objects of user libraries that do not	*/
+/* share a name with another object are left unread, to be read by	*/
+/* libcache_materialize() when first needed.  Returns false, having	*/
+/* done nothing, if the file must be read instead.  On success, "nsptr"	*/
+/* is set to the technology of the file, if it declares one.		*/
+/*----------------------------------------------------------------------*/
+
+bool libcache_replay(short mode, const QString &inname, TechPtr *nsptr)
+{
+   QByteArray body, technology, name, buffer;
+   objinstptr saveinst;
+   objlistptr redef;
+   objectptr *newobject;
+   LazyBody *lazy;
+   BBox bbox;
+   float fileversion;
+   qint32 ccolor;
+   quint8 rec, hasschem;
+   Prefetch *pre;
+
+   pre = takeprefetch(QFileInfo(inname).absoluteFilePath(), mode);
+   if (pre != NULL) {
+      bool cached = pre->cached;
+
+      body = pre->body;
+      technology = pre->technology;
+      fileversion = pre->fileversion;
+      delete pre;
+      if (!cached) return false;
+   }
+   else if (!readcache(mode, inname, &body, &fileversion, &technology))
+      return false;
+
+   QDataStream in(body);
+   setformat(in);
+   LibReader reader(in, mode);
+
+   if (!technology.isNull())
+      *nsptr = AddNewTechnology(technology.data(), inname.toLocal8Bit().data());
+   version = fileversion;
+
+   saveinst = areawin->topinstance;
+   areawin->topinstance = xobjs.libtop[mode];
+
+   load_in_progress = true;
+   for (;;) {
+      in >> rec;
+      if ((rec == REC_END) || (in.status() != QDataStream::Ok)) break;
+
+      if (rec == REC_OBJECT) {
+	 in >> name;
+	 newobject = new_library_object(mode, name.data(), &redef, *nsptr);
+
+	 /* An object that must be compared with another is read now */
+	 if ((redef == NULL) && (mode != FONTLIB)) {
+	    if ((lazy = reader.readlazy(*newobject)) == NULL) break;
+	    if (!add_lazy_object(in, mode, *newobject, lazy)) {
+	       QDataStream blockin(lazy->elements);
+	       setformat(blockin);
+	       LibReader(blockin, mode, &lazy->deps).readelements(*newobject);
+	       delete lazy;
+	       add_object_to_library(mode, *newobject);
+	    }
+	 }
+	 else {
+	    if (!reader.readobject(*newobject)) break;
+	    if (library_object_unique(mode, *newobject, redef))
+	       add_object_to_library(mode, *newobject);
+	 }
+      }
+      else if (rec == REC_BBOX) {
+	 /* (bounding boxes of an object that was read) */
+	 readbbox(in, bbox);
+	 readbbox(in, bbox);
+	 in >> hasschem;
+	 if (hasschem) readbbox(in, bbox);
+      }
+      else if (rec == REC_LIBINST) {
+	 in >> name >> buffer;
+	 new_library_instance(mode - LIBRARY, name.data(), buffer.data(), *nsptr);
+      }
+      else if (rec == REC_COLOR) {
+	 in >> ccolor;
+	 addnewcolorentry(ccolor);
+      }
+      else break;
+   }
+   load_in_progress = false;
+   if (in.status() != QDataStream::Ok)
+      Fprintf(stderr, "Library cache for %s is damaged\n",
+		inname.toLocal8Bit().data());
+   cleanupaliases(mode);
+
+   areawin->topinstance = saveinst;
+   return true;
+}
+
+/*----------------------------------------------------------------------*/
+/* Objects left unread by libcache_replay().  Once read, an object's	*/
+/* elements are kept, unless a limit has been set ("set cellcache n")	*/
+/* on the number of such objects read.  Then the elements of those	*/
+/* least recently used, which are not called from anywhere but their	*/
+/* library page, are dropped again by libcache_trim() so as to keep	*/
+/* within the limit.							*/
+/*----------------------------------------------------------------------*/
+
+static QSet<objectptr> residents;	/* read, and may be dropped */
+static quint64 lazyclock = 0;
+static int lazylimit = 0;		/* 0 = no limit */
+
+/*----------------------------------------------------------------------*/
+/* Read the elements of "thisobj" if they have not been read yet.	*/
+/* Called wherever the elements of an object are about to be used.	*/
+/*----------------------------------------------------------------------*/
+
+void libcache_materialize(objectptr thisobj)
+{
+   LazyBody *lazy;
+
+   if ((thisobj == NULL) || ((lazy = thisobj->lazy) == NULL)) return;
+   lazy->lastuse = ++lazyclock;
+   if (lazy->resident) return;
+   lazy->resident = true;
+
+   QDataStream in(lazy->elements);
+   setformat(in);
+   if (!LibReader(in, lazy->mode, &lazy->deps).readelements(thisobj))
+      Fprintf(stderr, "Library cache for %s is damaged\n", thisobj->name);
+   spatial_invalidate(thisobj);
+   glyph_invalidate(thisobj);
+
+   if (lazylimit > 0)
+      residents.insert(thisobj);
+   else {
+      thisobj->lazy = NULL;
+      delete lazy;
+   }
+}
+
+/*----------------------------------------------------------------------*/
+/* Forget the unread elements of an object being cleared or destroyed	*/
+/*----------------------------------------------------------------------*/
+
+void libcache_release(objectptr thisobj)
+{
+   if (thisobj->lazy == NULL) return;
+   residents.remove(thisobj);
+   delete thisobj->lazy;
+   thisobj->lazy = NULL;
+}
+
+/*----------------------------------------------------------------------*/
+/* Return true if unread object "thisobj" has an instance of "target"	*/
+/*----------------------------------------------------------------------*/
+
+bool libcache_uses(objectptr thisobj, objectptr target)
+{
+   return (thisobj->lazy != NULL) && !thisobj->lazy->resident &&
+		thisobj->lazy->deps.contains(target);
+}
+
+void libcache_setlimit(int limit)
+{
+   lazylimit = (limit < 0) ? 0 : limit;
+   libcache_trim();
+}
+
+static void addcallees(objectptr thisobj, QSet<objectptr> &used)
+{
+   if (thisobj == NULL) return;
+   for (objinstiter inst; thisobj->values(inst); )
+      used.insert(inst->thisobject);
+}
+
+static bool lesslastuse(objectptr a, objectptr b)
+{
+   return a->lazy->lastuse < b->lazy->lastuse;
+}
+
+/*----------------------------------------------------------------------*/
+/* Drop the elements of objects over the limit.  Only done between	*/
+/* redraws, as objects being drawn are not otherwise marked.		*/
+/*----------------------------------------------------------------------*/
+
+void libcache_trim()
+{
+   QSet<objectptr> used;
+   QList<objectptr> unused;
+   pushlistptr stack;
+   Undoptr urec;
+   int i, j;
+
+   if ((lazylimit == 0) || (residents.size() <= lazylimit)) return;
+
+   /* Objects called from pages or from other library objects */
+   for (i = 0; i < xobjs.pages; i++)
+      if (xobjs.pagelist[i].pageinst != NULL)
+	 addcallees(xobjs.pagelist[i].pageinst->thisobject, used);
+   for (i = 0; i < xobjs.numlibs; i++)
+      for (j = 0; j < xobjs.userlibs[i].number; j++)
+	 addcallees(*(xobjs.userlibs[i].library + j), used);
+   addcallees(areawin->editstack, used);
+
+   /* Objects being edited, or with edits on the undo stacks */
+   used.insert(topobject);
+   for (stack = areawin->stack; stack != NULL; stack = stack->next)
+      used.insert(stack->thisinst->thisobject);
+   for (urec = xobjs.undostack; urec != NULL; urec = urec->next)
+      if (urec->thisinst != NULL) used.insert(urec->thisinst->thisobject);
+   for (urec = xobjs.redostack; urec != NULL; urec = urec->last)
+      if (urec->thisinst != NULL) used.insert(urec->thisinst->thisobject);
+
+   foreach (objectptr thisobj, residents)
+      if (!used.contains(thisobj) && (thisobj->changes == 0) &&
+		(thisobj->labels == NULL) && (thisobj->polygons == NULL))
+	 unused.append(thisobj);
+   std::sort(unused.begin(), unused.end(), lesslastuse);
+
+   for (i = 0; (i < unused.size()) && (residents.size() > lazylimit); i++) {
+      objectptr thisobj = unused[i];
+
+      for (genericptr *pgen = thisobj->begin(); pgen != thisobj->end(); pgen++)
+	 delete *pgen;
+      thisobj->Plist::clear();
+      thisobj->subst.inst = NULL;
+      thisobj->subst.generation = -1;
+      spatial_invalidate(thisobj);
+      glyph_invalidate(thisobj);
+      thisobj->lazy->resident = false;
+      residents.remove(thisobj);
+   }
+}
+
+/*----------------------------------------------------------------------*/
+/* Fill the cache for the files in directory "dirname":  the fonts of	*/
+/* every encoding (".xfe") file in it or in its "fonts" subdirectory,	*/
+/* and, unless it is itself a font directory, every library (".lps")	*/
+/* file, each loaded into a library of its own.  Files whose cache is	*/
+/* current are left alone.						*/
+/*----------------------------------------------------------------------*/
+
+void libcache_prewarm(const QString &dirname)
+{
+   QDir dir(dirname), fontdir(dirname + "/fonts");
+   QStringList files, savepath = xobjs.libsearchpath;
+   int libnum;
+
+   if (!dir.exists()) {
+      Fprintf(stderr, "No directory %s\n", dirname.toLocal8Bit().data());
+      return;
+   }
+
+   /* Fonts and their character libraries are found by search path */
+   xobjs.libsearchpath.prepend(dir.absolutePath());
+
+   files = dir.entryList(QStringList("*.xfe"), QDir::Files, QDir::Name);
+   if (fontdir.exists())
+      files += fontdir.entryList(QStringList("*.xfe"), QDir::Files, QDir::Name);
+   foreach (QString file, files)
+      loadfontfile(QFileInfo(file).completeBaseName().toLocal8Bit().data());
+
+   if (dir.entryList(QStringList("*.xfe"), QDir::Files).isEmpty()) {
+      files = dir.entryList(QStringList("*.lps"), QDir::Files, QDir::Name);
+      foreach (QString file, files) {
+	 libnum = createlibrary(false);
+	 loadlibrary(libnum, dir.absoluteFilePath(file));
+      }
+   }
+   xobjs.libsearchpath = savepath;
+}
@@ -0,0 +1,120 @@
+#ifndef LIBCACHE_H
+#define LIBCACHE_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+#include "xcircuit.h"
+
+/*----------------------------------------------------------------------*/
+/* Binary form of library objects, as they stand right after being	*/
+/* read from a file (before being compared with any object of the same	*/
+/* name).  Instances refer to their object by the name written in the	*/
+/* file, looked up again when read back so that aliases and name	*/
+/* conflicts come out as they would from the text.  Fonts in labels	*/
+/* are kept by name and colors by value, since the font and color	*/
+/* tables are different in every session.				*/
+/*									*/
+/* The elements of an object are written as a block of their own,	*/
+/* after the names of the objects its instances call, so that the	*/
+/* block can be kept and read when the object is first needed.		*/
+/*									*/
+/* The same records make up the binary document format (xcbfile.cpp),	*/
+/* which adds a table of names (object names, parameter keys and font	*/
+/* names are then written as an index into it) and a table of images.	*/
+/* Without an image table, graphics cannot be written.			*/
+/*----------------------------------------------------------------------*/
+
+class StringTable {
+public:
+    qint32 index(const QByteArray &);
+
+    QList<QByteArray> strings;
+
+private:
+    QHash<QByteArray, qint32> indexes;
+};
+
+class LibWriter {
+public:
+    explicit LibWriter(QDataStream &out) : strings(NULL), images(NULL),
+        out(out), valid(true) {}
+
+    void writeobject(objectptr);
+    bool ok() const { return valid; }
+
+    /* Names of instances as written in the file; instances not	*/
+    /* listed are written with the full name of their object.		*/
+    QHash<objinstptr, QByteArray> instnames;
+
+    StringTable *strings;			/* table of names, or NULL */
+    const QHash<const XImage *, qint32> *images; /* index of each image */
+
+private:
+    void writeelements(objectptr);
+    void writeelement(genericptr);
+    void writename(const QByteArray &);
+    void writeparams(oparamptr);
+    void writeeparams(eparamptr);
+    void writestring(stringpart *);
+    void writepoint(const XPoint &);
+
+    QDataStream &out;
+    bool valid;
+    QList<QByteArray> deps;	/* names called by instances, in order */
+};
+
+/*----------------------------------------------------------------------*/
+/* The unread elements of a library object.  The objects called by its	*/
+/* instances are looked up when the object itself is read from the	*/
+/* cache, while the aliases of the file are still known.		*/
+/*----------------------------------------------------------------------*/
+
+class LazyBody {
+public:
+    LazyBody(short mode) : mode(mode), resident(false), lastuse(0) {}
+
+    short mode;
+    QByteArray elements;	/* LibWriter element block */
+    QVector<objectptr> deps;	/* objects called by its instances */
+    bool resident;		/* elements have been read (and may be */
+				/* dropped again) */
+    quint64 lastuse;
+};
+
+class LibReader {
+public:
+    LibReader(QDataStream &in, short mode, const QVector<objectptr> *deps = NULL) :
+        strings(NULL), images(NULL), narrowarcs(false), in(in), mode(mode), deps(deps), nextdep(0) {}
+
+    bool readobject(objectptr);
+    LazyBody *readlazy(objectptr);
+    bool readelements(Plist *);
+
+    const QList<QByteArray> *strings;	/* table of names, or NULL */
+    const QVector<int> *images;		/* entry in xobjs.imagelist of */
+					/* each image */
+    bool narrowarcs;			/* arc radii are 16 bits, as in */
+					/* format 1 documents */
+
+private:
+    bool readheader(objectptr);
+    bool readelement(Plist *);
+    QByteArray readname();
+    char *readcname();
+    oparamptr readparams();
+    eparamptr readeparams();
+    stringpart *readstring();
+    qint32 readcount(int);
+    void readpoint(XPoint &);
+
+    QDataStream &in;
+    short mode;
+    const QVector<objectptr> *deps;
+    int nextdep;
+};
+
+#endif // LIBCACHE_H
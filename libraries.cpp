@@ -343,6 +343,9 @@ int libmoveobject(objectptr thisobject, int libtarget)
 		*(xobjs.userlibs[libsource].library + j + 1);
       xobjs.userlibs[libsource].number--;
 
+   /* the object's place in the name index follows its library */
+   names_invalidate();
+
    /* Move all instances from library "libsource" to library "libtarget" */
 
    slast = NULL;
@@ -708,9 +711,10 @@ void composelib(short mode)
    int xpos = 0, ypos = areawin->height() << 1;
    int nypos = 220, nxpos;
    short fval;
-   short llx, lly, width, height;
+   int llx, lly, width, height;
 
-   int totalarea, targetwidth;
+   int targetwidth;
+   double totalarea;
    double scale, savescale;
    XPoint savepos;
 
@@ -744,8 +748,8 @@ void composelib(short mode)
 
    /* experimental:  attempt to produce a library with the same aspect  */
    /* ratio as the drawing window.                                      */
-   const short minWidth = 200; // minimum box width
-   const short minHeight = 220; // minimum box height
+   const int minWidth = 200; // minimum box width
+   const int minHeight = 220; // minimum box height
 
    totalarea = 0;
    for (spec = xobjs.userlibs[mode - LIBRARY].instlist; spec != NULL;
@@ -767,7 +771,7 @@ void composelib(short mode)
       height += 30;	/* height padding */
       width = qMax(width, minWidth);
       height = qMax(height, minHeight);
-      totalarea += (width * height);
+      totalarea += (double)width * height;
    }
 
    const double screenWidth = qApp->desktop()->width();
@@ -870,6 +874,7 @@ short finddepend(objinstptr libobj, objectptr **compobjp)
 	 compobj = xobjs.userlibs[i].library + j;
          *compobjp = compobj;
 		     
+	 if (libcache_uses(*compobj, libobj->thisobject)) return 2;
          for (objinstiter testobj; (*compobj)->values(testobj); ) {
                if (testobj->thisobject == libobj->thisobject) return 2;
 	 }
@@ -899,7 +904,8 @@ short finddepend(objinstptr libobj, objectptr **compobjp)
 
 void catvirtualcopy()
 {
-   short i, *newselect;
+   short i;
+   int *newselect;
    objinstptr libobj, libinst;
 
    if (areawin->selects == 0) return;
@@ -928,7 +934,7 @@ void catvirtualcopy()
 void cathide()
 {
    int i;
-   short *newselect;
+   int *newselect;
    objectptr *compobj;
    objinstptr libobj;
 
@@ -962,7 +968,8 @@ void cathide()
 
 void catdelete()
 {
-   short *newselect, *libpobjs;
+   int *newselect;
+   short *libpobjs;
    int i;
    objinstptr libobj;
    liblistptr ilist, llist;
@@ -1018,6 +1025,7 @@ void catdelete()
 
 	 for (tlib = libpage; tlib < libpage + *libpobjs; tlib++)
 	    if ((*tlib) == libobj->thisobject) {
+	       names_removeobject(LIBRARY + i, libobj->thisobject);
 	       for (slib = tlib; slib < libpage + *libpobjs - 1; slib++)
 		  (*slib) = (*(slib + 1));
 	       (*libpobjs)--;
@@ -1285,7 +1293,7 @@ void catmove(int x, int y)
 /// \todo most of this should go into the object operator=
 void copycat()
 {
-   short *newselect;
+   int *newselect;
    objectptr *newobj, *curlib, oldobj;
    objinstptr libobj;
    oparamptr ops, newops;
@@ -1313,6 +1321,7 @@ void copycat()
 
       sprintf((*newobj)->name, "_%s", oldobj->name);
       checkname(*newobj);
+      names_addobject(LIBRARY + libnum, *newobj);
 
       /* copy other object properties */
 
@@ -1382,7 +1391,7 @@ void copycat()
 
 void catalog_op(int op, int x, int y)
 {
-   short *newselect;
+   int *newselect;
    objinstptr *newobject;
    objectptr libpage = topobject;
    short ocentx, ocenty, rangex, rangey, xdiff, ydiff, flag = 0;
@@ -1472,7 +1481,7 @@ void catalog_op(int op, int x, int y)
 		     (*newobject)->position.y += ydiff;
 
                      u2u_snap((*newobject)->position);
-                     *newselect = (short)(newobject - (objinstptr *)topobject->begin());
+                     *newselect = (int)(newobject - (objinstptr *)topobject->begin());
                      if ((*newobject)->thisobject == libobj->thisobject)
 		        flag = 1;
 	          }
@@ -1487,7 +1496,7 @@ void catalog_op(int op, int x, int y)
 	             /* add this object to the list of selected items */
 
 	             newselect = allocselect();
-                     *newselect = (short)(newobject - (objinstptr *)topobject->begin());
+                     *newselect = (int)(newobject - (objinstptr *)topobject->begin());
 
 	          }
 	          if (op == XCF_Library_Copy) {
@@ -1521,7 +1530,7 @@ void catalog_op(int op, int x, int y)
 	       /* the entire area in the directory surrounding the object. */
 
 	       else if (op == XCF_Select) {
-                  short newinst = (short)(libobj - topobject->begin());
+                  int newinst = (int)(libobj - topobject->begin());
 		  /* (ignore this object if it is already in the list of selects) */
 		  for (newselect = areawin->selectlist; newselect <
 			areawin->selectlist + areawin->selects; newselect++)
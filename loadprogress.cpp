@@ -0,0 +1,334 @@
+/*----------------------------------------------------------------------*/
+/* loadprogress.cpp --- progress, cancellation and undoing of file	*/
+/*			loads						*/
+/*----------------------------------------------------------------------*/
+
+#include <QApplication>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QProgressDialog>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "xcircuit.h"
+#include "prototypes.h"
+#include "loadprogress.h"
+
+extern QWidget *top;
+
+LoadProgress *LoadProgress::current = NULL;
+
+static bool lastcancelled = false;	/* the last load was cancelled */
+
+/*----------------------------------------------------------------------*/
+/* Start a load of "size" bytes.  "mode" is the mode of loadfile().	*/
+/*----------------------------------------------------------------------*/
+
+LoadProgress::LoadProgress(short mode, const QString &name, qint64 size, FILE *ps) :
+   ps(ps), outer(current), mode(mode), firstpage(areawin->page),
+   stopped(false), failed(false), shown(false), dialog(NULL), held(NULL),
+   heldparts(0), images(xobjs.images)
+{
+   int i, j;
+
+   /* A load within a load is undone with it */
+   if (outer != NULL) return;
+
+   current = this;
+   lastcancelled = false;
+   allocstats_mark();
+
+   for (i = 0; i < xobjs.pagelist.count(); i++) {
+      defined.append(xobjs.pagelist[i].pageinst != NULL);
+      if (xobjs.pagelist[i].pageinst != NULL)
+	 note(xobjs.pagelist[i].pageinst->thisobject);
+   }
+   for (i = 0; i < xobjs.numlibs; i++) {
+      libsizes.append(xobjs.userlibs[i].number);
+      for (j = 0; j < xobjs.userlibs[i].number; j++)
+	 note(*(xobjs.userlibs[i].library + j));
+   }
+   if ((mode == 1) && (xobjs.pagelist[firstpage].pageinst != NULL))
+      heldparts = xobjs.pagelist[firstpage].pageinst->thisobject->parts;
+
+   /* The dialog shows itself if the load takes more than a moment */
+   if (size > 0) {
+      dialog = new QProgressDialog(QString("Loading %1").arg(
+		QFileInfo(name).fileName()), "Cancel", 0, (int)(size >> 10) + 1, top);
+      dialog->setWindowModality(Qt::WindowModal);
+      dialog->setMinimumDuration(500);
+      dialog->setValue(0);
+   }
+   timer.start();
+}
+
+LoadProgress::~LoadProgress()
+{
+   delete dialog;
+   if (outer != NULL) return;
+
+   current = NULL;
+   if (stopped || failed)
+      rollback();
+   else
+      commit();
+   lastcancelled = stopped;
+   allocstats_report(stopped ? "load (cancelled)" :
+		failed ? "load (failed)" : "load");
+}
+
+/*----------------------------------------------------------------------*/
+/* The file is damaged:  undo the load when it ends.  The load this	*/
+/* one is part of cannot keep half of it, and is undone as well.	*/
+/*----------------------------------------------------------------------*/
+
+void LoadProgress::fail()
+{
+   failed = true;
+   if (outer != NULL) outer->fail();
+}
+
+void LoadProgress::note(objectptr thisobj)
+{
+   Links *lptr = &links[thisobj];
+
+   lptr->symschem = thisobj->symschem;
+   lptr->schemtype = thisobj->schemtype;
+   lptr->name = thisobj->name;
+}
+
+/*----------------------------------------------------------------------*/
+/* Let the window redraw.  Until the (window modal) dialog is shown,	*/
+/* nothing else stops the user from editing, closing or loading into	*/
+/* the session half read, so input is left queued until then.		*/
+/*----------------------------------------------------------------------*/
+
+void LoadProgress::events()
+{
+   if ((dialog != NULL) && dialog->isVisible())
+      qApp->processEvents();
+   else
+      qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
+}
+
+/*----------------------------------------------------------------------*/
+/* Report that the load has reached byte "pos" of the file (or -1 if	*/
+/* not known), letting the window redraw and the user cancel now and	*/
+/* then.  Returns true if the load has been cancelled.			*/
+/*----------------------------------------------------------------------*/
+
+bool LoadProgress::step(qint64 pos)
+{
+   if (outer != NULL) return (stopped = outer->step(-1));
+   if (stopped) return true;
+   if (timer.elapsed() < 100) return false;
+
+   timer.restart();
+   if ((pos >= 0) && (dialog != NULL)) dialog->setValue((int)(pos >> 10));
+   events();
+   if ((dialog != NULL) && dialog->wasCanceled()) stopped = true;
+   return stopped;
+}
+
+/*----------------------------------------------------------------------*/
+/* A page has been read and its bounding box computed.  The first page	*/
+/* is shown at once, while the rest of the file is read.		*/
+/*----------------------------------------------------------------------*/
+
+bool LoadProgress::pagedone()
+{
+   if ((outer == NULL) && !shown && (mode != 2)) {
+      shown = true;
+      areawin->update();
+      events();
+      timer.restart();
+      if ((dialog != NULL) && dialog->wasCanceled()) stopped = true;
+      return stopped;
+   }
+   return step(-1);
+}
+
+/*----------------------------------------------------------------------*/
+/* The first page is about to be cleared for the load.  Its contents	*/
+/* are kept aside, and the page is read into a new object.		*/
+/*----------------------------------------------------------------------*/
+
+void LoadProgress::holdpage()
+{
+   objinstptr pageinst = xobjs.pagelist[areawin->page].pageinst;
+   objectptr pageobj;
+
+   if ((outer != NULL) || (mode != 0) || (held != NULL)) return;
+   if ((areawin->page != firstpage) || (pageinst == NULL)) return;
+
+   held = pageinst->thisobject;
+   heldpage = xobjs.pagelist[firstpage];
+   pageobj = new object;
+   strcpy(pageobj->name, held->name);
+   pageinst->thisobject = pageobj;
+}
+
+/*----------------------------------------------------------------------*/
+/* The load is complete:  what was on the first page is discarded, and	*/
+/* anything linked to it is linked to the page read in its place.	*/
+/*----------------------------------------------------------------------*/
+
+void LoadProgress::commit()
+{
+   objectptr pageobj;
+   int i, j;
+
+   if (held == NULL) return;
+   pageobj = xobjs.pagelist[firstpage].pageinst->thisobject;
+
+   for (i = 0; i < xobjs.pagelist.count(); i++)
+      if ((xobjs.pagelist[i].pageinst != NULL) &&
+		(xobjs.pagelist[i].pageinst->thisobject->symschem == held))
+	 xobjs.pagelist[i].pageinst->thisobject->symschem = pageobj;
+   for (i = 0; i < xobjs.numlibs; i++)
+      for (j = 0; j < xobjs.userlibs[i].number; j++)
+	 if ((*(xobjs.userlibs[i].library + j))->symschem == held)
+	    (*(xobjs.userlibs[i].library + j))->symschem = pageobj;
+
+   delete held;
+   held = NULL;
+}
+
+/*----------------------------------------------------------------------*/
+/* Remove library object "thisobj", the last in library "libnum"	*/
+/*----------------------------------------------------------------------*/
+
+static void removelast(int libnum, objectptr thisobj)
+{
+   Library *lib = &xobjs.userlibs[libnum];
+   liblistptr ilist, llist = NULL, next;
+
+   for (ilist = lib->instlist; ilist != NULL; ilist = next) {
+      next = ilist->next;
+      if (ilist->thisinst->thisobject == thisobj) {
+	 if (llist == NULL)
+	    lib->instlist = next;
+	 else
+	    llist->next = next;
+	 delete ilist->thisinst;
+	 delete ilist;
+      }
+      else llist = ilist;
+   }
+   lib->number--;
+   names_removeobject(LIBRARY + libnum, thisobj);
+   delete thisobj;
+}
+
+/*----------------------------------------------------------------------*/
+/* The load was cancelled, or its file was damaged:  put the pages,	*/
+/* libraries and images back as they were.  Technologies, fonts, colors	*/
+/* and libraries created by the load are kept, and the undo history is	*/
+/* lost.								*/
+/*----------------------------------------------------------------------*/
+
+void LoadProgress::rollback()
+{
+   QHash<objectptr, Links>::const_iterator it;
+   objectptr thisobj;
+   Library *lib;
+   int i;
+
+   flush_undo_stack();
+   clearselects();
+
+   /* Pages read are removed;  the page read over is put back */
+
+   for (i = 0; i < xobjs.pagelist.count(); i++) {
+      Pagedata *curpage = &xobjs.pagelist[i];
+      objinstptr pageinst = curpage->pageinst;
+
+      if (pageinst == NULL) continue;
+      if ((i == firstpage) && (held != NULL)) {
+	 delete pageinst->thisobject;
+	 *curpage = heldpage;
+	 curpage->pageinst = pageinst;
+	 pageinst->thisobject = held;
+	 held = NULL;
+      }
+      else if ((i == firstpage) && (mode == 1)) {
+	 thisobj = pageinst->thisobject;
+	 while (thisobj->parts > heldparts)
+	    delete thisobj->take_last();
+	 spatial_invalidate(thisobj);
+	 calcbbox(pageinst);
+      }
+      else if ((i >= defined.size()) || !defined[i]) {
+	 delete pageinst->thisobject;
+	 delete pageinst;
+	 curpage->pageinst = NULL;
+	 curpage->filename.clear();
+	 curpage->background.name.clear();
+      }
+   }
+
+   /* Library objects read are removed, last first */
+
+   for (i = 0; i < xobjs.numlibs; i++) {
+      lib = &xobjs.userlibs[i];
+      while (lib->number > ((i < libsizes.size()) ? libsizes[i] : 0))
+	 removelast(i, *(lib->library + lib->number - 1));
+   }
+
+   /* Names and schematic links of existing objects are put back */
+
+   for (it = links.constBegin(); it != links.constEnd(); ++it) {
+      thisobj = it.key();
+      thisobj->symschem = it->symschem;
+      thisobj->schemtype = it->schemtype;
+      strcpy(thisobj->name, it->name.constData());
+   }
+   names_invalidate();
+   names_clearaliases();
+
+   while (xobjs.images > images) {
+      Imagedata *img = xobjs.imagelist + (--xobjs.images);
+      delete img->image;
+      free(img->filename);
+   }
+
+   areawin->topinstance = xobjs.pagelist[firstpage].pageinst;
+   changepage(firstpage);
+   flush_undo_stack();
+
+   for (i = 0; i < xobjs.numlibs; i++)
+      composelib(LIBRARY + i);
+   composelib(PAGELIB);
+   pool_trim();
+   areawin->update();
+}
+
+/*----------------------------------------------------------------------*/
+/* Progress of the load under way, if any, for the text file reader.	*/
+/* Returns true if the load has been cancelled.				*/
+/*----------------------------------------------------------------------*/
+
+bool loadprogress_step(FILE *ps)
+{
+   LoadProgress *progress = LoadProgress::current;
+
+   if (progress == NULL) return false;
+   return progress->step((ps == progress->ps) ? (qint64)ftell(ps) : -1);
+}
+
+bool loadprogress_running()
+{
+   return (LoadProgress::current != NULL);
+}
+
+/*----------------------------------------------------------------------*/
+/* True if the load under way, or else the last one, was cancelled	*/
+/*----------------------------------------------------------------------*/
+
+bool loadprogress_cancelled()
+{
+   if (LoadProgress::current != NULL)
+      return LoadProgress::current->cancelled();
+   return lastcancelled;
+}
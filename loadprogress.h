@@ -0,0 +1,67 @@
+#ifndef LOADPROGRESS_H
+#define LOADPROGRESS_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <cstdio>
+
+#include "xcircuit.h"
+
+class QProgressDialog;
+
+/*----------------------------------------------------------------------*/
+/* Progress of a file load, shown (after a moment) in a dialog whose	*/
+/* "Cancel" button stops the load.  The state of the session is noted	*/
+/* when the load starts, and a cancelled load is undone by the		*/
+/* destructor:  pages and library objects read are removed, and pages	*/
+/* and objects that were changed are restored.  A load which finds its	*/
+/* file damaged is undone in the same way.				*/
+/*----------------------------------------------------------------------*/
+
+class LoadProgress {
+public:
+    LoadProgress(short mode, const QString &name, qint64 size, FILE *ps = NULL);
+    ~LoadProgress();
+
+    bool step(qint64 pos);
+    bool pagedone();
+    void holdpage();
+    bool cancelled() const { return stopped; }
+    void fail();
+
+    static LoadProgress *current;
+    FILE *const ps;		/* file read, if a text file */
+
+private:
+    struct Links {
+        objectptr symschem;
+        u_char schemtype;
+        QByteArray name;
+    };
+
+    void note(objectptr);
+    void events();
+    void rollback();
+    void commit();
+
+    LoadProgress *outer;	/* load this one is part of, if any */
+    short mode;
+    short firstpage;
+    bool stopped, failed, shown;
+    QProgressDialog *dialog;
+    QElapsedTimer timer;
+
+    objectptr held;		/* former contents of the first page */
+    Pagedata heldpage;
+    int heldparts;		/* size of the page imported onto */
+    QVector<bool> defined;	/* pages which existed */
+    QVector<short> libsizes;
+    short images;
+    QHash<objectptr, Links> links;	/* of existing pages and objects */
+};
+
+#endif // LOADPROGRESS_H
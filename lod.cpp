@@ -0,0 +1,623 @@
+/*----------------------------------------------------------------------*/
+/* lod.cpp --- level of detail and cached images of instances		*/
+/*----------------------------------------------------------------------*/
+
+#include <QCache>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QImage>
+#include <QPainter>
+#include <QVector>
+
+#include <cmath>
+#include <cstdio>
+
+#include "xcircuit.h"
+#include "prototypes.h"
+#include "colors.h"
+#include "context.h"
+#include "matrix.h"
+#include "xcqt.h"
+
+/*----------------------------------------------------------------------*/
+/* When zoomed out, an instance whose bounding box is only a few pixels	*/
+/* across is drawn in less detail, depending on its size on screen	*/
+/* (the larger side of the bounding box, in pixels):			*/
+/*									*/
+/*    below areawin->lodhide	not drawn at all			*/
+/*    below areawin->lodbox	drawn as a filled bounding box		*/
+/*    below areawin->lodthumb	drawn from a thumbnail image of the	*/
+/*				object, made on first use		*/
+/*									*/
+/* Labels less than areawin->lodtext pixels high are not drawn.  A	*/
+/* threshold of zero turns the rule off.  All are set with "set lod"	*/
+/* in the startup script.						*/
+/*									*/
+/* Thumbnails and sprites are made and found under the draw lock, as	*/
+/* any drawing thread may be using or throwing them out.  The image	*/
+/* found is copied out (cheaply, as it is shared) and drawn after the	*/
+/* lock is let go, so that threads are not held up by each other's	*/
+/* copying to the screen.						*/
+/*----------------------------------------------------------------------*/
+
+#define LOD_THUMBSIZE	64	/* pixels along the larger side */
+#define LOD_MAXTHUMBS	1024	/* thumbnails kept, of all objects */
+
+typedef struct {
+   int		color;		/* color the thumbnail was drawn in */
+   bool		pinpoints;	/* drawn with pin positions shown */
+   int		generation;	/* lod_generation when drawn */
+   BBox		bbox;		/* bounding box of the object drawn */
+   float	scale;		/* image pixels per user unit */
+   QImage	image;
+} Thumbnail;
+
+static QHash<objectptr, QVector<Thumbnail> > thumbnails;
+static int thumbcount = 0;
+static int lod_generation = 0;
+static thread_local bool drawingimage = false;	/* a thumbnail or sprite */
+						/* is being drawn */
+
+/*----------------------------------------------------------------------*/
+/* Draw "theinstance" (whose object is "theobject") from object	*/
+/* coordinates into a new thumbnail.					*/
+/*----------------------------------------------------------------------*/
+
+static void makethumbnail(Thumbnail *thumb, objinstptr theinstance, int passcolor)
+{
+   objectptr theobject = theinstance->thisobject;
+   BBox *bbox = &theobject->bbox;
+   int w, h;
+   Matrix inst;
+
+   thumb->color = passcolor;
+   thumb->pinpoints = areawin->pinpointon;
+   thumb->generation = lod_generation;
+   thumb->bbox = *bbox;
+   thumb->scale = (float)LOD_THUMBSIZE / qMax(bbox->width, bbox->height);
+   w = (int)(bbox->width * thumb->scale) + 3;
+   h = (int)(bbox->height * thumb->scale) + 3;
+   thumb->image = QImage(w, h, QImage::Format_ARGB32_Premultiplied);
+   thumb->image.fill(Qt::transparent);
+
+   QPainter p(&thumb->image);
+   p.setRenderHint(QPainter::Antialiasing);
+   DrawContext tctx(&p);
+   tctx.setClipRect(QRect(0, 0, w, h));
+
+   /* The object's lower left corner goes to pixel (1, h - 2), and the	*/
+   /* instance's own transformation, which UDrawObject() applies, is	*/
+   /* taken back out.							*/
+
+   tctx.CTM().set(thumb->scale, 0, 1 - bbox->lowerleft.x * thumb->scale,
+		0, -thumb->scale, h - 2 + bbox->lowerleft.y * thumb->scale);
+   inst.preMult(theinstance->position, theinstance->scale, theinstance->rotation);
+   inst.invert();
+   tctx.CTM().preMult(inst);
+
+   XTopSetForeground(tctx.gc(), passcolor);
+   drawingimage = true;
+   UDrawObject(&tctx, theinstance, 1, passcolor, NULL);
+   drawingimage = false;
+}
+
+/*----------------------------------------------------------------------*/
+/* Return the thumbnail of the object of "theinstance" in color		*/
+/* "passcolor", drawing it if there is none or it is out of date.	*/
+/*----------------------------------------------------------------------*/
+
+static const Thumbnail *thumbnail(objinstptr theinstance, int passcolor)
+{
+   objectptr theobject = theinstance->thisobject;
+   QVector<Thumbnail> *list;
+   Thumbnail *thumb = NULL;
+   int i;
+
+   if (thumbcount >= LOD_MAXTHUMBS) {
+      thumbnails.clear();
+      thumbcount = 0;
+   }
+   list = &thumbnails[theobject];
+
+   for (i = 0; i < list->size(); i++) {
+      thumb = list->data() + i;
+      if (thumb->color == passcolor) break;
+   }
+   if (i == list->size()) {
+      list->resize(i + 1);
+      thumbcount++;
+      thumb = list->data() + i;
+   }
+   else if ((thumb->generation == lod_generation) &&
+		(thumb->pinpoints == areawin->pinpointon) &&
+		(thumb->bbox.lowerleft.x == theobject->bbox.lowerleft.x) &&
+		(thumb->bbox.lowerleft.y == theobject->bbox.lowerleft.y) &&
+		(thumb->bbox.width == theobject->bbox.width) &&
+		(thumb->bbox.height == theobject->bbox.height))
+      return thumb;
+
+   makethumbnail(thumb, theinstance, passcolor);
+   return thumb;
+}
+
+/*----------------------------------------------------------------------*/
+/* Draw the object of "theinstance" as a filled bounding box		*/
+/*----------------------------------------------------------------------*/
+
+static void drawbox(DrawContext *ctx, objectptr theobject)
+{
+   XPoint corners[4], wcorners[4];
+   BBox *bbox = &theobject->bbox;
+
+   corners[0] = bbox->lowerleft;
+   corners[1] = XPoint(bbox->lowerleft.x + bbox->width, bbox->lowerleft.y);
+   corners[2] = XPoint(bbox->lowerleft.x + bbox->width,
+		bbox->lowerleft.y + bbox->height);
+   corners[3] = XPoint(bbox->lowerleft.x, bbox->lowerleft.y + bbox->height);
+   ctx->CTM().transform(corners, wcorners, 4);
+   strokepath(ctx, wcorners, 4, FILLED | FILLSOLID | NOBORDER, 1.0);
+}
+
+/*----------------------------------------------------------------------*/
+/* Draw the thumbnail "thumb" where the instance is, with the CTM of	*/
+/* the instance on top of the stack.					*/
+/*----------------------------------------------------------------------*/
+
+static void drawthumbnail(DrawContext *ctx, const Thumbnail *thumb)
+{
+   QPainter *p = ctx->gc();
+   float unit = 1.0 / thumb->scale;
+   QTransform toobject(unit, 0, 0, -unit,
+		thumb->bbox.lowerleft.x - unit,
+		thumb->bbox.lowerleft.y + (thumb->image.height() - 2) * unit);
+
+   p->save();
+   p->setTransform(toobject * ctx->CTM(), true);
+   p->setRenderHint(QPainter::SmoothPixmapTransform);
+   p->drawImage(0, 0, thumb->image);
+   p->restore();
+}
+
+/*----------------------------------------------------------------------*/
+/* Called by UDrawObject() below the top level, with the CTM of the	*/
+/* instance on top of the stack.  If the instance is small enough on	*/
+/* screen, draw it in less detail (or not at all) and return true.	*/
+/* Objects with parameters look different in each instance and are	*/
+/* not drawn from thumbnails.						*/
+/*----------------------------------------------------------------------*/
+
+bool lod_draw(DrawContext *ctx, objinstptr theinstance, int passcolor)
+{
+   objectptr theobject = theinstance->thisobject;
+   float size;
+
+   size = ctx->UTopScale() * qMax(theobject->bbox.width, theobject->bbox.height);
+
+   if (size < areawin->lodhide)
+      return true;
+   if (size < areawin->lodbox) {
+      drawbox(ctx, theobject);
+      return true;
+   }
+   if ((size < areawin->lodthumb) && !drawingimage && (theobject->params == NULL)
+		&& (passcolor != DOFORALL) && (theobject->bbox.width > 0)
+		&& (theobject->bbox.height > 0)) {
+      QMutexLocker lock(&drawlock);
+      Thumbnail thumb = *thumbnail(theinstance, passcolor);
+      lock.unlock();
+      drawthumbnail(ctx, &thumb);
+      return true;
+   }
+   return false;
+}
+
+/*----------------------------------------------------------------------*/
+/* True if "thislabel", drawn with the CTM on top of the stack, is too	*/
+/* small to read.							*/
+/*----------------------------------------------------------------------*/
+
+bool lod_labelhidden(DrawContext *ctx, labelptr thislabel)
+{
+   if (areawin->lodtext <= 0) return false;
+   return (ctx->UTopScale() * thislabel->scale * TEXTHEIGHT < areawin->lodtext);
+}
+
+/*----------------------------------------------------------------------*/
+/* Sprites:  symbols used many times over (transistors, resistors,	*/
+/* gates) are drawn once for each scale, rotation, flip and color at	*/
+/* which they appear, into an image at screen resolution, and then	*/
+/* copied to the screen for every instance.  The scale is taken in	*/
+/* steps of 1/SPRITE_STEPS of an octave, the image being stretched by	*/
+/* the small difference.  Instances with parameters of their own, and	*/
+/* objects with expression parameters, look different in each		*/
+/* instance and are always drawn in full.  Sprites are dropped least	*/
+/* recently used first when they take more than the limit set by	*/
+/* "set spritecache <megabytes>" (0 for no sprites).			*/
+/*----------------------------------------------------------------------*/
+
+#define SPRITE_STEPS	32
+#define SPRITE_MAXSIZE	256	/* pixels;  larger instances are drawn */
+#define SPRITE_LIMIT	64	/* default limit, in megabytes */
+
+#define SPRITE_FLIP	1	/* mirror image */
+#define SPRITE_PINS	2	/* drawn at the first level below the top */
+#define SPRITE_SMOOTH	4	/* drawn antialiased */
+#define SPRITE_PINPOINTS 8	/* drawn with pin positions shown */
+
+typedef struct {
+   objectptr	thisobj;
+   int		step;		/* scale, in steps of an octave */
+   short	rotation;
+   short	flags;
+   int		color;
+} SpriteKey;
+
+typedef struct {
+   QImage	image;
+   QPointF	origin;		/* where the object's origin falls */
+   float	scale;		/* scale the sprite was drawn at */
+   qreal	ratio;		/* device pixels per pixel */
+   int		generation;	/* lod_generation when drawn */
+   u_short	changes;	/* changes to the object when drawn */
+   BBox		bbox;		/* bounding box of the object drawn */
+} Sprite;
+
+inline bool operator==(const SpriteKey &a, const SpriteKey &b)
+{
+   return (a.thisobj == b.thisobj) && (a.step == b.step) &&
+	(a.rotation == b.rotation) && (a.flags == b.flags) && (a.color == b.color);
+}
+
+inline uint qHash(const SpriteKey &key, uint seed = 0)
+{
+   return qHash(key.thisobj, seed) ^ qHash(key.step) ^ (key.rotation << 8)
+	^ key.flags ^ qHash(key.color);
+}
+
+static QCache<SpriteKey, Sprite> sprites(SPRITE_LIMIT << 10);	/* cost in kB */
+
+/*----------------------------------------------------------------------*/
+/* True if the object has a parameter which is an expression		*/
+/*----------------------------------------------------------------------*/
+
+static bool hasexpressions(objectptr theobject)
+{
+   oparamptr ops;
+
+   for (ops = theobject->params; ops != NULL; ops = ops->next)
+      if (ops->type == XC_EXPR) return true;
+   return false;
+}
+
+/*----------------------------------------------------------------------*/
+/* Draw the sprite of "theinstance", with the CTM of the instance on	*/
+/* top of the stack of "ctx", but scaled by "k" (to the sprite's step)	*/
+/*----------------------------------------------------------------------*/
+
+static Sprite *makesprite(DrawContext *ctx, objinstptr theinstance, short level,
+	int passcolor, float k, qreal ratio)
+{
+   objectptr theobject = theinstance->thisobject;
+   BBox *bbox = &theobject->bbox;
+   const Matrix &ctm = ctx->CTM();
+   Sprite *sprite = new Sprite;
+   QTransform linear(ctm.a() * k, ctm.d() * k, ctm.b() * k, ctm.e() * k, 0, 0);
+   QRectF area;
+   float margin;
+   int w, h;
+   Matrix inst;
+
+   sprite->scale = ctx->UTopScale() * k;
+   sprite->ratio = ratio;
+   sprite->generation = lod_generation;
+   sprite->changes = theobject->changes;
+   sprite->bbox = *bbox;
+
+   /* bounding boxes do not include the line width */
+   margin = 8 + 4.0 * xobjs.pagelist[areawin->page].wirewidth * sprite->scale;
+   area = linear.mapRect(QRectF(bbox->lowerleft.x, bbox->lowerleft.y,
+		bbox->width, bbox->height)).adjusted(-margin, -margin, margin, margin);
+   w = (int)ceil(area.width());
+   h = (int)ceil(area.height());
+   sprite->origin = -area.topLeft();
+   sprite->image = QImage((int)ceil(w * ratio), (int)ceil(h * ratio),
+		QImage::Format_ARGB32_Premultiplied);
+   sprite->image.setDevicePixelRatio(ratio);
+   sprite->image.fill(Qt::transparent);
+
+   QPainter p(&sprite->image);
+   p.setRenderHint(QPainter::Antialiasing, areawin->antialias);
+   DrawContext sctx(&p);
+   sctx.setClipRect(QRect(0, 0, w, h));
+   sctx.CTM().set(ctm.a() * k, ctm.b() * k, sprite->origin.x(),
+		ctm.d() * k, ctm.e() * k, sprite->origin.y());
+   inst.preMult(theinstance->position, theinstance->scale, theinstance->rotation);
+   inst.invert();
+   sctx.CTM().preMult(inst);
+
+   XTopSetForeground(sctx.gc(), passcolor);
+   drawingimage = true;
+   UDrawObject(&sctx, theinstance, level, passcolor, NULL);
+   drawingimage = false;
+   return sprite;
+}
+
+/*----------------------------------------------------------------------*/
+/* Called by UDrawObject() below the top level, with the CTM of the	*/
+/* instance on top of the stack.  If the instance can be drawn from a	*/
+/* sprite, draw it so (making the sprite if need be) and return true.	*/
+/*----------------------------------------------------------------------*/
+
+bool sprite_draw(DrawContext *ctx, objinstptr theinstance, short level, int passcolor)
+{
+   objectptr theobject = theinstance->thisobject;
+   const Matrix &ctm = ctx->CTM();
+   QPainter *p;
+   SpriteKey key;
+   Sprite *sprite;
+   float scale, stepscale;
+   qreal ratio, r;
+   QPointF pos, origin;
+   QImage image;
+
+   if ((sprites.maxCost() == 0) || drawingimage || (passcolor == DOFORALL))
+      return false;
+   if ((theinstance->params != NULL) || hasexpressions(theobject))
+      return false;
+   if ((theobject->bbox.width <= 0) || (theobject->bbox.height <= 0))
+      return false;
+
+   scale = ctx->UTopScale();
+   if (scale * qMax(theobject->bbox.width, theobject->bbox.height) > SPRITE_MAXSIZE)
+      return false;
+
+   p = ctx->gc();
+   ratio = p->device()->devicePixelRatioF();
+
+   key.thisobj = theobject;
+   key.step = qRound(log2(scale) * SPRITE_STEPS);
+   key.rotation = ctx->UTopRotation();
+   key.flags = ((ctm.a() * ctm.e() - ctm.b() * ctm.d()) < 0) ? SPRITE_FLIP : 0;
+   if (level == 1) key.flags |= SPRITE_PINS;
+   if (areawin->antialias) key.flags |= SPRITE_SMOOTH;
+   if (areawin->pinpointon) key.flags |= SPRITE_PINPOINTS;
+   key.color = passcolor;
+   stepscale = exp2((float)key.step / SPRITE_STEPS);
+
+   /* A sprite is out of date if its object has changed since */
+
+   QMutexLocker lock(&drawlock);
+   sprite = sprites.object(key);
+   if ((sprite != NULL) && ((sprite->generation != lod_generation) ||
+		(sprite->changes != theobject->changes) || (sprite->ratio != ratio) ||
+		(sprite->bbox.lowerleft.x != theobject->bbox.lowerleft.x) ||
+		(sprite->bbox.lowerleft.y != theobject->bbox.lowerleft.y) ||
+		(sprite->bbox.width != theobject->bbox.width) ||
+		(sprite->bbox.height != theobject->bbox.height))) {
+      sprites.remove(key);
+      sprite = NULL;
+   }
+   if (sprite == NULL) {
+      sprite = makesprite(ctx, theinstance, level, passcolor, stepscale / scale, ratio);
+      /* (a sprite costing more than the whole cache is deleted) */
+      if (!sprites.insert(key, sprite, ((sprite->image.bytesPerLine()
+		* sprite->image.height()) >> 10) + 1))
+	 return false;
+   }
+   image = sprite->image;
+   origin = sprite->origin;
+   r = scale / sprite->scale;
+   lock.unlock();
+
+   /* The object's origin is at the translation of the CTM */
+
+   pos = QPointF(ctm.c(), ctm.f());
+   if (qAbs(r - 1.0) < 0.002)
+      p->drawImage(QPoint(qRound(pos.x() - origin.x()),
+		qRound(pos.y() - origin.y())), image);
+   else {
+      p->save();
+      p->translate(pos);
+      p->scale(r, r);
+      p->translate(-origin);
+      p->setRenderHint(QPainter::SmoothPixmapTransform);
+      p->drawImage(0, 0, image);
+      p->restore();
+   }
+   return true;
+}
+
+void sprite_setlimit(int megabytes)
+{
+   sprites.setMaxCost((megabytes < 0) ? 0 : megabytes << 10);
+}
+
+/*----------------------------------------------------------------------*/
+/* Some object, string or color has changed:  thumbnails and sprites	*/
+/* are redrawn on their next use.					*/
+/*----------------------------------------------------------------------*/
+
+void lod_invalidate()
+{
+   lod_generation++;
+}
+
+/*----------------------------------------------------------------------*/
+/* Forget the thumbnails and sprites of an object being deleted		*/
+/*----------------------------------------------------------------------*/
+
+void lod_forget(objectptr thisobj)
+{
+   QHash<objectptr, QVector<Thumbnail> >::iterator it = thumbnails.find(thisobj);
+
+   if (it != thumbnails.end()) {
+      thumbcount -= it->size();
+      thumbnails.erase(it);
+   }
+   if (sprites.isEmpty()) return;
+   foreach (const SpriteKey &key, sprites.keys())
+      if (key.thisobj == thisobj) sprites.remove(key);
+}
+
+/*----------------------------------------------------------------------*/
+/* "xcircuit -benchdraw <file>":  time drawing the top page of a file,	*/
+/* fitted to a window of LOD_BENCHWIDTH x LOD_BENCHHEIGHT pixels, first	*/
+/* with the level-of-detail thresholds of the startup script, then in	*/
+/* full detail.  Frames are drawn in tiles, on as many threads as	*/
+/* "set drawthreads" allows.						*/
+/*----------------------------------------------------------------------*/
+
+#define LOD_BENCHWIDTH	1280
+#define LOD_BENCHHEIGHT	960
+#define LOD_BENCHFRAMES	20
+
+static void benchframe(QImage *image)
+{
+   QPainter p(image);
+   p.setRenderHint(QPainter::Antialiasing, areawin->antialias);
+   p.fillRect(image->rect(), QColor(BACKGROUND));
+   DrawContext ctx(&p);
+
+   tiles_draw(&ctx, image->rect());
+}
+
+int lod_benchmark(const QString &name)
+{
+   short saved[4] = {areawin->lodhide, areawin->lodbox, areawin->lodthumb,
+		areawin->lodtext};
+   QElapsedTimer timer;
+   int pass, i;
+
+   if (!loadfile(0, -1, name)) {
+      Fprintf(stderr, "Cannot read %s\n", name.toLocal8Bit().data());
+      return 1;
+   }
+   areawin->viewport->resize(LOD_BENCHWIDTH, LOD_BENCHHEIGHT);
+   centerview(areawin->topinstance);
+
+   QImage image(areawin->width(), areawin->height(),
+		QImage::Format_ARGB32_Premultiplied);
+
+   for (pass = 0; pass < 2; pass++) {
+      if (pass == 1)
+	 areawin->lodhide = areawin->lodbox = areawin->lodthumb =
+		areawin->lodtext = 0;
+
+      benchframe(&image);	/* read library cells, make thumbnails */
+      timer.start();
+      for (i = 0; i < LOD_BENCHFRAMES; i++)
+	 benchframe(&image);
+      Fprintf(stdout, "%s: %.2f ms per frame\n",
+		(pass == 0) ? "level of detail" : "full detail",
+		timer.nsecsElapsed() / (1.0e6 * LOD_BENCHFRAMES));
+   }
+
+   areawin->lodhide = saved[0];
+   areawin->lodbox = saved[1];
+   areawin->lodthumb = saved[2];
+   areawin->lodtext = saved[3];
+   return 0;
+}
+
+/*----------------------------------------------------------------------*/
+/* "xcircuit -checkdraw <file>":  check that making cached images does	*/
+/* not disturb the drawing of the page around them.  Thumbnails and	*/
+/* sprites are drawn through a context nested inside the one drawing	*/
+/* the page (whose spatial index has culled the parts to visit), so	*/
+/* the page is drawn once with every image to be made and once more	*/
+/* from the cache, and the two frames must come out the same.  This is	*/
+/* done with the page fitted to the window and at each of a few zoom	*/
+/* steps (each making sprites at a new scale), on the GUI thread alone	*/
+/* and then in tiles.  At the same zoom steps, without antialiasing,	*/
+/* outlines stroked in batches must come out as when each segment was	*/
+/* drawn on its own (see DrawContext::stroke()).  Returns nonzero on	*/
+/* failure.								*/
+/*----------------------------------------------------------------------*/
+
+#define LOD_CHECKZOOMS	4	/* zoom steps, by a factor of two */
+
+static bool checkframes(const char *what, QImage *cold, QImage *warm)
+{
+   lod_invalidate();
+   benchframe(cold);		/* makes thumbnails and sprites while drawing */
+   benchframe(warm);		/* draws them from the cache */
+   if (*cold == *warm) return true;
+
+   Fprintf(stderr, "%s: page drawn differently while making cached images\n",
+		what);
+   return false;
+}
+
+static bool checkstrokes(const char *what, QImage *single, QImage *batched)
+{
+   DrawContext::setBatching(false);
+   lod_invalidate();
+   benchframe(single);
+   DrawContext::setBatching(true);
+   lod_invalidate();
+   benchframe(batched);
+   if (*single == *batched) return true;
+
+   Fprintf(stderr, "%s: outlines stroked in batches differ from outlines "
+		"drawn a segment at a time\n", what);
+   return false;
+}
+
+/* Zoom in by "factor" about the middle of the window */
+
+static void checkzoom(float factor)
+{
+   float cx = areawin->pcorner.x + areawin->width() / (2 * areawin->vscale);
+   float cy = areawin->pcorner.y + areawin->height() / (2 * areawin->vscale);
+
+   areawin->vscale *= factor;
+   areawin->pcorner.x = (int)(cx - areawin->width() / (2 * areawin->vscale));
+   areawin->pcorner.y = (int)(cy - areawin->height() / (2 * areawin->vscale));
+}
+
+int lod_check(const QString &name)
+{
+   char what[32];
+   int failed = 0, threads, zoom;
+   bool antialias;
+
+   if (!loadfile(0, -1, name)) {
+      Fprintf(stderr, "Cannot read %s\n", name.toLocal8Bit().data());
+      return 1;
+   }
+   areawin->viewport->resize(LOD_BENCHWIDTH, LOD_BENCHHEIGHT);
+   centerview(areawin->topinstance);
+
+   /* every instance small enough is drawn from a thumbnail */
+   areawin->lodhide = areawin->lodbox = 0;
+   if (areawin->lodthumb == 0) areawin->lodthumb = 16;
+
+   QImage cold(areawin->width(), areawin->height(),
+		QImage::Format_ARGB32_Premultiplied);
+   QImage warm(cold.size(), QImage::Format_ARGB32_Premultiplied);
+
+   for (threads = 1; threads >= 0; threads--) {
+      tiles_setthreads(threads);
+      centerview(areawin->topinstance);
+      for (zoom = 0; zoom < LOD_CHECKZOOMS; zoom++) {
+	 snprintf(what, sizeof(what), "%s, zoom %d", (threads == 1) ?
+		"one thread" : "tiled", 1 << zoom);
+	 if (!checkframes(what, &cold, &warm)) failed++;
+	 checkzoom(2.0);
+      }
+   }
+
+   antialias = areawin->antialias;
+   areawin->antialias = false;
+   tiles_setthreads(1);
+   centerview(areawin->topinstance);
+   for (zoom = 0; zoom < LOD_CHECKZOOMS; zoom++) {
+      snprintf(what, sizeof(what), "outlines, zoom %d", 1 << zoom);
+      if (!checkstrokes(what, &cold, &warm)) failed++;
+      checkzoom(2.0);
+   }
+   areawin->antialias = antialias;
+
+   Fprintf(stdout, "drawing check %s\n", (failed == 0) ? "passed" : "failed");
+   return (failed == 0) ? 0 : 1;
+}
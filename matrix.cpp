@@ -6,37 +6,15 @@
 #include "prototypes.h"
 
 Matrix::Matrix() :
-        QTransform(),
-        next(NULL)
+        QTransform()
 {
 }
 
 Matrix::Matrix(const Matrix & src) :
-        QTransform(src),
-        next(NULL)
+        QTransform(src)
 {
 }
 
-void Matrix::pop(Matrix*& stack)
-{
-    if (!stack) {
-        Wprintf("Matrix stack pop error");
-        return;
-    }
-    Matrix* last = stack->next;
-    delete stack;
-    stack = last;
-}
-
-void Matrix::push(Matrix *& stack)
-{
-    Matrix* nmatrix;
-    if (stack) nmatrix = new Matrix(*stack);
-    else nmatrix = new Matrix;
-    nmatrix->next = stack;
-    stack = nmatrix;
-}
-
 float Matrix::getScale() const
 {
     return (float)sqrt(a() * a() + d() * d());
@@ -145,7 +123,7 @@ void Matrix::preScale()
    /* matches what PostScript produces.					*/
 }
 
-void Matrix::transform(const XPoint *ipoints, XPoint *points, short number) const
+void Matrix::transform(const XPoint *ipoints, XPoint *points, int number) const
 {
     const XPoint *in = ipoints;
     XPoint *out = points;
@@ -155,7 +133,7 @@ void Matrix::transform(const XPoint *ipoints, XPoint *points, short number) cons
     }
 }
 
-void Matrix::transform(const XfPoint *fpoints, XPoint *points, short number) const
+void Matrix::transform(const XfPoint *fpoints, XPoint *points, int number) const
 {
    const XfPoint * in = fpoints;
    XPoint *out = points;
@@ -165,7 +143,7 @@ void Matrix::transform(const XfPoint *fpoints, XPoint *points, short number) con
    }
 }
 
-void Matrix::set(float a, float b, float c, float d, float e, float f)
+void Matrix::set(float a, float b, double c, float d, float e, double f)
 {
     setMatrix(a, d, 0.0, b, e, 0.0, c, f, 1.0);
 }
@@ -177,21 +155,22 @@ void Matrix::set(float a, float b, float c, float d, float e, float f)
 
 void Matrix::makeWCTM()
 {
-    float A,B,C,D,E,F;
+    float A,B,D,E;
+    double C,F;
     A = a() * areawin->vscale;
     B = b() * areawin->vscale;
-    C = (c() - (float)areawin->pcorner.x) * areawin->vscale;
+    C = (c() - (double)areawin->pcorner.x) * areawin->vscale;
 
     D = d() * -areawin->vscale;
     E = e() * -areawin->vscale;
-    F = (float)areawin->height() + ((float)areawin->pcorner.y - f()) *
+    F = (double)areawin->height() + ((double)areawin->pcorner.y - f()) *
             areawin->vscale;
     set(A, B, C, D, E, F);
 }
 
 /*------------------------------------------------------------------------*/
 
-void UTransformPoints(XPoint *points, XPoint *newpoints, short number,
+void UTransformPoints(XPoint *points, XPoint *newpoints, int number,
         XPoint atpt, float scale, short rotate)
 {
    Matrix LCTM;
@@ -203,7 +182,7 @@ void UTransformPoints(XPoint *points, XPoint *newpoints, short number,
 /* Transform points inward to next hierarchical level */
 /*----------------------------------------------------*/
 
-void InvTransformPoints(XPoint *points, XPoint *newpoints, short number,
+void InvTransformPoints(XPoint *points, XPoint *newpoints, int number,
         XPoint atpt, float scale, short rotate)
 {
    Matrix LCTM;
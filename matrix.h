@@ -18,8 +18,6 @@ class Matrix : public QTransform {
 public:
     Matrix();
     Matrix(const Matrix&);
-    static void pop(Matrix*&);
-    static void push(Matrix*&);
 
     float getScale() const;
     int getRotation() const;
@@ -33,26 +31,23 @@ public:
     void mult(XPoint, float, short);
     void preScale();
 
-    void transform(const XPoint *ipoints, XPoint *points, short number) const;
-    void transform(const XfPoint *fpoints, XPoint *points, short number) const;
-    void set(float a, float b, float c, float d, float e, float f);
+    void transform(const XPoint *ipoints, XPoint *points, int number) const;
+    void transform(const XfPoint *fpoints, XPoint *points, int number) const;
+    void set(float a, float b, double c, float d, float e, double f);
 
     void makeWCTM();
 
     inline float a() const { return m11(); }
     inline float b() const { return m21(); }
-    inline float c() const { return m31(); }
+    inline double c() const { return m31(); }
     inline float d() const { return m12(); }
     inline float e() const { return m22(); }
-    inline float f() const { return m32(); }
-
-private:
-    Matrix* next;
+    inline double f() const { return m32(); }
 };
 
 static const float EPS = 1e-9;
 
-void UTransformPoints(XPoint *, XPoint *, short, XPoint, float, short);
-void InvTransformPoints(XPoint *, XPoint *, short, XPoint, float, short);
+void UTransformPoints(XPoint *, XPoint *, int, XPoint, float, short);
+void InvTransformPoints(XPoint *, XPoint *, int, XPoint, float, short);
 
 #endif // MATRIX_H
@@ -168,7 +168,7 @@ void setwidth(QAction*, const QString &str, void * dataptr_)
 
 void changetextscale(float newscale)
 {
-   short *osel;
+   int *osel;
    labelptr settext;
    stringpart *strptr, *nextptr;
 
@@ -343,8 +343,8 @@ bool setoutputpagesize(XPoint *dataptr, const QString & str)
       return false;
    }
 
-   dataptr->x = (short)(px * 72.0);
-   dataptr->y = (short)(py * 72.0);
+   dataptr->x = (int)(px * 72.0);
+   dataptr->y = (int)(py * 72.0);
 
    if (!strcmp(units, "cm")) {
       dataptr->x /= 2.54;
@@ -361,7 +361,7 @@ bool setoutputpagesize(XPoint *dataptr, const QString & str)
 labelptr gettextsize(float **floatptr)
 {
    labelptr settext = NULL;
-   short    *osel;
+   int    *osel;
    stringpart *strptr, *nextptr;
    const float f_one = 1.00;
 
@@ -441,7 +441,7 @@ void setdscale(QAction*, const QString & str, void *dataptr_)
       QTextStream s(&str2);
       s >> dataptr->x;
       s >> dataptr->y;
-      Wprintf("New scale is %hd:%hd", dataptr->x, dataptr->y);
+      Wprintf("New scale is %d:%d", dataptr->x, dataptr->y);
       W1printf(" ");
    }
 }
@@ -454,7 +454,7 @@ void setosize(QAction*, const QString &str, void*)
 {
    float tmpres, oldsize;
    bool waschanged = false;
-   short *osel;
+   int *osel;
    objinstptr nsobj;
    bool ok;
    tmpres = str.toFloat(&ok);
@@ -491,7 +491,7 @@ void setosize(QAction*, const QString &str, void*)
 void setwwidth(QAction*, const QString & str, void*)
 {
    float     tmpres, oldwidth;
-   short     *osel;
+   int     *osel;
    arcptr    nsarc;
    polyptr   nspoly;
    splineptr nsspline;
@@ -744,6 +744,9 @@ int createlibrary(bool force)
    xobjs.userlibs[libnum - LIBRARY].number = 0;
    xobjs.userlibs[libnum - LIBRARY].instlist = NULL;
 
+   /* libraries after the new one have been renumbered */
+   names_invalidate();
+
    sprintf(_STR2, "xcircuit::newlibrarybutton \"%s\"", newlibobj->name);
    Tcl_Eval(xcinterp, _STR2);
 
@@ -905,7 +908,7 @@ int setelementstyle(QAction* a, u_short value, u_short mask)
 {
    /// \todo
    bool preselected, selected = false;
-   short *sstyle;
+   int *sstyle;
    u_short newstyle, oldstyle;
 
    if (areawin->selects == 0) {
@@ -1021,7 +1024,7 @@ int setelementstyle(QAction* a, u_short value, u_short mask)
 
 void setcolor(Widget w, int cindex)
 {
-   short *scolor;
+   int *scolor;
    int *ecolor, cval;
    bool selected = false;
    stringpart *strptr, *nextptr;
@@ -1355,7 +1358,7 @@ void setfontval(QAction* w, void* value, labelptr settext)
 
 void setfont(QAction* w, void* value, void*)
 {
-   short *fselect;
+   int *fselect;
    labelptr settext;
    short labelcount = 0;
    bool preselected;
@@ -1455,7 +1458,7 @@ void setfontstyle(QAction* w, void* value, labelptr settext)
 
 void fontstyle(QAction* w, void* value, void*)
 {
-   short *fselect;
+   int *fselect;
    labelptr settext;
    short labelcount = 0;
    bool preselected;
@@ -1554,7 +1557,7 @@ void setfontencoding(QAction* w, void* value, void* settext_)
 
 void fontencoding(QAction* w, void* value, void*)
 {
-   short *fselect;
+   int *fselect;
    labelptr settext;
    short labelcount = 0;
    bool preselected;
@@ -0,0 +1,298 @@
+/*----------------------------------------------------------------------*/
+/* nameindex.cpp --- lookup of library objects, aliases and		*/
+/*		     technologies by name				*/
+/*----------------------------------------------------------------------*/
+
+#include <QSet>
+
+#include <cstring>
+
+#include "xcircuit.h"
+#include "prototypes.h"
+#include "nameindex.h"
+
+/*----------------------------------------------------------------------*/
+/* NameTable								*/
+/*----------------------------------------------------------------------*/
+
+void NameTable::clear()
+{
+   full.clear();
+   canon.clear();
+}
+
+/*----------------------------------------------------------------------*/
+/* The key of a name:  without leading underscores and, if		*/
+/* "canonical", without the technology.					*/
+/*----------------------------------------------------------------------*/
+
+QByteArray NameTable::key(const char *name, bool canonical)
+{
+   const char *techptr;
+
+   if (canonical && ((techptr = strstr(name, "::")) != NULL))
+      name = techptr + 2;
+   while (*name == '_') name++;
+   return QByteArray::fromRawData(name, strlen(name));
+}
+
+/*----------------------------------------------------------------------*/
+/* Enter an object, which is last (so far) in library "lib".  An	*/
+/* object already entered (as when the index was rebuilt after the	*/
+/* object was added to its library) is not entered again.		*/
+/*----------------------------------------------------------------------*/
+
+void NameTable::Entries::add(objectptr thisobj, int lib)
+{
+   int i;
+
+   if (objs.contains(thisobj)) return;
+   for (i = libs.size(); (i > 0) && (libs[i - 1] > lib); i--) ;
+   objs.insert(i, thisobj);
+   libs.insert(i, lib);
+}
+
+void NameTable::Entries::remove(objectptr thisobj)
+{
+   int i = objs.indexOf(thisobj);
+
+   if (i < 0) return;
+   objs.remove(i);
+   libs.remove(i);
+}
+
+void NameTable::add(objectptr thisobj, int lib)
+{
+   /* Keys are copied here, as they refer to the object's name */
+   full[QByteArray(key(thisobj->name, false).constData())].add(thisobj, lib);
+   canon[QByteArray(key(thisobj->name, true).constData())].add(thisobj, lib);
+}
+
+void NameTable::remove(objectptr thisobj)
+{
+   QHash<QByteArray, Entries>::iterator it;
+
+   it = full.find(key(thisobj->name, false));
+   if (it != full.end()) {
+      it->remove(thisobj);
+      if (it->objs.isEmpty()) full.erase(it);
+   }
+   it = canon.find(key(thisobj->name, true));
+   if (it != canon.end()) {
+      it->remove(thisobj);
+      if (it->objs.isEmpty()) canon.erase(it);
+   }
+}
+
+/*----------------------------------------------------------------------*/
+/* Return the objects matching "name", or NULL if there are none	*/
+/*----------------------------------------------------------------------*/
+
+const NameTable::Entries *NameTable::find(const char *name, bool canonical) const
+{
+   const QHash<QByteArray, Entries> &table = canonical ? canon : full;
+   QHash<QByteArray, Entries>::const_iterator it;
+
+   it = table.constFind(key(name, canonical));
+   return (it == table.constEnd()) ? NULL : &(*it);
+}
+
+/*----------------------------------------------------------------------*/
+/* The indexes of the user libraries and of the font library.  Every	*/
+/* change to a library must be told to the index:  an object added at	*/
+/* the end of a library or removed from it is applied in place with	*/
+/* names_addobject() (once it has its final name, after checkname())	*/
+/* or names_removeobject(), and anything else				*/
+/* (objects moved between libraries, libraries added) calls		*/
+/* names_invalidate(), after which the index is rebuilt on the next	*/
+/* lookup.  The sizes of the libraries are no test of staleness, as an	*/
+/* object deleted and another added leave them the same.		*/
+/*----------------------------------------------------------------------*/
+
+typedef struct {
+   NameTable table;
+   bool valid;
+} NameIndex;
+
+static NameIndex libnames = {NameTable(), false};
+static NameIndex fontnames = {NameTable(), false};
+
+/* Aliases (file load only) and technologies */
+
+static QHash<objectptr, QSet<QByteArray> > objaliases;
+static QSet<QByteArray> allaliases;
+static QHash<QByteArray, TechPtr> technames;
+
+static inline NameIndex *nameindex(short mode)
+{
+   return (mode == FONTLIB) ? &fontnames : &libnames;
+}
+
+static objectptr libobject(short mode, int lib, int j)
+{
+   return (mode == FONTLIB) ? *(xobjs.fontlib.library + j) :
+		*(xobjs.userlibs[lib].library + j);
+}
+
+/*----------------------------------------------------------------------*/
+/* Bring the index for "mode" up to date				*/
+/*----------------------------------------------------------------------*/
+
+static NameIndex *names_sync(short mode)
+{
+   NameIndex *index = nameindex(mode);
+   int libs = (mode == FONTLIB) ? 1 : xobjs.numlibs;
+   int i, j, number;
+
+   if (index->valid) return index;
+
+   index->table.clear();
+   for (i = 0; i < libs; i++) {
+      number = (mode == FONTLIB) ? xobjs.fontlib.number : xobjs.userlibs[i].number;
+      for (j = 0; j < number; j++)
+	 index->table.add(libobject(mode, i, j), i);
+   }
+   index->valid = true;
+   return index;
+}
+
+/*----------------------------------------------------------------------*/
+/* Discard the library indexes.  Called when an object in a library is	*/
+/* renamed, moved to another library, or the libraries are rearranged.	*/
+/*----------------------------------------------------------------------*/
+
+void names_invalidate()
+{
+   libnames.valid = false;
+   fontnames.valid = false;
+}
+
+/*----------------------------------------------------------------------*/
+/* An object has been added to the end of library "mode", and named.	*/
+/*----------------------------------------------------------------------*/
+
+void names_addobject(short mode, objectptr thisobj)
+{
+   NameIndex *index = nameindex(mode);
+
+   if (index->valid)
+      index->table.add(thisobj, (mode == FONTLIB) ? 0 : (mode - LIBRARY));
+}
+
+/*----------------------------------------------------------------------*/
+/* An object has been removed from library "mode" (and is about to be	*/
+/* destroyed).  Must be called while the object still has its name.	*/
+/*----------------------------------------------------------------------*/
+
+void names_removeobject(short mode, objectptr thisobj)
+{
+   NameIndex *index = nameindex(mode);
+
+   if (index->valid)
+      index->table.remove(thisobj);
+   objaliases.remove(thisobj);
+}
+
+/*----------------------------------------------------------------------*/
+/* Find the library objects whose name matches "name", not counting	*/
+/* leading underscores.  If "canonical", the technologies of the	*/
+/* objects are ignored.  The objects are returned in library order in	*/
+/* "found" and, if "libs" is not NULL, their library numbers (from	*/
+/* zero) in "libs";  both are valid until the libraries next change.	*/
+/* Mode FONTLIB searches the font library, any other mode all of the	*/
+/* user libraries.  Returns the number of objects found.		*/
+/*----------------------------------------------------------------------*/
+
+int names_find(short mode, const char *name, bool canonical, objectptr **found,
+		int **libs)
+{
+   NameIndex *index = names_sync(mode);
+   const NameTable::Entries *entries;
+   int i;
+
+   entries = index->table.find(name, canonical);
+   if (entries == NULL) return 0;
+
+   /* An object renamed without notice shows up here;  start over */
+   for (i = 0; i < entries->objs.size(); i++) {
+      const char *oname = entries->objs[i]->name;
+      const char *techptr;
+
+      if (canonical && ((techptr = strstr(oname, "::")) != NULL))
+	 oname = techptr + 2;
+      if (objnamecmp((char *)name, (char *)oname)) {
+	 index->valid = false;
+	 index = names_sync(mode);
+	 entries = index->table.find(name, canonical);
+	 if (entries == NULL) return 0;
+	 break;
+      }
+   }
+
+   *found = (objectptr *)entries->objs.constData();
+   if (libs != NULL) *libs = (int *)entries->libs.constData();
+   return entries->objs.size();
+}
+
+/*----------------------------------------------------------------------*/
+/* Find a user library object named exactly "name", other than "skip"	*/
+/*----------------------------------------------------------------------*/
+
+objectptr names_findexact(const char *name, objectptr skip)
+{
+   objectptr *found;
+   int i, n;
+
+   n = names_find(LIBRARY, name, false, &found, NULL);
+   for (i = 0; i < n; i++)
+      if ((found[i] != skip) && !strcmp(name, found[i]->name))
+	 return found[i];
+   return NULL;
+}
+
+/*----------------------------------------------------------------------*/
+/* Object name aliases, recorded by addalias() during a file load	*/
+/*----------------------------------------------------------------------*/
+
+void names_addalias(objectptr thisobj, const char *alias)
+{
+   objaliases[thisobj].insert(QByteArray(alias));
+   allaliases.insert(QByteArray(alias));
+}
+
+/*----------------------------------------------------------------------*/
+/* Return true if "alias" is an alias of object "thisobj", or of any	*/
+/* object if "thisobj" is NULL.						*/
+/*----------------------------------------------------------------------*/
+
+bool names_isalias(objectptr thisobj, const char *alias)
+{
+   QByteArray key = QByteArray::fromRawData(alias, strlen(alias));
+   QHash<objectptr, QSet<QByteArray> >::const_iterator it;
+
+   if (thisobj == NULL) return allaliases.contains(key);
+   it = objaliases.constFind(thisobj);
+   if (it == objaliases.constEnd()) return false;
+   return it->contains(key);
+}
+
+void names_clearaliases()
+{
+   objaliases.clear();
+   allaliases.clear();
+}
+
+/*----------------------------------------------------------------------*/
+/* Technologies								*/
+/*----------------------------------------------------------------------*/
+
+void names_addtech(TechPtr nsp)
+{
+   technames.insert(QByteArray(nsp->technology), nsp);
+}
+
+TechPtr names_findtech(const char *technology)
+{
+   return technames.value(QByteArray::fromRawData(technology,
+		strlen(technology)), NULL);
+}
@@ -0,0 +1,40 @@
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+
+#include "xcircuit.h"
+
+/*----------------------------------------------------------------------*/
+/* Hash index of library object names.  Objects are entered under the	*/
+/* full name ("<technology>::<name>") and under the name without the	*/
+/* technology, both without leading underscores, so that one lookup	*/
+/* returns every object which objnamecmp() would match.  Each key	*/
+/* holds its objects in library order (library, then position), which	*/
+/* is the order of a walk over all libraries.				*/
+/*----------------------------------------------------------------------*/
+
+class NameTable {
+public:
+    struct Entries {
+        QVector<objectptr> objs;
+        QVector<int> libs;		/* library of each object */
+
+        void add(objectptr, int lib);
+        void remove(objectptr);
+    };
+
+    void clear();
+    void add(objectptr, int lib);
+    void remove(objectptr);
+    const Entries *find(const char *name, bool canonical) const;
+
+private:
+    static QByteArray key(const char *name, bool canonical);
+
+    QHash<QByteArray, Entries> full, canon;
+};
+
+#endif // NAMEINDEX_H
@@ -0,0 +1,310 @@
+/*----------------------------------------------------------------------*/
+/* netindex.cpp --- position and net lookup, and deferred polygon	*/
+/*		    numbering, for netlist generation			*/
+/*----------------------------------------------------------------------*/
+
+#include <algorithm>
+
+#include <QThreadPool>
+
+#include "xcircuit.h"
+#include "prototypes.h"
+#include "netindex.h"
+
+static inline int EndPoint(int n) { return (n == 1) ? 1 : (n - 1); }
+static inline int NextPoint(int n) { return (n == 1) ? 0 : 1; }
+
+/*----------------------------------------------------------------------*/
+/* NetGrid								*/
+/*----------------------------------------------------------------------*/
+
+void NetGrid::clear()
+{
+   cells.clear();
+}
+
+/*----------------------------------------------------------------------*/
+/* Enter the segment from a to b (a point, if a == b) under "key"	*/
+/*----------------------------------------------------------------------*/
+
+void NetGrid::insert(const XPoint *a, const XPoint *b, int key)
+{
+   int x, y, x0, y0, x1, y1;
+
+   x0 = cell(qMin(a->x, b->x) - Slack);
+   x1 = cell(qMax(a->x, b->x) + Slack);
+   y0 = cell(qMin(a->y, b->y) - Slack);
+   y1 = cell(qMax(a->y, b->y) + Slack);
+
+   for (y = y0; y <= y1; y++)
+      for (x = x0; x <= x1; x++) {
+	 QVector<int> &bucket = cells[cellkey(x, y)];
+	 if (bucket.isEmpty() || (bucket.last() != key))
+	    bucket.append(key);
+      }
+}
+
+/*----------------------------------------------------------------------*/
+/* Enter every segment of a polygon under "key"				*/
+/*----------------------------------------------------------------------*/
+
+void NetGrid::insertpoly(const polygon *poly, int key)
+{
+   const XPoint *pt = poly->points.begin();
+   int i, n = poly->points.count();
+
+   for (i = 0; i < EndPoint(n); i++)
+      insert(pt + i, pt + i + NextPoint(n), key);
+}
+
+/*----------------------------------------------------------------------*/
+/* Append the keys of all items possibly touching the segment a-b.	*/
+/* Keys may be repeated.						*/
+/*----------------------------------------------------------------------*/
+
+void NetGrid::find(const XPoint *a, const XPoint *b, QVector<int> &keys) const
+{
+   int x, y, x0, y0, x1, y1;
+   QHash<quint32, QVector<int> >::const_iterator it;
+
+   x0 = cell(qMin(a->x, b->x));
+   x1 = cell(qMax(a->x, b->x));
+   y0 = cell(qMin(a->y, b->y));
+   y1 = cell(qMax(a->y, b->y));
+
+   for (y = y0; y <= y1; y++)
+      for (x = x0; x <= x1; x++) {
+	 it = cells.constFind(cellkey(x, y));
+	 if (it != cells.constEnd())
+	    keys += *it;
+      }
+}
+
+void NetGrid::findpoly(const XPoint *pts, int n, QVector<int> &keys) const
+{
+   int i;
+
+   for (i = 0; i < EndPoint(n); i++)
+      find(pts + i, pts + i + NextPoint(n), keys);
+}
+
+void NetGrid::findpoly(const polygon *poly, QVector<int> &keys) const
+{
+   findpoly(poly->points.begin(), poly->points.count(), keys);
+}
+
+/*----------------------------------------------------------------------*/
+/* PolyIndex								*/
+/*----------------------------------------------------------------------*/
+
+PolyIndex::PolyIndex(objectptr thisobj) :
+        owner(thisobj),
+        head(NULL)
+{
+   sync();
+}
+
+/*----------------------------------------------------------------------*/
+/* Enter polygons added at the head of the list since the last lookup	*/
+/*----------------------------------------------------------------------*/
+
+void PolyIndex::sync()
+{
+   PolylistPtr plist;
+   QVector<PolylistPtr> added;
+
+   if (owner->polygons == head) return;
+
+   for (plist = owner->polygons; plist != head; plist = plist->next) {
+      if (plist == NULL) {
+	 /* The list has been replaced; start over */
+	 entries.clear();
+	 grid.clear();
+	 head = NULL;
+	 sync();
+	 return;
+      }
+      added.append(plist);
+   }
+   while (!added.isEmpty()) {
+      plist = added.takeLast();
+      grid.insertpoly(plist->poly, entries.size());
+      entries.append(plist);
+   }
+   head = owner->polygons;
+}
+
+/*----------------------------------------------------------------------*/
+/* Turn a list of keys into list entries, in list (newest first) order	*/
+/*----------------------------------------------------------------------*/
+
+void PolyIndex::order(QVector<int> &keys, QVector<PolylistPtr> &found) const
+{
+   int i;
+
+   std::sort(keys.begin(), keys.end());
+   found.clear();
+   for (i = keys.size() - 1; i >= 0; i--)
+      if ((i == keys.size() - 1) || (keys[i] != keys[i + 1]))
+	 found.append(entries[keys[i]]);
+}
+
+/*----------------------------------------------------------------------*/
+/* Find the polygons possibly touching the segment (or point) a-b	*/
+/*----------------------------------------------------------------------*/
+
+void PolyIndex::find(const XPoint *a, const XPoint *b, QVector<PolylistPtr> &found)
+{
+   QVector<int> keys;
+
+   sync();
+   grid.find(a, b, keys);
+   order(keys, found);
+}
+
+/*----------------------------------------------------------------------*/
+/* Find the polygons possibly touching any segment of a point list	*/
+/*----------------------------------------------------------------------*/
+
+void PolyIndex::findpoly(const XPoint *pts, int n, QVector<PolylistPtr> &found)
+{
+   QVector<int> keys;
+
+   sync();
+   grid.findpoly(pts, n, keys);
+   order(keys, found);
+}
+
+/*----------------------------------------------------------------------*/
+/* Find the polygons possibly touching either of the points a and b	*/
+/*----------------------------------------------------------------------*/
+
+void PolyIndex::findends(const XPoint *a, const XPoint *b, QVector<PolylistPtr> &found)
+{
+   QVector<int> keys;
+
+   sync();
+   grid.find(a, a, keys);
+   grid.find(b, b, keys);
+   order(keys, found);
+}
+
+/*----------------------------------------------------------------------*/
+/* NetMembers								*/
+/*----------------------------------------------------------------------*/
+
+NetMembers::NetMembers(objectptr cschem) :
+        owner(cschem),
+        ok(true)
+{
+   PolylistPtr plist;
+   LabellistPtr llist;
+
+   for (plist = cschem->polygons; ok && (plist != NULL); plist = plist->next) {
+      if (plist->subnets != 0) ok = false;
+      else add((Genericlist *)plist, false);
+   }
+   for (llist = cschem->labels; ok && (llist != NULL); llist = llist->next) {
+      if (llist->subnets != 0) ok = false;
+      else add((Genericlist *)llist, true);
+   }
+   if (!ok) nets.clear();
+}
+
+/*----------------------------------------------------------------------*/
+/* Record a new polygon or label entry of the object			*/
+/*----------------------------------------------------------------------*/
+
+void NetMembers::add(Genericlist *entry, bool islabel)
+{
+   Member m;
+
+   if (!ok) return;
+   if (entry->subnets != 0) {
+      ok = false;
+      nets.clear();
+      return;
+   }
+   m.entry = entry;
+   m.islabel = islabel;
+   nets[entry->net.id].append(m);
+}
+
+/*----------------------------------------------------------------------*/
+/* An entry's net ID has been changed directly from "oldid"		*/
+/*----------------------------------------------------------------------*/
+
+void NetMembers::moved(Genericlist *entry, int oldid)
+{
+   QHash<int, QVector<Member> >::iterator it = nets.find(oldid);
+   int i;
+
+   if (it == nets.end()) return;
+   for (i = 0; i < it->size(); i++) {
+      if ((*it)[i].entry == entry) {
+	 Member m = (*it)[i];
+	 it->remove(i);
+	 if (it->isEmpty()) nets.erase(it);
+	 nets[entry->net.id].append(m);
+	 return;
+      }
+   }
+}
+
+/*----------------------------------------------------------------------*/
+/* Change every member of net "oldid" to net "newid".  The labels	*/
+/* changed are returned in "labels".  Returns true if any entry was	*/
+/* changed, as mergenetlist() would for the whole list.			*/
+/*----------------------------------------------------------------------*/
+
+bool NetMembers::relabel(int oldid, int newid, QVector<LabellistPtr> &labels)
+{
+   QVector<Member> moving;
+   int i;
+
+   labels.clear();
+   if (oldid == newid) return false;
+   moving = nets.take(oldid);
+   if (moving.isEmpty()) return false;
+
+   QVector<Member> &dest = nets[newid];
+   for (i = 0; i < moving.size(); i++) {
+      moving[i].entry->net.id = newid;
+      if (moving[i].islabel)
+	 labels.append((LabellistPtr)moving[i].entry);
+      dest.append(moving[i]);
+   }
+   return true;
+}
+
+/*----------------------------------------------------------------------*/
+/* NetJob								*/
+/*----------------------------------------------------------------------*/
+
+NetJob::NetJob(objectptr cschem, objectptr pschem, objinstptr cinst,
+		int old_parts, int nextnet) :
+        cschem(cschem),
+        pschem(pschem),
+        cinst(cinst),
+        old_parts(old_parts),
+        nextnet(nextnet)
+{
+   setAutoDelete(false);
+}
+
+void NetJob::run()
+{
+   nextnet = gennetpolys(cschem, pschem, cinst, old_parts, nextnet);
+   done.release();
+}
+
+/*----------------------------------------------------------------------*/
+/* Wait for the job, or run it here if it has not been started		*/
+/*----------------------------------------------------------------------*/
+
+void NetJob::finish()
+{
+   if (QThreadPool::globalInstance()->tryTake(this))
+      run();
+   done.acquire();
+}
@@ -0,0 +1,119 @@
+#ifndef NETINDEX_H
+#define NETINDEX_H
+
+#include <QHash>
+#include <QVector>
+#include <QRunnable>
+#include <QSemaphore>
+
+#include "xcircuit.h"
+
+/*----------------------------------------------------------------------*/
+/* Buckets of netlist geometry (wire segments and pin positions),	*/
+/* hashed on a coarse grid.  Each item is entered in every cell its	*/
+/* box touches, grown by a slack covering the ONDIST tolerance of the	*/
+/* connectivity tests and the roundoff of finddist().  A lookup returns	*/
+/* the keys of all items which may touch the given point or segment;	*/
+/* the caller still makes the exact test.				*/
+/*----------------------------------------------------------------------*/
+
+class NetGrid {
+public:
+    void clear();
+    void insert(const XPoint *, const XPoint *, int key);
+    void insertpoly(const polygon *, int key);
+    void find(const XPoint *, const XPoint *, QVector<int> &) const;
+    void findpoly(const polygon *, QVector<int> &) const;
+    void findpoly(const XPoint *, int, QVector<int> &) const;
+
+    static const int CellSize = 256;
+    static const int Slack = 64;
+
+private:
+    static inline int cell(int c) { return (c >> 8); }
+    static inline quint32 cellkey(int cx, int cy)
+	{ return ((quint32)(cx & 0xffff) << 16) | (quint32)(cy & 0xffff); }
+
+    QHash<quint32, QVector<int> > cells;
+};
+
+/*----------------------------------------------------------------------*/
+/* Index of the network polygon list of an object.  The list only	*/
+/* grows at its head while a netlist is being generated, so new		*/
+/* entries are picked up on each lookup.  Lookups return entries in	*/
+/* list order, so that nets are merged in the same order as a walk of	*/
+/* the whole list would merge them.					*/
+/*----------------------------------------------------------------------*/
+
+class PolyIndex {
+public:
+    explicit PolyIndex(objectptr);
+    void find(const XPoint *, const XPoint *, QVector<PolylistPtr> &);
+    void findpoly(const XPoint *, int, QVector<PolylistPtr> &);
+    void findends(const XPoint *, const XPoint *, QVector<PolylistPtr> &);
+
+    /* lists shorter than this are simply walked */
+    static const int MinPolys = 32;
+
+private:
+    void sync();
+    void order(QVector<int> &, QVector<PolylistPtr> &) const;
+
+    objectptr owner;
+    PolylistPtr head;			/* list head at last sync */
+    QVector<PolylistPtr> entries;	/* oldest first */
+    NetGrid grid;
+};
+
+/*----------------------------------------------------------------------*/
+/* Members of each net of an object, for relabeling a net in netmerge()	*/
+/* without walking all polygons and labels.  A net merge relabels the	*/
+/* members of the old net (union by relabeling), so that every list	*/
+/* entry always holds its final net ID, as the rest of the netlister	*/
+/* expects.  Only nets without buses are tracked;  valid() is false if	*/
+/* the object has any bus entries.					*/
+/*----------------------------------------------------------------------*/
+
+class NetMembers {
+public:
+    explicit NetMembers(objectptr);
+
+    inline bool valid() const { return ok; }
+    inline objectptr schem() const { return owner; }
+    void add(Genericlist *, bool islabel);
+    void moved(Genericlist *, int oldid);
+    bool relabel(int oldid, int newid, QVector<LabellistPtr> &);
+
+private:
+    struct Member {
+        Genericlist *entry;
+        bool islabel;
+    };
+
+    objectptr owner;
+    bool ok;
+    QHash<int, QVector<Member> > nets;
+};
+
+/*----------------------------------------------------------------------*/
+/* Deferred polygon numbering of one schematic (gennetpolys()), run on	*/
+/* the global thread pool.  finish() returns when the job is done,	*/
+/* running it on the calling thread if no pool thread has taken it yet.	*/
+/*----------------------------------------------------------------------*/
+
+class NetJob : public QRunnable {
+public:
+    NetJob(objectptr cschem, objectptr pschem, objinstptr cinst,
+		int old_parts, int nextnet);
+    void run();
+    void finish();
+
+private:
+    objectptr cschem, pschem;
+    objinstptr cinst;
+    int old_parts;
+    int nextnet;
+    QSemaphore done;
+};
+
+#endif // NETINDEX_H
@@ -20,6 +20,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <cctype>
+#include <algorithm>
 
 #include <sys/types.h>	/* For preventing multiple file inclusions, use stat() */
 #include <sys/stat.h>
@@ -39,6 +40,16 @@
 #include "colors.h"
 #include "prototypes.h"
 #include "xcqt.h"
+#include "netindex.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QPair>
+#include <QThreadPool>
+
+#ifdef NETLIST_DEBUG
+#include <QSet>
+#endif
 
 #ifdef HAVE_PYTHON
 extern PyObject *PyGetStringParts(stringpart *);
@@ -91,6 +102,128 @@ static inline int NextPoint(int n) { return (n == 1) ? 0 : 1; }
 #define ONDIST 4  /* "slack" in algorithm for almost-touching lines */
 #define onsegment(a, b, x) (finddist(a, b, x) <= ONDIST)
 
+/*----------------------------------------------------------------------*/
+/* Lookup of network polygons by position.  While createnets() runs,	*/
+/* the polygon list of each object is indexed on a grid (see		*/
+/* netindex.h) once it is long enough to be worth it, and the members	*/
+/* of each net of the schematic whose polygons are being enumerated	*/
+/* are tracked for netmerge().  Candidates are always returned in list	*/
+/* order, so that nets are merged and numbered exactly as a walk of the	*/
+/* whole list would do it.  Each thread numbering polygons has its own	*/
+/* indexes.								*/
+/*----------------------------------------------------------------------*/
+
+static thread_local bool netindex_active = false;
+static thread_local QHash<objectptr, PolyIndex *> polyindexes;
+static thread_local NetMembers *net_members = NULL;
+
+static PolyIndex *polyindex(objectptr thisobj)
+{
+   PolylistPtr plist;
+   int count = 0;
+
+   if (!netindex_active) return NULL;
+
+   QHash<objectptr, PolyIndex *>::const_iterator it = polyindexes.constFind(thisobj);
+   if (it != polyindexes.constEnd()) return *it;
+
+   for (plist = thisobj->polygons; plist != NULL; plist = plist->next)
+      if (++count >= PolyIndex::MinPolys)
+	 return (polyindexes[thisobj] = new PolyIndex(thisobj));
+   return NULL;
+}
+
+static void allpolys(objectptr thisobj, QVector<PolylistPtr> &found)
+{
+   PolylistPtr plist;
+
+   found.clear();
+   for (plist = thisobj->polygons; plist != NULL; plist = plist->next)
+      found.append(plist);
+}
+
+/* Polygons of thisobj possibly touching any segment of "pts" */
+
+static void nearpolys(objectptr thisobj, XPoint *pts, int number,
+		QVector<PolylistPtr> &found)
+{
+   PolyIndex *pindex = polyindex(thisobj);
+
+   if (pindex != NULL) pindex->findpoly(pts, number, found);
+   else allpolys(thisobj, found);
+}
+
+/* Polygons of thisobj possibly touching either of two points */
+
+static void nearends(objectptr thisobj, XPoint *pt1, XPoint *pt2,
+		QVector<PolylistPtr> &found)
+{
+   PolyIndex *pindex = polyindex(thisobj);
+
+   if (pindex != NULL) pindex->findends(pt1, pt2, found);
+   else allpolys(thisobj, found);
+}
+
+static void netindex_reset()
+{
+   qDeleteAll(polyindexes);
+   polyindexes.clear();
+   delete net_members;
+   net_members = NULL;
+}
+
+/*----------------------------------------------------------------------*/
+/* Polygon numbering jobs.  While createnets() runs, the polygon	*/
+/* enumeration of each schematic (gennetlist() part 3) is handed to the	*/
+/* thread pool, so that independent subcircuits are numbered at the	*/
+/* same time.  gennetlist() first finishes the job of any object it	*/
+/* reads, taking the job back to run itself if no thread has started	*/
+/* it.  Everything else, including the allocation of global net IDs,	*/
+/* runs in the original order, so the netlist is the same as a serial	*/
+/* build (see netlist_jobcheck()).  A job reads the list of global	*/
+/* labels, so addglobalpin() finishes all jobs before changing it;  the	*/
+/* labels of the object a job numbers are only added to by gennetlist()	*/
+/* on that object, after it has finished the job.			*/
+/*									*/
+/* Only schematics of a single page are numbered by jobs.  The pages	*/
+/* of a multi-page schematic share one netlist:  the pins of each page	*/
+/* are matched against the nets numbered on the pages before it, and	*/
+/* each page numbers its nets after those of the last, so the pages	*/
+/* must be numbered one after another on the calling thread.		*/
+/*----------------------------------------------------------------------*/
+
+static bool netjobs_active = false;
+static bool netjobs_allowed = true;	/* false to build serially */
+static QHash<objectptr, NetJob *> netjobs;
+
+static void startnetjob(objectptr cschem, objectptr pschem, objinstptr cinst,
+		int old_parts, int nextnet)
+{
+   NetJob *job = new NetJob(cschem, pschem, cinst, old_parts, nextnet);
+
+   netjobs.insert(pschem, job);
+   QThreadPool::globalInstance()->start(job);
+}
+
+static void finishnetjob(objectptr thisobj)
+{
+   NetJob *job;
+
+   if (thisobj == NULL) return;
+   if ((job = netjobs.take(thisobj)) == NULL) return;
+   job->finish();
+   delete job;
+}
+
+static void finishnetjobs()
+{
+   foreach (NetJob *job, netjobs) {
+      job->finish();
+      delete job;
+   }
+   netjobs.clear();
+}
+
 /*--------------------------------------------------------------*/
 /* d36a:  Base 36 to string conversion				*/
 /*--------------------------------------------------------------*/
@@ -408,8 +541,15 @@ void createnets(objinstptr thisinst, bool quiet)
 	 
 
    /* Wprintf("Generating netlists"); */ /* Diagnostic */
+   netindex_reset();
+   netindex_active = true;
+   netjobs_active = netjobs_allowed;
    gennetlist(thisinst);
+   finishnetjobs();
+   netjobs_active = false;
    gencalls(thisobject);
+   netindex_active = false;
+   netindex_reset();
    cleartraversed(thisobject);
    resolve_devnames(thisobject);
    /* Wprintf("Finished netlists"); */
@@ -520,6 +660,183 @@ int netmax(objectptr cschem)
    return smax;
 }
 
+/*----------------------------------------------------------------------*/
+/* Part 3 of gennetlist():  Assign network numbers to all polygons in	*/
+/* page cschem of the master schematic pschem, numbering new nets from	*/
+/* "nextnet".  Returns the next unused net number.  This touches only	*/
+/* the netlists of pschem and of its symbol, and so may be run on a	*/
+/* worker thread (see startnetjob()).					*/
+/*----------------------------------------------------------------------*/
+
+int gennetpolys(objectptr cschem, objectptr pschem, objinstptr cinst,
+		int old_parts, int nextnet)
+{
+   genericptr *cgen;
+   labelptr olabel;
+   polyptr cpoly, tpoly;
+   XPoint *tpt, *tpt2, *endpt, *endpt2;
+   PolylistPtr plist;
+   LabellistPtr lseek;
+   Genericlist *tmplist, *resolved_net, newlist;
+   QVector<LabellistPtr> pins;
+   QVector<PolylistPtr> candidates;
+   QVector<int> pinkeys;
+   NetGrid pingrid;
+   int i, k;
+   bool worker = !netindex_active;
+
+   /* A worker thread indexes polygons for this job only */
+   if (worker) netindex_active = true;
+
+   newlist.subnets = 0;
+
+   /* Collect the pin labels which apply to this object, in the	*/
+   /* order they are checked, and bucket them by position.  The	*/
+   /* label list does not change while polygons are enumerated.	*/
+
+   for (lseek = pschem->labels; lseek != NULL; lseek = lseek->next) {
+      if (lseek->cschem != cschem) continue;
+      else if ((lseek->cinst != NULL) && (lseek->cinst != cinst))
+	 continue;
+      pingrid.insert(&lseek->label->position, &lseek->label->position,
+		  pins.size());
+      pins.append(lseek);
+
+      /* if we've encountered a unique instance, then con-	*/
+      /* tinue past all other instances using this label.	*/
+      if (lseek->cinst != NULL)
+	 while (lseek->next && (lseek->next->label == lseek->label))
+	    lseek = lseek->next;
+   }
+
+   /* Track net members for merging, unless there are buses */
+   if (netindex_active) {
+      net_members = new NetMembers(pschem);
+      if (!net_members->valid()) {
+	 delete net_members;
+	 net_members = NULL;
+      }
+   }
+
+   for (i = 0; i < old_parts; i++) {
+      cgen = cschem->begin() + i;
+      if (IS_POLYGON(*cgen)) {
+	 cpoly = TOPOLY(cgen);
+
+	 /* Ignore non-network (closed, bbox, filled) polygons */
+	 if (nonnetwork(cpoly)) continue;
+
+	 resolved_net = (Genericlist *)NULL;
+
+	 /* Check for attachment of each segment of this polygon	*/
+	 /* to position of every recorded pin label.			*/
+
+	 pinkeys.clear();
+	 pingrid.findpoly(cpoly, pinkeys);
+	 std::sort(pinkeys.begin(), pinkeys.end());
+	 pinkeys.erase(std::unique(pinkeys.begin(), pinkeys.end()),
+		  pinkeys.end());
+
+	 for (k = 0; k < pinkeys.size(); k++) {
+	    lseek = pins[pinkeys[k]];
+	    olabel = lseek->label;
+	    tmplist = (Genericlist *)lseek;
+	    for (endpt = cpoly->points.begin(); endpt < cpoly->points.begin()
+			  + EndPoint(cpoly->points.count()); endpt++) {
+	       endpt2 = endpt + NextPoint(cpoly->points.count());
+	       if (onsegment(endpt, endpt2, &olabel->position)) {
+
+		  if (resolved_net != NULL) {
+		     if (mergenets(pschem, resolved_net, tmplist))
+			resolved_net = tmplist;
+		  }
+		  if (resolved_net == NULL) {
+		     addpoly(cschem, cpoly, tmplist);
+		     resolved_net = tmplist;
+		  }
+	       }
+	    }
+	 }
+
+	 /* Check for attachment of each segment of this polygon */
+	 /* to endpoints of every recorded network polygon.      */
+
+	 nearpolys(pschem, cpoly->points.begin(), cpoly->points.count(),
+		  candidates);
+	 for (k = 0; k < candidates.size(); k++) {
+	    plist = candidates[k];
+	    if (plist->cschem != cschem) continue;
+	    else if ((tpoly = plist->poly) == cpoly) continue;
+	    tpt = tpoly->points.begin();
+	    tpt2 = tpoly->points.end() - 1;
+	    tmplist = (Genericlist *)plist;
+
+	    for (endpt = cpoly->points.begin(); endpt < cpoly->points.begin()
+			  + EndPoint(cpoly->points.count()); endpt++) {
+	       endpt2 = endpt + NextPoint(cpoly->points.count());
+
+	       if (onsegment(endpt, endpt2, tpt) ||
+			  onsegment(endpt, endpt2, tpt2)) {
+
+		  /* Nets previously counted distinct have    */
+		  /* been connected together by this polygon. */
+		  if (resolved_net != NULL) {
+		     if (mergenets(pschem, resolved_net, tmplist))
+			resolved_net = tmplist;
+		  }
+		  if (resolved_net == NULL) {
+		     addpoly(cschem, cpoly, tmplist);
+		     resolved_net = tmplist;
+		  }
+	       }
+	    }
+
+	    /* Check for attachment of the endpoints of this polygon */
+	    /* to each segment of every recorded network polygon.	   */
+
+	    endpt = cpoly->points.begin();
+	    endpt2 = cpoly->points.end() - 1;
+	    for (tpt = tpoly->points.begin(); tpt < tpoly->points.begin()
+		     + EndPoint(tpoly->points.count()); tpt++) {
+	       tpt2 = tpt + NextPoint(tpoly->points.count());
+
+	       if (onsegment(tpt, tpt2, endpt) ||
+			  onsegment(tpt, tpt2, endpt2)) {
+
+		  /* Nets previously counted distinct have    */
+		  /* been connected together by this polygon. */
+		  if (resolved_net != 0) {
+		     if (mergenets(pschem, resolved_net, tmplist))
+			resolved_net = tmplist;
+		  }
+		  if (resolved_net == 0) {
+		     addpoly(cschem, cpoly, tmplist);
+		     resolved_net = tmplist;
+		  }
+	       }
+	    }
+	 }
+	 if (resolved_net == 0) {
+
+	    /* This polygon belongs to an unvisited	*/
+	    /* network.  Give this polygon a new net	*/
+	    /* number and add to the net list.		*/
+
+	    newlist.net.id = nextnet++;
+	    addpoly(cschem, cpoly, &newlist);
+	 }
+      }
+   }
+   delete net_members;
+   net_members = NULL;
+
+   if (worker) {
+      netindex_active = false;
+      netindex_reset();
+   }
+   return nextnet;
+}
+
 /*----------------------------------------------------------------------*/
 /* Resolve nets and pins for the indicated object			*/
 /*									*/
@@ -533,26 +850,29 @@ int netmax(objectptr cschem)
 void gennetlist(objinstptr thisinst)
 {
    genericptr *cgen;
-   labelptr olabel, clab;
-   polyptr cpoly, tpoly;
+   labelptr clab;
    objectptr thisobject, callobj, cschem, pschem;
    objinstptr cinst, labinst;
    int old_parts;
    stringpart *cstr;
    bool visited;
 
-   XPoint *tpt, *tpt2, *endpt, *endpt2;
-   int i, j, n, nextnet, lbus;
+   int i, j, n, nextnet, lbus, numpages;
    buslist *sbus;
-   PolylistPtr plist;
    LabellistPtr lseek;
-   Genericlist *netlist, *tmplist, *buspins, *resolved_net, newlist;
+   Genericlist *netlist, *tmplist, *buspins, newlist;
 
    newlist.subnets = 0;
    newlist.net.id = -1;
 
-   /* Determine the type of object being netlisted */
+   /* Polygons of this object, or of its schematic, may still be	*/
+   /* being numbered on a worker thread.				*/
    thisobject = thisinst->thisobject;
+   finishnetjob(thisobject);
+   finishnetjob(thisobject->symschem);
+   libcache_materialize(thisobject);
+
+   /* Determine the type of object being netlisted */
    setobjecttype(thisobject);
 
    if (thisobject->schemtype == NONETWORK) return;
@@ -596,6 +916,21 @@ void gennetlist(objinstptr thisinst)
 
    nextnet = netmax(pschem) + 1;
 
+   /* Polygon numbering can be left to a worker thread only if one	*/
+   /* page is numbered here (see startnetjob()).			*/
+
+   numpages = 1;
+   if (pschem->schemtype == PRIMARY) {
+      numpages = 0;
+      for (j = 0; j < xobjs.pages; j++) {
+         cinst = xobjs.pagelist[j].pageinst;
+         if ((cinst != NULL) && ((cinst->thisobject == pschem) ||
+		((cinst->thisobject->schemtype == SECONDARY) &&
+		(cinst->thisobject->symschem == pschem))))
+	    numpages++;
+      }
+   }
+
    /* We start the loop for schematics but will modify the loop	*/
    /* variable to execute just once in the case of a symbol.	*/
    /* It's just not worth the trouble to turn this into a	*/
@@ -797,113 +1132,10 @@ void gennetlist(objinstptr thisinst)
 		cschem->schemtype == SECONDARY ||
 		(cschem->schemtype == SYMBOL && cschem->symschem == NULL))) {
 
-	 for (i = 0; i < old_parts; i++) {
-            cgen = cschem->begin() + i;
-            if (IS_POLYGON(*cgen)) {
- 	       cpoly = TOPOLY(cgen);
-
-	       /* Ignore non-network (closed, bbox, filled) polygons */
-	       if (nonnetwork(cpoly)) continue;
-
-	       resolved_net = (Genericlist *)NULL;
-
-	       /* Check for attachment of each segment of this polygon	*/
-	       /* to position of every recorded pin label.			*/
-
-	       for (lseek = pschem->labels; lseek != NULL; lseek = lseek->next) {
-		  if (lseek->cschem != cschem) continue;
-		  else if ((lseek->cinst != NULL) && (lseek->cinst != cinst))
-		     continue;
-		  olabel = lseek->label;
-		  tmplist = (Genericlist *)lseek;
-                  for (endpt = cpoly->points.begin(); endpt < cpoly->points.begin()
-                                + EndPoint(cpoly->points.count()); endpt++) {
-                     endpt2 = endpt + NextPoint(cpoly->points.count());
-		     if (onsegment(endpt, endpt2, &olabel->position)) {
-
-			if (resolved_net != NULL) {
-			   if (mergenets(pschem, resolved_net, tmplist))
-			      resolved_net = tmplist;
-		        }
-			if (resolved_net == NULL) {
-		           addpoly(cschem, cpoly, tmplist);
-			   resolved_net = tmplist;
-		        }
-		     }
-	          }
-	          /* if we've encountered a unique instance, then con-	*/
-	          /* tinue past all other instances using this label.	*/
-	          if (lseek->cinst != NULL)
-		     while (lseek->next && (lseek->next->label == lseek->label))
-		        lseek = lseek->next;
-	       }
-
-	       /* Check for attachment of each segment of this polygon */
-	       /* to endpoints of every recorded network polygon.      */
-
-	       for (plist = pschem->polygons; plist != NULL; plist = plist->next) { 
-		  if (plist->cschem != cschem) continue;
-	          else if ((tpoly = plist->poly) == cpoly) continue;
-                  tpt = tpoly->points.begin();
-                  tpt2 = tpoly->points.end() - 1;
-		  tmplist = (Genericlist *)plist;
-
-                  for (endpt = cpoly->points.begin(); endpt < cpoly->points.begin()
-                                + EndPoint(cpoly->points.count()); endpt++) {
-                     endpt2 = endpt + NextPoint(cpoly->points.count());
-
-		     if (onsegment(endpt, endpt2, tpt) ||
-				onsegment(endpt, endpt2, tpt2)) {
-
-		        /* Nets previously counted distinct have    */
-		        /* been connected together by this polygon. */
-			if (resolved_net != NULL) {
-			   if (mergenets(pschem, resolved_net, tmplist))
-		   	      resolved_net = tmplist;
-		        }
-		        if (resolved_net == NULL) {
-		           addpoly(cschem, cpoly, tmplist);
-		           resolved_net = tmplist;
-		        }
-		     }
-		  }
-
-	          /* Check for attachment of the endpoints of this polygon */
-	          /* to each segment of every recorded network polygon.	   */
-
-                  endpt = cpoly->points.begin();
-                  endpt2 = cpoly->points.end() - 1;
-                  for (tpt = tpoly->points.begin(); tpt < tpoly->points.begin()
-                           + EndPoint(tpoly->points.count()); tpt++) {
-                     tpt2 = tpt + NextPoint(tpoly->points.count());
-
-	     	     if (onsegment(tpt, tpt2, endpt) ||
-			   	onsegment(tpt, tpt2, endpt2)) {
-
-		        /* Nets previously counted distinct have    */
-		        /* been connected together by this polygon. */
-			if (resolved_net != 0) {
-			   if (mergenets(pschem, resolved_net, tmplist))
-		              resolved_net = tmplist;
-		        }
-		        if (resolved_net == 0) {
-		           addpoly(cschem, cpoly, tmplist);
-		           resolved_net = tmplist;
-		        }
-		     }
-	          }
-	       }
-	       if (resolved_net == 0) {
-
-	          /* This polygon belongs to an unvisited	*/
-	          /* network.  Give this polygon a new net	*/
-	          /* number and add to the net list.		*/
-
-		  newlist.net.id = nextnet++;
-	          addpoly(cschem, cpoly, &newlist);
-	       }
-	    }
-         }
+	 if (netjobs_active && (numpages == 1))
+	    startnetjob(cschem, pschem, cinst, old_parts, nextnet);
+	 else
+	    nextnet = gennetpolys(cschem, pschem, cinst, old_parts, nextnet);
       }
    }
 }
@@ -915,7 +1147,7 @@ void gennetlist(objinstptr thisinst)
 /*--------------------------------------------------------------*/
 
 void search_on_siblings(objinstptr cinst, objinstptr isib, pushlistptr schemtop,
-	short llx, short lly, short urx, short ury)
+	int llx, int lly, int urx, int ury)
 {
    pointlist tmppts;
    XPoint sbbox[2];
@@ -1050,7 +1282,7 @@ void gencalls(objectptr thisobject)
    objinstptr cinst, isib, callinst;
    objectptr callobj, callsymb, cschem, pschem;
    XPoint xpos;
-   short ibllx, iblly, iburx, ibury, sbllx, sblly, sburx, sbury;
+   int ibllx, iblly, iburx, ibury, sbllx, sblly, sburx, sbury;
    int i, j, k;
    labelptr olabel;
    polyptr tpoly;
@@ -1743,7 +1975,7 @@ labelptr new_global_pin(labelptr clabel, objinstptr cinst)
    newlabel = new label(GLOBAL, XPoint(0, 0));
    newlabel->justify = 0;
    newlabel->color = DEFAULTCOLOR;
-   free(newlabel->string);
+   freelabel(newlabel->string);
    newlabel->string = stringcopyall(clabel->string, cinst);
 
    /* Add label to the global netlist and return a pointer to	*/
@@ -1820,7 +2052,8 @@ int searchconnect(XPoint *points, int number, objinstptr cinst, int subnets)
    objectptr tobj, cobj = cinst->thisobject;
    LabellistPtr tseek;
    PolylistPtr pseek;
-   int i;
+   QVector<PolylistPtr> candidates;
+   int i, k;
    int found = 0;
 
    /* Generate temporary polygon in the coordinate system of	*/
@@ -1875,7 +2108,9 @@ int searchconnect(XPoint *points, int number, objinstptr cinst, int subnets)
 	 }
       }
 
-      for (pseek = cobj->polygons; pseek != NULL; pseek = pseek->next) {
+      nearpolys(cobj, endpt, (number == 1) ? 1 : 2, candidates);
+      for (k = 0; k < candidates.size(); k++) {
+	 pseek = candidates[k];
 	 tpoly = pseek->poly;
 
 	 /* Search for connections from segments passed to this	*/
@@ -1902,8 +2137,9 @@ int searchconnect(XPoint *points, int number, objinstptr cinst, int subnets)
    /* Search for connections from endpoints passed to this	*/
    /* function to segments of polygons in the netlist.		*/
 
-   for (pseek = cobj->polygons; pseek != NULL; pseek = pseek->next) {
-
+   nearends(cobj, endpt, endpt2, candidates);
+   for (k = 0; k < candidates.size(); k++) {
+      pseek = candidates[k];
       tpoly = pseek->poly;
       for (tpt = tpoly->points.begin(); tpt < tpoly->points.begin()
                         + EndPoint(tpoly->points.count()); tpt++) {
@@ -1961,6 +2197,9 @@ Genericlist *addpoly(objectptr cschem, polyptr poly, Genericlist *netlist)
    newpoly->next = pschem->polygons;
    pschem->polygons = newpoly;
 
+   if ((net_members != NULL) && (net_members->schem() == pschem))
+      net_members->add((Genericlist *)newpoly, false);
+
    return (Genericlist *)newpoly;
 }
 
@@ -2150,6 +2389,30 @@ bool mergenetlist(objectptr cschem, Genericlist *testlist,
 /* Attempts to merge different subnets in a bus are thwarted.		*/
 /*----------------------------------------------------------------------*/
 
+/*----------------------------------------------------------------------*/
+/* Because nets that have been merged away may be re-used later,	*/
+/* change the name of a temporary label to the new net number.		*/
+/*----------------------------------------------------------------------*/
+
+static void renametemppin(LabellistPtr llist, Genericlist *savenet,
+		Genericlist *newnet)
+{
+   int pinnet;
+   char *newtext;
+
+   if (llist->label->string->type != FONT_NAME) {
+      newtext = llist->label->string->data.string;
+      if (sscanf(newtext + 3, "%d", &pinnet) == 1) {
+	 if (pinnet == savenet->net.id) {
+	    *(newtext + 3) = '\0';
+	    llist->label->string->data.string = textprintnet(newtext,
+			NULL, newnet);
+	    free(newtext);
+	 }
+      }
+   }
+}
+
 bool netmerge(objectptr cschem, Genericlist *orignet, Genericlist *newnet)
 {
    PolylistPtr plist;
@@ -2157,13 +2420,28 @@ bool netmerge(objectptr cschem, Genericlist *orignet, Genericlist *newnet)
    CalllistPtr calls;
    PortlistPtr ports;
    Genericlist savenet;
+   QVector<LabellistPtr> merged;
    int i;
    buslist *obus, *nbus;
-   bool rval;
+   bool rval, bymembers;
 
    /* Trivial case; do nothing */
    if (match_buses(orignet, newnet, MATCH_EXACT)) return true;
 
+   /* Nets of the schematic being enumerated are relabeled by their	*/
+   /* tracked members, as long as only single nets are involved.	*/
+
+   bymembers = false;
+   if ((net_members != NULL) && (net_members->schem() == cschem)) {
+      if (net_members->valid() && (orignet->subnets == 0) &&
+		(newnet->subnets == 0))
+	 bymembers = true;
+      else {
+	 delete net_members;
+	 net_members = NULL;
+      }
+   }
+
    /* Disallow an attempt to convert a global net to a local net: */
    /* The global net ID always dominates!			  */
 
@@ -2172,6 +2450,10 @@ bool netmerge(objectptr cschem, Genericlist *orignet, Genericlist *newnet)
       int globnet = orignet->net.id;
       orignet->net.id = newnet->net.id;
       newnet->net.id = globnet;
+      if (bymembers) {
+	 net_members->moved(orignet, globnet);
+	 net_members->moved(newnet, orignet->net.id);
+      }
    }
 
    /* Check that the lists of changes are compatible.  It appears to be	*/
@@ -2203,31 +2485,22 @@ can_merge:
    copy_bus(&savenet, orignet);
 
    rval = false;
-   for (plist = cschem->polygons; plist != NULL; plist = plist->next)
-      if (mergenetlist(cschem, (Genericlist *)plist, &savenet, newnet))
-	 rval = true;
+   if (bymembers) {
+      rval = net_members->relabel(savenet.net.id, newnet->net.id, merged);
+      for (i = 0; i < merged.size(); i++)
+	 renametemppin(merged[i], &savenet, newnet);
+   }
+   else {
+      for (plist = cschem->polygons; plist != NULL; plist = plist->next)
+	 if (mergenetlist(cschem, (Genericlist *)plist, &savenet, newnet))
+	    rval = true;
 
-   for (llist = cschem->labels; llist != NULL; llist = llist->next)
-      if (mergenetlist(cschem, (Genericlist *)llist, &savenet, newnet)) {
-	 int pinnet;
-	 char *newtext;
-	 rval = true;
-
-	 /* Because nets that have been merged away may be re-used later, */
-	 /* change the name of any temporary labels to the new net number */
-
-	 if (llist->label->string->type != FONT_NAME) {
-	    newtext = llist->label->string->data.string;
-	    if (sscanf(newtext + 3, "%d", &pinnet) == 1) {
-	       if (pinnet == savenet.net.id) {
-		  *(newtext + 3) = '\0';
-		  llist->label->string->data.string = textprintnet(newtext,
-				NULL, newnet);
-		  free(newtext);
-	       }
-	    }
+      for (llist = cschem->labels; llist != NULL; llist = llist->next)
+	 if (mergenetlist(cschem, (Genericlist *)llist, &savenet, newnet)) {
+	    rval = true;
+	    renametemppin(llist, &savenet, newnet);
 	 }
-      }
+   }
 
    if (rval) {
 
@@ -2274,6 +2547,762 @@ bool mergenets(objectptr cschem, Genericlist *orignet, Genericlist *newnet)
    return merged;
 }
 
+/*----------------------------------------------------------------------*/
+/* Incremental netlist maintenance.					*/
+/*									*/
+/* Adding, moving or deleting network wires updates the netlist of the	*/
+/* schematic in place, rather than invalidating it:  an added wire	*/
+/* joins (and merges) the nets it touches, and a removed wire splits	*/
+/* its net into the pieces that remain connected, reassigning the	*/
+/* calls to instance pins on that net.  Whenever the change could reach	*/
+/* beyond the schematic's own nets---buses, global nets, nets that are	*/
+/* ports of the schematic, instance-dependent pins, or wires near	*/
+/* subcircuits whose connections are found by surveying their wires---	*/
+/* the netlist is invalidated and rebuilt as before.			*/
+/*									*/
+/* The edits are checked against full rebuilds by "xcircuit -checknets"	*/
+/* (see netlist_check()).  Compiling with NETLIST_DEBUG also checks	*/
+/* each incrementally maintained netlist against a full rebuild the	*/
+/* next time it is used.						*/
+/*----------------------------------------------------------------------*/
+
+/* The nets of a netlist, by member:  wires, named labels and the pins	*/
+/* of the calls (an instance and its port number).			*/
+
+typedef QHash<QPair<const void *, int>, int> NetPartition;
+
+static void netpartition(objectptr pschem, NetPartition &nets)
+{
+   PolylistPtr plist;
+   LabellistPtr llist;
+   CalllistPtr calls;
+   PortlistPtr ports;
+
+   nets.clear();
+   for (plist = pschem->polygons; plist != NULL; plist = plist->next)
+      nets.insert(qMakePair((const void *)plist->poly, -1),
+		(plist->subnets == 0) ? plist->net.id : 0);
+
+   /* Temporary pins are created as needed, and are not compared */
+   for (llist = pschem->labels; llist != NULL; llist = llist->next)
+      if ((llist->cinst == NULL) && (llist->label->string->type == FONT_NAME))
+	 nets.insert(qMakePair((const void *)llist->label, -1),
+		(llist->subnets == 0) ? llist->net.id : 0);
+
+   for (calls = pschem->calls; calls != NULL; calls = calls->next)
+      for (ports = calls->ports; ports != NULL; ports = ports->next)
+	 nets.insert(qMakePair((const void *)calls->callinst, ports->portid),
+		ports->netid);
+}
+
+/* True if two netlists divide the same members into the same nets,	*/
+/* however the nets are numbered.					*/
+
+static bool samenets(const NetPartition &before, const NetPartition &after)
+{
+   QHash<int, int> fwd, back;
+
+   if (before.size() != after.size()) return false;
+   for (NetPartition::const_iterator it = before.constBegin();
+		it != before.constEnd(); ++it) {
+      NetPartition::const_iterator found = after.constFind(it.key());
+      if (found == after.constEnd()) return false;
+
+      int oldid = it.value(), newid = found.value();
+      if ((fwd.contains(oldid) && (fwd.value(oldid) != newid)) ||
+		(back.contains(newid) && (back.value(newid) != oldid)))
+	 return false;
+      fwd.insert(oldid, newid);
+      back.insert(newid, oldid);
+   }
+   return true;
+}
+
+#ifdef NETLIST_DEBUG
+
+static QSet<objectptr> edited_nets;
+
+static void netcompare(objectptr pschem, NetPartition &before)
+{
+   NetPartition after;
+
+   netpartition(pschem, after);
+   if (!samenets(before, after))
+      Fprintf(stderr, "Netlist check:  incremental netlist of %s does not "
+		"match a full rebuild\n", pschem->name);
+}
+
+#endif /* NETLIST_DEBUG */
+
+static void noteedited(objectptr pschem)
+{
+#ifdef NETLIST_DEBUG
+   edited_nets.insert(pschem);
+#else
+   (void)pschem;
+#endif
+}
+
+/*----------------------------------------------------------------------*/
+/* Return the master schematic if the netlist of cschem exists and can	*/
+/* be updated in place, or NULL.					*/
+/*----------------------------------------------------------------------*/
+
+static objectptr editablenets(objectptr cschem)
+{
+   objectptr pschem;
+   PolylistPtr plist;
+   LabellistPtr llist;
+
+   if (!(cschem->schemtype == PRIMARY || cschem->schemtype == SECONDARY ||
+		(cschem->schemtype == SYMBOL && cschem->symschem == NULL)))
+      return NULL;
+
+   pschem = (cschem->schemtype == SECONDARY) ? cschem->symschem : cschem;
+   if (!pschem->valid) return NULL;
+
+   for (plist = pschem->polygons; plist != NULL; plist = plist->next)
+      if (plist->subnets != 0) return NULL;
+   for (llist = pschem->labels; llist != NULL; llist = llist->next)
+      if (llist->subnets != 0) return NULL;
+   if (pschem->symschem != NULL)
+      for (llist = pschem->symschem->labels; llist != NULL; llist = llist->next)
+	 if (llist->subnets != 0) return NULL;
+
+   return pschem;
+}
+
+/*----------------------------------------------------------------------*/
+/* The connection tests of gennetlist():  Each segment of one wire	*/
+/* against the endpoints of the other, and a wire against a point.	*/
+/*----------------------------------------------------------------------*/
+
+static bool wiretouches(polyptr wire, XPoint *pt)
+{
+   XPoint *endpt, *endpt2;
+
+   for (endpt = wire->points.begin(); endpt < wire->points.begin()
+		+ EndPoint(wire->points.count()); endpt++) {
+      endpt2 = endpt + NextPoint(wire->points.count());
+      if (onsegment(endpt, endpt2, pt)) return true;
+   }
+   return false;
+}
+
+static bool wirestouch(polyptr wire1, polyptr wire2)
+{
+   return (wiretouches(wire1, wire2->points.begin()) ||
+	wiretouches(wire1, wire2->points.end() - 1) ||
+	wiretouches(wire2, wire1->points.begin()) ||
+	wiretouches(wire2, wire1->points.end() - 1));
+}
+
+/*----------------------------------------------------------------------*/
+/* Check if a wire comes near an instance of an object that is its own	*/
+/* schematic (any such instance, if "wire" is NULL).  Connections into	*/
+/* such objects are found by searchconnect(), which leaves temporary	*/
+/* pins inside the object, so these are always rebuilt.			*/
+/*----------------------------------------------------------------------*/
+
+static bool nearsurvey(objectptr cschem, objectptr pschem, polyptr wire)
+{
+   genericptr *cgen;
+   objinstptr cinst;
+   objectptr callobj;
+   int ibllx, iblly, iburx, ibury;
+   int llx = 0, lly = 0, urx = 0, ury = 0, i;
+
+   if (wire != NULL) {
+      llx = urx = wire->points[0].x;
+      lly = ury = wire->points[0].y;
+      for (i = 1; i < wire->points.count(); i++) {
+	 llx = qMin(llx, (int)wire->points[i].x);
+	 urx = qMax(urx, (int)wire->points[i].x);
+	 lly = qMin(lly, (int)wire->points[i].y);
+	 ury = qMax(ury, (int)wire->points[i].y);
+      }
+      llx -= ONDIST;
+      lly -= ONDIST;
+      urx += ONDIST;
+      ury += ONDIST;
+   }
+
+   for (i = 0; i < cschem->parts; i++) {
+      cgen = cschem->begin() + i;
+      if (!IS_OBJINST(*cgen)) continue;
+      cinst = TOOBJINST(cgen);
+      callobj = (cinst->thisobject->symschem != NULL) ?
+		cinst->thisobject->symschem : cinst->thisobject;
+      if (callobj == pschem) continue;
+      if ((cinst->thisobject->symschem != NULL) ||
+		(callobj->schemtype == FUNDAMENTAL) ||
+		(callobj->schemtype == TRIVIAL))
+	 continue;
+      if (wire == NULL) return true;
+
+      calcinstbbox(cgen, &ibllx, &iblly, &iburx, &ibury);
+      if ((ibllx <= urx) && (iburx >= llx) && (iblly <= ury) && (ibury >= lly))
+	 return true;
+   }
+   return false;
+}
+
+static bool isportnet(objectptr pschem, int netid)
+{
+   PortlistPtr ports;
+
+   for (ports = pschem->ports; ports != NULL; ports = ports->next)
+      if (ports->netid == netid) return true;
+   return false;
+}
+
+static void renameportnet(objectptr pschem, int oldid, int newid)
+{
+   PortlistPtr ports;
+
+   for (ports = pschem->ports; ports != NULL; ports = ports->next)
+      if (ports->netid == oldid) ports->netid = newid;
+}
+
+/*----------------------------------------------------------------------*/
+/* Add a network wire of cschem to its netlist.  Returns false if the	*/
+/* netlist must be rebuilt instead.					*/
+/*----------------------------------------------------------------------*/
+
+static bool addwire(objectptr cschem, polyptr wire)
+{
+   objectptr pschem;
+   PolylistPtr plist;
+   LabellistPtr llist;
+   QVector<Genericlist *> touched;
+   Genericlist *netlist, newlist;
+   int i, j, portnets = 0;
+
+   if ((pschem = editablenets(cschem)) == NULL) return false;
+   if (nearsurvey(cschem, pschem, wire)) return false;
+
+   for (llist = pschem->labels; llist != NULL; llist = llist->next) {
+      if (llist->cschem != cschem) continue;
+      if (!wiretouches(wire, &llist->label->position)) continue;
+      if (llist->cinst != NULL) return false;
+      touched.append((Genericlist *)llist);
+   }
+   for (plist = pschem->polygons; plist != NULL; plist = plist->next) {
+      if (plist->poly == wire) return false;
+      if (plist->cschem != cschem) continue;
+      if (wirestouch(wire, plist->poly))
+	 touched.append((Genericlist *)plist);
+   }
+
+   /* A global net is shared with every other schematic */
+   for (i = 0; i < touched.size(); i++)
+      if (touched[i]->net.id < 0) return false;
+
+   /* Keep one entry per net */
+   for (i = 0; i < touched.size(); i++) {
+      for (j = 0; j < i; j++)
+	 if (touched[j]->net.id == touched[i]->net.id) break;
+      if (j < i) touched.remove(i--);
+      else if (isportnet(pschem, touched[i]->net.id)) portnets++;
+   }
+
+   /* Shorting two ports together changes the calls in the parents */
+   if (portnets > 1) return false;
+
+   if (touched.isEmpty()) {
+      newlist.subnets = 0;
+      newlist.net.id = netmax(pschem) + 1;
+      addpoly(cschem, wire, &newlist);
+   }
+   else {
+      netlist = addpoly(cschem, wire, touched[0]);
+      if (netlist == NULL) return false;
+      for (i = 1; i < touched.size(); i++) {
+	 int oldid = touched[i]->net.id, keepid = netlist->net.id;
+	 mergenets(pschem, touched[i], netlist);
+	 renameportnet(pschem, oldid, netlist->net.id);
+	 renameportnet(pschem, keepid, netlist->net.id);
+      }
+   }
+   return true;
+}
+
+/*----------------------------------------------------------------------*/
+/* Remove a network wire of cschem from its netlist, splitting its net	*/
+/* if the wire was the only connection between parts of it.  The wire	*/
+/* may have moved since it was entered in the netlist.  Wires in "skip"	*/
+/* are being removed as well, and are not counted as connections.	*/
+/* Returns false (with the netlist unchanged) if the netlist must be	*/
+/* rebuilt instead.							*/
+/*----------------------------------------------------------------------*/
+
+static int rootof(QVector<int> &parent, int i)
+{
+   while (parent[i] != i)
+      i = parent[i] = parent[parent[i]];
+   return i;
+}
+
+static void unite(QVector<int> &parent, int i, int j)
+{
+   parent[rootof(parent, i)] = rootof(parent, j);
+}
+
+static bool removewire(objectptr cschem, polyptr wire,
+		const QVector<polyptr> &skip)
+{
+   struct PortHit {
+      PortlistPtr port;
+      int member;
+   };
+
+   objectptr pschem, callsymb;
+   PolylistPtr plist, plast, entry;
+   LabellistPtr llist, slist;
+   CalllistPtr calls;
+   PortlistPtr ports;
+   QVector<PolylistPtr> polys;
+   QVector<LabellistPtr> labels;
+   QVector<PortHit> hits;
+   QVector<int> parent, netids;
+   Genericlist oldnet;
+   XPoint xpos;
+   int netid, childnet, nextnet, first, np, i, j;
+
+   if ((pschem = editablenets(cschem)) == NULL) return false;
+
+   plast = NULL;
+   for (entry = pschem->polygons; entry != NULL; entry = entry->next) {
+      if (entry->poly == wire) break;
+      plast = entry;
+   }
+   if (entry == NULL) return false;
+
+   netid = entry->net.id;
+   if (netid < 0) return false;
+   if (isportnet(pschem, netid)) return false;
+   if (pschem->symschem != NULL)
+      for (llist = pschem->symschem->labels; llist != NULL; llist = llist->next)
+	 if (llist->net.id == netid) return false;
+   if (nearsurvey(cschem, pschem, NULL)) return false;
+
+   /* Gather what remains of the net */
+
+   for (plist = pschem->polygons; plist != NULL; plist = plist->next)
+      if ((plist != entry) && (plist->net.id == netid) &&
+		!skip.contains(plist->poly))
+	 polys.append(plist);
+   for (llist = pschem->labels; llist != NULL; llist = llist->next)
+      if (llist->net.id == netid) {
+	 if ((llist->cinst != NULL) || (llist->label->pin == GLOBAL))
+	    return false;
+	 labels.append(llist);
+      }
+
+   np = polys.size();
+   parent.resize(np + labels.size());
+   for (i = 0; i < parent.size(); i++) parent[i] = i;
+
+   /* Connections by position, as made by gennetlist() */
+
+   for (i = 0; i < np; i++) {
+      for (j = i + 1; j < np; j++)
+	 if ((polys[i]->cschem == polys[j]->cschem) &&
+		wirestouch(polys[i]->poly, polys[j]->poly))
+	    unite(parent, i, j);
+      for (j = 0; j < labels.size(); j++)
+	 if ((polys[i]->cschem == labels[j]->cschem) &&
+		wiretouches(polys[i]->poly, &labels[j]->label->position))
+	    unite(parent, i, np + j);
+   }
+
+   /* Connections between labels by position, and by name */
+
+   for (i = 0; i < labels.size(); i++)
+      for (j = i + 1; j < labels.size(); j++) {
+	 if ((labels[i]->cschem == labels[j]->cschem) &&
+		proximity(&labels[i]->label->position, &labels[j]->label->position))
+	    unite(parent, np + i, np + j);
+	 else if ((labels[i]->label->string->type == FONT_NAME) &&
+		(labels[j]->label->string->type == FONT_NAME) &&
+		!stringcomprelaxed(labels[i]->label->string,
+		labels[j]->label->string, NULL))
+	    unite(parent, np + i, np + j);
+      }
+
+   /* Connections through the pins of called instances.  Every pin	*/
+   /* on the net must still find a wire or label at its position.	*/
+
+   for (calls = pschem->calls; calls != NULL; calls = calls->next) {
+      for (ports = calls->ports; ports != NULL; ports = ports->next) {
+	 if (ports->netid != netid) continue;
+	 childnet = porttonet(calls->callobj, ports->portid);
+	 callsymb = calls->callinst->thisobject;
+	 first = -1;
+	 for (slist = callsymb->labels; slist != NULL; slist = slist->next) {
+	    if (slist->cschem != callsymb) continue;
+	    else if ((slist->cinst != NULL) && (slist->cinst != calls->callinst))
+	       continue;
+	    if (slist->subnets != 0) return false;
+	    if (slist->net.id != childnet) continue;
+
+	    UTransformPoints(&(slist->label->position), &xpos, 1,
+			calls->callinst->position, calls->callinst->scale,
+			calls->callinst->rotation);
+	    for (i = 0; i < parent.size(); i++) {
+	       if (i < np) {
+		  if ((polys[i]->cschem != calls->cschem) ||
+			!wiretouches(polys[i]->poly, &xpos))
+		     continue;
+	       }
+	       else if ((labels[i - np]->cschem != calls->cschem) ||
+			!proximity(&labels[i - np]->label->position, &xpos))
+		  continue;
+	       if (first < 0) first = i;
+	       else unite(parent, first, i);
+	    }
+	 }
+	 if (first < 0) return false;
+	 hits.append(PortHit());
+	 hits.last().port = ports;
+	 hits.last().member = first;
+      }
+   }
+
+   /* Commit:  drop the wire, then number the pieces.  The piece	*/
+   /* holding the first remaining member keeps the net ID.		*/
+
+   if (plast == NULL)
+      pschem->polygons = entry->next;
+   else
+      plast->next = entry->next;
+   delete entry;
+
+   nextnet = netmax(pschem) + 1;
+   netids.fill(0, parent.size());
+   for (i = 0; i < parent.size(); i++) {
+      j = rootof(parent, i);
+      if (netids[j] == 0)
+	 netids[j] = (j == rootof(parent, 0)) ? netid : nextnet++;
+   }
+
+   oldnet.subnets = 0;
+   oldnet.net.id = netid;
+   for (i = 0; i < np; i++)
+      polys[i]->net.id = netids[rootof(parent, i)];
+   for (i = 0; i < labels.size(); i++) {
+      labels[i]->net.id = netids[rootof(parent, np + i)];
+      if (labels[i]->net.id != netid)
+	 renametemppin(labels[i], &oldnet, (Genericlist *)labels[i]);
+   }
+   for (i = 0; i < hits.size(); i++)
+      hits[i].port->netid = netids[rootof(parent, hits[i].member)];
+
+   return true;
+}
+
+/*----------------------------------------------------------------------*/
+/* A network wire has been added to object cschem			*/
+/*----------------------------------------------------------------------*/
+
+void add_netlist_wire(objectptr cschem, polyptr wire)
+{
+   if (nonnetwork(wire)) return;
+   if (addwire(cschem, wire))
+      noteedited((cschem->schemtype == SECONDARY) ? cschem->symschem : cschem);
+   else
+      invalidate_netlist(cschem);
+}
+
+/*----------------------------------------------------------------------*/
+/* Collect the network wires in the selection.  Returns false if the	*/
+/* selection holds anything else relevant to the netlist (see		*/
+/* select_invalidate_netlist()).					*/
+/*----------------------------------------------------------------------*/
+
+static bool selectwires(QVector<polyptr> &wires)
+{
+   int i;
+
+   for (i = 0; i < areawin->selects; i++) {
+      genericptr gptr = SELTOGENERIC(areawin->selectlist + i);
+      switch (gptr->type) {
+	 case POLYGON:
+	    if (!nonnetwork(TOPOLY(&gptr)))
+	       wires.append(TOPOLY(&gptr));
+	    break;
+	 case LABEL:
+            if ((TOLABEL(&gptr))->pin == LOCAL || (TOLABEL(&gptr))->pin == GLOBAL)
+	       return false;
+	    break;
+	 case OBJINST:
+	    if ((TOOBJINST(&gptr))->thisobject->schemtype != NONETWORK)
+	       return false;
+	    break;
+      }
+   }
+   return true;
+}
+
+/*----------------------------------------------------------------------*/
+/* The selected elements are about to be deleted.			*/
+/*----------------------------------------------------------------------*/
+
+void select_remove_netlist()
+{
+   QVector<polyptr> wires;
+   int i;
+
+   if (!selectwires(wires)) {
+      select_invalidate_netlist();
+      return;
+   }
+   for (i = 0; i < wires.size(); i++) {
+      if (!removewire(topobject, wires[i], wires)) {
+	 invalidate_netlist(topobject);
+	 return;
+      }
+   }
+   if (wires.size() > 0)
+      noteedited((topobject->schemtype == SECONDARY) ? topobject->symschem :
+		topobject);
+}
+
+/*----------------------------------------------------------------------*/
+/* The selected elements have been moved.				*/
+/*----------------------------------------------------------------------*/
+
+void select_move_netlist()
+{
+   QVector<polyptr> wires;
+   int i;
+
+   if (!selectwires(wires)) {
+      select_invalidate_netlist();
+      return;
+   }
+   for (i = 0; i < wires.size(); i++) {
+      if (!removewire(topobject, wires[i], wires)) {
+	 invalidate_netlist(topobject);
+	 return;
+      }
+   }
+   for (i = 0; i < wires.size(); i++) {
+      if (!addwire(topobject, wires[i])) {
+	 invalidate_netlist(topobject);
+	 return;
+      }
+   }
+   if (wires.size() > 0)
+      noteedited((topobject->schemtype == SECONDARY) ? topobject->symschem :
+		topobject);
+}
+
+/*----------------------------------------------------------------------*/
+/* "xcircuit -checknets <file>":  check the in-place netlist edits	*/
+/* against full rebuilds.  Each network wire of each schematic page is	*/
+/* taken out of the netlist as if deleted, and the result compared	*/
+/* with the netlist built without the wire;  the wire is then put back	*/
+/* as if drawn again, and the result compared with the netlist built	*/
+/* with it.  Edits which fall back to a rebuild are counted, but there	*/
+/* is nothing to compare.  Returns nonzero on failure.			*/
+/*----------------------------------------------------------------------*/
+
+static bool checkedit(objinstptr pageinst, objectptr pschem, polyptr wire,
+		const char *what)
+{
+   NetPartition edited, rebuilt;
+
+   netpartition(pschem, edited);
+   invalidate_netlist(pageinst->thisobject);
+   updatenets(pageinst, true);
+   netpartition(pschem, rebuilt);
+   if (samenets(edited, rebuilt)) return true;
+
+   Fprintf(stderr, "%s: netlist after %s the wire at (%d, %d) does not "
+		"match a full rebuild\n", pageinst->thisobject->name, what,
+		wire->points[0].x, wire->points[0].y);
+   return false;
+}
+
+int netlist_check(const QString &name)
+{
+   QVector<polyptr> wires, none;
+   objinstptr pageinst;
+   objectptr cschem, pschem;
+   int page, i, edits = 0, rebuilds = 0, failed = 0;
+
+   if (!loadfile(0, -1, name)) {
+      Fprintf(stderr, "Cannot read %s\n", name.toLocal8Bit().data());
+      return 1;
+   }
+
+   for (page = 0; page < xobjs.pages; page++) {
+      pageinst = xobjs.pagelist[page].pageinst;
+      if (pageinst == NULL) continue;
+      cschem = pageinst->thisobject;
+      if ((cschem->schemtype != PRIMARY) && (cschem->schemtype != SECONDARY))
+	 continue;
+      pschem = (cschem->schemtype == SECONDARY) ? cschem->symschem : cschem;
+      if (updatenets(pageinst, true) <= 0) continue;
+
+      wires.clear();
+      for (polyiter cpoly; cschem->values(cpoly); )
+	 if (!nonnetwork(cpoly)) wires.append(cpoly);
+
+      for (i = 0; i < wires.size(); i++) {
+	 if (!removewire(cschem, wires[i], none)) {
+	    rebuilds++;
+	    continue;
+	 }
+	 edits++;
+
+	 /* The rebuild leaves out the wire while it is marked as a	*/
+	 /* bounding box.						*/
+	 wires[i]->style |= BBOX;
+	 if (!checkedit(pageinst, pschem, wires[i], "deleting")) failed = 1;
+	 wires[i]->style &= ~BBOX;
+
+	 if (addwire(cschem, wires[i])) {
+	    edits++;
+	    if (!checkedit(pageinst, pschem, wires[i], "drawing")) failed = 1;
+	 }
+	 else {
+	    rebuilds++;
+	    invalidate_netlist(cschem);
+	    updatenets(pageinst, true);
+	 }
+      }
+   }
+
+   Fprintf(stdout, "%d wire edits checked, %d left to a rebuild\n", edits,
+		rebuilds);
+   Fprintf(stdout, "netlist check %s\n", failed ? "failed" : "passed");
+   return failed;
+}
+
+/*----------------------------------------------------------------------*/
+/* "xcircuit -benchnets <file>":  time full builds of the netlist of	*/
+/* each schematic page of the file, as a measure of netlist		*/
+/* throughput to compare between builds.				*/
+/*----------------------------------------------------------------------*/
+
+#define NETLIST_BENCHRUNS	20
+
+int netlist_benchmark(const QString &name)
+{
+   QElapsedTimer timer;
+   objinstptr pageinst;
+   objectptr cschem;
+   double total = 0.0, ms;
+   int page, i;
+
+   if (!loadfile(0, -1, name)) {
+      Fprintf(stderr, "Cannot read %s\n", name.toLocal8Bit().data());
+      return 1;
+   }
+
+   for (page = 0; page < xobjs.pages; page++) {
+      pageinst = xobjs.pagelist[page].pageinst;
+      if (pageinst == NULL) continue;
+      cschem = pageinst->thisobject;
+      if ((cschem->schemtype != PRIMARY) && (cschem->schemtype != SECONDARY))
+	 continue;
+      if (updatenets(pageinst, true) <= 0) continue;	/* read cells */
+
+      timer.start();
+      for (i = 0; i < NETLIST_BENCHRUNS; i++) {
+	 invalidate_netlist(cschem);
+	 updatenets(pageinst, true);
+      }
+      ms = timer.nsecsElapsed() / (1.0e6 * NETLIST_BENCHRUNS);
+      total += ms;
+      Fprintf(stdout, "%s (%d elements): %.2f ms per netlist\n",
+		cschem->name, cschem->parts, ms);
+   }
+   Fprintf(stdout, "all pages: %.2f ms per netlist\n", total);
+   return 0;
+}
+
+/*----------------------------------------------------------------------*/
+/* "xcircuit -checknetjobs <file>":  check that numbering the nets of	*/
+/* subcircuits on the thread pool gives the same netlist as numbering	*/
+/* them one after another.  The netlist of each top-level schematic	*/
+/* page is built serially and written out in each of a few formats,	*/
+/* then built again with jobs and written again, and the two files of	*/
+/* each format must be the same byte for byte.  Returns nonzero on	*/
+/* failure.								*/
+/*----------------------------------------------------------------------*/
+
+static QByteArray jobnetlist(objinstptr pageinst, const char *mode,
+		bool jobs)
+{
+   objectptr cschem = pageinst->thisobject;
+   QByteArray text;
+   char *cpos, suffix[32];
+
+   netjobs_allowed = jobs;
+   invalidate_netlist(cschem);
+   updatenets(pageinst, true);
+   sprintf(suffix, "%s.%s", jobs ? "jobs" : "serial", mode);
+   writenet(cschem, mode, suffix);
+   netjobs_allowed = true;
+
+   /* as named by writenet() */
+   if ((cpos = strchr(cschem->name, ':')) != NULL) *cpos = '\0';
+   QFile file(QFile::decodeName(cschem->name) + "." + suffix);
+   if (cpos != NULL) *cpos = ':';
+
+   if (file.open(QIODevice::ReadOnly)) {
+      text = file.readAll();
+      file.close();
+      file.remove();
+   }
+   return text;
+}
+
+int netlist_jobcheck(const QString &name)
+{
+   static const char *modes[] = {"spice", "flatspice", "flatsim", NULL};
+   QByteArray serial, jobs;
+   objinstptr pageinst;
+   objectptr cschem;
+   int page, i, compared = 0, failed = 0;
+
+   if (!loadfile(0, -1, name)) {
+      Fprintf(stderr, "Cannot read %s\n", name.toLocal8Bit().data());
+      return 1;
+   }
+
+   for (page = 0; page < xobjs.pages; page++) {
+      pageinst = xobjs.pagelist[page].pageinst;
+      if (pageinst == NULL) continue;
+      cschem = pageinst->thisobject;
+      if (cschem->schemtype != PRIMARY) continue;
+      if (updatenets(pageinst, true) <= 0) continue;
+
+      for (i = 0; modes[i] != NULL; i++) {
+	 serial = jobnetlist(pageinst, modes[i], false);
+	 jobs = jobnetlist(pageinst, modes[i], true);
+	 if (serial.isEmpty()) {
+	    Fprintf(stderr, "%s: no %s netlist written\n", cschem->name,
+			modes[i]);
+	    failed = 1;
+	 }
+	 else if (serial != jobs) {
+	    Fprintf(stderr, "%s: %s netlist built with jobs differs from "
+			"the serial build\n", cschem->name, modes[i]);
+	    failed = 1;
+	 }
+	 else compared++;
+      }
+   }
+
+   Fprintf(stdout, "%d netlists compared\n", compared);
+   Fprintf(stdout, "netlist job check %s\n", failed ? "failed" : "passed");
+   return failed;
+}
+
 /*----------------------------------------------------------------------*/
 /* Remove a call to an object instance from the call list of cschem	*/
 /*----------------------------------------------------------------------*/
@@ -2368,6 +3397,10 @@ Genericlist *addpin(objectptr cschem, objinstptr cinst, labelptr pin,
       newlabel->next = pschem->labels;
       pschem->labels = newlabel;
    }
+
+   if ((net_members != NULL) && (net_members->schem() == pschem))
+      net_members->add((Genericlist *)newlabel, true);
+
    return (Genericlist *)newlabel;
 }
 		
@@ -2403,6 +3436,10 @@ Genericlist *addglobalpin(objectptr cschem, objinstptr cinst, labelptr pin,
       lastlabel = srchlab;
    }
 
+   /* Polygon numbering jobs look up global nets by label (through	*/
+   /* netmerge()), so none may be running while the list changes.	*/
+   finishnetjobs();
+
    /* Create a new entry and link to label list of the object */
 	 
    newlabel = new Labellist;
@@ -2672,6 +3709,8 @@ Genericlist *pointtonet(objectptr cschem, objinstptr cinst, XPoint *testpoint)
    LabellistPtr plab;
    Genericlist *preturn;
    objectptr pschem;	/* primary schematic */
+   QVector<PolylistPtr> candidates;
+   int i;
 
    /* cschem is the object containing the point.  However, if the object */
    /* is a secondary schematic, the netlist is located in the master.	 */
@@ -2698,7 +3737,9 @@ Genericlist *pointtonet(objectptr cschem, objinstptr cinst, XPoint *testpoint)
    /* merged together.							*/
 
    preturn = (Genericlist *)NULL;
-   for (ppoly = pschem->polygons; ppoly != NULL; ppoly = ppoly->next) {
+   nearpolys(pschem, testpoint, 1, candidates);
+   for (i = 0; i < candidates.size(); i++) {
+      ppoly = candidates[i];
       if (ppoly->cschem != cschem) continue;
       for (tpt = ppoly->poly->points.begin(); tpt < ppoly->poly->points.begin()
                 + EndPoint(ppoly->poly->points.count()); tpt++) {
@@ -5145,6 +6186,18 @@ int updatenets(objinstptr uinst, bool quiet) {
       thisinst = uinst;
    }
 
+#ifdef NETLIST_DEBUG
+   NetPartition edited;
+   bool checkedits = edited_nets.remove(thisobject) &&
+		(checkvalid(thisobject) != -1);
+
+   /* Force a full rebuild, to be compared with the netlist as edited */
+   if (checkedits) {
+      netpartition(thisobject, edited);
+      thisobject->valid = false;
+   }
+#endif
+
    if (checkvalid(thisobject) == -1) {
       uselection *ssave;
 
@@ -5166,6 +6219,10 @@ int updatenets(objinstptr uinst, bool quiet) {
       }
    }
 
+#ifdef NETLIST_DEBUG
+   if (checkedits) netcompare(thisobject, edited);
+#endif
+
    if (thisobject->labels == NULL && thisobject->polygons == NULL) {
       if (quiet == false)
          Wprintf("Netlist error:  No netlist elements in object %s",
@@ -5556,7 +6613,7 @@ bool writepcb(struct Ptab **ptableptr, objectptr cschem, CalllistPtr cfrom,
 	    /* Get the pin name from the equation LHS */ 
 	    if (psrch == NULL) {
                tmpstr = new Pstr;
-	       tmpstr->string = (stringpart *)malloc(sizeof(stringpart));
+	       tmpstr->string = new stringpart;
 	       tmpstr->string->type = TEXT_STRING;
 	       tmpstr->string->nextpart = NULL;
 	       tmpstr->string->data.string = tmppinname;
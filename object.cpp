@@ -1,5 +1,7 @@
 #include "xcircuit.h"
 #include "prototypes.h"
+#include "spatial.h"
+#include "glyph.h"
 
 void object::set_defaults()
 {
@@ -12,6 +14,8 @@ void object::set_defaults()
         params = ops->next;
         delete ops;
     }
+    subst.inst = NULL;
+    subst.generation = -1;
     viewscale = 0.5;
 
     /* Object should not reference the window:  this needs to be rethunk! */
@@ -35,11 +39,16 @@ void object::set_defaults()
     calls = NULL;
     valid = false;
     traversed = false;
+    spatial_invalidate(this);
+    glyph_invalidate(this);
 }
 
 object::object() :
         Plist(),
-        params(NULL)
+        params(NULL),
+        spatial(NULL),
+        glyph(NULL),
+        lazy(NULL)
 {
     set_defaults();
 }
@@ -47,10 +56,14 @@ object::object() :
 object::~object()
 {
     clear();
+    delete spatial;
+    delete glyph;
+    lod_forget(this);
 }
 
 void object::clear() // replaces reset(this, NORMAL); use delete object to replace reset(this, DELETE)
 {
+    libcache_release(this);
     if (polygons != NULL || labels != NULL)
        destroynets(this);
 
@@ -79,10 +92,8 @@ bool object::operator ==(const object & other) const
 {
     const object *obja = this, *objb = &other;
 
-    const genericptr *compgen;
-    genericptr *glist, *gchk, *remg;
-    short      csize;
-    bool    bres;
+    genericptr agen;
+    int        i, j;
 
     /* quick check on equivalence of number of objects */
 
@@ -118,26 +129,25 @@ bool object::operator ==(const object & other) const
 
     /* For the exhaustive check we must match component for component. */
     /* Best not to assume that elements are in same order for both.    */
-
-    csize = obja->parts;
-
-    glist = new genericptr[csize];
-    std::copy(objb->begin(), objb->begin() + csize, glist);
-    for (compgen = 0; obja->values(compgen); ) {
-       bres = false;
-       for (gchk = glist; gchk < glist + csize; gchk++) {
-          if ((*compgen)->color == (*gchk)->color)
-             bres = **compgen == **gchk;
-          if (bres) {
-            csize--;
-            for (remg = gchk; remg < glist + csize; remg++)
-                *remg = *(remg + 1);
-            break;
-          }
+    /* They usually are, so the element in the same place is tried	*/
+    /* first, and the rest are searched only if it does not match.	*/
+
+    QVector<bool> matched(objb->parts, false);
+
+    for (i = 0; i < obja->parts; i++) {
+       agen = obja->at(i);
+       if (!matched[i] && (agen->color == objb->at(i)->color) &&
+		(*agen == *objb->at(i)))
+          j = i;
+       else {
+          for (j = 0; j < objb->parts; j++)
+             if (!matched[j] && (agen->color == objb->at(j)->color) &&
+			(*agen == *objb->at(j)))
+                break;
+          if (j == objb->parts) return false;
        }
+       matched[j] = true;
     }
-    delete [] glist;
-    if (csize != 0) return false;
 
     /* Both objects cannot attempt to set an associated schematic/symbol to  */
     /* separate objects, although it is okay for one to make the association */
@@ -155,7 +165,7 @@ bool object::operator ==(const object & other) const
 /* Returns the number (position in plist) or -1 if not found */
 /*-----------------------------------------------------------*/
 
-short object::find(objectptr other) const
+int object::find(objectptr other) const
 {
    for (objinstiter inst; values(inst); ) {
        if (inst->thisobject == other || inst->thisobject->find(other) >= 0)
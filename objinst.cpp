@@ -1,3 +1,5 @@
+#include <cmath>
+
 #include "elements.h"
 #include "xcircuit.h"
 #include "prototypes.h"
@@ -5,6 +7,7 @@
 #include "colors.h"
 #include "context.h"
 #include "matrix.h"
+#include "spatial.h"
 
 objinst::objinst() :
         positionable(OBJINST),
@@ -65,6 +68,7 @@ objinst & objinst::operator=(const objinst & src)
 {
     if (&src == this) return *this;
     positionable::operator=(src);
+    libcache_materialize(src.thisobject);
     position = src.position;
     rotation = src.rotation;
     scale = src.scale;
@@ -120,6 +124,46 @@ void objinst::doGetBbox(XPoint * npoints, float scale, int extend, objinst *) co
    UTransformPoints(points, npoints, 4, position, scale, rotation);
 }
 
+/*----------------------------------------------------------------------*/
+/* For objects with many elements, find the elements which may be	*/
+/* visible in the area being drawn, in drawing order.  Returns false	*/
+/* if all elements should be drawn.					*/
+/*----------------------------------------------------------------------*/
+
+static bool visibleparts(DrawContext* ctx, objectptr theobject, QVector<int> &vparts)
+{
+   SpatialIndex *sidx;
+   QTransform ictm;
+   QRectF area;
+   float margin;
+   bool ok;
+
+   /* The index of the object being edited is only kept current	*/
+   /* while elements are being moved.				*/
+
+   if ((theobject == topobject) && (eventmode != NORMAL_MODE) &&
+		(eventmode != MOVE_MODE) && (eventmode != COPY_MODE) &&
+		(eventmode != CATMOVE_MODE))
+      return false;
+
+   ictm = ctx->CTM().inverted(&ok);
+   if (!ok) return false;
+
+   QMutexLocker lock(&drawlock);
+   if ((sidx = spatial_index(theobject)) == NULL) return false;
+   area = ictm.mapRect(QRectF(ctx->clipRect()));
+
+   /* element bounding boxes do not include the line width */
+   margin = sidx->maxwidth() * xobjs.pagelist[areawin->page].wirewidth + 1;
+   area.adjust(-margin, -margin, margin, margin);
+
+   sidx->query((int)qBound(-(qreal)MAXCOORD, floor(area.left()), (qreal)MAXCOORD),
+		(int)qBound(-(qreal)MAXCOORD, floor(area.top()), (qreal)MAXCOORD),
+		(int)qBound(-(qreal)MAXCOORD, ceil(area.right()), (qreal)MAXCOORD),
+		(int)qBound(-(qreal)MAXCOORD, ceil(area.bottom()), (qreal)MAXCOORD), vparts);
+   return true;
+}
+
 /*----------------------------------------------------------------------*/
 /* Main recursive object instance drawing routine.			*/
 /*    context is the instance information passed down from above	*/
@@ -134,17 +178,9 @@ void UDrawObject(DrawContext* ctx, objinstptr theinstance, short level, int pass
    float	tmpwidth;
    int		defaultcolor = passcolor;
    int		curcolor = passcolor;
-   short	savesel;
    XPoint 	bboxin[2], bboxout[2];
-   u_char	xm, ym;
    objectptr	theobject = theinstance->thisobject;
 
-   /* Save the number of selections and set it to zero while we do the	*/
-   /* object drawing.							*/
-
-   savesel = areawin->selects;
-   areawin->selects = 0;
-
    /* All parts are given in the coordinate system of the object, unless */
    /* this is the top-level object, in which they will be interpreted as */
    /* relative to the screen.						 */
@@ -166,14 +202,22 @@ void UDrawObject(DrawContext* ctx, objinstptr theinstance, short level, int pass
       extendschembbox(theinstance, &(bboxin[0]), &(bboxin[1]));
    ctx->CTM().transform(bboxin, bboxout, 2);
 
-   xm = (bboxout[0].x < bboxout[1].x) ? 0 : 1;
-   ym = (bboxout[0].y < bboxout[1].y) ? 0 : 1;
+   /* instances too small to make out are drawn in less detail, and	*/
+   /* symbols used over and over are copied from a sprite		*/
 
-   if (bboxout[xm].x < areawin->width() && bboxout[ym].y < areawin->height() &&
-       bboxout[1 - xm].x > 0 && bboxout[1 - ym].y > 0) {
+   if (ctx->visible(bboxout) && ((level == 0) || (!lod_draw(ctx, theinstance, passcolor)
+		&& !sprite_draw(ctx, theinstance, level, passcolor)))) {
 
-     /* make parameter substitutions */
+     /* Library objects are read from the cache on first use, and	*/
+     /* parameter values are substituted into the object's elements,	*/
+     /* under the draw lock.  The elements of an object with		*/
+     /* parameters hold this instance's values only until another	*/
+     /* instance is drawn, so the lock is kept until it is done.	*/
+
+     QMutexLocker lock(&drawlock);
+     libcache_materialize(theobject);
      psubstitute(theinstance);
+     if (theobject->params == NULL) lock.unlock();
 
      /* draw all of the elements */
 
@@ -181,10 +225,23 @@ void UDrawObject(DrawContext* ctx, objinstptr theinstance, short level, int pass
      SetLineAttributes(ctx->gc(), tmpwidth, LineSolid, CapRound,
                 JoinBevel);
 
+     /* on large objects, only visit elements near the drawing area */
+
+     QVector<int> &vparts = ctx->parts();
+     bool culled = visibleparts(ctx, theobject, vparts);
+     int vnext = 0;
+
      /* guard against plist being regenerated during a redraw by the	*/
      /* expression parameter mechanism (should that be prohibited?)	*/
 
-     for (areagen = 0; theobject->values(areagen); ) {
+     for (areagen = 0; ; ) {
+       if (culled) {
+          if ((vnext >= vparts.size()) || (vparts[vnext] >= theobject->parts))
+             break;
+          areagen = theobject->begin() + vparts[vnext++];
+       }
+       else if (!theobject->values(areagen))
+          break;
 
        if (defaultcolor != DOFORALL) {
           if ((*areagen)->color != curcolor) {
@@ -215,11 +272,14 @@ void UDrawObject(DrawContext* ctx, objinstptr theinstance, short level, int pass
                 }
                 if ((!alist) || (!blist)) break;
              }
-             UDrawObject(ctx, TOOBJINST(areagen), level + 1, curcolor, stack);
+             if (level < HIERARCHY_LIMIT)
+                UDrawObject(ctx, TOOBJINST(areagen), level + 1, curcolor, stack);
              break;
 
           case(LABEL):
-             if (level == 0 || TOLABEL(areagen)->pin == false)
+             if (lod_labelhidden(ctx, TOLABEL(areagen)))
+                break;
+             else if (level == 0 || TOLABEL(areagen)->pin == false)
                 UDrawString(ctx, TOLABEL(areagen), curcolor, theinstance);
              else if ((TOLABEL(areagen)->justify & PINVISIBLE) && areawin->pinpointon)
                 UDrawString(ctx, TOLABEL(areagen), curcolor, theinstance);
@@ -243,8 +303,6 @@ void UDrawObject(DrawContext* ctx, objinstptr theinstance, short level, int pass
      }
    }
 
-   /* restore the selection list (if any) */
-   areawin->selects = savesel;
    ctx->UPopCTM();
    if (stack) pop_stack(stack);
 }
@@ -9,6 +9,8 @@
 /*----------------------------------------------------------------------*/
 
 #include <QAction>
+#include <QByteArray>
+#include <QHash>
 
 #include <cstdio>
 #include <cstdlib>
@@ -55,11 +57,6 @@ static u_char param_select[] = {
 
 static QAction *param_buttons[15];
 
-/*----------------------------------------------------------------------*/
-/* Basic routines for matching parameters by key values.  Note that	*/
-/* this really, really ought to be replaced by a hash table search!	*/
-/*----------------------------------------------------------------------*/
-
 void param_init()
 {
     param_buttons[0] = menuAction("Parameters_Numeric");   /* P_NUMERIC */
@@ -79,6 +76,51 @@ void param_init()
     param_buttons[14] = menuAction("Parameters_Position");  /* P_POSITION */
 }
 
+/*----------------------------------------------------------------------*/
+/* Basic routines for matching parameters by key values.  Every key	*/
+/* string is interned as a small integer, so that parameter lists are	*/
+/* indexed by integer, and element parameters (which keep the ID of	*/
+/* their key) are matched without comparing strings.			*/
+/*----------------------------------------------------------------------*/
+
+static QHash<QByteArray, int> paramkeys;
+
+u_int ParamList::stamps = 0;
+
+int paramkeyid(const char *key)
+{
+   QByteArray rawkey = QByteArray::fromRawData(key, strlen(key));
+   QHash<QByteArray, int>::const_iterator it = paramkeys.constFind(rawkey);
+   int keyid;
+
+   if (it != paramkeys.constEnd()) return *it;
+   keyid = paramkeys.size();
+   paramkeys.insert(QByteArray(key), keyid);
+   return keyid;
+}
+
+/*----------------------------------------------------------------------*/
+/* Look up a parameter by key ID, reindexing the list if it has been	*/
+/* changed.  Where a key appears more than once, the first entry wins,	*/
+/* as for a search of the list.						*/
+/*----------------------------------------------------------------------*/
+
+oparamptr ParamList::find(int keyid) const
+{
+   oparamptr ops;
+
+   if (stale) {
+      index.clear();
+      for (ops = head; ops != NULL; ops = ops->next) {
+	 int opsid = paramkeyid(ops->key);
+	 if (!index.contains(opsid))
+	    index.insert(opsid, ops);
+      }
+      stale = false;
+   }
+   return index.value(keyid, NULL);
+}
+
 /*----------------------------------------------------------------------*/
 /* Check for the existance of a parameter with key "key" in object	*/
 /* "thisobj".   Return true if the parameter exists.			*/
@@ -86,13 +128,7 @@ void param_init()
 
 bool check_param(objectptr thisobj, char *key)
 {
-   oparamptr tops;
-
-   for (tops = thisobj->params; tops != NULL; tops = tops->next)
-      if (!strcmp(tops->key, key))
-	 return true;
-
-   return false;
+   return (thisobj->params.find(paramkeyid(key)) != NULL);
 }
 
 /*----------------------------------------------------------------------*/
@@ -123,6 +159,7 @@ eparamptr make_new_eparam(char *key)
    newepp->next = NULL;
    newepp->key = (char *)malloc(1 + strlen(key));
    strcpy(newepp->key, key);
+   newepp->keyid = paramkeyid(key);
    newepp->pdata.refkey = NULL;		/* equivalently, sets pointno=0 */
    newepp->flags = 0;
 
@@ -151,13 +188,13 @@ char *find_indirect_param(objinstptr thisinst, char *refkey)
 
 oparamptr match_param(const object* thisobj, const char *key)
 {
-   oparamptr fparam;
-
-   for (fparam = thisobj->params; fparam != NULL; fparam = fparam->next)
-      if (!strcmp(fparam->key, key))
-	 return fparam;
+   return match_paramid(thisobj, paramkeyid(key));
+}
 
-   return NULL;		/* No parameter matched the key---error condition */
+oparamptr match_paramid(const object* thisobj, int keyid)
+{
+   /* NULL if no parameter matched the key---error condition */
+   return thisobj->params.find(keyid);
 }
 
 /*----------------------------------------------------------------------*/
@@ -167,13 +204,12 @@ oparamptr match_param(const object* thisobj, const char *key)
 
 oparamptr match_instance_param(objinstptr thisinst, const char *key)
 {
-   oparamptr fparam;
-
-   for (fparam = thisinst->params; fparam != NULL; fparam = fparam->next)
-      if (!strcmp(fparam->key, key))
-	 return fparam;
+   return match_instance_paramid(thisinst, paramkeyid(key));
+}
 
-   return NULL;		/* No parameter matched the key---error condition */
+oparamptr match_instance_paramid(objinstptr thisinst, int keyid)
+{
+   return thisinst->params.find(keyid);
 }
 
 /*----------------------------------------------------------------------*/
@@ -188,10 +224,15 @@ oparamptr match_instance_param(objinstptr thisinst, const char *key)
 /*----------------------------------------------------------------------*/
 
 oparamptr find_param(objinstptr thisinst, const char *key)
+{
+   return find_paramid(thisinst, paramkeyid(key));
+}
+
+oparamptr find_paramid(objinstptr thisinst, int keyid)
 {
    oparamptr fparam, ops;
-   fparam = match_instance_param(thisinst, key);
-   ops = match_param(thisinst->thisobject, key);
+   fparam = match_instance_paramid(thisinst, keyid);
+   ops = match_paramid(thisinst->thisobject, keyid);
    if ((fparam == NULL) || ((ops->type == XC_EXPR) && (fparam->type != XC_EXPR)))
       fparam = ops;
 
@@ -258,8 +299,10 @@ oparamptr free_instance_param(objinstptr thisinst, oparamptr thisparam)
 
    for (ops = thisinst->params; ops != NULL; ops = ops->next) {
       if (ops == thisparam) {
-	 if (lastops != NULL)
+	 if (lastops != NULL) {
 	    lastops->next = ops->next;
+	    thisinst->params.invalidate();
+	 }
 	 else
 	    thisinst->params = ops->next;
          delete ops;
@@ -464,8 +507,8 @@ int epsubstitute(genericptr thiselem, objectptr thisobj, objinstptr pinst,
       /* Otherwise, revert to the type of the object.	*/
       /* Normally they will be the same.			*/
 
-      ops = match_param(thisobj, epp->key);
-      dps = (pinst != NULL) ?  find_param(pinst, epp->key) : ops;
+      ops = match_paramid(thisobj, epp->keyid);
+      dps = (pinst != NULL) ?  find_paramid(pinst, epp->keyid) : ops;
 
       if (dps != NULL) {
 
@@ -523,14 +566,14 @@ int epsubstitute(genericptr thiselem, objectptr thisobj, objinstptr pinst,
 	       
 	    /* Create a new instance parameter */
 	    newop = copyparameter(dps);
-	    newop->next = thisinst->params;
-	    thisinst->params = newop;
 
 	    /* Change the key from the parent to the child */
 	    if (strcmp(ops->key, refop->key)) {
 	       free(newop->key);
 	       newop->key = strdup(refop->key);
 	    }
+	    newop->next = thisinst->params;
+	    thisinst->params = newop;
 	    continue;
 	 }
       }
@@ -811,6 +854,61 @@ int epsubstitute(genericptr thiselem, objectptr thisobj, objinstptr pinst,
    return retval;
 }
 
+/*------------------------------------------------------*/
+/* Memory of the last substitution into each object.	*/
+/* Parameter lists are stamped whenever they change;	*/
+/* the parameter generation is bumped on any other edit	*/
+/* which may change parameter values or elements.	*/
+/*------------------------------------------------------*/
+
+static int param_generation = 0;
+
+void param_invalidate()
+{
+   param_generation++;
+}
+
+/*------------------------------------------------------*/
+/* Return true if the elements of "thisobj" still hold	*/
+/* the values of instance "pinst".  The object being	*/
+/* edited, and objects with expression parameters	*/
+/* (which may evaluate differently each time), are	*/
+/* always substituted.					*/
+/*------------------------------------------------------*/
+
+static bool substcurrent(objectptr thisobj, objinstptr pinst)
+{
+   const Substitution *last = &thisobj->subst;
+
+   if ((last->generation != param_generation) || (last->inst != pinst))
+      return false;
+   if (last->objstamp != thisobj->params.stamp())
+      return false;
+   if ((pinst != NULL) && (last->inststamp != pinst->params.stamp()))
+      return false;
+   return true;
+}
+
+static void substrecord(objectptr thisobj, objinstptr pinst, int retval)
+{
+   Substitution *last = &thisobj->subst;
+   oparamptr ops;
+
+   last->generation = -1;
+   if ((pinst != NULL) && (pinst == areawin->topinstance)) return;
+   for (ops = thisobj->params; ops != NULL; ops = ops->next)
+      if (ops->type == XC_EXPR) return;
+   if (pinst != NULL)
+      for (ops = pinst->params; ops != NULL; ops = ops->next)
+	 if (ops->type == XC_EXPR) return;
+
+   last->inst = pinst;
+   last->generation = param_generation;
+   last->objstamp = thisobj->params.stamp();
+   last->inststamp = (pinst != NULL) ? pinst->params.stamp() : 0;
+   last->retval = retval;
+}
+
 /*------------------------------------------------------*/
 /* Make numerical parameter substitutions into all	*/
 /* elements of an object.  "thisinst" may be NULL, in	*/
@@ -831,6 +929,11 @@ int opsubstitute(objectptr thisobj, objinstptr pinst)
    int retval = -1;
    bool needrecalc;	/* for arcs and splines */
 
+   libcache_materialize(thisobj);
+
+   /* Nothing to do if the elements already hold this instance's values */
+   if (substcurrent(thisobj, pinst)) return thisobj->subst.retval;
+
    /* Perform expression parameter substitutions on all labels.	*/
    /* Note that this used to be done on an immediate basis as	*/
    /* labels were parsed.  The main difference is that only one	*/
@@ -845,8 +948,10 @@ int opsubstitute(objectptr thisobj, objinstptr pinst)
                         nextstringpartrecompute(strptr, pinst)) ;
    }
 
-   if (thisobj->params == NULL)
+   if (thisobj->params == NULL) {
+      substrecord(thisobj, pinst, -1);
       return -1;			    /* object has no parameters */
+   }
 
    for (eptr = thisobj->begin(); eptr != thisobj->end(); eptr++) {
 
@@ -860,6 +965,7 @@ int opsubstitute(objectptr thisobj, objinstptr pinst)
 
       if (needrecalc) thiselem->calc();
    }
+   substrecord(thisobj, pinst, retval);
    return retval;
 }
 
@@ -913,7 +1019,7 @@ void pwriteback(objinstptr thisinst)
    objinstptr pinst;
    eparamptr epp;
    oparamptr ops, ips;
-   int k, type, *destivalptr, found;
+   int k, type, *destivalptr, found, keyid;
    XPoint *setpt;
    bool changed, need_redraw = false;
    union {
@@ -940,12 +1046,13 @@ void pwriteback(objinstptr thisinst)
 	 continue;
       found = 0;
       changed = false;
-      ips = (pinst != NULL) ? match_instance_param(pinst, ops->key) : NULL;
+      keyid = paramkeyid(ops->key);
+      ips = (pinst != NULL) ? match_instance_paramid(pinst, keyid) : NULL;
       for (eptr = thisobj->begin(); eptr != thisobj->end(); eptr++) {
          thiselem = *eptr;
          if (thiselem->passed == NULL) continue;	/* Nothing to write back */
          for (epp = thiselem->passed; epp != NULL; epp = epp->next) {
-	    if (!strcmp(epp->key, ops->key)) {
+	    if (epp->keyid == keyid) {
 	       found++;
 	       if (ELEMENTTYPE(thiselem) == PATH)
 		  k = epp->pdata.pathpt[1];
@@ -1128,6 +1235,7 @@ void pwriteback(objinstptr thisinst)
    /* get erased (so they won't be written to the output unnecessarily) */
 
    if (pinst != NULL) resolveparams(pinst);
+   param_invalidate();
 
    if (need_redraw) {
       incr_changes(thisobj);
@@ -1204,6 +1312,7 @@ void resolveparams(objinstptr thisinst)
 
    /* If the instance has no parameters itself, ignore it. */
    if (thisinst == NULL || thisinst->params == NULL) return;
+   param_invalidate();
 
    /* If the object was pushed into from a library, we want to change	*/
    /* the default, not the instanced, parameter values.  However, this	*/
@@ -2161,8 +2270,11 @@ void free_object_param(objectptr thisobj, oparamptr thisparam)
       for (k = 0; k < xobjs.userlibs[j].number; k++) {
 	 if (*(xobjs.userlibs[j].library + k) == thisobj)
 	    l = j;
-	 else
+	 else {
+	    if (libcache_uses(*(xobjs.userlibs[j].library + k), thisobj))
+	       libcache_materialize(*(xobjs.userlibs[j].library + k));
             searchinst(*(xobjs.userlibs[j].library + k), thisobj, key);
+	 }
       }
    }
 
@@ -2200,8 +2312,10 @@ void free_object_param(objectptr thisobj, oparamptr thisparam)
 
    for (ops = thisobj->params; ops != NULL; ops = ops->next) {
       if (ops == thisparam) {
-	 if (lastops != NULL)
+	 if (lastops != NULL) {
 	    lastops->next = ops->next;
+	    thisobj->params.invalidate();
+	 }
 	 else
 	    thisobj->params = ops->next;
          delete ops;
@@ -2275,7 +2389,7 @@ void unmakeparam(labelptr thislabel, stringpart *thispart)
       thislabel->string = newstr;
    else
       lastpart->nextpart = newstr;
-   free(strptr);
+   delete strptr;
 
    /* Merge strings at boundaries, if possible. */
    mergestring(endpart);
@@ -2293,7 +2407,8 @@ void unmakeparam(labelptr thislabel, stringpart *thispart)
 
 void unparameterize(int mode)
 {
-   short *fselect, ptype;
+   int *fselect;
+   short ptype;
    int locpos;
    stringpart *strptr, *tmpptr, *lastptr;
    labelptr settext;
@@ -2356,7 +2471,8 @@ void unparameterize(int mode)
 
 void parameterize(int mode, char *key, short cycle)
 {
-   short *fselect, ptype;
+   int *fselect;
+   short ptype;
    labelptr settext;
    bool preselected;
 
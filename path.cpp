@@ -38,28 +38,36 @@ generic* path::copy() const
 
 void path::draw(DrawContext* ctx) const
 {
-    pointlist   tmppoints;
+    XPoint	*tmppoints;
     const genericptr	*genpath;
     polyptr	thepoly;
     splineptr	thespline;
     int		pathsegs = 0, curseg = 0;
 
+    for (genpath = 0; values(genpath); ) {
+       switch(ELEMENTTYPE(*genpath)) {
+          case POLYGON:
+             pathsegs += TOPOLY(genpath)->points.count();
+             break;
+          case SPLINE:
+             pathsegs += SPLINESEGS;
+             break;
+       }
+    }
+    tmppoints = ctx->points(pathsegs);
+
     for (genpath = 0; values(genpath); ) {
        if (!*genpath) qDebug("%s %p trying to paint element %d=NULL", __FUNCTION__, this, genpath-begin());
        switch(ELEMENTTYPE(*genpath)) {
           case POLYGON:
              thepoly = TOPOLY(genpath);
-             pathsegs += thepoly->points.count();
-             tmppoints.resize(pathsegs);
-             ctx->CTM().transform(thepoly->points.begin(), tmppoints.begin() + curseg, thepoly->points.count());
-             curseg = pathsegs;
+             ctx->CTM().transform(thepoly->points.begin(), tmppoints + curseg, thepoly->points.count());
+             curseg += thepoly->points.count();
              break;
           case SPLINE:
              thespline = TOSPLINE(genpath);
-             pathsegs += SPLINESEGS;
-             tmppoints.resize(pathsegs);
-             makesplinepath(ctx, thespline, tmppoints.begin() + curseg);
-             curseg = pathsegs;
+             makesplinepath(ctx, thespline, tmppoints + curseg);
+             curseg += SPLINESEGS;
 
              if (thespline->cycle != NULL) {
                 // currently edited spline
@@ -69,7 +77,7 @@ void path::draw(DrawContext* ctx) const
              break;
        }
     }
-    strokepath(ctx, tmppoints.begin(), pathsegs, style, width);
+    strokepath(ctx, tmppoints, pathsegs, style, width);
 }
 
 void path::calc()
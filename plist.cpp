@@ -2,25 +2,24 @@
 
 #include "elements.h"
 
+u_int Plist::resizes = 0;
+
 Plist::Plist():
         parts(0),
-        plist((genericptr*)malloc(1*sizeof(genericptr)))
+        plist(NULL),
+        room(0)
 {}
 
 Plist::Plist(const Plist & src):
         parts(0),
-        plist(NULL)
+        plist(NULL),
+        room(0)
 {
     *this = src;
 }
 
 Plist::~Plist()
 {
-    QString s;
-    if (plist) {
-        for (genericptr* p = begin(); p != end(); ++p) s += QString("%1 ").arg((intptr_t)*p,0,16);
-    }
-    if (false) qDebug("~Plist() %p [plist=%p]: %ls", this, plist, s.utf16());
     free(plist);
     plist=0;
 }
@@ -29,9 +28,7 @@ Plist & Plist::operator=(const Plist & src)
 {
     if (&src == this) return *this;
     parts = 0;
-    free(plist);
-    plist = (genericptr *)malloc(src.parts * sizeof(genericptr));
-    if (false) qDebug("= plist %p gets a new plist %p", this, plist);
+    reserve(src.parts);
 
     for (generic* const *gen = src.begin(); gen != src.end(); ++gen) {
         append((*gen)->copy());
@@ -44,11 +41,27 @@ void Plist::clear()
     if (parts) {
         free(plist);
         parts = 0;
-        plist = (genericptr *)malloc(1*sizeof(genericptr));
-        if (false) qDebug("clr plist %p gets a new plist %p", this, plist);
+        plist = NULL;
+        room = 0;
     }
 }
 
+/* Make room for at least "want" elements.  The list grows by doubling,	*/
+/* so that building a list one element at a time copies it only a	*/
+/* logarithmic number of times.						*/
+
+void Plist::reserve(int want)
+{
+    int newroom;
+
+    if (want <= room) return;
+    newroom = (room < 4) ? 4 : room;
+    while (newroom < want) newroom <<= 1;
+    plist = (genericptr *)realloc(plist, newroom * sizeof(genericptr));
+    room = newroom;
+    ++resizes;
+}
+
 bool Plist::operator==(const Plist & o) const
 {
     if (parts != o.parts) return false;
@@ -59,16 +72,14 @@ bool Plist::operator==(const Plist & o) const
 }
 
 genericptr* Plist::append(genericptr ptr) {
-    plist = (genericptr*) realloc(plist, (parts+1)*sizeof(genericptr));
-    if (false) qDebug("+ plist %p gets a resized plist %p", this, plist);
+    reserve(parts+1);
     *(plist+parts) = ptr;
     ++parts;
     return plist+parts-1;
 }
 
 genericptr* Plist::temp_append(genericptr ptr) {
-    plist = (genericptr*) realloc(plist, (parts+1)*sizeof(genericptr));
-    if (false) qDebug("t+ plist %p gets a resized plist %p", this, plist);
+    reserve(parts+1);
     *(plist+parts) = ptr;
     return plist+parts;
 }
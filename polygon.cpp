@@ -46,10 +46,10 @@ generic* polygon::copy() const
 
 void polygon::draw(DrawContext* ctx) const
 {
-   pointlist tmppoints(points.count());
+   XPoint *tmppoints = ctx->points(points.count());
 
-   ctx->CTM().transform(points.begin(), tmppoints.begin(), tmppoints.count());
-   strokepath(ctx, tmppoints.begin(), tmppoints.count(), style, width);
+   ctx->CTM().transform(points.begin(), tmppoints, points.count());
+   strokepath(ctx, tmppoints, points.count(), style, width);
 }
 
 void polygon::indicate(DrawContext* ctx, eparamptr epp, oparamptr ops) const
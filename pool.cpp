@@ -0,0 +1,183 @@
+/*----------------------------------------------------------------------*/
+/* pool.cpp --- allocation of elements and label string parts		*/
+/*----------------------------------------------------------------------*/
+
+#include <QMutex>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "xcircuit.h"
+#include "prototypes.h"
+
+/*----------------------------------------------------------------------*/
+/* Elements and string parts are small, made by the thousand when a	*/
+/* file is read or a selection is copied, and mostly freed together	*/
+/* when a page is cleared.  They are carved from large chunks, one	*/
+/* list of free blocks for each size (in steps of POOL_ALIGN bytes).	*/
+/* A freed block goes back on its list for the next element of the	*/
+/* same size.  The chunks of a size with no blocks in use are returned	*/
+/* to the system by pool_trim().  Anything larger than the largest	*/
+/* size comes from the heap as usual.					*/
+/*----------------------------------------------------------------------*/
+
+#define POOL_ALIGN	16
+#define POOL_SIZES	16		/* blocks of up to 256 bytes */
+#define POOL_CHUNK	65536		/* bytes taken from the heap at a time */
+
+typedef struct _poolblock {
+   struct _poolblock *next;
+} poolblock;
+
+typedef struct {
+   poolblock *freelist;	/* blocks not in use */
+   poolblock *chunks;		/* chunks taken from the heap */
+   u_int inuse;
+} poolsize;
+
+static poolsize pools[POOL_SIZES];
+static QMutex poollock;		/* netlist jobs may make labels */
+
+/* Allocation counters */
+
+typedef struct {
+   u_int elements;		/* elements made */
+   u_int strings;		/* string parts made */
+   u_int heap;			/* blocks taken from the heap */
+   u_int resizes;		/* element lists grown */
+} allocstats;
+
+static allocstats totals, marked;
+
+/*----------------------------------------------------------------------*/
+/* Get a block of "size" bytes, counting it in "count"			*/
+/*----------------------------------------------------------------------*/
+
+static void *pool_alloc(size_t size, u_int *count)
+{
+   poolsize *pool;
+   poolblock *block;
+   char *chunk;
+   size_t bsize;
+   int i, nblocks;
+
+   QMutexLocker lock(&poollock);
+
+   (*count)++;
+   if (size > POOL_SIZES * POOL_ALIGN) {
+      totals.heap++;
+      return malloc(size);
+   }
+   pool = pools + (size - 1) / POOL_ALIGN;
+
+   if (pool->freelist == NULL) {
+      /* The first block of a chunk links it into the list of chunks */
+      bsize = ((size - 1) / POOL_ALIGN + 1) * POOL_ALIGN;
+      nblocks = POOL_CHUNK / bsize;
+      chunk = (char *)malloc(nblocks * bsize);
+      totals.heap++;
+
+      block = (poolblock *)chunk;
+      block->next = pool->chunks;
+      pool->chunks = block;
+      for (i = nblocks - 1; i > 0; i--) {
+	 block = (poolblock *)(chunk + i * bsize);
+	 block->next = pool->freelist;
+	 pool->freelist = block;
+      }
+   }
+   block = pool->freelist;
+   pool->freelist = block->next;
+   pool->inuse++;
+   return block;
+}
+
+/*----------------------------------------------------------------------*/
+/* Give back a block from pool_alloc()					*/
+/*----------------------------------------------------------------------*/
+
+static void pool_free(void *ptr, size_t size)
+{
+   poolsize *pool;
+   poolblock *block = (poolblock *)ptr;
+
+   if (ptr == NULL) return;
+   if (size > POOL_SIZES * POOL_ALIGN) {
+      free(ptr);
+      return;
+   }
+   QMutexLocker lock(&poollock);
+   pool = pools + (size - 1) / POOL_ALIGN;
+   block->next = pool->freelist;
+   pool->freelist = block;
+   pool->inuse--;
+}
+
+void *generic::operator new(size_t size)
+{
+   return pool_alloc(size, &totals.elements);
+}
+
+void generic::operator delete(void *ptr, size_t size)
+{
+   pool_free(ptr, size);
+}
+
+void *stringpart::operator new(size_t size)
+{
+   return pool_alloc(size, &totals.strings);
+}
+
+void stringpart::operator delete(void *ptr, size_t size)
+{
+   pool_free(ptr, size);
+}
+
+/*----------------------------------------------------------------------*/
+/* Return to the system the chunks of every size of which no block is	*/
+/* in use, as after the only page using them has been cleared.		*/
+/*----------------------------------------------------------------------*/
+
+void pool_trim()
+{
+   poolsize *pool;
+   poolblock *chunk;
+
+   QMutexLocker lock(&poollock);
+
+   for (pool = pools; pool < pools + POOL_SIZES; pool++) {
+      if (pool->inuse > 0) continue;
+      while ((chunk = pool->chunks) != NULL) {
+	 pool->chunks = chunk->next;
+	 free(chunk);
+      }
+      pool->freelist = NULL;
+   }
+}
+
+/*----------------------------------------------------------------------*/
+/* Allocation counts, printed for each load and copy when the		*/
+/* environment variable XCIRCUIT_ALLOCSTATS is set.  allocstats_mark()	*/
+/* starts a count and allocstats_report() prints what was allocated	*/
+/* since.								*/
+/*----------------------------------------------------------------------*/
+
+void allocstats_mark()
+{
+   totals.resizes = Plist::resizes;
+   marked = totals;
+}
+
+void allocstats_report(const char *what)
+{
+   static int reporting = -1;
+
+   if (reporting < 0)
+      reporting = (getenv((const char *)"XCIRCUIT_ALLOCSTATS") != NULL);
+   if (!reporting) return;
+   totals.resizes = Plist::resizes;
+   Fprintf(stdout, "%s: %u elements, %u string parts, %u list resizes, "
+		"%u heap blocks\n", what, totals.elements - marked.elements,
+		totals.strings - marked.strings, totals.resizes - marked.resizes,
+		totals.heap - marked.heap);
+}
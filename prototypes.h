@@ -9,7 +9,10 @@
 #include <QString>
 
 class DrawContext;
+class Autosave;
+struct TextLayout;
 class QAction;
+class QRect;
 class uselection;
 
 /* from undo.c */
@@ -25,7 +28,7 @@ void truncate_undo_stack(void);
 void free_undo_record(Undoptr);
 void free_redo_record(Undoptr);
 stringpart *get_original_string(labelptr);
-short *recover_selectlist(Undoptr);
+int *recover_selectlist(Undoptr);
 void undo_call(QAction*, void*, void*);
 void redo_call(QAction*, void*, void*);
 
@@ -58,8 +61,8 @@ void textreturn(void);
 void rejustify(short);
 void findconstrained(polyptr);
 void reversefpoints(XfPoint *, short);
-void freeparts(short *, short);
-void removep(short *, short);
+void freeparts(int *, short);
+void removep(int *, short);
 void unjoin(void);
 void unjoin_call(QAction*, void*, void*);
 labelptr findlabelcopy(labelptr, stringpart *);
@@ -78,7 +81,7 @@ void boxbutton(int, int);
 void trackbox(Widget, caddr_t, caddr_t);
 void trackwire(Widget, caddr_t, caddr_t);
 void startwire(XPoint *);
-void setendpoint(short *, short, XPoint **, XPoint *);
+void setendpoint(int *, short, XPoint **, XPoint *);
 void wire_op(int, int ,int);
 
 /* from events.c: */
@@ -134,8 +137,8 @@ void elemrotate(genericptr, short, XPoint *);
 void elementrotate(short, XPoint *);
 void edit(int, int);
 void pathedit(genericptr);
-void xc_lower(short *);
-void xc_raise(short *);
+void xc_lower(int *);
+void xc_raise(int *);
 void exchange(void);
 void elhflip(genericptr *, short);
 void elvflip(genericptr *, short);
@@ -143,11 +146,11 @@ void elementflip(XPoint *);
 void elementvflip(XPoint *);
 short getkeynum(void);
 void makepress(XtPointer, XtIntervalId *);
-void reviseselect(short *, int, short *);
+void reviseselect(int *, int, int *);
 void deletebutton(int, int);
 void delete_one_element(objinstptr, genericptr);
-short *xc_undelete(objinstptr, objectptr, short *);
-objectptr delete_element(objinstptr, short *, int);
+int *xc_undelete(objinstptr, objectptr, int *);
+objectptr delete_element(objinstptr, int *, int);
 void printname(objectptr);
 bool checkname(objectptr);
 char *checkvalidname(char *, objectptr);
@@ -170,7 +173,7 @@ void finish_op(int, int, int);
 void path_op(genericptr, int, int, int);
 void inst_op(genericptr, int, int, int);
 void standard_element_delete();
-void delete_for_xfer(short *, int);
+void delete_for_xfer(int *, int);
 void delete_noundo();
 
 /* from filelist.c: */
@@ -202,10 +205,10 @@ float getpsscale(float, short);
 void dostcount(FILE *, short *, short);
 short printparams(FILE *, objinstptr, short);
 void printobjectparams(FILE *, objectptr);
-void varcheck(FILE *, short, objectptr, short *, genericptr, u_char);
+void varcheck(FILE *, int, objectptr, short *, genericptr, u_char);
 void varfcheck(FILE *, float, objectptr, short *, genericptr, u_char);
-bool varpcheck(FILE *, short, objectptr, int, short *, genericptr, u_char);
-bool varpathcheck(FILE *, short, objectptr, int, short *,
+bool varpcheck(FILE *, int, objectptr, int, short *, genericptr, u_char);
+bool varpathcheck(FILE *, int, objectptr, int, short *,
                 genericptr *, pathptr, u_char);
 void getfile(QAction*, void*, void*);
 int filecmp(const QString &, const QString &);
@@ -219,20 +222,25 @@ void startloadfile(int, const QString & list);
 void normalloadfile(QAction*, const QString&, void*);
 void importfile(QAction*, const QString&, void*);
 bool loadfile(short, int, const QString&);
+int lookupfont(const char *);
 void readlabel(objectptr, char *, stringpart **);
 void readparams(objectptr, objinstptr, objectptr, char *);
 u_char *find_match(u_char *);
 char *advancetoken(char *);
-char *varpscan(objectptr, char *, short *, genericptr, int, int, u_char);
+char *varpscan(objectptr, char *, int *, genericptr, int, int, u_char);
+char *varscan(objectptr, char *, int *, genericptr, u_char);
 char *varscan(objectptr, char *, short *, genericptr, u_char);
 char *varfscan(objectptr, char *, float *, genericptr, u_char);
 objinstptr addtoinstlist(int, objectptr, bool);
 bool objectread(FILE *, objectptr, short, short, short, char *,
 		int, TechPtr);
 void importfromlibrary(short, char *, char *);
+objinstptr new_library_instance(short, char *, char *, TechPtr);
+objectptr findinstobject(short, char *);
 objectptr *new_library_object(short, char *, objlistptr *, TechPtr);
 bool library_object_unique(short, objectptr, objlistptr);
 void add_object_to_library(short, objectptr);
+void cleanupaliases(short);
 char *find_delimiter(char *);
 char standard_delimiter_end(char);
 
@@ -253,6 +261,8 @@ void savelibpopup(QAction*, void*, void*);
 void savelibrary(QAction*, const QString &, void*);
 void savetechnology(char *, char *);
 void findfonts(objectptr, short *);
+void printimage(FILE *, const XImage &, const char *);
+void setassaved(objectptr *, short);
 void savefile(short);
 int printRGBvalues(char *, int, const char *);
 char *nosprint(char *);
@@ -272,6 +282,7 @@ void printpageobject(FILE *, objectptr, short, short);
 /* from fontfile.c: */
 
 FILE *findfontfile(const char *);
+void prefetchfont(const char *);
 int loadfontfile(const char *);
 
 /* from formats.c: */
@@ -292,7 +303,7 @@ void findsplinepos(splineptr, float, XPoint *, int *);
 void ffindsplinepos(splineptr, float, XfPoint *);
 float findsplinemin(splineptr, XPoint *);
 short closepoint(polyptr, XPoint *);
-short closedistance(polyptr, XPoint *);
+int closedistance(polyptr, XPoint *);
 void updateinstparam(objectptr);
 short checkbounds(DrawContext*);
 void window_to_user(short, short, XPoint *);
@@ -306,10 +317,10 @@ XPoint u2u_getSnapped(XPoint f);
 void u2u_snap(XPoint &);
 void snap(short, short, XPoint *);
 void manhattanize(XPoint *, polyptr, short, bool);
-void bboxcalc(short, short *, short *);
-void calcextents(genericptr *, short *, short *, short *, short *);
-void calcinstbbox(genericptr *, short *, short *, short *, short *);
-void calcbboxsingle(genericptr *, objinstptr, short *, short *, short *, short *);
+void bboxcalc(int, int *, int *);
+void calcextents(genericptr *, int *, int *, int *, int *);
+void calcinstbbox(genericptr *, int *, int *, int *, int *);
+void calcbboxsingle(genericptr *, objinstptr, int *, int *, int *, int *);
 bool object_in_library(short, objectptr);
 void calcbboxinst(objinstptr);
 void updatepagebounds(objectptr);
@@ -320,22 +331,24 @@ void calcbboxselect(void);
 void calcbboxvalues(objinstptr, genericptr *);
 void centerview(objinstptr);
 void refresh(QAction*, void*, void*);
+void invalidate_element(genericptr *);
+void invalidate_selected();
 void zoomview(QAction*, void*, void*);
 void UDrawSimpleLine(DrawContext*, const XPoint *, const XPoint *);
 void UDrawLine(DrawContext*, const XPoint *, const XPoint *);
 void UDrawCircle(DrawContext*, const XPoint *, u_char);
 void UDrawX(DrawContext*, labelptr);
 void UDrawXDown(DrawContext*, labelptr);
-int  toplevelwidth(objinstptr, short *);
-int  toplevelheight(objinstptr, short *);
+int  toplevelwidth(objinstptr, int *);
+int  toplevelheight(objinstptr, int *);
 void extendschembbox(objinstptr, XPoint *, XPoint *);
-void pinadjust(short, short *, short *, short);
+void pinadjust(short, int *, int *, short);
 void UDrawTextLine(DrawContext*, labelptr, short);
 void UDrawTLine(DrawContext*, labelptr);
 void UDrawXLine(DrawContext*, XPoint, XPoint);
 void UDrawBox(DrawContext*, XPoint, XPoint);
 float UDrawRescaleBox(DrawContext*, const XPoint &);
-void strokepath(DrawContext*, XPoint *, short, short, float);
+void strokepath(DrawContext*, XPoint *, int, short, float);
 void makesplinepath(DrawContext*, const spline *, XPoint *);
 void UDrawObject(DrawContext*, objinstptr, short, int, pushlistptr *);
 void TopDoLatex(void);
@@ -533,16 +546,23 @@ void NameToPosition(objinstptr, labelptr, XPoint *);
 XPoint *NetToPosition(int, objectptr);
 int getsubnet(int, objectptr);
 void invalidate_netlist(objectptr);
+void add_netlist_wire(objectptr, polyptr);
+void select_remove_netlist(void);
+void select_move_netlist(void);
 void remove_netlist_element(objectptr, genericptr);
 int updatenets(objinstptr, bool);
+int netlist_check(const QString &);
+int netlist_benchmark(const QString &);
+int netlist_jobcheck(const QString &);
 void createnets(objinstptr, bool);
 bool nonnetwork(polyptr);
 int globalmax(void);
 LabellistPtr geninfolist(objectptr, objinstptr, const char *);
 void gennetlist(objinstptr);
+int gennetpolys(objectptr, objectptr, objinstptr, int, int);
 void gencalls(objectptr);
 void search_on_siblings(objinstptr, objinstptr, pushlistptr,
-		short, short, short, short);
+		int, int, int, int);
 char *GetHierarchy(pushlistptr *, bool);
 bool HierNameToObject(objinstptr, char *, pushlistptr *);
 void resolve_devindex(objectptr, bool);
@@ -611,9 +631,14 @@ int exit_spice(void);
 
 void param_init();
 char *find_indirect_param(objinstptr, char *);
+int paramkeyid(const char *);
 oparamptr match_param(const object*, const char *);
+oparamptr match_paramid(const object*, int);
 oparamptr match_instance_param(objinstptr, const char *);
+oparamptr match_instance_paramid(objinstptr, int);
 oparamptr find_param(objinstptr, const char *);
+oparamptr find_paramid(objinstptr, int);
+void param_invalidate();
 int get_num_params(objectptr);
 void free_object_param(objectptr, oparamptr);
 oparamptr free_instance_param(objinstptr, oparamptr);
@@ -746,14 +771,14 @@ void xlib_swapschem(Widget, void*, void*);
 
 /* from selection.c: */
 
-void enable_selects(objectptr, short *, int);
-void disable_selects(objectptr, short *, int);
+void enable_selects(objectptr, int *, int);
+void disable_selects(objectptr, int *, int);
 void selectfilter(QAction *, void*, void*);
 bool checkselect(short, bool draw_selected = false);
-void geneasydraw(DrawContext*, short, int, objectptr, objinstptr);
-void gendrawselected(DrawContext*, short *, objectptr, objinstptr);
+void geneasydraw(DrawContext*, int, int, objectptr, objinstptr);
+void gendrawselected(DrawContext*, int *, objectptr, objinstptr);
 selection *genselectelement(short, u_char, objectptr, objinstptr);
-short *allocselect(void);
+int *allocselect(void);
 void setoptionmenu(void);
 int test_insideness(int, int, const XPoint *);
 bool pathselect(genericptr *, short, float);
@@ -769,7 +794,7 @@ void unselect_all(void);
 void select_connected_pins();
 void reset_cycles();
 selection *recurselect(short, u_char, pushlistptr *);
-short *recurse_select_element(short, u_char);
+int *recurse_select_element(short, u_char);
 void startselect(void);
 void trackselarea(void);
 void trackrescale(void);
@@ -777,9 +802,100 @@ pointselect *addcycle(genericptr *, short, u_char);
 void copycycles(pointselect **, pointselect * const*);
 void advancecycle(genericptr *, short);
 void removecycle(genericptr);
-bool checkforcycles(short *, int);
+bool checkforcycles(int *, int);
 void makerefcycle(pointselect *, short);
 
+/* from spatial.c: */
+
+SpatialIndex *spatial_index(objectptr);
+void spatial_invalidate(objectptr);
+void spatial_update(objectptr, genericptr *);
+void spatial_bboxchanged(void);
+int spatial_benchmark(int);
+
+/* from autosave.c: */
+
+void autosave_start(Autosave *);
+void autosave_wait(void);
+
+/* from nameindex.c: */
+
+void names_invalidate(void);
+void names_addobject(short, objectptr);
+void names_removeobject(short, objectptr);
+int names_find(short, const char *, bool, objectptr **, int **);
+objectptr names_findexact(const char *, objectptr);
+void names_addalias(objectptr, const char *);
+bool names_isalias(objectptr, const char *);
+void names_clearaliases(void);
+void names_addtech(TechPtr);
+TechPtr names_findtech(const char *);
+
+/* from libcache.c: */
+
+void libcache_prefetch(short, const char *);
+void libcache_endprefetch(void);
+bool libcache_replay(short, const QString &, TechPtr *);
+void libcache_begin(short, const QString &, TechPtr);
+void libcache_end(void);
+void libcache_reject(void);
+void libcache_beginobject(const char *);
+void libcache_endobject(objectptr);
+void libcache_instance(objinstptr, const char *);
+void libcache_libinst(const char *, const char *);
+void libcache_color(int);
+void libcache_addedobject(short, objectptr);
+void libcache_materialize(objectptr);
+void libcache_release(objectptr);
+bool libcache_uses(objectptr, objectptr);
+void libcache_setlimit(int);
+void libcache_trim(void);
+void libcache_prewarm(const QString &);
+
+/* from loadprogress.c: */
+
+bool loadprogress_step(FILE *);
+bool loadprogress_running(void);
+bool loadprogress_cancelled(void);
+
+/* from xcbfile.c: */
+
+void savexcb(short);
+bool loadxcb(short, int, const QString &);
+bool convertfile(const QString &, const QString &);
+
+/* from pool.c: */
+
+void pool_trim(void);
+void allocstats_mark(void);
+void allocstats_report(const char *);
+
+/* from layout.c: */
+
+const TextLayout *textlayout(const label *, objinstptr, bool, TextLayout *);
+void layout_invalidate(void);
+
+/* from lod.c: */
+
+bool lod_draw(DrawContext*, objinstptr, int);
+bool lod_labelhidden(DrawContext*, labelptr);
+bool sprite_draw(DrawContext*, objinstptr, short, int);
+void sprite_setlimit(int);
+void lod_invalidate(void);
+void lod_forget(objectptr);
+int lod_benchmark(const QString &);
+int lod_check(const QString &);
+
+/* from tiles.c: */
+
+void tiles_draw(DrawContext*, const QRect &);
+void tiles_setthreads(int);
+
+/* from glyph.c: */
+
+bool glyph_draw(DrawContext*, objectptr, float, int);
+void glyph_invalidate(objectptr);
+
 /* from text.c: */
 
 bool hasparameter(labelptr);
@@ -820,6 +936,7 @@ int find_ordinal(int, labelptr, objinstptr);
 
 short UDrawChar(DrawContext*, u_char, short, short, int, int);
 void UDrawString(DrawContext*, labelptr, int, objinstptr, bool drawX = true);
+void layoutstring(const label *, objinstptr, bool, TextLayout *);
 TextExtents ULength(const label *, objinstptr, short, XPoint *);
 void composefontlib(short);
 void fontcat_op(int, int, int);
@@ -1163,7 +1163,7 @@ static PyObject *xc_setattr(PyObject *self, PyObject *args)
    if ((dval = PyDict_GetItemString(attrdict, "position")) != NULL) {
       if (PyTuple_Check(dval) && PyTuple_Size(dval) == 2) {
          if ((pval = PyTuple_GetItem(dval, 0)) != NULL) {
-            short xpos = (short)PyInt_AsLong(pval);
+            int xpos = (int)PyInt_AsLong(pval);
             switch(ELEMENTTYPE(*gelem)) {
 	       case ARC:
 	          TOARC(gelem)->position.x = xpos;
@@ -1182,7 +1182,7 @@ static PyObject *xc_setattr(PyObject *self, PyObject *args)
          }
 
          if ((pval = PyTuple_GetItem(dval, 1)) != NULL) {
-            short ypos = (short)PyInt_AsLong(pval);
+            int ypos = (int)PyInt_AsLong(pval);
             switch(ELEMENTTYPE(*gelem)) {
 	       case ARC:
 	          TOARC(gelem)->position.y = ypos;
@@ -1314,9 +1314,9 @@ static PyObject *xc_setattr(PyObject *self, PyObject *args)
 		  pval = PyList_GetItem(dval, i);
 		  if (PyTuple_Check(pval) && PyTuple_Size(pval) == 2) {
 		     qval = PyTuple_GetItem(pval, 0);
-		     TOSPLINE(gelem)->ctrl[i].x = (short)PyInt_AsLong(qval);
+		     TOSPLINE(gelem)->ctrl[i].x = (int)PyInt_AsLong(qval);
 		     qval = PyTuple_GetItem(pval, 1);
-		     TOSPLINE(gelem)->ctrl[i].y = (short)PyInt_AsLong(qval);
+		     TOSPLINE(gelem)->ctrl[i].y = (int)PyInt_AsLong(qval);
 		  }
 		  else {
                      PyErr_SetString(PyExc_TypeError,
@@ -1343,9 +1343,9 @@ static PyObject *xc_setattr(PyObject *self, PyObject *args)
 		  pval = PyList_GetItem(dval, i);
 		  if (PyTuple_Check(pval) && PyTuple_Size(pval) == 2) {
 		     qval = PyTuple_GetItem(pval, 0);
-		     TOPOLY(gelem)->points[i].x = (short)PyInt_AsLong(qval);
+		     TOPOLY(gelem)->points[i].x = (int)PyInt_AsLong(qval);
 		     qval = PyTuple_GetItem(pval, 1);
-		     TOPOLY(gelem)->points[i].y = (short)PyInt_AsLong(qval);
+		     TOPOLY(gelem)->points[i].y = (int)PyInt_AsLong(qval);
 		  }
 		  else {
                      PyErr_SetString(PyExc_TypeError,
@@ -302,6 +302,33 @@ short execcommand(short pflags, char *cmdptr)
          else if (!strcmp(value, "manhattan")) boxedit(NULL, (void*)MANHATTAN, NULL);
          else if (!strcmp(value, "normal")) boxedit(NULL, (void*)NORMAL, NULL);
       }
+      else if (!strncmp(argptr, "cellcache", 9)) {
+	 int limit = 0;
+	 sscanf(argptr + 9, "%d", &limit);
+	 libcache_setlimit(limit);
+      }
+      else if (!strncmp(argptr, "spritecache", 11)) {
+	 /* "set spritecache <megabytes>", 0 for no sprites */
+	 int limit = 0;
+	 sscanf(argptr + 11, "%d", &limit);
+	 sprite_setlimit(limit);
+      }
+      else if (!strncmp(argptr, "drawthreads", 11)) {
+	 /* "set drawthreads <n>", 0 for one per processor */
+	 int threads = 0;
+	 sscanf(argptr + 11, "%d", &threads);
+	 tiles_setthreads(threads);
+      }
+      else if (!strncmp(argptr, "lod", 3)) {
+	 /* "set lod hide|box|thumbnail|text <pixels>" */
+	 int pixels = 0;
+	 if (sscanf(argptr + 3, "%49s %d", value, &pixels) == 2) {
+	    if (!strcmp(value, "hide")) areawin->lodhide = pixels;
+	    else if (!strcmp(value, "box")) areawin->lodbox = pixels;
+	    else if (!strncmp(value, "thumb", 5)) areawin->lodthumb = pixels;
+	    else if (!strcmp(value, "text")) areawin->lodtext = pixels;
+	 }
+      }
       else if (!strncmp(argptr, "line", 4)) {
 	 if (strstr(argptr + 4, "width")) {
 	    sscanf(argptr + 4, "%*s %f", &areawin->linewidth);
@@ -352,6 +379,28 @@ short execcommand(short pflags, char *cmdptr)
    return flags;
 }
 
+/*-------------------------------------------------------------------------*/
+/* Start reading the caches of the libraries and fonts loaded by a         */
+/* script, so that they are (mostly) checked and in memory by the time     */
+/* the commands loading them are run.  Libraries without a current cache   */
+/* are parsed when their command is run (see libcache_prefetch()).         */
+/*-------------------------------------------------------------------------*/
+
+static void prefetchscript(FILE *fd)
+{
+   char temp[250], cmdstr[50], str[150];
+   long pos = ftell(fd);
+
+   while (fgets(temp, 249, fd) != NULL) {
+      if (sscanf(temp, "%49s %149s", cmdstr, str) != 2) continue;
+      if (!strcmp(cmdstr, "library"))
+	 libcache_prefetch(LIBRARY, str);
+      else if (!strncmp(cmdstr, "font", 4))
+	 prefetchfont(str);
+   }
+   fseek(fd, pos, SEEK_SET);
+}
+
 /*-------------------------------------------------------------------------*/
 #define TEMPLEN 128
 
@@ -361,6 +410,8 @@ short readcommand(short mode, FILE *fd)
    short templen = TEMPLEN, tempmax = TEMPLEN;
    short flags = (mode == 0) ? 0 : LIBOVERRIDE | LIBLOADED | FONTOVERRIDE;
 
+   prefetchscript(fd);
+
    temp = (char *)malloc(templen);
    tmpptr = temp;
 
@@ -426,7 +477,10 @@ void execscript(QAction*, const QString& str, void*)
    QString fn = str;
 
    xc_tilde_expand(fn);
-   if ((fd = fopen(fn.toLocal8Bit(), "r")) != NULL) readcommand(0, fd);
+   if ((fd = fopen(fn.toLocal8Bit(), "r")) != NULL) {
+      readcommand(0, fd);
+      libcache_endprefetch();
+   }
    else {
       Wprintf("Failed to open script file \"%ls\"\n", fn.utf16());
    }
@@ -445,6 +499,9 @@ void loadrcfile()
 
    fn = USER_RC_FILE;     /* Name imported from Makefile */
 
+   /* The default font is wanted unless overridden */
+   prefetchfont("Helvetica");
+
    /* try first in current directory, then look in user's home directory */
 
    xc_tilde_expand(fn);
@@ -502,6 +559,8 @@ void loadrcfile()
 
    if (!(flags & KEYOVERRIDE))
       default_keybindings();
+
+   libcache_endprefetch();
 }
 
 #endif
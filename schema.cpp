@@ -103,21 +103,28 @@ char *GetCanonicalName(char *fullname)
 
 objectptr NameToObject(char *objname, objinstptr *ret_inst, bool dopages)
 {
-   int i;
+   int i, n, *libs;
+   objectptr *found;
    liblistptr spec;
    bool notech = false;
    char *techptr;
 
    if (strstr(objname, "::") == NULL) notech = true;
 
-   for (i = 0; i < xobjs.numlibs; i++) {
-      for (spec = xobjs.userlibs[i].instlist; spec != NULL; spec = spec->next) {
-	 techptr = spec->thisinst->thisobject->name;
-	 if (notech)
-	    techptr = GetCanonicalName(spec->thisinst->thisobject->name);
-         if (!strcmp(objname, techptr)) {
+   /* Candidates come from the name index, in library order; the	*/
+   /* instance returned is the object's first in its library.	*/
+
+   n = names_find(LIBRARY, objname, notech, &found, &libs);
+   for (i = 0; i < n; i++) {
+      techptr = found[i]->name;
+      if (notech)
+	 techptr = GetCanonicalName(found[i]->name);
+      if (strcmp(objname, techptr)) continue;
+
+      for (spec = xobjs.userlibs[libs[i]].instlist; spec != NULL; spec = spec->next) {
+         if (spec->thisinst->thisobject == found[i]) {
 	    if (ret_inst) *ret_inst = spec->thisinst;
-	    return spec->thisinst->thisobject;
+	    return found[i];
 	 }
       }
    }
@@ -204,7 +211,7 @@ void startconnect(QAction* button, void* clientdata, void* calldata)
 
 void connectivity(QAction*, void*, void*)
 {
-   short *gsel = NULL;
+   int *gsel = NULL;
    selection *rselect = NULL, *nextselect;
    genericptr ggen = NULL;
    Genericlist *netlist = NULL;
@@ -386,7 +393,7 @@ void pinconvert(labelptr thislab, unsigned int mode)
 
 void dopintype(QAction*, void* mode_, void*)
 {
-   short *gsel;
+   int *gsel;
    char typestr[40];
    short savetype = -1;
 
@@ -750,7 +757,7 @@ int changeotherpins(labelptr newlabel, stringpart *oldstring)
 	 if (tlab->pin != LOCAL) continue;
 	 if (!stringcomp(tlab->string, oldstring)) {
 	    if (newlabel != NULL) {
-	       free(tlab->string);
+	       freelabel(tlab->string);
 	       tlab->string = stringcopy(newlabel->string);
 	       rval++;
 	    }
@@ -777,7 +784,7 @@ void xlib_swapschem(Widget, void* mode, void*)
 
 void swapschem(int allow_create, int libnum, char *fullname)
 {
-   objectptr savepage = topobject;
+   objectptr savepage = topobject, newsymbol = NULL;
    labelptr  *pinlab;
    bool lflag;
    pushlistptr stacktop;
@@ -819,6 +826,7 @@ void swapschem(int allow_create, int libnum, char *fullname)
 	 newobject = xobjs.userlibs[loclibnum].library
 		+ xobjs.userlibs[loclibnum].number - 1;
          *newobject = new object;
+	 newsymbol = *newobject;
 	 (*newobject)->schemtype = SYMBOL;
 	 (*newobject)->hidden = false;
 
@@ -859,6 +867,8 @@ void swapschem(int allow_create, int libnum, char *fullname)
       }
       strcpy(topobject->name, canonname);
       checkname(topobject);
+      if (newsymbol != NULL)
+	 names_addobject(LIBRARY + loclibnum, newsymbol);
 
       /* copy all pin labels into the new object */
 
@@ -24,6 +24,7 @@
 #include "colors.h"
 #include "prototypes.h"
 #include "xcqt.h"
+#include "spatial.h"
 
 /*----------------------------------------------------------------------*/
 /* Exported Variable definitions					*/
@@ -52,10 +53,10 @@ selection::~selection()
 /* Prevent a list of elements from being selected.			*/
 /*----------------------------------------------------------------------*/
 
-void disable_selects(objectptr thisobject, short *selectlist, int selects)
+void disable_selects(objectptr thisobject, int *selectlist, int selects)
 {
    genericptr genptr;
-   short *i;
+   int *i;
 
    for (i = selectlist; i < selectlist + selects; i++) {
       genptr = thisobject->at(*i);
@@ -69,10 +70,10 @@ void disable_selects(objectptr thisobject, short *selectlist, int selects)
 /* the disable_selects() routine.					*/
 /*----------------------------------------------------------------------*/
 
-void enable_selects(objectptr thisobject, short *selectlist, int selects)
+void enable_selects(objectptr thisobject, int *selectlist, int selects)
 {
    genericptr genptr;
-   short *i;
+   int *i;
 
    for (i = selectlist; i < selectlist + selects; i++) {
       genptr = thisobject->at(*i);
@@ -106,7 +107,7 @@ void selectfilter(QAction * a, void* value, void*)
 
 bool checkselect(short value, bool draw_selected)
 {
-   short *check;
+   int *check;
    editmode savemode;
  
    value &= areawin->filter;	/* apply the selection filter */
@@ -130,9 +131,9 @@ bool checkselect(short value, bool draw_selected)
 /* from an object. 						*/
 /*--------------------------------------------------------------*/
 
-void reviseselect(short *slist, int selects, short *removed)
+void reviseselect(int *slist, int selects, int *removed)
 {
-   short *chkselect;
+   int *chkselect;
 
    for (chkselect = slist; chkselect < slist + selects; chkselect++)
       if (*chkselect > *removed) (*chkselect)--;
@@ -142,7 +143,7 @@ void reviseselect(short *slist, int selects, short *removed)
 /* Draw a selected item */
 /*----------------------*/
 
-void geneasydraw(DrawContext* ctx, short instance, int mode, objectptr curobj, objinstptr curinst)
+void geneasydraw(DrawContext* ctx, int instance, int mode, objectptr curobj, objinstptr curinst)
 {
    genericptr elementptr = curobj->at(instance);
 
@@ -167,7 +168,7 @@ void geneasydraw(DrawContext* ctx, short instance, int mode, objectptr curobj, o
 /* Draw a selected item, including selection color */
 /*-------------------------------------------------*/
 
-void gendrawselected(DrawContext* ctx, short *newselect, objectptr curobj, objinstptr curinst)
+void gendrawselected(DrawContext* ctx, int *newselect, objectptr curobj, objinstptr curinst)
 {
    /* Don't draw selection color when selecting for edit */
    if (eventmode == PENDING_MODE) return;
@@ -196,15 +197,27 @@ void gendrawselected(DrawContext* ctx, short *newselect, objectptr curobj, objin
 /* Allocate or reallocate memory for a new selection */
 /*---------------------------------------------------*/
 
-short *allocselect()
+/* Room for a list of "n" selections.  The list is allocated in	*/
+/* powers of two, so that adding to it one at a time does not copy	*/
+/* it every time (realloc() to the size already allocated is cheap).	*/
+
+static size_t selectroom(int n)
 {
-   short *newselect;
+   size_t room = 1;
+
+   while ((int)room < n) room <<= 1;
+   return room * sizeof(int);
+}
+
+int *allocselect()
+{
+   int *newselect;
 
    if (areawin->selects == 0)
-      areawin->selectlist = (short *) malloc(sizeof(short));
+      areawin->selectlist = (int *) malloc(sizeof(int));
    else
-      areawin->selectlist = (short *) realloc(areawin->selectlist,
-	 (areawin->selects + 1) * sizeof(short));
+      areawin->selectlist = (int *) realloc(areawin->selectlist,
+	 selectroom(areawin->selects + 1));
 
    newselect = areawin->selectlist + areawin->selects;
    areawin->selects++;
@@ -218,7 +231,7 @@ short *allocselect()
 
 void setoptionmenu()
 {
-   short      *mselect;
+   int        *mselect;
    labelptr   mlabel;
 
    if (areawin->selects == 0) {
@@ -378,11 +391,11 @@ bool pathselect(genericptr *curgen, short class_, float range)
 /* Check to see if any selection has registered cycles	*/
 /*------------------------------------------------------*/
 
-bool checkforcycles(short *selectlist, int selects)
+bool checkforcycles(int *selectlist, int selects)
 {
    genericptr pgen;
    pointselect *cycptr;
-   short *ssel;
+   int *ssel;
 
    for (ssel = selectlist; ssel < selectlist + selects; ssel++) {
       pgen = SELTOGENERIC(ssel);
@@ -699,10 +712,29 @@ selection *genselectelement(short class_, u_char mode, objectptr selobj,
    if (mode == MODE_RECURSE_WIDE)
       range = RANGE_WIDE;
 
+   /* On large objects, consider only the elements near the cursor.	*/
+   /* The margin covers both pathselect() and the instance bounding	*/
+   /* box extension.							*/
+
+   QVector<int> nearparts;
+   SpatialIndex *sidx = spatial_index(selobj);
+   int nnext = 0;
+
+   if (sidx != NULL) {
+      int margin = (int)(range + 3 + range / (areawin->vscale + 0.05));
+      sidx->query(areawin->save.x - margin, areawin->save.y - margin,
+		areawin->save.x + margin, areawin->save.y + margin, nearparts);
+   }
+
    /* Loop through all elements found underneath the cursor */
 
    for (curgen = selobj->begin(); curgen != selobj->end(); curgen++) {
 
+      if (sidx != NULL) {
+         if (nnext >= nearparts.size()) break;
+         curgen = selobj->begin() + nearparts[nnext++];
+      }
+
       selected = false;
 
       /* Check among polygons, arcs, and curves */
@@ -786,16 +818,16 @@ selection *genselectelement(short class_, u_char mode, objectptr selobj,
       if (selected) {
          if (rselect == NULL) {
             rselect = new selection;
-	    rselect->selectlist = (short *)malloc(sizeof(short));
+	    rselect->selectlist = (int *)malloc(sizeof(int));
 	    rselect->selects = 0;
 	    rselect->thisinst = selinst;
 	    rselect->next = NULL;
 	 }
          else {
-            rselect->selectlist = (short *)realloc(rselect->selectlist,
-			(rselect->selects + 1) * sizeof(short));
+            rselect->selectlist = (int *)realloc(rselect->selectlist,
+			selectroom(rselect->selects + 1));
 	 }
-	 *(rselect->selectlist + rselect->selects) = (short)(curgen -
+	 *(rselect->selectlist + rselect->selects) = (int)(curgen -
                 selobj->begin());
 	 rselect->selects++;
       }
@@ -872,7 +904,7 @@ bool areaelement(genericptr *curgen, bool is_path, short level)
 
 bool selectarea(objectptr selobj, short level)
 {
-   short	*newselect;
+   int		*newselect;
    genericptr   *curgen, *pathgen;
    bool	selected;
    stringpart	*strptr;
@@ -884,10 +916,7 @@ bool selectarea(objectptr selobj, short level)
    /* put points of area bounding box into proper order */
 
    if (areawin->origin.y > areawin->save.y) {
-      short tmp;
-      tmp = areawin->origin.y;
-      areawin->origin.y = areawin->save.y;
-      areawin->save.y = tmp;
+      std::swap(areawin->origin.y, areawin->save.y);
    }
    if (areawin->origin.x > areawin->save.x) {
       std::swap(areawin->origin.x, areawin->save.x);
@@ -896,8 +925,34 @@ bool selectarea(objectptr selobj, short level)
       areawin->textpos = areawin->textend = 0;
    } 
 
+   /* On large objects, consider only elements overlapping the box */
+
+   QVector<int> nearparts;
+   SpatialIndex *sidx = spatial_index(selobj);
+   int nnext = 0;
+
+   if (sidx != NULL)
+      sidx->query(areawin->origin.x, areawin->origin.y, areawin->save.x,
+		areawin->save.y, nearparts);
+
+   /* Elements already selected, so that each is checked in constant time */
+
+   QVector<bool> wasselected;
+
+   if (selobj == topobject) {
+      wasselected.fill(false, topobject->parts);
+      for (newselect = areawin->selectlist; newselect <
+		areawin->selectlist + areawin->selects; newselect++)
+	 wasselected[*newselect] = true;
+   }
+
    for (curgen = selobj->begin(); curgen != selobj->end(); curgen++) {
 
+      if (sidx != NULL) {
+         if (nnext >= nearparts.size()) break;
+         curgen = selobj->begin() + nearparts[nnext++];
+      }
+
       /* apply the selection filter */
       if (!((*curgen)->type & areawin->filter)) continue;
 
@@ -1027,17 +1082,14 @@ bool selectarea(objectptr selobj, short level)
 
       /* check if this part has already been selected */
 
-      if (selected)
-         for (newselect = areawin->selectlist; newselect <
-              areawin->selectlist + areawin->selects; newselect++)
-            if (*newselect == (short)(curgen - topobject->begin()))
-                  selected = false;
+      if (selected && wasselected[curgen - topobject->begin()])
+         selected = false;
 
       /* add to list of selections */
 
       if (selected) {
          newselect = allocselect();
-         *newselect = (short)(curgen - topobject->begin());
+         *newselect = (int)(curgen - topobject->begin());
       }
    }
    if (selobj != topobject) return false;
@@ -1167,12 +1219,12 @@ selection *recurselect(short class_, u_char mode, pushlistptr *seltop)
 {
    selection *rselect, *rcheck, *lastselect;
    genericptr rgen;
-   short i;
+   int i;
    objectptr selobj;
    objinstptr selinst;
    XPoint savesave, tmppt;
    pushlistptr selnew;
-   short j, unselects;
+   int j, unselects;
    u_char locmode = (mode == MODE_CONNECT) ? UNDO_DONE : mode;
    u_char recmode = (mode != MODE_CONNECT) ? MODE_RECURSE_WIDE : MODE_RECURSE_NARROW;
 
@@ -1282,7 +1334,7 @@ void trackselarea()
    newpos = UGetCursorPos();
    if (newpos == areawin->save) return;
 
-   areawin->update();
+   areawin->updateOverlay();
    areawin->save = newpos;
 }
 
@@ -1297,7 +1349,7 @@ void trackrescale()
    newpos = UGetCursorPos();
    if (newpos == areawin->save) return;
 
-   areawin->update();
+   areawin->updateOverlay();
    areawin->save = newpos;
 }
 
@@ -1309,12 +1361,13 @@ int dcompare(const void *a, const void *b)
 {
    XPoint cpt;
    genericptr agen, bgen;
-   short j, k, adist, bdist;
+   int j, k;
+   int adist, bdist;
 
    cpt = areawin->save;
 
-   j = *((short *)a);
-   k = *((short *)b);
+   j = *((int *)a);
+   k = *((int *)b);
 
    agen = topobject->at(j);
    bgen = topobject->at(k);
@@ -1335,7 +1388,7 @@ int dcompare(const void *a, const void *b)
 bool compareselection(selection *sa, selection *sb)
 {
    int i, j, match;
-   short n1, n2;
+   int n1, n2;
 
    if ((sa == NULL) || (sb == NULL)) return false;
    if (sa->selects != sb->selects) return false;
@@ -1363,7 +1416,8 @@ void label_connect_cycles(labelptr thislab)
    bool is_selected;
    XPoint *testpt;
    polyptr cpoly;
-   short *stest, cycle;
+   int *stest;
+   short cycle;
 
    if (thislab->pin == LOCAL || thislab->pin == GLOBAL) {
       for (pgen = topobject->begin(); pgen != topobject->end(); pgen++) {
@@ -1408,7 +1462,8 @@ void inst_connect_cycles(objinstptr thisinst)
    bool is_selected;
    XPoint refpoint;
    polyptr cpoly;
-   short *stest, cycle;
+   int *stest;
+   short cycle;
    objectptr thisobj = thisinst->thisobject;
 
    for (labeliter clab; thisobj->values(clab); ) {
@@ -1453,7 +1508,7 @@ void inst_connect_cycles(objinstptr thisinst)
 
 void select_connected_pins()
 {
-   short *selptr;
+   int *selptr;
    objinstptr selinst;
    labelptr sellab;
 
@@ -1488,11 +1543,11 @@ void reset_cycles()
 /* Recursive selection mechanism					*/
 /*----------------------------------------------------------------------*/
 
-short *recurse_select_element(short class_, u_char mode) {
+int *recurse_select_element(short class_, u_char mode) {
    pushlistptr seltop, nextptr;
    selection *rselect;
-   short *newselect, localpick;
-   static short pick = 0;
+   int *newselect, localpick;
+   static int pick = 0;
    static selection *saveselect = NULL;
    int i, j, k, ilast, jlast;
    bool unselect = false;
@@ -1512,7 +1567,7 @@ short *recurse_select_element(short class_, u_char mode) {
    if (rselect) {
       /* Order polygons according to nearest point distance. */
       qsort((void *)rselect->selectlist, (size_t)rselect->selects,
-		sizeof(short), dcompare);
+		sizeof(int), dcompare);
 
       if (compareselection(rselect, saveselect))
 	 pick++;
@@ -0,0 +1,535 @@
+/*----------------------------------------------------------------------*/
+/* spatial.cpp --- per-object spatial index of elements			*/
+/*----------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <cmath>
+
+#include <QElapsedTimer>
+
+#include "xcircuit.h"
+#include "prototypes.h"
+#include "spatial.h"
+
+/*----------------------------------------------------------------------*/
+/* Bumped whenever the bounding box of any object or instance changes.	*/
+/* Instance entries depend on the bounding box of the instanced object, */
+/* so all indexes are then rebuilt on their next use.			*/
+/*----------------------------------------------------------------------*/
+
+static int spatial_epoch = 0;
+
+SpatialIndex::SpatialIndex(object * obj) :
+        owner(obj),
+        valid(false),
+        epoch(0),
+        querymark(0),
+        nx(1), ny(1),
+        ox(0), oy(0), ux(0), uy(0),
+        cw(1), ch(1),
+        widest(0.0)
+{
+}
+
+inline int SpatialIndex::cellx(int x) const
+{
+   x = (x - ox) / cw;
+   return (x < 0) ? 0 : (x >= nx) ? nx - 1 : x;
+}
+
+inline int SpatialIndex::celly(int y) const
+{
+   y = (y - oy) / ch;
+   return (y < 0) ? 0 : (y >= ny) ? ny - 1 : y;
+}
+
+/*----------------------------------------------------------------------*/
+/* Compute the area covered by an element, as far as selection and	*/
+/* drawing are concerned.  This is the element bounding box, extended	*/
+/* by the points which are tested for selection but may lie outside of	*/
+/* it (arc centers, pins of instances).					*/
+/*----------------------------------------------------------------------*/
+
+void SpatialIndex::entrybbox(genericptr *gelem, Entry & e)
+{
+   int llx, lly, urx, ury;
+   float lwidth = 0.0;
+
+   llx = lly = MAXCOORD;
+   urx = ury = -MAXCOORD;
+
+   e.elem = *gelem;
+   e.mark = 0;
+   e.wide = false;
+   e.always = (owner->params != NULL) && has_param(*gelem);
+
+   if (!e.always) {
+      calcbboxsingle(gelem, (objinstptr)NULL, &llx, &lly, &urx, &ury);
+
+      switch (ELEMENTTYPE(*gelem)) {
+         case ARC:
+	    bboxcalc(TOARC(gelem)->position.x, &llx, &urx);
+	    bboxcalc(TOARC(gelem)->position.y, &lly, &ury);
+	    lwidth = TOARC(gelem)->width;
+	    break;
+         case GRAPHIC:
+	    bboxcalc(TOGRAPHIC(gelem)->position.x, &llx, &urx);
+	    bboxcalc(TOGRAPHIC(gelem)->position.y, &lly, &ury);
+	    break;
+         case OBJINST: {
+	    objinstptr einst = TOOBJINST(gelem);
+	    if (einst->schembbox != NULL) {
+	       XPoint pts[4], npts[4];
+	       short j;
+	       pts[0] = pts[1] = pts[2] = pts[3] = einst->schembbox->lowerleft;
+	       pts[1].y = pts[2].y = pts[0].y + einst->schembbox->height;
+	       pts[2].x = pts[3].x = pts[0].x + einst->schembbox->width;
+	       UTransformPoints(pts, npts, 4, einst->position, einst->scale,
+			einst->rotation);
+	       for (j = 0; j < 4; j++) {
+		  bboxcalc(npts[j].x, &llx, &urx);
+		  bboxcalc(npts[j].y, &lly, &ury);
+	       }
+	    }
+	    lwidth = 2.0 * fabs(einst->scale);
+	    } break;
+         case POLYGON:
+	    lwidth = TOPOLY(gelem)->width;
+	    break;
+         case SPLINE:
+	    lwidth = TOSPLINE(gelem)->width;
+	    break;
+         case PATH:
+	    lwidth = TOPATH(gelem)->width;
+	    break;
+         default:
+	    break;
+      }
+   }
+
+   /* Elements without extent (e.g., labels with empty parameters)	*/
+   /* are simply always returned.					*/
+
+   if ((llx > urx) || (lly > ury)) e.always = true;
+
+   e.llx = llx;
+   e.lly = lly;
+   e.urx = urx;
+   e.ury = ury;
+   if (lwidth > widest) widest = lwidth;
+}
+
+/*----------------------------------------------------------------------*/
+/* Add element "i" to the grid cells it covers				*/
+/*----------------------------------------------------------------------*/
+
+void SpatialIndex::insert(int i)
+{
+   Entry &e = entries[i];
+   int x, y, x0, y0, x1, y1;
+
+   if (!e.always) {
+      x0 = cellx(e.llx);
+      x1 = cellx(e.urx);
+      y0 = celly(e.lly);
+      y1 = celly(e.ury);
+      e.wide = ((x1 - x0 + 1) * (y1 - y0 + 1) > MaxCells);
+   }
+   if (e.always || e.wide) {
+      e.wide = true;
+      always.append(i);
+      return;
+   }
+   for (y = y0; y <= y1; y++)
+      for (x = x0; x <= x1; x++)
+	 cells[y * nx + x].append(i);
+}
+
+/*----------------------------------------------------------------------*/
+/* Remove element "i" from the grid cells, using its recorded extent	*/
+/*----------------------------------------------------------------------*/
+
+void SpatialIndex::remove(int i)
+{
+   Entry &e = entries[i];
+   int x, y;
+
+   if (e.wide) {
+      always.removeOne(i);
+      return;
+   }
+   for (y = celly(e.lly); y <= celly(e.ury); y++)
+      for (x = cellx(e.llx); x <= cellx(e.urx); x++)
+	 cells[y * nx + x].removeOne(i);
+}
+
+/*----------------------------------------------------------------------*/
+/* Rebuild the index from scratch.  The grid covers the extent of all	*/
+/* elements, with cells holding a handful of elements each on average.	*/
+/*----------------------------------------------------------------------*/
+
+void SpatialIndex::rebuild()
+{
+   genericptr *gelem;
+   int i, n, ncells;
+   long lx, ly, hx, hy, width, height;
+
+   n = owner->parts;
+   entries.resize(n);
+   always.clear();
+   widest = 0.0;
+
+   lx = ly = MAXCOORD;
+   hx = hy = -MAXCOORD;
+   for (i = 0, gelem = owner->begin(); i < n; i++, gelem++) {
+      Entry &e = entries[i];
+      entrybbox(gelem, e);
+      if (e.always) continue;
+      if (e.llx < lx) lx = e.llx;
+      if (e.lly < ly) ly = e.lly;
+      if (e.urx > hx) hx = e.urx;
+      if (e.ury > hy) hy = e.ury;
+   }
+   if (lx > hx) lx = hx = 0;
+   if (ly > hy) ly = hy = 0;
+
+   ox = lx;
+   oy = ly;
+   ux = hx;
+   uy = hy;
+   width = hx - lx + 1;
+   height = hy - ly + 1;
+
+   ncells = qMax(1, n / 4);
+   nx = (int)(sqrt((double)ncells * width / height) + 0.5);
+   nx = qBound(1, nx, 256);
+   ny = qBound(1, ncells / nx, 256);
+   cw = (int)((width + nx - 1) / nx);
+   ch = (int)((height + ny - 1) / ny);
+
+   cells.clear();
+   cells.resize(nx * ny);
+   for (i = 0; i < n; i++) insert(i);
+
+   querymark = 0;
+   epoch = spatial_epoch;
+   valid = true;
+}
+
+/*----------------------------------------------------------------------*/
+/* Revise the entry of a single element whose geometry has changed.	*/
+/*----------------------------------------------------------------------*/
+
+void SpatialIndex::update(genericptr *gelem)
+{
+   int i;
+
+   if (!valid) return;
+
+   i = gelem - owner->begin();
+   if ((owner->parts != entries.size()) || (i < 0) || (i >= entries.size())) {
+      valid = false;
+      return;
+   }
+   remove(i);
+   entrybbox(gelem, entries[i]);
+   insert(i);
+}
+
+/*----------------------------------------------------------------------*/
+/* Add the elements of one list which overlap the given area and have	*/
+/* not been seen yet in this query.  Returns false if the index turned	*/
+/* out to be out of date.						*/
+/*----------------------------------------------------------------------*/
+
+bool SpatialIndex::scan(const QVector<int> & list, int llx, int lly,
+		int urx, int ury, QVector<int> & found)
+{
+   foreach (int i, list) {
+      Entry &e = entries[i];
+      if (e.mark == querymark) continue;
+      e.mark = querymark;
+      if (!e.always && ((e.urx < llx) || (e.llx > urx) ||
+		(e.ury < lly) || (e.lly > ury)))
+	 continue;
+      if (owner->at(i) != e.elem) return false;
+      found.append(i);
+   }
+   return true;
+}
+
+/*----------------------------------------------------------------------*/
+/* Gather the elements overlapping the given area from the cells	*/
+/* covering it and from the list of unfiled elements.			*/
+/*----------------------------------------------------------------------*/
+
+bool SpatialIndex::collect(int llx, int lly, int urx, int ury,
+		QVector<int> & found)
+{
+   int x, y;
+
+   querymark++;
+
+   if (!scan(always, llx, lly, urx, ury, found)) return false;
+   for (y = celly(lly); y <= celly(ury); y++)
+      for (x = cellx(llx); x <= cellx(urx); x++)
+	 if (!scan(cells[y * nx + x], llx, lly, urx, ury, found)) return false;
+   return true;
+}
+
+/*----------------------------------------------------------------------*/
+/* Find the indices of all elements which may overlap the given area	*/
+/* (in the object's own coordinates), in drawing order.			*/
+/*----------------------------------------------------------------------*/
+
+void SpatialIndex::query(int llx, int lly, int urx, int ury,
+		QVector<int> & found)
+{
+   found.clear();
+   if (!valid || (epoch != spatial_epoch) || (owner->parts != entries.size()))
+      rebuild();
+
+   if (!collect(llx, lly, urx, ury, found)) {
+      found.clear();
+      rebuild();
+      collect(llx, lly, urx, ury, found);
+   }
+   std::sort(found.begin(), found.end());
+}
+
+/*----------------------------------------------------------------------*/
+/* Return the spatial index of an object, or NULL if the object is too	*/
+/* small for one to be worthwhile.					*/
+/*----------------------------------------------------------------------*/
+
+SpatialIndex *spatial_index(objectptr thisobj)
+{
+   if (thisobj->parts < SpatialIndex::MinParts) return NULL;
+   if (thisobj->spatial == NULL)
+      thisobj->spatial = new SpatialIndex(thisobj);
+   return thisobj->spatial;
+}
+
+/*----------------------------------------------------------------------*/
+/* The object has changed in some unknown way; rebuild before next use	*/
+/*----------------------------------------------------------------------*/
+
+void spatial_invalidate(objectptr thisobj)
+{
+   if (thisobj->spatial != NULL)
+      thisobj->spatial->invalidate();
+}
+
+/*----------------------------------------------------------------------*/
+/* A single element of the object has moved or changed size		*/
+/*----------------------------------------------------------------------*/
+
+void spatial_update(objectptr thisobj, genericptr *gelem)
+{
+   if (thisobj->spatial != NULL)
+      thisobj->spatial->update(gelem);
+}
+
+/*----------------------------------------------------------------------*/
+/* The bounding box of an object or instance has changed, so instance	*/
+/* entries anywhere may be out of date.					*/
+/*----------------------------------------------------------------------*/
+
+void spatial_bboxchanged()
+{
+   spatial_epoch++;
+}
+
+/*----------------------------------------------------------------------*/
+/* "xcircuit -benchparts <count>":  build an object of "count" boxes	*/
+/* laid out on a square grid, one element at a time, then index it and	*/
+/* look up single boxes in it.  Element lists grow by doubling, so the	*/
+/* list must be reallocated no more than a logarithmic number of times;	*/
+/* the index must hold every box, and each lookup inside a box must	*/
+/* find that box alone.  The edits of benchedits() are then timed at	*/
+/* a tenth of "count" and at "count", and must not take more than	*/
+/* SPATIAL_BENCHGROWTH times as long on the larger object.  Returns	*/
+/* nonzero on failure.							*/
+/*----------------------------------------------------------------------*/
+
+#define SPATIAL_BENCHPITCH	64	/* grid spacing of the boxes */
+#define SPATIAL_BENCHSIZE	32	/* side of each box */
+#define SPATIAL_BENCHLOOKUPS	100000
+#define SPATIAL_BENCHGROWTH	30	/* for ten times the elements */
+#define SPATIAL_BENCHEDITS	5	/* edits timed by benchedits() */
+
+static const char *benchsteps[SPATIAL_BENCHEDITS] = {
+   "select all", "delete", "undo delete", "redo delete", "flush undo"
+};
+
+/*----------------------------------------------------------------------*/
+/* Add "count" boxes on a square grid to object "bench".		*/
+/*----------------------------------------------------------------------*/
+
+static void benchboxes(objectptr bench, int count)
+{
+   polyptr *newpoly;
+   int side, i, x, y;
+
+   side = (int)ceil(sqrt((double)count));
+   for (i = 0; i < count; i++) {
+      x = (i % side) * SPATIAL_BENCHPITCH;
+      y = (i / side) * SPATIAL_BENCHPITCH;
+      newpoly = bench->append(new polygon(4, x, y));
+      (*newpoly)->points[1].y += SPATIAL_BENCHSIZE;
+      (*newpoly)->points[2].x += SPATIAL_BENCHSIZE;
+      (*newpoly)->points[2].y += SPATIAL_BENCHSIZE;
+      (*newpoly)->points[3].x += SPATIAL_BENCHSIZE;
+   }
+}
+
+/*----------------------------------------------------------------------*/
+/* Time the edits of an object of "count" boxes, shown as the top	*/
+/* page:  select all of it through selectarea(), delete it through	*/
+/* standard_element_delete() (delete_element() and its undo record),	*/
+/* undo the delete (xc_undelete() and the uselection record), redo it	*/
+/* (uselection::regen() and delete_element()), undo it again, and free	*/
+/* the undo records.  The time of each is put in "ms".  Returns		*/
+/* nonzero if an edit leaves the wrong number of elements.		*/
+/*----------------------------------------------------------------------*/
+
+static int benchedits(int count, double ms[SPATIAL_BENCHEDITS])
+{
+   objectptr bench = new object;
+   objinstptr benchinst = new objinst(bench), saveinst;
+   QElapsedTimer timer;
+   short savefilter;
+   int failed = 0, selects;
+
+   benchboxes(bench, count);
+   calcbbox(benchinst);
+
+   flush_undo_stack();
+   unselect_all();
+   saveinst = areawin->topinstance;
+   savefilter = areawin->filter;
+   areawin->topinstance = benchinst;
+   areawin->filter = ALL_TYPES;
+
+   areawin->origin.x = areawin->origin.y = -MAXCOORD;
+   areawin->save.x = areawin->save.y = MAXCOORD;
+   timer.start();
+   selectarea(bench, 0);
+   ms[0] = timer.nsecsElapsed() / 1.0e6;
+   selects = areawin->selects;
+
+   timer.restart();
+   standard_element_delete();
+   ms[1] = timer.nsecsElapsed() / 1.0e6;
+   if ((selects != count) || (bench->parts != 0)) failed = 1;
+
+   timer.restart();
+   undo_action();
+   ms[2] = timer.nsecsElapsed() / 1.0e6;
+   if (bench->parts != count) failed = 1;
+
+   timer.restart();
+   redo_action();
+   ms[3] = timer.nsecsElapsed() / 1.0e6;
+   if (bench->parts != 0) failed = 1;
+
+   undo_action();
+   if (bench->parts != count) failed = 1;
+
+   timer.restart();
+   unselect_all();
+   flush_undo_stack();
+   ms[4] = timer.nsecsElapsed() / 1.0e6;
+
+   if (failed)
+      Fprintf(stderr, "selected %d of %d elements; %d left after edits\n",
+		selects, count, bench->parts);
+
+   areawin->topinstance = saveinst;
+   areawin->filter = savefilter;
+   delete benchinst;
+   delete bench;
+   return failed;
+}
+
+int spatial_benchmark(int count)
+{
+   objectptr bench;
+   QVector<int> found;
+   QElapsedTimer timer;
+   double small[SPATIAL_BENCHEDITS], large[SPATIAL_BENCHEDITS];
+   u_int resizes = Plist::resizes, allowed;
+   int side, i, j, x, y, failed = 0;
+
+   if (count < 1) count = 1000000;
+   side = (int)ceil(sqrt((double)count));
+
+   /* Allowed reallocations:  one per doubling from the first 4 slots */
+   for (allowed = 1, j = 4; j < count; j <<= 1) allowed++;
+
+   bench = new object;
+   timer.start();
+   benchboxes(bench, count);
+   resizes = Plist::resizes - resizes;
+   Fprintf(stdout, "append %d elements: %.2f ms, %u reallocations\n", count,
+		timer.nsecsElapsed() / 1.0e6, resizes);
+   if ((bench->parts != count) || (resizes > allowed)) {
+      Fprintf(stderr, "element list grew %u times (at most %u allowed)\n",
+		resizes, allowed);
+      failed = 1;
+   }
+
+   /* The first query builds the index */
+
+   timer.restart();
+   if (spatial_index(bench) != NULL)
+      spatial_index(bench)->query(-MAXCOORD, -MAXCOORD, MAXCOORD, MAXCOORD,
+		found);
+   Fprintf(stdout, "index %d elements: %.2f ms\n", count,
+		timer.nsecsElapsed() / 1.0e6);
+   if ((count >= SpatialIndex::MinParts) && (found.size() != count)) {
+      Fprintf(stderr, "index holds %d of %d elements\n", found.size(), count);
+      failed = 1;
+   }
+
+   if (count >= SpatialIndex::MinParts) {
+      timer.restart();
+      for (j = 0; j < SPATIAL_BENCHLOOKUPS; j++) {
+	 i = (int)(((qint64)j * 7919) % count);
+	 x = (i % side) * SPATIAL_BENCHPITCH + SPATIAL_BENCHSIZE / 4;
+	 y = (i / side) * SPATIAL_BENCHPITCH + SPATIAL_BENCHSIZE / 4;
+	 spatial_index(bench)->query(x, y, x + SPATIAL_BENCHSIZE / 2,
+		y + SPATIAL_BENCHSIZE / 2, found);
+	 if ((found.size() != 1) || (found[0] != i)) {
+	    Fprintf(stderr, "lookup of element %d found %d elements\n", i,
+			found.size());
+	    failed = 1;
+	    break;
+	 }
+      }
+      Fprintf(stdout, "look up %d elements: %.2f us per lookup\n",
+		SPATIAL_BENCHLOOKUPS, timer.nsecsElapsed() /
+		(1.0e3 * SPATIAL_BENCHLOOKUPS));
+   }
+
+   delete bench;
+
+   /* Edits must grow no faster than the object, give or take noise */
+
+   if (count >= 10) {
+      if (benchedits(count / 10, small) || benchedits(count, large))
+	 failed = 1;
+      for (j = 0; j < SPATIAL_BENCHEDITS; j++) {
+	 Fprintf(stdout, "%s: %.2f ms for %d elements, %.2f ms for %d\n",
+		benchsteps[j], small[j], count / 10, large[j], count);
+	 if (large[j] > SPATIAL_BENCHGROWTH * std::max(small[j], 1.0)) {
+	    Fprintf(stderr, "%s grows faster than the element count\n",
+			benchsteps[j]);
+	    failed = 1;
+	 }
+      }
+   }
+
+   Fprintf(stdout, "element scale check %s\n", failed ? "failed" : "passed");
+   return failed;
+}
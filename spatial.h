@@ -0,0 +1,67 @@
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include <QVector>
+
+#include "xctypes.h"
+
+class object;
+class generic;
+
+/*----------------------------------------------------------------------*/
+/* Uniform grid over the elements of one object, used to find the	*/
+/* elements near a point or inside an area without looking at every	*/
+/* element.  Queries return element indices in plist (drawing) order.	*/
+/*									*/
+/* The index is rebuilt lazily:  it is marked invalid when the object	*/
+/* is changed in an unknown way, and rebuilt on the next query.  Single	*/
+/* elements are revised in place from calcbboxvalues().  Elements with	*/
+/* parameters change with every instance, so they are never filtered.	*/
+/*----------------------------------------------------------------------*/
+
+class SpatialIndex {
+public:
+    explicit SpatialIndex(object *);
+
+    inline void invalidate() { valid = false; }
+    void update(generic **);
+    void query(int llx, int lly, int urx, int ury, QVector<int> &);
+    inline float maxwidth() const { return widest; }
+
+    /* objects with fewer elements are simply scanned */
+    static const int MinParts = 64;
+    /* elements spanning more cells are kept in a separate list */
+    static const int MaxCells = 64;
+
+private:
+    struct Entry {
+        generic *elem;
+        int llx, lly, urx, ury;
+        int mark;
+        bool always;		/* never filtered out */
+        bool wide;		/* kept in the "always" list */
+    };
+
+    void rebuild();
+    void entrybbox(generic **, Entry &);
+    void insert(int);
+    void remove(int);
+    inline int cellx(int x) const;
+    inline int celly(int y) const;
+    bool scan(const QVector<int> &, int, int, int, int, QVector<int> &);
+    bool collect(int, int, int, int, QVector<int> &);
+
+    object *owner;
+    bool valid;
+    int epoch;
+    int querymark;
+    int nx, ny;
+    int ox, oy, ux, uy;		/* grid bounds (user units) */
+    int cw, ch;			/* cell size */
+    float widest;		/* largest line width of any element */
+    QVector<Entry> entries;
+    QVector<QVector<int> > cells;
+    QVector<int> always;	/* parameterized, unbounded or huge elements */
+};
+
+#endif // SPATIAL_H
@@ -945,7 +945,7 @@ static void SVGDrawString(DrawContext* ctx, labelptr drawlabel, int passcolor, o
 
 static void OutputSVG(DrawContext* ctx, char *filename, bool fullscale)
 {
-   short	savesel;
+   int	savesel;
    objinstptr	pinst;
    int cstyle;
    float outwidth, outheight, cscale;
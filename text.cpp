@@ -17,6 +17,7 @@
 #include "prototypes.h"
 #include "xcqt.h"
 #include "colors.h"
+#include "layout.h"
 
 /*------------------------------------------------------------------------*/
 /* External Variable definitions                                          */
@@ -70,7 +71,7 @@ bool hasparameter(labelptr curlabel)
 
 void joinlabels()
 {
-   short *jl;
+   int *jl;
    stringpart *endpart;
    labelptr dest, source;
 
@@ -113,6 +114,8 @@ stringpart *makesegment(stringpart **strhead, stringpart *before)
 {
    stringpart *newptr, *lastptr, *nextptr;
 
+   layout_invalidate();
+
    newptr = new stringpart;
    newptr->data.string = NULL;
 
@@ -234,6 +237,8 @@ stringpart *deletestring(stringpart *dstr, stringpart **strtop, objinstptr thisi
    char *key;
    oparamptr ops;
 
+   layout_invalidate();
+
    if (dstr == *strtop)
       *strtop = dstr->nextpart;
    else {
@@ -282,7 +287,7 @@ stringpart *deletestring(stringpart *dstr, stringpart **strtop, objinstptr thisi
    }
    if (dstr->type == TEXT_STRING)
       free(dstr->data.string);
-   free(dstr);
+   delete dstr;
 
    /* attempt to merge, if legal */
    if (strptr)
@@ -304,6 +309,8 @@ stringpart *mergestring(stringpart *firststr)
 {
    stringpart *nextstr = NULL;
 
+   layout_invalidate();
+
    if (firststr) nextstr = firststr->nextpart;
    if (nextstr != NULL) {
       if (firststr->type == TEXT_STRING && nextstr->type == TEXT_STRING) {
@@ -312,7 +319,7 @@ stringpart *mergestring(stringpart *firststr)
 		1 + strlen(firststr->data.string) + strlen(nextstr->data.string));
          strcat(firststr->data.string, nextstr->data.string);
          free(nextstr->data.string);
-         free(nextstr);
+         delete nextstr;
       }
    }
    return firststr;
@@ -328,7 +335,8 @@ stringpart *mergestring(stringpart *firststr)
 /* 11/20/06---changed to allow two different static strings to save	*/
 /* promoted results.  This is necessary because we may be comparing	*/
 /* two promoted results in, e.g., stringcomprelaxed(), and we don't	*/
-/* want to overwrite the first result with the second.			*/
+/* want to overwrite the first result with the second.  Each thread	*/
+/* (drawing threads, netlist jobs) has strings of its own.		*/
 /*----------------------------------------------------------------------*/
 
 stringpart *linkstring(objinstptr localinst, stringpart *strstart,
@@ -336,8 +344,8 @@ stringpart *linkstring(objinstptr localinst, stringpart *strstart,
 {
    char *key;
    stringpart *tmpptr, *nextptr = NULL;
-   static stringpart *promote[2] = {NULL, NULL};
-   static unsigned char pidx = 0;
+   static thread_local stringpart *promote[2] = {NULL, NULL};
+   static thread_local unsigned char pidx = 0;
    oparamptr ops;
 
    if (strstart->type != PARAM_START) return NULL;
@@ -1213,6 +1221,9 @@ stringpart *stringcopyback(stringpart *string, objinstptr thisinst)
    oparamptr pparam;
    bool need_free;
 
+   /* numeric parameter values may be changed in place */
+   param_invalidate();
+
    for (strptr = string; strptr != NULL; strptr = strptr->nextpart) {
 
       newpart = new stringpart;
@@ -1311,22 +1322,13 @@ short UDrawChar(DrawContext* ctx, u_char code, short styles, short ffont, int gr
    objectptr drawchar;
    XPoint alphapts[2];
    short  localwidth;
-   objinst charinst;
 
    if ((ffont >= fontcount) || (fonts[ffont].encoding == NULL))
       return 0;
 
-   alphapts[0].x = 0;
-   alphapts[0].y = 0;
-   charinst.color = DEFAULTCOLOR;
-   charinst.rotation = 0;
-   charinst.scale = fonts[ffont].scale;
-   charinst.position = alphapts[0];
-   
    /* get proper font and character */
 
    drawchar = fonts[ffont].encoding[(u_char)code];
-   charinst.thisobject = drawchar;
 
    localwidth = (drawchar->bbox.lowerleft.x + drawchar->bbox.width) * fonts[ffont].scale;
 
@@ -1335,8 +1337,22 @@ short UDrawChar(DrawContext* ctx, u_char code, short styles, short ffont, int gr
    }
 
    if (!(styles & 64)) {
-      
-      UDrawObject(ctx, &charinst, SINGLE, passcolor, NULL);
+
+      /* Most characters are drawn from their flattened glyph; those	*/
+      /* which cannot be flattened are drawn as an object instance.	*/
+
+      if (!glyph_draw(ctx, drawchar, fonts[ffont].scale, passcolor)) {
+         objinst charinst;
+
+         alphapts[0].x = 0;
+         alphapts[0].y = 0;
+         charinst.color = DEFAULTCOLOR;
+         charinst.rotation = 0;
+         charinst.scale = fonts[ffont].scale;
+         charinst.position = alphapts[0];
+         charinst.thisobject = drawchar;
+         UDrawObject(ctx, &charinst, SINGLE, passcolor, NULL);
+      }
 
       /* under- and overlines */
       if (styles & 8)
@@ -1367,7 +1383,6 @@ void UDrawString(DrawContext* ctx, labelptr drawlabel, int passcolor, objinstptr
    float  tmpscale = 1.0, natscale = 1.0;
    float  tmpthick = xobjs.pagelist[areawin->page].wirewidth;
    XPoint newpoint, bboxin[2], bboxout[2];
-   u_char xm, ym;
    TextExtents tmpext;
    short *tabstops = NULL;
    short tabno, numtabs = 0;
@@ -1427,11 +1442,8 @@ void UDrawString(DrawContext* ctx, labelptr drawlabel, int passcolor, objinstptr
    bboxin[1].x = newpoint.x + tmpext.width;
    bboxin[1].y = newpoint.y + tmpext.ascent;
    ctx->CTM().transform(bboxin, bboxout, 2);
-   xm = (bboxout[0].x < bboxout[1].x) ? 0 : 1;
-   ym = (bboxout[0].y < bboxout[1].y) ? 0 : 1;
 
-   if (bboxout[xm].x < areawin->width() && bboxout[ym].y < areawin->height() &&
-       bboxout[1 - xm].x > 0 && bboxout[1 - ym].y > 0) {
+   if (ctx->visible(bboxout)) {
 
        pos = 0;
        for (strptr = drawlabel->string; strptr != NULL;
@@ -1631,29 +1643,44 @@ void UDrawString(DrawContext* ctx, labelptr drawlabel, int passcolor, objinstptr
 }
 
 /*----------------------------------------------------------------------*/
-/* Compute the actual length of a string or portion thereof.		*/
+/* Record the extents for all string positions up to "locpos" not yet	*/
+/* recorded.  These are the extents ULength() would return if stopped	*/
+/* at that position.							*/
 /*----------------------------------------------------------------------*/
 
-TextExtents ULength(const label * drawlabel, objinstptr localinst,
-        short dostop, XPoint *tbreak)
+static void layoutstops(TextLayout *layout, short locpos, float xtotal,
+	const TextExtents *retext)
+{
+   TextExtents stopext = *retext;
+
+   stopext.width = qMax((short)0, (short)xtotal);
+   while (layout->stops.size() < locpos)
+      layout->stops.append(stopext);
+}
+
+/*----------------------------------------------------------------------*/
+/* Measure a string, recording the extents at each string position and	*/
+/* the position of each character (see layout.h).  If "strip" is set,	*/
+/* technology namespaces are not counted.				*/
+/*----------------------------------------------------------------------*/
+
+void layoutstring(const label * drawlabel, objinstptr localinst, bool strip,
+	TextLayout *layout)
 {
    float oldscale, strscale, natscale, locscale = 1.0, xtotal = 0.5;
-   float lasttotal = xtotal;
    stringpart *strptr;
    u_char *textptr;
    objectptr *somebet = NULL, chptr;
-   short locpos = 0, lastpos = 0;
+   short locpos = 0;
    float ykern = 0.0;
    TextExtents retext;
+   TextLayout::Glyph glyph;
+   oparamptr ops;
    short *tabstops = NULL;
-   short tabno, numtabs = 0;
-
-   retext.width = retext.ascent = retext.descent = retext.base = 0;
+   short tabno, numtabs = 0, maxwidth = 0;
 
-   if (fontcount == 0) return retext;
-
-   /* Don't draw temporary labels from schematic capture system */
-   else if (drawlabel->string->type != FONT_NAME) return retext;
+   layout->clear();
+   retext = layout->full;
 
    natscale = 1.0;
      
@@ -1680,8 +1707,7 @@ TextExtents ULength(const label * drawlabel, objinstptr localinst,
 	    natscale = strscale = oldscale;
 	    ykern = 0.0;
 	    retext.base -= BASELINE;
-	    if (!dostop)
-               retext.width = qMax(retext.width, (short)xtotal);
+            maxwidth = qMax(maxwidth, (short)xtotal);
 	    xtotal = 0.5;
 	    break;
 	 case HALFSPACE: 
@@ -1737,15 +1763,20 @@ TextExtents ULength(const label * drawlabel, objinstptr localinst,
 	          natscale = locscale;
 	    }
 	    break;
+	 case PARAM_START:
+	    /* Expression results may change between calls */
+	    ops = (localinst == NULL) ? match_param(topobject, strptr->data.string)
+			: find_param(localinst, strptr->data.string);
+	    if ((ops != NULL) && (ops->type == XC_EXPR))
+	       layout->cacheable = false;
+	    break;
 	 case TEXT_STRING:
             textptr = (u_char*)strptr->data.string;
 
 	    /* Don't write technology names in catalog mode if	*/
 	    /* the option is enabled, so ignore when measuring	*/
 
-	    if (((eventmode == CATALOG_MODE) && !xobjs.showtech)
-			|| ((eventmode == CATTEXT_MODE)
-			&& (drawlabel != TOLABEL(EDITPART)))) {
+	    if (strip) {
                 char *nsptr = strstr((const char*)textptr, "::");
 		if (nsptr != NULL) {
                    textptr = (u_char*)nsptr + 2;
@@ -1755,7 +1786,7 @@ TextExtents ULength(const label * drawlabel, objinstptr localinst,
 
 	    if (somebet == NULL) break;
 	    for (; textptr && *textptr != '\0'; textptr++) {
-               if (dostop && (locpos >= dostop)) break;
+               layoutstops(layout, locpos, xtotal, &retext);
 	       locpos++;
 
 	       chptr = (*(somebet + *textptr));
@@ -1767,30 +1798,67 @@ TextExtents ULength(const label * drawlabel, objinstptr localinst,
                retext.descent = qMin(retext.descent, (short)(retext.base + ykern +
 			(float)(chptr->bbox.lowerleft.y * locscale * strscale)));
 
-               if (tbreak != NULL) 
-	          if ((xtotal > tbreak->x) && (retext.base <= tbreak->y)) break;
-               lasttotal = xtotal;
-	       lastpos = locpos;
+	       glyph.pos = locpos;
+	       glyph.base = retext.base;
+	       glyph.x = xtotal;
+	       layout->glyphs.append(glyph);
 	    }
 	    break;
       }
       if (strptr->type != TEXT_STRING) locpos++;
-      if (dostop && (locpos >= dostop)) break;
+      layoutstops(layout, locpos, xtotal, &retext);
    }
    if (tabstops != NULL) free(tabstops);
 
+   layout->tail = retext;
+   layout->tail.width = qMax((short)0, (short)xtotal);
+   layout->full = retext;
+   layout->full.width = qMax(maxwidth, (short)xtotal);
+   layout->xend = xtotal;
+   layout->posend = locpos;
+}
+
+/*----------------------------------------------------------------------*/
+/* Compute the actual length of a string or portion thereof.		*/
+/*									*/
+/* If "dostop" is nonzero, measure only up to that string position.	*/
+/* If "tbreak" is non-NULL, return in retext.width the string position	*/
+/* nearest to that point instead.  Measurements are cached with the	*/
+/* label (see layout.cpp).						*/
+/*----------------------------------------------------------------------*/
+
+TextExtents ULength(const label * drawlabel, objinstptr localinst,
+        short dostop, XPoint *tbreak)
+{
+   TextExtents retext;
+   TextLayout scratch;
+   const TextLayout *layout;
+   bool strip;
+
+   retext.width = retext.ascent = retext.descent = retext.base = 0;
+
+   if (fontcount == 0) return retext;
+
+   /* Don't draw temporary labels from schematic capture system */
+   else if (drawlabel->string->type != FONT_NAME) return retext;
+
+   /* Don't write technology names in catalog mode if the option is	*/
+   /* enabled, so ignore when measuring					*/
+
+   strip = (((eventmode == CATALOG_MODE) && !xobjs.showtech)
+		|| ((eventmode == CATTEXT_MODE)
+		&& (drawlabel != TOLABEL(EDITPART))));
+
+   layout = textlayout(drawlabel, localinst, strip, &scratch);
+
    /* special case: return character position in retext.width */
    if (tbreak != NULL) {
-      int slen = stringlength(drawlabel->string, true, localinst);
-      if ((tbreak->x - lasttotal) < (xtotal - tbreak->x))
-	 locpos = lastpos + 1;
-      if (locpos < 1) locpos = 1;
-      else if (locpos > slen) locpos = slen;
-      retext.width = locpos;
+      retext.width = layout->hit(tbreak, stringlength(drawlabel->string,
+		true, localinst));
       return retext;
    }
-   retext.width = qMax(retext.width, (short int)xtotal);
-   return retext;
+   if (dostop) return layout->stop(dostop);
+   return layout->full;
 }
 
 /*----------------------------------------------------------------------*/
@@ -0,0 +1,176 @@
+/*----------------------------------------------------------------------*/
+/* tiles.cpp --- drawing the page on several threads at once		*/
+/*----------------------------------------------------------------------*/
+
+#include <QAtomicInt>
+#include <QImage>
+#include <QPainter>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+
+#include "xcircuit.h"
+#include "prototypes.h"
+#include "colors.h"
+#include "context.h"
+#include "xcqt.h"
+
+/*----------------------------------------------------------------------*/
+/* The elements of the page are drawn in square tiles, each into an	*/
+/* image of its own, by a pool of threads and the GUI thread together;	*/
+/* the images are then copied into place by the GUI thread.  Each tile	*/
+/* culls the hierarchy against its own area, so that only the parts of	*/
+/* the page falling in the tile are visited.  While the tiles are	*/
+/* drawn the GUI thread does nothing else, so the window and the	*/
+/* objects may be read freely;  whatever drawing writes to is guarded	*/
+/* by the draw lock (see context.h).					*/
+/*									*/
+/* Areas of a single tile are drawn directly, as are objects with	*/
+/* parameters at the top level, and everything when "set drawthreads	*/
+/* 1" is given in the startup script.					*/
+/*----------------------------------------------------------------------*/
+
+#define TILE_SIZE	256	/* pixels along each side */
+
+typedef struct {
+   QRect	area;		/* window area of the tile */
+   QPointF	origin;		/* window position of the image */
+   QImage	image;
+} Tile;
+
+static int drawthreads = 0;	/* 0 for one per processor */
+
+/*----------------------------------------------------------------------*/
+/* Number of threads to draw with, counting the GUI thread		*/
+/*----------------------------------------------------------------------*/
+
+static int tiles_threads()
+{
+   if (drawthreads > 0) return drawthreads;
+   return qMax(QThread::idealThreadCount(), 1);
+}
+
+static QThreadPool *tiles_pool()
+{
+   static QThreadPool *pool = NULL;
+
+   if (pool == NULL) pool = new QThreadPool;
+   return pool;
+}
+
+void tiles_setthreads(int threads)
+{
+   drawthreads = (threads < 0) ? 0 : threads;
+}
+
+/*----------------------------------------------------------------------*/
+/* Draw the page into the image of one tile.  The image covers whole	*/
+/* device pixels, so that it can be copied into the scene unscaled.	*/
+/*----------------------------------------------------------------------*/
+
+static void drawtile(Tile *tile, qreal ratio, int margin)
+{
+   pushlistptr hierstack = NULL;
+   QRect pixels = QRectF(QPointF(tile->area.topLeft()) * ratio,
+		QSizeF(tile->area.size()) * ratio).toAlignedRect();
+
+   tile->origin = QPointF(pixels.topLeft()) / ratio;
+   tile->image = QImage(pixels.size(), QImage::Format_ARGB32_Premultiplied);
+   tile->image.setDevicePixelRatio(ratio);
+   tile->image.fill(Qt::transparent);
+
+   QPainter p(&tile->image);
+   p.setRenderHint(QPainter::Antialiasing, areawin->antialias);
+   p.translate(-tile->origin);
+   DrawContext c(&p);
+   c.setClipRect(tile->area.adjusted(-margin, -margin, margin, margin));
+
+   SetForeground(c.gc(), FOREGROUND);
+   UDrawObject(&c, areawin->topinstance, TOPLEVEL, FOREGROUND, &hierstack);
+   free_stack(&hierstack);
+}
+
+/*----------------------------------------------------------------------*/
+/* Each thread takes the next tile not yet taken until there are none	*/
+/* left, so that threads which draw empty tiles go on to others.	*/
+/*----------------------------------------------------------------------*/
+
+static void drawtiles(Tile *tiles, int count, QAtomicInt *next, qreal ratio,
+	int margin)
+{
+   int i;
+
+   while ((i = next->fetchAndAddRelaxed(1)) < count)
+      drawtile(tiles + i, ratio, margin);
+}
+
+class TileJob : public QRunnable {
+public:
+   TileJob(Tile *tiles, int count, QAtomicInt *next, qreal ratio, int margin) :
+	tiles(tiles), count(count), next(next), ratio(ratio), margin(margin) {}
+   void run() { drawtiles(tiles, count, next, ratio, margin); }
+
+private:
+   Tile *tiles;
+   int count;
+   QAtomicInt *next;
+   qreal ratio;
+   int margin;
+};
+
+/*----------------------------------------------------------------------*/
+/* Draw the elements of the page in "area" of the window, through the	*/
+/* painter of "ctx".  Called by drawScene() after the background and	*/
+/* grid have been drawn.						*/
+/*----------------------------------------------------------------------*/
+
+void tiles_draw(DrawContext *ctx, const QRect &area)
+{
+   QPainter *p = ctx->gc();
+   QVector<Tile> tiles;
+   QAtomicInt next(0);
+   qreal ratio = p->device()->devicePixelRatioF();
+   int threads = tiles_threads();
+   int margin, x, y, i;
+
+   /* Tiles are laid out on a fixed grid, clipped to the area.  An	*/
+   /* object with parameters is drawn wholly under the draw lock, so	*/
+   /* when the top object has them (a symbol being edited) the tiles	*/
+   /* could only be drawn one at a time, and are not used.		*/
+
+   if ((threads > 1) && (areawin->topinstance->thisobject->params == NULL))
+      for (y = area.top() - area.top() % TILE_SIZE; y <= area.bottom(); y += TILE_SIZE)
+	 for (x = area.left() - area.left() % TILE_SIZE; x <= area.right();
+			x += TILE_SIZE) {
+	    Tile tile;
+	    tile.area = QRect(x, y, TILE_SIZE, TILE_SIZE).intersected(area);
+	    if (!tile.area.isEmpty()) tiles.append(tile);
+	 }
+
+   if (tiles.size() < 2) {
+      pushlistptr hierstack = NULL;
+
+      SetForeground(ctx->gc(), FOREGROUND);
+      UDrawObject(ctx, areawin->topinstance, TOPLEVEL, FOREGROUND, &hierstack);
+      free_stack(&hierstack);
+      return;
+   }
+
+   /* Elements whose bounding box misses a tile may still reach into	*/
+   /* it with their line width, so cull generously.			*/
+
+   margin = 8 + (int)(4.0 * xobjs.pagelist[areawin->page].wirewidth
+		* areawin->vscale);
+
+   threads = qMin(threads, tiles.size());
+   tiles_pool()->setMaxThreadCount(threads - 1);
+   for (i = 1; i < threads; i++)
+      tiles_pool()->start(new TileJob(tiles.data(), tiles.size(), &next,
+		ratio, margin));
+   drawtiles(tiles.data(), tiles.size(), &next, ratio, margin);
+   tiles_pool()->waitForDone();
+
+   for (i = 0; i < tiles.size(); i++)
+      p->drawImage(tiles[i].origin, tiles[i].image);
+}
@@ -35,8 +35,8 @@
 struct arcinfo {
    float angle1;
    float angle2;
-   short radius;
-   short yaxis;
+   int radius;
+   int yaxis;
    XPoint position;
 };
 
@@ -117,10 +117,10 @@ bool setwindow(XCWindowData *trywindow)
 /*   each element, so the original element ordering can be recovered.	*/
 /*----------------------------------------------------------------------*/
 
-uselection::uselection(objinstptr topinst, short *slist, int n) :
+uselection::uselection(objinstptr topinst, int *slist, int n) :
         number(n),
         element(n > 0 ? new genericptr[n] : NULL),
-        idx(n > 0 ? new short[n] : NULL)
+        idx(n > 0 ? new int[n] : NULL)
 {
     if (n > 0) {
         for (int i = 0; i < number; ++i) {
@@ -142,32 +142,34 @@ uselection::~uselection()
 /* record.								*/
 /*----------------------------------------------------------------------*/
 
-short * uselection::regen(objinstptr thisinst)
+int * uselection::regen(objinstptr thisinst)
 {
    int j, k;
    objectptr thisobj = thisinst->thisobject;
    bool reorder = false;
-   short *slist = NULL;
+   int *slist = NULL;
+   QHash<genericptr, int> where;
 
    if (number > 0)
-      slist = (short *)malloc(number * sizeof(short));
+      slist = (int *)malloc(number * sizeof(int));
 
    k = 0;
    for (int i = 0; i < number; i++) {
       /* Use the element address, not the selection order. */
       genericptr egen = element[i];
-      if (egen == thisobj->at(idx[i])) {
+      if ((idx[i] < thisobj->parts) && (egen == thisobj->at(idx[i]))) {
          // this is a short-circuit, we use idx[] as a cache of indices into
          // the object's plist
          j = idx[i];
       }
       else {
-         // the short-circuit has failed, we search for the element
+         // the short-circuit has failed, we look up the element in a
+         // table of the object's elements, made the first time it is needed
          reorder = true;
-         for (j = 0; j < thisobj->parts; j++) {
-            if (egen == thisobj->at(j))
-	       break;
-	 }
+         if (where.isEmpty())
+            for (j = thisobj->parts - 1; j >= 0; j--)
+               where.insert(thisobj->at(j), j);
+         j = where.value(egen, thisobj->parts);
       }
       if (j < thisobj->parts) {
          slist[k] = j;
@@ -295,7 +297,7 @@ int select_previous(Undoptr thisrecord)
 /* function restore the original ordering of parts that were deleted.	*/
 /*----------------------------------------------------------------------*/
 
-short *recover_selectlist(Undoptr thisrecord)
+int *recover_selectlist(Undoptr thisrecord)
 {
    Undoptr chkrecord;
    uselection *srec;
@@ -360,7 +362,7 @@ void register_for_undo(u_int type, u_char mode, objinstptr thisinst, ...)
 {
    va_list args;
    int drawmode, nval, oval, *idata, snum, deltax, deltay, dir, i;
-   short *slist;
+   int *slist;
    objectptr delobj;
    objinstptr newinst;
    Undoptr newrecord;
@@ -377,6 +379,9 @@ void register_for_undo(u_int type, u_char mode, objinstptr thisinst, ...)
    /* This action invalidates everything in the "redo" stack, so flush it */
    flush_redo_stack();
 
+   /* Something is being changed (in color, perhaps) */
+   lod_invalidate();
+
    /* Create the new record and push it onto the stack */
    newrecord = new Undostack;
    newrecord->next = xobjs.undostack;
@@ -451,9 +456,9 @@ void register_for_undo(u_int type, u_char mode, objinstptr thisinst, ...)
       case XCF_Select:
       case XCF_Library_Pop:
 	 /* 2 args:							*/
-	 /*	slist = current selection list (short *)		*/
+	 /*	slist = current selection list (int *)			*/
 	 /*	snum  = number of selections (int)			*/
-	 slist = va_arg(args, short *);
+	 slist = va_arg(args, int *);
 	 snum = va_arg(args, int);
          srec = new uselection(thisinst, slist, snum);
 	 newrecord->undodata = (char *)srec;
@@ -596,7 +601,7 @@ short undo_one_action()
    uselection *srec;
    editelement *erec;
    scaleinfo *escale;
-   short *slist;
+   int *slist;
    XPoint *delta, position;
    int i, j, snum;
    int savemode;
@@ -962,6 +967,18 @@ void undo_finish_series()
          xobjs.undostack->idx = -xobjs.undostack->idx;
 }
 
+/*----------------------------------------------------------------------*/
+/* undo_netlist ---							*/
+/*	Edits played back from the undo or redo stack are not tracked	*/
+/*	by the netlist, which must be rebuilt.				*/
+/*----------------------------------------------------------------------*/
+
+static void undo_netlist(Undoptr thisrecord)
+{
+   if ((thisrecord != NULL) && (thisrecord->thisinst != NULL))
+      invalidate_netlist(thisrecord->thisinst->thisobject);
+}
+
 /*----------------------------------------------------------------------*/
 /* undo_action ---							*/
 /*	Play undo record back to the completion of a series.		*/
@@ -969,9 +986,15 @@ void undo_finish_series()
 
 void undo_action()
 {
+   layout_invalidate();
+   param_invalidate();
+   lod_invalidate();
+   undo_netlist(xobjs.undostack);
    short idx = undo_one_action();
-   while (xobjs.undostack && xobjs.undostack->idx == idx)
+   while (xobjs.undostack && xobjs.undostack->idx == idx) {
+      undo_netlist(xobjs.undostack);
       undo_one_action();
+   }
 }
 
 /*----------------------------------------------------------------------*/
@@ -984,7 +1007,7 @@ short redo_one_action()
    Undoptr thisrecord;
    objectptr thisobj;
    genericptr egen;
-   short *slist;
+   int *slist;
    XPoint *delta, position;
    uselection *srec;
    editelement *erec;
@@ -1305,9 +1328,15 @@ short redo_one_action()
 
 void redo_action()
 {
+   layout_invalidate();
+   param_invalidate();
+   lod_invalidate();
+   undo_netlist(xobjs.redostack);
    short idx = redo_one_action();
-   while (xobjs.redostack && xobjs.redostack->idx == idx)
+   while (xobjs.redostack && xobjs.redostack->idx == idx) {
+      undo_netlist(xobjs.redostack);
       redo_one_action();
+   }
 }
 
 /*----------------------------------------------------------------------*/
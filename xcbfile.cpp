@@ -0,0 +1,622 @@
+/*----------------------------------------------------------------------*/
+/* xcbfile.cpp --- binary document format (".xcb" files)		*/
+/*----------------------------------------------------------------------*/
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QSaveFile>
+#include <QSet>
+#include <QTemporaryFile>
+#include <QVector>
+#include <QtEndian>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "xcircuit.h"
+#include "colors.h"
+#include "prototypes.h"
+#include "libcache.h"
+#include "loadprogress.h"
+
+extern float version;
+extern bool load_in_progress;
+
+/*----------------------------------------------------------------------*/
+/* File format								*/
+/*									*/
+/* A header (magic number, format, program version, the table of names	*/
+/* and the colors of the session) is followed by records:  the images,	*/
+/* then the definitions of all objects used, bottom up, then the pages.	*/
+/* Objects and page contents are written by LibWriter, names being	*/
+/* written as an index into the table.  Images are kept as 32-bit	*/
+/* premultiplied ARGB words, little-endian, compressed if that makes	*/
+/* them smaller.  A background is kept as a copy of its PostScript	*/
+/* file.								*/
+/*----------------------------------------------------------------------*/
+
+#define XCB_MAGIC	0x58434244	/* "XCBD" */
+#define XCB_FORMAT	2		/* format 1 had 16-bit arc radii */
+
+enum {XCB_END = 0, XCB_IMAGE, XCB_OBJECT, XCB_PAGE};
+enum {IMAGE_RAW = 0, IMAGE_ZLIB};
+enum {LINK_NONE = 0, LINK_SYMBOL, LINK_PRIMARY};	/* page to schematic */
+
+static void setformat(QDataStream &stream)
+{
+   stream.setVersion(QDataStream::Qt_5_0);
+   stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+}
+
+/*----------------------------------------------------------------------*/
+/* Swap the pixels of an image between the file and the host order	*/
+/*----------------------------------------------------------------------*/
+
+static inline void swappixels(char *pixels, int size)
+{
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+   quint32 *pptr = (quint32 *)pixels;
+   int i;
+
+   for (i = 0; i < size / 4; i++, pptr++) *pptr = qbswap(*pptr);
+#else
+   Q_UNUSED(pixels);
+   Q_UNUSED(size);
+#endif
+}
+
+/*----------------------------------------------------------------------*/
+/* Write an image record for "img"					*/
+/*----------------------------------------------------------------------*/
+
+static void writeimage(QDataStream &out, StringTable &table, Imagedata *img)
+{
+   QImage image = img->image->convertToFormat(QImage::Format_ARGB32_Premultiplied);
+   QByteArray pixels((const char *)image.constBits(),
+		image.bytesPerLine() * image.height());
+   QByteArray packed;
+   const char *fptr = "";
+
+   /* Only the file name is kept, as written to PostScript */
+   if (img->filename != NULL) {
+      fptr = strrchr(img->filename, '/');
+      fptr = (fptr == NULL) ? img->filename : fptr + 1;
+   }
+
+   swappixels(pixels.data(), pixels.size());
+   packed = qCompress(pixels);
+
+   out << (quint8)XCB_IMAGE << table.index(fptr) << (qint32)image.width()
+	<< (qint32)image.height();
+   if (packed.size() < pixels.size()) {
+      out << (quint8)IMAGE_ZLIB << (qint32)packed.size();
+      out.writeRawData(packed.constData(), packed.size());
+   }
+   else {
+      out << (quint8)IMAGE_RAW << (qint32)pixels.size();
+      out.writeRawData(pixels.constData(), pixels.size());
+   }
+}
+
+/*----------------------------------------------------------------------*/
+/* Collect the objects used by "localdata" in "objects", each after	*/
+/* the objects it uses (see printobjects()).				*/
+/*----------------------------------------------------------------------*/
+
+static void collectobjects(objectptr localdata, QSet<objectptr> &seen,
+		QVector<objectptr> &objects)
+{
+   if (seen.contains(localdata)) return;
+   seen.insert(localdata);
+   libcache_materialize(localdata);
+
+   if (localdata->symschem && (localdata->schemtype == PRIMARY))
+      collectobjects(localdata->symschem, seen, objects);
+   for (objinstiter gptr; localdata->values(gptr); )
+      collectobjects(gptr->thisobject, seen, objects);
+
+   objects.append(localdata);
+}
+
+static void collectpageobjects(objectptr pageobj, QSet<objectptr> &seen,
+		QVector<objectptr> &objects)
+{
+   if (pageobj->symschem && (pageobj->schemtype == PRIMARY))
+      collectobjects(pageobj->symschem, seen, objects);
+   for (objinstiter gptr; pageobj->values(gptr); )
+      collectobjects(gptr->thisobject, seen, objects);
+}
+
+/*----------------------------------------------------------------------*/
+/* Write page "mpage":  its name, its link to a symbol or schematic,	*/
+/* its settings, its background and its contents.			*/
+/*----------------------------------------------------------------------*/
+
+static void writepage(QDataStream &out, LibWriter &writer, StringTable &table,
+		int mpage)
+{
+   Pagedata *curpage = &xobjs.pagelist[mpage];
+   objectptr pageobj = curpage->pageinst->thisobject;
+   quint8 link = LINK_NONE;
+   QString bgname = curpage->background.name;
+   QByteArray bgdata;
+   BBox *bbox = &curpage->background.bbox;
+
+   if (pageobj->symschem != NULL) {
+      if (is_page(pageobj->symschem) == -1)
+	 link = LINK_SYMBOL;
+      else if (pageobj->schemtype == SECONDARY)
+	 link = LINK_PRIMARY;
+   }
+
+   out << (quint8)XCB_PAGE << table.index(pageobj->name) << link;
+   if (link != LINK_NONE) out << table.index(pageobj->symschem->name);
+
+   out << (qint16)curpage->pmode << (qint16)curpage->orient
+	<< (qint16)curpage->coordstyle
+	<< (qint32)curpage->pagesize.x << (qint32)curpage->pagesize.y
+	<< (qint32)curpage->drawingscale.x << (qint32)curpage->drawingscale.y
+	<< (qint32)curpage->margins.x << (qint32)curpage->margins.y
+	<< curpage->outscale << curpage->gridspace << curpage->snapspace
+	<< curpage->wirewidth;
+
+   if (!bgname.isEmpty()) {
+      QFile bgfile((bgname[0] == '@') ? bgname.mid(1) : bgname);
+
+      if (bgfile.open(QIODevice::ReadOnly))
+	 bgdata = bgfile.readAll();
+      else
+	 Fprintf(stderr, "Error opening background file \"%s\" for reading.\n",
+		bgfile.fileName().toLocal8Bit().data());
+   }
+   out << (quint8)!bgdata.isEmpty();
+   if (!bgdata.isEmpty())
+      out << bgdata << (qint32)bbox->lowerleft.x << (qint32)bbox->lowerleft.y
+		<< (qint32)bbox->width << (qint32)bbox->height;
+
+   writer.writeobject(pageobj);
+}
+
+/*----------------------------------------------------------------------*/
+/* Save the current page and the pages associated with it in the	*/
+/* binary format, as savefile() would in PostScript.  The file is	*/
+/* replaced only once it has been written out in full.			*/
+/*----------------------------------------------------------------------*/
+
+void savexcb(short mode)
+{
+   QString fname = xobjs.pagelist[areawin->page].filename;
+   QByteArray body;
+   QDataStream out(&body, QIODevice::WriteOnly);
+   LibWriter writer(out);
+   StringTable table;
+   QHash<const XImage *, qint32> imageindex;
+   QVector<objectptr> objects;
+   QSet<objectptr> seen;
+   short *pagelist, *glist, page, multipage;
+   int i;
+
+   xc_tilde_expand(fname);
+   while (xc_variable_expand(fname)) ;
+
+   if (mode != NO_SUBCIRCUITS)
+      collectsubschems(areawin->page);
+
+   pagelist = pagetotals(areawin->page, (mode == NO_SUBCIRCUITS) ?
+		INDEPENDENT : TOTAL_PAGES);
+
+   multipage = 0;
+   for (page = 0; page < xobjs.pagelist.count(); page++)
+      if (pagelist[page] > 0)
+	 multipage++;
+
+   if (multipage == 0) {
+      Wprintf("Panic:  could not find this page in page list!");
+      free(pagelist);
+      return;
+   }
+
+   setformat(out);
+   writer.strings = &table;
+   writer.images = &imageindex;
+
+   /* Images used on any of the pages */
+
+   glist = collect_graphics(pagelist);
+   for (i = 0; i < xobjs.images; i++) {
+      if (glist[i] == 0) continue;
+      writeimage(out, table, xobjs.imagelist + i);
+      imageindex.insert(xobjs.imagelist[i].image, imageindex.size());
+   }
+   free(glist);
+
+   /* Object definitions, bottom up */
+
+   for (page = 0; page < xobjs.pagelist.count(); page++)
+      if (pagelist[page] > 0)
+	 collectpageobjects(xobjs.pagelist[page].pageinst->thisobject, seen,
+		objects);
+
+   foreach (objectptr thisobj, objects) {
+      out << (quint8)XCB_OBJECT << table.index(thisobj->name)
+	   << (qint32)((thisobj->symschem == NULL) ? -1 :
+		table.index(thisobj->symschem->name));
+      opsubstitute(thisobj, NULL);
+      writer.writeobject(thisobj);
+   }
+
+   for (page = 0; page < xobjs.pagelist.count(); page++)
+      if (pagelist[page] > 0)
+	 writepage(out, writer, table, page);
+
+   out << (quint8)XCB_END;
+
+   if (!writer.ok()) {
+      Wprintf("Cannot save %ls in binary form.", fname.utf16());
+      free(pagelist);
+      return;
+   }
+
+   QSaveFile file(fname);
+   if (!file.open(QIODevice::WriteOnly)) {
+      Wprintf("Can't open file %ls for writing.", fname.utf16());
+      free(pagelist);
+      return;
+   }
+   QDataStream header(&file);
+   setformat(header);
+   header << (quint32)XCB_MAGIC << (qint32)XCB_FORMAT << (float)PROG_VERSION
+	<< table.strings << colorlist;
+   header.writeRawData(body.constData(), body.size());
+   if ((header.status() != QDataStream::Ok) || !file.commit()) {
+      Wprintf("Error writing file %ls.", fname.utf16());
+      free(pagelist);
+      return;
+   }
+
+   /* No unsaved changes in these objects */
+   setassaved(objects.data(), objects.size());
+   for (page = 0; page < xobjs.pagelist.count(); page++)
+      if (pagelist[page] > 0)
+	 xobjs.pagelist[page].pageinst->thisobject->changes = 0;
+   xobjs.new_changes = countchanges(NULL);
+   free(pagelist);
+
+   Wprintf("File %ls saved (%d page%s).", fname.utf16(), multipage,
+		(multipage > 1 ? "s" : ""));
+
+   /* Write LATEX strings, if any are present */
+   TopDoLatex();
+}
+
+/*----------------------------------------------------------------------*/
+/* Look up an entry of the table of names (-1 for none)			*/
+/*----------------------------------------------------------------------*/
+
+static QByteArray readtablename(QDataStream &in, const QList<QByteArray> &strings)
+{
+   qint32 index;
+
+   in >> index;
+   if ((index >= 0) && (index < strings.size()))
+      return strings.at(index);
+   if (index != -1)
+      in.setStatus(QDataStream::ReadCorruptData);
+   return QByteArray();
+}
+
+/*----------------------------------------------------------------------*/
+/* Read an image record and add the image to the image list.  Raw	*/
+/* pixels are read straight from the file into the image.		*/
+/*----------------------------------------------------------------------*/
+
+static bool readimage(QDataStream &in, const QList<QByteArray> &strings,
+		QVector<int> &images)
+{
+   QByteArray name, packed, pixels;
+   Imagedata *iptr;
+   qint32 width, height, size;
+   quint8 encoding;
+   int isize;
+
+   name = readtablename(in, strings);
+   in >> width >> height >> encoding >> size;
+   if ((in.status() != QDataStream::Ok) || (width < 0) || (height < 0)
+		|| (size < 0))
+      return false;
+
+   iptr = addnewimage(name.data(), width, height);
+   images.append(xobjs.images - 1);
+   isize = iptr->image->bytesPerLine() * height;
+
+   if (encoding == IMAGE_RAW) {
+      if ((size != isize) || (in.readRawData((char *)iptr->image->bits(),
+		size) != size))
+	 return false;
+   }
+   else {
+      packed.resize(size);
+      if (in.readRawData(packed.data(), size) != size) return false;
+      pixels = qUncompress(packed);
+      if (pixels.size() != isize) return false;
+      memcpy(iptr->image->bits(), pixels.constData(), isize);
+   }
+   swappixels((char *)iptr->image->bits(), isize);
+   return true;
+}
+
+/*----------------------------------------------------------------------*/
+/* Read a page record into the current page (or, in library mode, read	*/
+/* and drop it).  A page to be linked to its primary schematic once	*/
+/* all pages have been read is added to "masters".			*/
+/*----------------------------------------------------------------------*/
+
+static bool readpage(QDataStream &in, LibReader &reader,
+		const QList<QByteArray> &strings, short mode,
+		QList<QPair<int, QByteArray> > &masters, LoadProgress &progress)
+{
+   Pagedata *curpage = &xobjs.pagelist[areawin->page];
+   QByteArray pagename, linkname, bgdata;
+   qint32 psx, psy, dsx, dsy, mgx, mgy, llx, lly, width, height;
+   qint16 pmode, orient, coordstyle;
+   float outscale, gridspace, snapspace, wirewidth;
+   quint8 link, hasbg;
+   bool result;
+
+   pagename = readtablename(in, strings);
+   in >> link;
+   if (link != LINK_NONE) linkname = readtablename(in, strings);
+   in >> pmode >> orient >> coordstyle >> psx >> psy >> dsx >> dsy
+	>> mgx >> mgy >> outscale >> gridspace >> snapspace >> wirewidth;
+   in >> hasbg;
+   if (hasbg) in >> bgdata >> llx >> lly >> width >> height;
+   if (in.status() != QDataStream::Ok) return false;
+
+   /* Library load mode:  ignore all pages, just load objects */
+   if (mode == 2) {
+      object scratch;
+      return reader.readobject(&scratch);
+   }
+
+   if (mode == 0) {
+      progress.holdpage();
+      topobject->clear();
+      pagereset(areawin->page);
+      flush_undo_stack();
+      result = reader.readobject(topobject);
+   }
+   else {
+      /* Import:  the elements are added to the page */
+      object scratch;
+      int i;
+
+      invalidate_netlist(topobject);
+      freenetlist(topobject);
+      flush_undo_stack();
+      result = reader.readobject(&scratch);
+      for (i = 0; i < scratch.parts; i++)
+	 topobject->append(scratch.at(i));
+      scratch.parts = 0;
+   }
+   topobject->valid = false;
+
+   curpage->pmode = pmode;
+   curpage->orient = orient;
+   curpage->pagesize.x = psx;
+   curpage->pagesize.y = psy;
+   curpage->drawingscale.x = dsx;
+   curpage->drawingscale.y = dsy;
+   curpage->margins.x = mgx;
+   curpage->margins.y = mgy;
+   curpage->gridspace = gridspace;
+   curpage->snapspace = snapspace;
+   curpage->wirewidth = wirewidth;
+   setgridtype((char *)((coordstyle == CM) ? "cmscale" : "inchscale"));
+   curpage->coordstyle = coordstyle;
+   curpage->outscale = outscale;
+
+   if (link == LINK_SYMBOL)
+      checkschem(topobject, linkname.data());
+   else if (link == LINK_PRIMARY)
+      masters.append(qMakePair((int)areawin->page, linkname));
+
+   if (hasbg) {
+      /* "@" denotes a temporary file */
+      QTemporaryFile bgfile(xobjs.tempdir + "/XXXXXX");
+
+      bgfile.setAutoRemove(false);
+      if (bgfile.open() && (bgfile.write(bgdata) == bgdata.size())) {
+	 bgfile.close();
+	 register_bg("@" + bgfile.fileName());
+	 curpage->background.bbox.lowerleft.x = llx;
+	 curpage->background.bbox.lowerleft.y = lly;
+	 curpage->background.bbox.width = width;
+	 curpage->background.bbox.height = height;
+      }
+      else
+	 Fprintf(stderr, "Error generating temporary filename\n");
+   }
+
+   if (mode == 0) {
+      sprintf(topobject->name, "%.79s", pagename.constData());
+      renamepage(areawin->page);
+   }
+   return result;
+}
+
+/*----------------------------------------------------------------------*/
+/* Load a binary file, with the same meaning of "mode" and "libnum" as	*/
+/* loadfile().  The file is mapped into memory and read in place.	*/
+/*----------------------------------------------------------------------*/
+
+bool loadxcb(short mode, int libnum, const QString &inname)
+{
+   QFile file(inname);
+   QByteArray data, name;
+   QList<QByteArray> strings;
+   QVector<QRgb> colors;
+   QVector<int> images;
+   QList<QPair<int, QByteArray> > masters;
+   int loclibnum = (libnum == -1) ? USERLIB : libnum;
+   int pages = 0;
+   quint32 magic;
+   qint32 format;
+   float fileversion;
+   quint8 rec;
+   uchar *map;
+   objlistptr redef;
+   objectptr *newobject;
+   bool ok = true;
+
+   if (!file.open(QIODevice::ReadOnly)) {
+      Wprintf("Can't open file %ls", inname.utf16());
+      return false;
+   }
+   map = file.map(0, file.size());
+   if (map != NULL)
+      data = QByteArray::fromRawData((const char *)map, file.size());
+   else
+      data = file.readAll();
+
+   QDataStream in(data);
+   setformat(in);
+   in >> magic >> format >> fileversion;
+   if ((in.status() != QDataStream::Ok) || (magic != XCB_MAGIC)
+		|| (format < 1) || (format > XCB_FORMAT)) {
+      Wprintf("File %ls is not in a known binary format", inname.utf16());
+      return false;
+   }
+   in >> strings >> colors;
+   foreach (QRgb color, colors)
+      addnewcolorentry(color);
+
+   LoadProgress progress(mode, inname, file.size());
+
+   LibReader objreader(in, loclibnum);
+   objreader.strings = &strings;
+   objreader.images = &images;
+   objreader.narrowarcs = (format == 1);
+
+   LibReader pagereader(in, LIBRARY);
+   pagereader.strings = &strings;
+   pagereader.images = &images;
+   pagereader.narrowarcs = (format == 1);
+
+   load_in_progress = true;
+   while (ok) {
+      if (progress.step(in.device()->pos())) break;
+      in >> rec;
+      if ((rec == XCB_END) || (in.status() != QDataStream::Ok)) break;
+
+      if (rec == XCB_IMAGE)
+	 ok = readimage(in, strings, images);
+
+      else if (rec == XCB_OBJECT) {
+	 QByteArray schemname;
+
+	 name = readtablename(in, strings);
+	 schemname = readtablename(in, strings);
+	 if (name.isNull()) break;
+
+	 newobject = new_library_object(loclibnum, name.data(), &redef, NULL);
+	 ok = objreader.readobject(*newobject);
+	 (*newobject)->valid = false;
+	 if (library_object_unique(loclibnum, *newobject, redef)) {
+	    add_object_to_library(loclibnum, *newobject);
+	    if (!schemname.isNull()) checksym(*newobject, schemname.data());
+	 }
+      }
+
+      else if (rec == XCB_PAGE) {
+	 /* go to new page if necessary */
+	 if ((pages > 0) && (mode != 2)) {
+	    while (areawin->page < xobjs.pages &&
+			xobjs.pagelist[areawin->page].pageinst != NULL)
+	       areawin->page++;
+	    changepage(areawin->page);
+	 }
+	 ok = readpage(in, pagereader, strings, mode, masters, progress);
+	 if (mode != 2) {
+	    if (mode == 0) xobjs.pagelist[areawin->page].filename = inname;
+	    calcbbox(areawin->topinstance);
+	    centerview(areawin->topinstance);
+	 }
+	 pages++;
+	 if (progress.pagedone()) break;
+      }
+      else break;
+   }
+   load_in_progress = false;
+
+   if (progress.cancelled()) {
+      Wprintf("Load of %ls cancelled.", inname.utf16());
+      return false;
+   }
+   if (!ok || (in.status() != QDataStream::Ok) || (rec != XCB_END)) {
+      Wprintf("File %ls is damaged; load undone.", inname.utf16());
+      progress.fail();
+      return false;
+   }
+
+   if (map != NULL) file.unmap(map);
+   cleanupaliases(USERLIB);
+
+   /* Connect master->slave schematics */
+   for (int i = 0; i < masters.size(); i++) {
+      objectptr master = NameToPageObject(masters[i].second.data(), NULL, NULL);
+      objectptr slave = xobjs.pagelist[masters[i].first].pageinst->thisobject;
+
+      if (master) {
+	 slave->symschem = master;
+	 slave->schemtype = SECONDARY;
+      }
+      else
+	 Fprintf(stderr, "Error:  Cannot find primary schematic for %s\n",
+		slave->name);
+   }
+
+   Wprintf("Loaded file: %ls (%d page%s)", inname.utf16(), pages,
+	(pages > 1 ? "s" : ""));
+
+   composelib(loclibnum);
+   centerview(xobjs.libtop[loclibnum]);
+   composelib(PAGELIB);
+
+   if (fileversion > PROG_VERSION + VEPS) {
+      Wprintf("WARNING: file %ls is version %2.1f vs. executable version %2.1f",
+		inname.utf16(), fileversion, PROG_VERSION);
+   }
+   version = PROG_VERSION;
+   return true;
+}
+
+/*----------------------------------------------------------------------*/
+/* Convert a file between PostScript and the binary format, the format	*/
+/* of each being taken from its name ("-convert <in> <out>").		*/
+/*----------------------------------------------------------------------*/
+
+bool convertfile(const QString &inname, const QString &outname)
+{
+   QString loaded;
+   int page;
+
+   if (!loadfile(0, -1, inname)) {
+      Fprintf(stderr, "Cannot read %s\n", inname.toLocal8Bit().data());
+      return false;
+   }
+
+   /* The pages read are saved together under the new name */
+   loaded = xobjs.pagelist[areawin->page].filename;
+   for (page = 0; page < xobjs.pagelist.count(); page++)
+      if ((xobjs.pagelist[page].pageinst != NULL)
+		&& (xobjs.pagelist[page].filename == loaded))
+	 xobjs.pagelist[page].filename = outname;
+
+   savefile(CURRENT_PAGE);
+   return true;
+}
@@ -53,6 +53,7 @@
 #endif
 
 #include "xcircuit.h"
+#include "area.h"
 #include "matrix.h"
 #include "cursors.h"
 #include "prototypes.h"
@@ -122,6 +123,7 @@ void quit(QAction* a, void*, void*)
    /* filename.							*/
 
    if (xobjs.tempfile != NULL) {
+      autosave_wait();
       if (a != NULL) {
          if (!QFile::remove(xobjs.tempfile))
             Fprintf(stderr, "Error deleting file \"%s\"\n", xobjs.tempfile.toLocal8Bit().data());
@@ -528,6 +530,7 @@ XCWindowData::XCWindowData()
 {
     toolbar_on = true;
     viewport = NULL;
+    area = NULL;
     mapped = false;
     psfont = 0;
     justify = FLIPINV;
@@ -555,6 +558,10 @@ XCWindowData::XCWindowData()
     stack = NULL;   /* at the top of the hierarchy */
     pinpointon = false;
     pinattach = false;
+    lodhide = 2;
+    lodbox = 5;
+    lodthumb = 16;
+    lodtext = 4;
     buschar = '(';	/* Vector notation for buses */
     defaultcursor = &CROSS;
     event_mode = NORMAL_MODE;
@@ -964,7 +971,17 @@ QAction* menuAction(const char *m) {
     return a;
 }
 
+/// Schedules a repaint after the drawing has changed in some unknown way;
+/// the retained page rendering is discarded.
 void XCWindowData::update()
+{
+    if (area) area->invalidate();
+    updateOverlay();
+}
+
+/// Schedules a repaint where only the selection or pending (not yet
+/// placed) elements have changed; the retained page rendering is reused.
+void XCWindowData::updateOverlay()
 {
     if (! updates) viewport->update();
     updates ++;
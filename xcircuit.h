@@ -30,8 +30,9 @@ typedef unsigned long	u_long;
 #endif
 
 #define SetThinLineAttributes	XSetLineAttributes
+#define LineWidth(c)	((c) >= 1.55 ? (int)((c) + 0.45) : 0)
 #define SetLineAttributes(b, c, d, e, f) \
-         XSetLineAttributes(b, ((c) >= 1.55 ? (int)(c + 0.45) : 0), d, e, f)
+         XSetLineAttributes(b, LineWidth(c), d, e, f)
 #define flusharea()	
 
 #define Fprintf fprintf
@@ -78,6 +79,7 @@ typedef struct {
 #define MINAUTOSCALE 0.75F /* Won't automatically scale closer than this */
 #define MAXCHANGES 20 /* Number of changes to induce a temp file save	*/
 #define PADSPACE   10 /* Spacing of pinlabels from their origins	*/
+#define MAXCOORD 0x3fffffff /* Largest user coordinate, of either sign	*/
 
 #define TBBORDER   1  /* border around toolbar buttons */
 
@@ -309,12 +311,12 @@ enum paramwhich {
 
 class uselection {
 public:
-    short number;
+    int number;
     genericptr * const element;
-    short * const idx;
-    uselection(objinstptr, short*, int);
+    int * const idx;
+    uselection(objinstptr, int*, int);
     ~uselection();
-    short* regen(objinstptr);
+    int* regen(objinstptr);
 };
 NO_FREE(uselection *);
 
@@ -360,7 +362,7 @@ enum UNDO_MODES {UNDO_DONE = 0, UNDO_MORE, MODE_CONNECT, MODE_RECURSE_WIDE,
 class selection {
 public:
     int selects;
-    short *selectlist;
+    int *selectlist;
     objinst *thisinst;
     selection *next;
     inline selection() : selectlist(NULL) {}
@@ -400,6 +402,9 @@ typedef struct {
 
 struct object;
 typedef object *objectptr;
+class SpatialIndex;
+class GlyphPath;
+class LazyBody;
 
 typedef struct _Polylist *PolylistPtr;
 typedef struct _Polylist
@@ -494,6 +499,19 @@ typedef struct {
    objinstptr	thisinst;
 } Highlight;
 
+/*----------------------------------------------------------------------*/
+/* The parameter values last substituted into the elements of an	*/
+/* object (see opsubstitute())						*/
+/*----------------------------------------------------------------------*/
+
+typedef struct {
+   objinstptr	inst;		/* instance substituted, or NULL */
+   int		generation;	/* parameter generation, or -1 if none */
+   u_int	objstamp;	/* stamp of the object's parameter list */
+   u_int	inststamp;	/* stamp of the instance's parameter list */
+   int		retval;		/* result of the substitution */
+} Substitution;
+
 /*----------------------------------------------------------------------*/
 /* Main object structure						*/
 /*----------------------------------------------------------------------*/
@@ -507,7 +525,8 @@ public:
    XPoint	pcorner;	/* position relative to window */
    BBox		bbox;		/* bounding box information (excluding */
                                 /* parameterized elements) */
-   oparamptr	params;		/* list of parameters, with default values */
+   ParamList	params;		/* list of parameters, with default values */
+   Substitution	subst;		/* values currently in the elements */
 
    Highlight	highlight;	/* net to be highlighted on redraw */
    u_char	schemtype;
@@ -520,12 +539,16 @@ public:
    CalllistPtr  calls;		/* Netlist subcircuits and connections */
    NetnamePtr   netnames;	/* Local names for flattening */
                                 /* (this probably shouldn't be here. . .) */
+   SpatialIndex *spatial;	/* element lookup by position (may be NULL) */
+   GlyphPath    *glyph;	/* flattened font character (may be NULL) */
+   LazyBody     *lazy;	/* elements not yet read from the library */
+				/* cache (may be NULL) */
    object();
    ~object();
    void clear();
    void clear_nodelete();
    bool operator==(const object &) const;
-   short find(object* other) const;
+   int find(object* other) const;
 protected:
    void set_defaults();
 };
@@ -828,12 +851,16 @@ struct XCWindowData {
    bool	pinpointon;
    bool	pinattach;	/* keep wires attached to pins when moving objinsts */
    bool	toolbar_on;
+   short	lodhide;	/* level of detail thresholds, in pixels */
+   short	lodbox;		/* (see lod.cpp) */
+   short	lodthumb;
+   short	lodtext;
 
    /* buffers and associated variables */
    XPoint	save, origin;
-   short	selects;
-   short	*selectlist;
-   short	attachto;
+   int		selects;
+   int		*selectlist;
+   int		attachto;
    short	lastlibrary;
    short	textpos;
    short	textend;
@@ -846,6 +873,7 @@ struct XCWindowData {
 
    XCWindowData();
    void update();
+   void updateOverlay();
    void markUpdated();
 private:
    int updates;
@@ -995,25 +1023,25 @@ extern Globaldata xobjs;
 
 /* conversions from a selection to a specific type */
 
-static inline genericptr * SELTOGENERICPTR(short* a) {
+static inline genericptr * SELTOGENERICPTR(int* a) {
     return  topobject->begin() + *a;
 }
 
-static inline genericptr * SELTOGENERICPTR(short a) {
+static inline genericptr * SELTOGENERICPTR(int a) {
     return  topobject->begin() + a;
 }
 
-static inline polyptr SELTOPOLY(short* a) { return TOPOLY(SELTOGENERICPTR(a)); }
-static inline labelptr SELTOLABEL(short* a) { return TOLABEL(SELTOGENERICPTR(a)); }
-static inline objinstptr SELTOOBJINST(short* a) { return TOOBJINST(SELTOGENERICPTR(a)); }
-static inline arcptr SELTOARC(short* a) { return TOARC(SELTOGENERICPTR(a)); }
-static inline splineptr SELTOSPLINE(short* a) { return TOSPLINE(SELTOGENERICPTR(a)); }
-static inline pathptr SELTOPATH(short* a) { return TOPATH(SELTOGENERICPTR(a)); }
-static inline graphicptr SELTOGRAPHIC(short* a) { return TOGRAPHIC(SELTOGENERICPTR(a)); }
-static inline genericptr SELTOGENERIC(short* a) { return TOGENERIC(SELTOGENERICPTR(a)); }
-
-static inline u_short SELECTTYPE(short* a) { return SELTOGENERIC(a)->type & ALL_TYPES; }
-static inline int SELTOCOLOR(short* a) { return SELTOGENERIC(a)->color; }
+static inline polyptr SELTOPOLY(int* a) { return TOPOLY(SELTOGENERICPTR(a)); }
+static inline labelptr SELTOLABEL(int* a) { return TOLABEL(SELTOGENERICPTR(a)); }
+static inline objinstptr SELTOOBJINST(int* a) { return TOOBJINST(SELTOGENERICPTR(a)); }
+static inline arcptr SELTOARC(int* a) { return TOARC(SELTOGENERICPTR(a)); }
+static inline splineptr SELTOSPLINE(int* a) { return TOSPLINE(SELTOGENERICPTR(a)); }
+static inline pathptr SELTOPATH(int* a) { return TOPATH(SELTOGENERICPTR(a)); }
+static inline graphicptr SELTOGRAPHIC(int* a) { return TOGRAPHIC(SELTOGENERICPTR(a)); }
+static inline genericptr SELTOGENERIC(int* a) { return TOGENERIC(SELTOGENERICPTR(a)); }
+
+static inline u_short SELECTTYPE(int* a) { return SELTOGENERIC(a)->type & ALL_TYPES; }
+static inline int SELTOCOLOR(int* a) { return SELTOGENERIC(a)->color; }
 
 QAction* menuAction(const char *m);
 
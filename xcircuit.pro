@@ -93,7 +93,19 @@ SOURCES = \
     object.cpp \
     context.cpp \
     positionable.cpp \
-    matrix.cpp
+    matrix.cpp \
+    spatial.cpp \
+    glyph.cpp \
+    layout.cpp \
+    netindex.cpp \
+    autosave.cpp \
+    nameindex.cpp \
+    libcache.cpp \
+    xcbfile.cpp \
+    loadprogress.cpp \
+    pool.cpp \
+    lod.cpp \
+    tiles.cpp
 
 HEADERS = \
     colors.h \
@@ -109,7 +121,15 @@ HEADERS = \
     area.h \
     elements.h \
     context.h \
-    matrix.h
+    matrix.h \
+    spatial.h \
+    glyph.h \
+    layout.h \
+    netindex.h \
+    autosave.h \
+    nameindex.h \
+    libcache.h \
+    loadprogress.h
 
 OTHER_FILES += \
     lib/xcircps2.pro
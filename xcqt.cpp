@@ -14,6 +14,7 @@
 #include <QStack>
 #include <QStyle>
 #include <QByteArray>
+#include <QVarLengthArray>
 #include <QMap>
 #include <QMapIterator>
 #include <QLineEdit>
@@ -39,7 +40,8 @@ QWidget *overlay = NULL;
 
 enum { STIPPLES = 8 }; /* Number of predefined stipple patterns		*/
 
-static QPixmap * STIPPLE[STIPPLES*2];  /* Polygon fill-style stipple patterns, first transparent then opaque */
+static QImage STIPPLE[STIPPLES*2];  /* Polygon fill-style stipple patterns, first transparent then opaque */
+				/* (images, as any drawing thread may fill with them) */
 
 static uint8_t STIPDATA[STIPPLES][5] = {
    "\000\004\000\001",
@@ -458,7 +460,11 @@ void xcRemoveTimeout(XtIntervalId tid)
 void XSetLineAttributes(QPainter* gc, unsigned int w, Qt::PenStyle style, Qt::PenCapStyle cap, Qt::PenJoinStyle join)
 {
     Q_ASSERT(gc);
-    QPen p(gc->pen());
+    const QPen & cur = gc->pen();
+    if (cur.width() == (int)w && cur.style() == style &&
+            cur.capStyle() == cap && cur.joinStyle() == join)
+        return;
+    QPen p(cur);
     p.setCapStyle(cap);
     p.setJoinStyle(join);
     p.setStyle(style);
@@ -475,9 +481,9 @@ void DrawArc(QPainter* gc, int x, int y, unsigned int w, unsigned int h, int a1,
 void FillPolygon(QPainter* gc, XPoint *points, int npoints)
 {
     Q_ASSERT(gc);
-    QPoint * qpoints = new QPoint[npoints];
-    std::copy(points, points+npoints, qpoints);
-    gc->drawPolygon(qpoints, npoints);
+    QVarLengthArray<QPoint, 256> qpoints(npoints);
+    std::copy(points, points+npoints, qpoints.data());
+    gc->drawPolygon(qpoints.data(), npoints);
 }
 
 void XClearArea(Window win, int x, int y, unsigned width, unsigned height, bool exposures)
@@ -491,8 +497,10 @@ void XClearArea(Window win, int x, int y, unsigned width, unsigned height, bool
 void SetForeground(QPainter* gc, unsigned long foreground)
 {
     Q_ASSERT(gc);
+    QColor color((QRgb)foreground);
+    if (gc->pen().color() == color) return;
     QPen p(gc->pen());
-    p.setColor(QColor((QRgb)foreground));
+    p.setColor(color);
     gc->setPen(p);
 }
 
@@ -514,7 +522,7 @@ void SetStipple(QPainter* gc, int stipple_index, bool opaque)
 {
     Q_ASSERT(gc);
     Q_ASSERT(stipple_index >= 0 && stipple_index < STIPPLES);
-    QBrush b(*STIPPLE[stipple_index + (opaque ? STIPPLES : 0)]);
+    QBrush b(STIPPLE[stipple_index + (opaque ? STIPPLES : 0)]);
     gc->setBrush(b);
 }
 
@@ -951,12 +959,14 @@ XCWindowData *GUI_init(int *argc, char *argv[])
 
    for (int i = 0; i < STIPPLES; i++) {
       QPixmap *transp = CreateBitmapFromData(STIPDATA[i], 4, 4);
-      QPixmap *opaque = new QPixmap(transp->size());
-      QPainter p(opaque);
-      p.fillRect(opaque->rect(), Qt::white);
+      QPixmap opaque(transp->size());
+      QPainter p(&opaque);
+      p.fillRect(opaque.rect(), Qt::white);
       p.drawPixmap(0,0,*transp);
-      STIPPLE[i] = transp;
-      STIPPLE[i+STIPPLES] = opaque;
+      p.end();
+      STIPPLE[i] = transp->toImage();
+      STIPPLE[i+STIPPLES] = opaque.toImage();
+      delete transp;
   }
 
    setupAppData();
@@ -1067,6 +1077,7 @@ int main(int argc, char **argv)
 {
    char  *argv0;		/* find root of argv[0] */
    short k = 0;
+   int i;
 
    /*-----------------------------------------------------------*/
    /* Find the root of the command called from the command line */
@@ -1113,6 +1124,93 @@ int main(int argc, char **argv)
    composelib(PAGELIB);	/* make sure we have a valid page list */
    composelib(LIBLIB);	/* and library directory */
 
+   /*-----------------------------------------------------------*/
+   /* "-prewarm <directory>" fills the library cache for the	*/
+   /* fonts and libraries in the directory, and exits.		*/
+   /*-----------------------------------------------------------*/
+
+   for (i = 1; i < argc - 1; i++) {
+      if (!strcmp(argv[i], "-prewarm")) {
+         libcache_prewarm(QString::fromLocal8Bit(argv[i + 1]));
+         return 0;
+      }
+   }
+
+   /*-----------------------------------------------------------*/
+   /* "-benchdraw <file>" times drawing the file zoomed out, 	*/
+   /* with and without the level-of-detail rules, and exits.	*/
+   /*-----------------------------------------------------------*/
+
+   for (i = 1; i < argc - 1; i++) {
+      if (!strcmp(argv[i], "-benchdraw"))
+         return lod_benchmark(QString::fromLocal8Bit(argv[i + 1]));
+   }
+
+   /*-----------------------------------------------------------*/
+   /* "-benchparts <count>" times building and indexing an	*/
+   /* object of that many elements, and selecting, deleting	*/
+   /* and undeleting all of it at that size and a tenth of it,	*/
+   /* checks it, and exits.					*/
+   /*-----------------------------------------------------------*/
+
+   for (i = 1; i < argc - 1; i++) {
+      if (!strcmp(argv[i], "-benchparts"))
+         return spatial_benchmark(QByteArray(argv[i + 1]).toInt());
+   }
+
+   /*-----------------------------------------------------------*/
+   /* "-checkdraw <file>" checks that the file is drawn the	*/
+   /* same while thumbnails are being made, and with outlines	*/
+   /* stroked in batches or singly, and exits.			*/
+   /*-----------------------------------------------------------*/
+
+   for (i = 1; i < argc - 1; i++) {
+      if (!strcmp(argv[i], "-checkdraw"))
+         return lod_check(QString::fromLocal8Bit(argv[i + 1]));
+   }
+
+   /*-----------------------------------------------------------*/
+   /* "-checknets <file>" checks the netlist of the file as	*/
+   /* edited in place against full rebuilds, and exits.		*/
+   /*-----------------------------------------------------------*/
+
+   for (i = 1; i < argc - 1; i++) {
+      if (!strcmp(argv[i], "-checknets"))
+         return netlist_check(QString::fromLocal8Bit(argv[i + 1]));
+   }
+
+   /*-----------------------------------------------------------*/
+   /* "-checknetjobs <file>" checks that the netlists of the	*/
+   /* file built with jobs on the thread pool are the same as	*/
+   /* built serially, and exits.				*/
+   /*-----------------------------------------------------------*/
+
+   for (i = 1; i < argc - 1; i++) {
+      if (!strcmp(argv[i], "-checknetjobs"))
+         return netlist_jobcheck(QString::fromLocal8Bit(argv[i + 1]));
+   }
+
+   /*-----------------------------------------------------------*/
+   /* "-benchnets <file>" times building the netlist of each	*/
+   /* schematic page of the file, and exits.			*/
+   /*-----------------------------------------------------------*/
+
+   for (i = 1; i < argc - 1; i++) {
+      if (!strcmp(argv[i], "-benchnets"))
+         return netlist_benchmark(QString::fromLocal8Bit(argv[i + 1]));
+   }
+
+   /*-----------------------------------------------------------*/
+   /* "-convert <in> <out>" converts a file between PostScript	*/
+   /* and the binary (".xcb") format, and exits.		*/
+   /*-----------------------------------------------------------*/
+
+   for (i = 1; i < argc - 2; i++) {
+      if (!strcmp(argv[i], "-convert"))
+         return convertfile(QString::fromLocal8Bit(argv[i + 1]),
+		QString::fromLocal8Bit(argv[i + 2])) ? 0 : 1;
+   }
+
    /*----------------------------------------------------*/
    /* Parse the command line for initial file to load.   */
    /* Otherwise, look for possible crash-recovery files. */
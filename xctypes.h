@@ -101,9 +101,9 @@ NO_FREE(XfPoint*);
 struct XlPoint;
 class XPoint {
 public:
-    short x, y;
+    int x, y;
     inline XPoint() {}
-    inline XPoint(short _x, short _y) : x(_x), y(_y) {}
+    inline XPoint(int _x, int _y) : x(_x), y(_y) {}
     inline XPoint(const QPoint & p) : x(p.x()), y(p.y()) {}
     inline XPoint(const XfPoint & p) : x(round(p.x)), y(round(p.y)) {}
     inline operator QPoint() const { return QPoint(x, y); }
@@ -155,7 +155,7 @@ inline XPoint & XPoint::operator=(const QPoint & other) { x = other.x(); y = oth
 class BBox {
 public:
    XPoint	lowerleft;
-   Dimension	width, height;
+   int		width, height;
 };
 NO_FREE(BBox*);
 
@@ -156,7 +156,7 @@ void setjust(QAction* w, void* value_, labelptr settext, short mode)
 
 void setvjust(QAction* w, void* value, void*)
 {
-   short *fselect;
+   int *fselect;
    labelptr settext;
    short labelcount = 0;
 
@@ -185,7 +185,7 @@ void setvjust(QAction* w, void* value, void*)
 
 void sethjust(QAction* w, void* value, void*)
 {
-   short *fselect;
+   int *fselect;
    labelptr settext;
    short labelcount = 0;
 
@@ -214,7 +214,7 @@ void sethjust(QAction* w, void* value, void*)
 
 void setjustbit(QAction* w, void* value_, void*)
 {
-   short *fselect;
+   int *fselect;
    labelptr settext;
    short labelcount = 0;
    int value = (intptr_t)value_;
@@ -244,7 +244,7 @@ void setjustbit(QAction* w, void* value_, void*)
 
 void setpinjustbit(QAction* w, void* value_, void*)
 {
-   short *fselect;
+   int *fselect;
    labelptr settext;
    int value = (intptr_t)value_;
 
@@ -605,7 +605,7 @@ void getosize(QAction* a, void*, void*)
 {
    char buffer[50];
    float flval;
-   short *osel = areawin->selectlist;
+   int *osel = areawin->selectlist;
    short selects = 0;
    objinstptr setobj = NULL;
 
@@ -645,7 +645,7 @@ void getwirewidth(QAction* a, void*, void*)
 void getwwidth(QAction* a, void*, void*)
 {
    char buffer[50];
-   short *osel = areawin->selectlist;
+   int *osel = areawin->selectlist;
    genericptr setel;
    float flval;
 
@@ -1139,6 +1139,9 @@ int createlibrary(bool force)
    xobjs.userlibs[libnum - LIBRARY].number = 0;
    xobjs.userlibs[libnum - LIBRARY].instlist = NULL;
 
+   /* libraries after the new one have been renumbered */
+   names_invalidate();
+
    /* To-do:  initialize technology list */
    /*
    xobjs.userlibs[libnum - LIBRARY].filename = NULL;
@@ -1302,7 +1305,7 @@ void setcolor(QAction* a, void* value_, void*)
     int cindex = colorMenu->actions().indexOf(a)-3;
 
     unsigned int value = (uintptr_t)value_;
-    short *scolor;
+    int *scolor;
     int cval;
     bool selected = false;
     stringpart *strptr, *nextptr;